@@ -0,0 +1,94 @@
+/*
+ * RosettaPad - CRC32 Microbenchmark
+ * ==================================
+ *
+ * Compares the CRC32 implementations on DualSense-sized BT reports
+ * (1 header byte + 74 report bytes) and on a larger buffer.
+ *
+ * Run with: make bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/crc32.h"
+
+#define BENCH_ITERATIONS    2000000
+#define BENCH_LARGE_SIZE    4096
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Per-call cost in ns; the CRC feeds the next call so nothing is hoisted */
+static double bench_impl(crc32_impl_t impl, const uint8_t* data, size_t len, int iterations) {
+    volatile uint32_t sink = 0;
+    uint32_t crc = 0;
+    
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        crc = crc32_update_with(impl, crc, data, len);
+    }
+    uint64_t end = now_ns();
+    
+    sink = crc;
+    (void)sink;
+    return (double)(end - start) / iterations;
+}
+
+int main(void) {
+    crc32_init();
+    
+    /* Known answer: CRC32("123456789") = 0xCBF43926 */
+    const uint8_t check[] = "123456789";
+    int failed = 0;
+    for (int impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+        if (!crc32_impl_available(impl)) continue;
+        uint32_t crc = crc32_update_with(impl, 0, check, 9);
+        if (crc != 0xCBF43926u) {
+            printf("FAIL %s: 0x%08X\n", crc32_impl_name(impl), crc);
+            failed = 1;
+        }
+    }
+    
+    /* All implementations must agree on every length and alignment */
+    uint8_t data[BENCH_LARGE_SIZE + 8];
+    srand(1);
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = rand() & 0xFF;
+    
+    for (size_t off = 0; off < 8; off++) {
+        for (size_t len = 0; len <= 200; len++) {
+            uint32_t ref = crc32_update_with(CRC32_IMPL_BYTEWISE, 0, data + off, len);
+            for (int impl = 1; impl < CRC32_IMPL_COUNT; impl++) {
+                if (!crc32_impl_available(impl)) continue;
+                if (crc32_update_with(impl, 0, data + off, len) != ref) {
+                    printf("FAIL %s: len=%zu off=%zu\n", crc32_impl_name(impl), len, off);
+                    failed = 1;
+                }
+            }
+        }
+    }
+    
+    if (failed) return 1;
+    
+    printf("%-10s %14s %14s %12s\n", "impl", "75B (ns)", "4KiB (ns)", "MB/s");
+    for (int impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+        if (!crc32_impl_available(impl)) {
+            printf("%-10s %14s %14s %12s\n", crc32_impl_name(impl), "n/a", "n/a", "n/a");
+            continue;
+        }
+        
+        double small = bench_impl(impl, data, 75, BENCH_ITERATIONS);
+        double large = bench_impl(impl, data, BENCH_LARGE_SIZE, BENCH_ITERATIONS / 50);
+        printf("%-10s %14.1f %14.1f %12.1f%s\n",
+               crc32_impl_name(impl), small, large,
+               BENCH_LARGE_SIZE / large * 1000.0,
+               impl == (int)crc32_active_impl() ? "  (active)" : "");
+    }
+    
+    return 0;
+}
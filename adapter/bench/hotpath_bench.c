@@ -0,0 +1,501 @@
+/*
+ * RosettaPad - Translation Hot Path Microbenchmark
+ * =================================================
+ *
+ * Times every stage between a DualSense report and a DS3 report, without
+ * hardware: the DualSense driver runs on an offline device and is fed
+ * synthetic BT 0x31 reports (valid CRC, moving sticks, gyro and touch).
+ *
+ * Single-threaded rows report ns/op as the median (and best) of
+ * BENCH_RUNS runs. Contention rows run the same state latch with the
+ * thread set the adapter actually has:
+ *
+ *   input    process_input + motion + remap + controller_state_update
+ *   usb      eventfd wakeup -> ds3_frame_acquire
+ *   bt       ds3_frame_acquire every 1.25 ms (800 Hz motion)
+ *   output   the real controller_output_thread, with ep2 output
+ *            reports parsed at 100 Hz
+ *
+ * Output is a fixed-width table; compare two builds with diff.
+ *
+ * Run with: make bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "core/common.h"
+#include "core/crc32.h"
+#include "core/remap.h"
+#include "core/motion.h"
+#include "controllers/dualsense/dualsense.h"
+#include "console/ps3/ds3_emulation.h"
+
+#define BENCH_RUNS          5
+#define BENCH_ITERATIONS    200000
+#define BENCH_FRAMES        64      /* Distinct synthetic reports, cycled */
+#define BENCH_READERS       3       /* Spinning readers in the contention row */
+#define PIPELINE_PERIOD_NS  1000000ULL  /* Paced input rate for latency (1 kHz) */
+#define PIPELINE_SAMPLES    2000
+#define BENCH_OUTPUT_REPORT_SIZE 48  /* DS3 ep2 output report */
+
+/* common.c calls into the PS3 BT layer on standby transitions */
+void ps3_bt_disconnect(void) {}
+int ps3_bt_wake(void) { return -1; }
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(ns / 1000000000ULL),
+        .tv_nsec = (long)(ns % 1000000000ULL),
+    };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Rows are collected and printed together, clear of driver log lines */
+#define BENCH_MAX_ROWS 16
+
+static struct {
+    char name[48];
+    double median;
+    double best;
+} g_rows[BENCH_MAX_ROWS];
+static int g_row_count = 0;
+
+static void add_row(const char* name, double median, double best) {
+    if (g_row_count >= BENCH_MAX_ROWS) return;
+    snprintf(g_rows[g_row_count].name, sizeof(g_rows[0].name), "%s", name);
+    g_rows[g_row_count].median = median;
+    g_rows[g_row_count].best = best;
+    g_row_count++;
+}
+
+static void print_table(void) {
+    printf("\nTranslation hot path (%d runs x %d ops)\n\n", BENCH_RUNS, BENCH_ITERATIONS);
+    printf("%-40s %12s %12s\n", "benchmark", "median ns", "best ns");
+    printf("%-40s %12s %12s\n", "----------------------------------------",
+           "------------", "------------");
+    for (int i = 0; i < g_row_count; i++) {
+        printf("%-40s %12.1f %12.1f\n", g_rows[i].name, g_rows[i].median, g_rows[i].best);
+    }
+    printf("\n");
+}
+
+/* ============================================================================
+ * INPUTS
+ * ============================================================================ */
+
+static uint8_t g_frames[BENCH_FRAMES][DS_BT_INPUT_SIZE];
+static controller_device_t g_dev;
+static volatile uint32_t g_sink;
+
+static void put16(uint8_t* p, int v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void build_frames(void) {
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        uint8_t* f = g_frames[i];
+        memset(f, 0, DS_BT_INPUT_SIZE);
+
+        f[DS_OFF_REPORT_ID] = DS_BT_REPORT_ID;
+        f[DS_OFF_COUNTER] = (uint8_t)(i << 4);
+        f[DS_OFF_LX] = (uint8_t)(128 + (i * 7) % 100 - 50);
+        f[DS_OFF_LY] = (uint8_t)(128 - (i * 5) % 90 + 45);
+        f[DS_OFF_RX] = (uint8_t)(128 + (i * 3) % 60 - 30);
+        f[DS_OFF_RY] = 128;
+        f[DS_OFF_L2] = (uint8_t)(i * 4);
+        f[DS_OFF_BUTTONS1] = (uint8_t)((i & 0x10) | 0x08);  /* D-pad centered */
+        f[DS_OFF_BUTTONS2] = (uint8_t)(i & 0x03);
+        put16(&f[DS_OFF_GYRO_X], (i * 37) % 400 - 200);
+        put16(&f[DS_OFF_GYRO_Y], (i * 11) % 300 - 150);
+        put16(&f[DS_OFF_GYRO_Z], (i * 13) % 200 - 100);
+        put16(&f[DS_OFF_ACCEL_X], (i * 17) % 500 - 250);
+        put16(&f[DS_OFF_ACCEL_Y], 8192 + (i * 19) % 300);
+        put16(&f[DS_OFF_ACCEL_Z], (i * 23) % 400 - 200);
+
+        /* First finger on the touchpad for half the frames */
+        uint8_t* t = &f[DS_OFF_TOUCHPAD];
+        t[0] = (i & 0x20) ? 0x01 : DS_TOUCH_INACTIVE;
+        t[1] = (uint8_t)(i * 20);
+        t[2] = 0x23;
+        t[3] = 0x10;
+        t[4] = DS_TOUCH_INACTIVE;
+        f[DS_OFF_BATTERY] = 0x18;
+
+        /* BT CRC covers the implicit 0xA1 HIDP header */
+        uint8_t header = 0xA1;
+        uint32_t crc = crc32_update(0, &header, 1);
+        crc = crc32_update(crc, f, DS_BT_INPUT_SIZE - 4);
+        f[74] = (uint8_t)crc;
+        f[75] = (uint8_t)(crc >> 8);
+        f[76] = (uint8_t)(crc >> 16);
+        f[77] = (uint8_t)(crc >> 24);
+    }
+}
+
+/* Plausible DualSense calibration (typical gains, small biases) */
+static void build_calibration(ds_calibration_t* calib) {
+    memset(calib, 0, sizeof(*calib));
+    for (int i = 0; i < 3; i++) {
+        calib->gyro[i].bias = (int16_t)(3 - i);
+        calib->gyro[i].sens_numer = 2 * 540 * DS_GYRO_RES_PER_DEG_S;
+        calib->gyro[i].sens_denom = 2 * 8800;
+        calib->accel[i].bias = (int16_t)(i * 10);
+        calib->accel[i].sens_numer = 2 * DS_ACC_RES_PER_G;
+        calib->accel[i].sens_denom = 16300;
+    }
+    calib->valid = 1;
+}
+
+/* ============================================================================
+ * SINGLE-THREADED STAGES
+ * ============================================================================ */
+
+typedef double (*bench_fn)(int iterations);
+
+static void run_bench(const char* name, bench_fn fn) {
+    double runs[BENCH_RUNS];
+
+    fn(BENCH_ITERATIONS / 10);  /* Warm caches and branch predictors */
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        runs[r] = fn(BENCH_ITERATIONS);
+    }
+    qsort(runs, BENCH_RUNS, sizeof(runs[0]), cmp_double);
+    add_row(name, runs[BENCH_RUNS / 2], runs[0]);
+}
+
+static double bench_process_input(int iterations) {
+    controller_state_t state;
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        g_dev.driver->process_input(&g_dev, g_frames[i % BENCH_FRAMES], DS_BT_INPUT_SIZE, &state);
+        g_sink += state.buttons;
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+static double bench_remap(int iterations) {
+    controller_state_t states[BENCH_FRAMES];
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        g_dev.driver->process_input(&g_dev, g_frames[i], DS_BT_INPUT_SIZE, &states[i]);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        controller_state_t s = states[i % BENCH_FRAMES];
+        remap_apply(0, &s);
+        g_sink += s.buttons;
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+static double bench_motion(int iterations) {
+    controller_state_t states[BENCH_FRAMES];
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        g_dev.driver->process_input(&g_dev, g_frames[i], DS_BT_INPUT_SIZE, &states[i]);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        controller_state_t* s = &states[i % BENCH_FRAMES];
+        motion_apply(0, s);
+        g_sink += s->motion_out[3];
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+static controller_state_t g_states[BENCH_FRAMES];
+
+static double bench_build_report(int iterations) {
+    uint8_t report[DS3_INPUT_REPORT_SIZE] = {0};
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        g_sink += (uint32_t)ds3_build_input_report(&g_states[i % BENCH_FRAMES], report);
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+static double bench_frame_acquire_cached(int iterations) {
+    controller_state_update(&g_states[0]);
+    ds3_frame_release(ds3_frame_acquire());
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        const ds3_frame_t* frame = ds3_frame_acquire();
+        g_sink += frame->seq;
+        ds3_frame_release(frame);
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+static double bench_parse_output(int iterations) {
+    /* Rumble on/off, alternating */
+    uint8_t reports[2][BENCH_OUTPUT_REPORT_SIZE];
+    memset(reports, 0, sizeof(reports));
+    reports[0][0] = reports[1][0] = 0x01;
+    reports[0][3] = 1;
+    reports[0][5] = 0xC0;
+    reports[0][10] = reports[1][10] = 0x02;   /* LED change would log */
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        ds3_parse_output_report(0, reports[i & 1], BENCH_OUTPUT_REPORT_SIZE);
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+static double bench_crc32(int iterations) {
+    uint8_t buf[DS_BT_INPUT_SIZE];
+    memcpy(buf, g_frames[0], sizeof(buf));
+
+    uint32_t crc = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        buf[1] = (uint8_t)crc;     /* Chain so nothing is hoisted */
+        crc = dualsense_calc_crc32(buf, DS_BT_INPUT_SIZE - 3);
+    }
+    g_sink += crc;
+    return (double)(now_ns() - start) / iterations;
+}
+
+static double bench_state_roundtrip(int iterations) {
+    controller_state_t out;
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        controller_state_update(&g_states[i % BENCH_FRAMES]);
+        controller_state_copy(&out);
+        g_sink += out.generation;
+    }
+    return (double)(now_ns() - start) / iterations;
+}
+
+/* ============================================================================
+ * CONTENDED STATE LATCH
+ * ============================================================================ */
+
+static volatile int g_readers_run;
+
+static void* spin_reader(void* arg) {
+    (void)arg;
+    controller_state_t s;
+    while (g_readers_run) {
+        controller_state_copy(&s);
+        g_sink += s.generation;
+    }
+    return NULL;
+}
+
+static void run_contended_roundtrip(void) {
+    char name[64];
+    pthread_t readers[BENCH_READERS];
+
+    g_readers_run = 1;
+    for (int i = 0; i < BENCH_READERS; i++) {
+        pthread_create(&readers[i], NULL, spin_reader, NULL);
+    }
+
+    snprintf(name, sizeof(name), "state update+copy (%d spinning readers)", BENCH_READERS);
+    run_bench(name, bench_state_roundtrip);
+
+    g_readers_run = 0;
+    for (int i = 0; i < BENCH_READERS; i++) {
+        pthread_join(readers[i], NULL);
+    }
+}
+
+/* ============================================================================
+ * REAL THREAD SET
+ * ============================================================================ */
+
+static volatile int g_pipeline_run;
+static uint64_t g_latency[PIPELINE_SAMPLES];
+static volatile int g_latency_count;
+
+/* USB ep1 path: woken by the state eventfd, like the AIO loop */
+static void* usb_thread(void* arg) {
+    int fd = *(int*)arg;
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+
+    while (g_pipeline_run) {
+        if (poll(&pfd, 1, 50) <= 0) continue;
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) < 0) continue;
+
+        const ds3_frame_t* frame = ds3_frame_acquire();
+        uint64_t input_ns = frame->input_ns;
+        ds3_frame_release(frame);
+
+        int n = g_latency_count;
+        if (input_ns && n < PIPELINE_SAMPLES) {
+            g_latency[n] = now_ns() - input_ns;
+            g_latency_count = n + 1;
+        }
+    }
+    return NULL;
+}
+
+/* BT motion path: fixed 800 Hz */
+static void* bt_thread(void* arg) {
+    (void)arg;
+    uint64_t next = now_ns();
+
+    while (g_pipeline_run) {
+        next += 1250000ULL;
+        sleep_until(next);
+        const ds3_frame_t* frame = ds3_frame_acquire();
+        g_sink += frame->seq;
+        ds3_frame_release(frame);
+    }
+    return NULL;
+}
+
+/* ep2 path: PS3 rumble/LED writes at 100 Hz */
+static void* ep2_thread(void* arg) {
+    (void)arg;
+    uint8_t report[BENCH_OUTPUT_REPORT_SIZE] = {0x01};
+    uint64_t next = now_ns();
+    int i = 0;
+
+    while (g_pipeline_run) {
+        next += 10000000ULL;
+        sleep_until(next);
+        report[5] = (uint8_t)(i++ & 0xFF);
+        ds3_parse_output_report(0, report, sizeof(report));
+    }
+    return NULL;
+}
+
+/* Input path as in controller_handle_report() */
+static double pipeline_input(int iterations, uint64_t period_ns) {
+    controller_state_t state;
+    uint64_t next = now_ns();
+    uint64_t busy = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        if (period_ns) {
+            next += period_ns;
+            sleep_until(next);
+        }
+        uint64_t t0 = now_ns();
+        g_dev.driver->process_input(&g_dev, g_frames[i % BENCH_FRAMES], DS_BT_INPUT_SIZE, &state);
+        state.timestamp_ns = t0;
+        motion_apply(0, &state);
+        remap_apply(0, &state);
+        controller_state_update(&state);
+        busy += now_ns() - t0;
+    }
+    return (double)busy / iterations;
+}
+
+static void run_pipeline(void) {
+    pthread_t usb_tid, bt_tid, ep2_tid, out_tid;
+    int state_fd = controller_state_subscribe();
+    if (state_fd < 0) {
+        printf("FAIL: controller_state_subscribe\n");
+        return;
+    }
+
+    g_pipeline_run = 1;
+    pthread_create(&usb_tid, NULL, usb_thread, &state_fd);
+    pthread_create(&bt_tid, NULL, bt_thread, NULL);
+    pthread_create(&ep2_tid, NULL, ep2_thread, NULL);
+    pthread_create(&out_tid, NULL, controller_output_thread, NULL);
+
+    /* Free-running input: cost per frame with every consumer awake */
+    double runs[BENCH_RUNS];
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        runs[r] = pipeline_input(BENCH_ITERATIONS / 4, 0);
+    }
+    qsort(runs, BENCH_RUNS, sizeof(runs[0]), cmp_double);
+    add_row("pipeline input stage (4 threads)", runs[BENCH_RUNS / 2], runs[0]);
+
+    /* Paced input: state update -> USB report built, per frame */
+    g_latency_count = 0;
+    pipeline_input(PIPELINE_SAMPLES, PIPELINE_PERIOD_NS);
+    usleep(10000);
+
+    int n = g_latency_count;
+    if (n > 0) {
+        qsort(g_latency, (size_t)n, sizeof(g_latency[0]), cmp_u64);
+        add_row("pipeline input->usb report p50 (1 kHz)", (double)g_latency[n / 2],
+                  (double)g_latency[0]);
+        add_row("pipeline input->usb report p99 (1 kHz)", (double)g_latency[n * 99 / 100],
+                  (double)g_latency[0]);
+    }
+
+    g_pipeline_run = 0;
+    g_running = 0;     /* Stops controller_output_thread */
+    controller_output_wake();
+    pthread_join(usb_tid, NULL);
+    pthread_join(bt_tid, NULL);
+    pthread_join(ep2_tid, NULL);
+    pthread_join(out_tid, NULL);
+    controller_state_unsubscribe(state_fd);
+    close(state_fd);
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+int main(void) {
+    crc32_init();
+    motion_init();
+    ds3_init();
+    remap_init();
+    build_frames();
+
+    ds_calibration_t calib;
+    build_calibration(&calib);
+    if (dualsense_attach_offline(&g_dev, &calib) < 0) {
+        printf("FAIL: dualsense_attach_offline\n");
+        return 1;
+    }
+
+    /* Sanity: every synthetic frame must parse (CRC included) */
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        if (g_dev.driver->process_input(&g_dev, g_frames[i], DS_BT_INPUT_SIZE,
+                                        &g_states[i]) != 0) {
+            printf("FAIL: frame %d rejected by process_input\n", i);
+            return 1;
+        }
+        motion_apply(0, &g_states[i]);
+    }
+
+    run_bench("dualsense_process_input (BT 0x31)", bench_process_input);
+    run_bench("motion_apply (calibrated, DS3)", bench_motion);
+    run_bench("remap_apply (default profile)", bench_remap);
+    run_bench("ds3_build_input_report (new state)", bench_build_report);
+    run_bench("ds3_frame_acquire (unchanged state)", bench_frame_acquire_cached);
+    run_bench("ds3_parse_output_report", bench_parse_output);
+    run_bench("dualsense_calc_crc32 (75 bytes)", bench_crc32);
+    run_bench("state update+copy (uncontended)", bench_state_roundtrip);
+    run_contended_roundtrip();
+    run_pipeline();
+
+    g_dev.driver->on_disconnect(&g_dev);
+    print_table();
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * RosettaPad - Loopback Console Sink
+ * ===================================
+ *
+ * Output half of the hardware-free loopback test (--loopback). Stands in
+ * for the FunctionFS ep1 path on the input event loop: woken by the same
+ * state eventfd, it builds the DS3 report exactly like the USB layer and
+ * timestamps it instead of queueing it for the PS3.
+ *
+ * Each report's sequence number (see loopback_pad.h) is matched to its
+ * emit time, giving the end-to-end latency from uhid write to DS3 report,
+ * plus dropped inputs (never reached a report) and duplicates (the same
+ * input reported twice).
+ */
+
+#ifndef ROSETTAPAD_LOOPBACK_SINK_H
+#define ROSETTAPAD_LOOPBACK_SINK_H
+
+#include <stdint.h>
+
+#include "core/event_loop.h"
+
+/* Latency samples kept per measurement window */
+#define LOOPBACK_MAX_SAMPLES 65536
+
+typedef struct {
+    uint32_t sent;              /* Reports emitted by the virtual pad */
+    uint32_t received;          /* Distinct inputs that reached a DS3 report */
+    uint32_t dropped;           /* sent - received */
+    uint32_t duplicated;        /* DS3 reports repeating an input already seen */
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+} loopback_result_t;
+
+/**
+ * Subscribe to slot 0 state on the input thread's loop.
+ * @return 0 on success, -1 on failure
+ */
+int loopback_sink_attach(event_loop_t* loop);
+
+/**
+ * Unsubscribe (from the loop's thread).
+ */
+void loopback_sink_detach(void);
+
+/**
+ * Start a measurement window. Thread-safe.
+ */
+void loopback_sink_begin(void);
+
+/**
+ * Close the window and compute its results. Thread-safe.
+ * @param sent Reports the pad emitted during the window
+ */
+void loopback_sink_end(uint32_t sent, loopback_result_t* out);
+
+#endif /* ROSETTAPAD_LOOPBACK_SINK_H */
@@ -14,6 +14,8 @@
 #include <stdint.h>
 #include <bluetooth/bluetooth.h>
 
+#include "core/event_loop.h"
+
 /* ============================================================================
  * CONFIGURATION
  * ============================================================================ */
@@ -31,6 +33,23 @@
 #define DS3_BT_INPUT_REPORT_SIZE    50
 #define DS3_BT_OUTPUT_REPORT_SIZE   49
 
+/* Input report scheduling */
+#define PS3_BT_DEFAULT_RATE_HZ  100     /* Steady-state report rate */
+#define PS3_BT_MIN_RATE_HZ      25      /* Floor when backing off */
+#define PS3_BT_MAX_RATE_HZ      250
+#define PS3_BT_MIN_GAP_US       4000    /* Min spacing for change-triggered sends */
+#define PS3_BT_RECOVER_SENDS    50      /* Clean sends before raising rate again */
+
+/* Connection state machine (runs on the reactor) */
+#define PS3_BT_TICK_MS              50      /* State machine check interval */
+#define PS3_BT_CONNECT_DELAY_MS     250     /* USB gone this long -> connect over BT */
+#define PS3_BT_CONNECT_TIMEOUT_MS   6000    /* Both channels up within this */
+#define PS3_BT_USB_STABLE_MS        100     /* USB back this long -> drop BT */
+#define PS3_BT_RETRY_MIN_MS         250     /* First retry after a failed connect */
+#define PS3_BT_RETRY_MAX_MS         8000    /* Backoff doubles up to this */
+#define PS3_BT_WAKE_ATTEMPTS        5       /* Connects tried for one wake */
+#define PS3_BT_WAKE_HOLD_MS         100     /* PS button press length */
+
 /* PS3 MAC file path */
 #define PS3_MAC_FILE    "/tmp/rosettapad/ps3_mac"
 
@@ -69,6 +88,12 @@ typedef struct {
     uint32_t packets_sent;
     uint32_t packets_dropped;
     uint32_t reconnect_count;
+    
+    int input_rate_hz;      /* Current (possibly backed-off) report rate */
+    
+    int8_t rssi;            /* Last HCI Read_RSSI, dB from golden range */
+    uint8_t link_quality;   /* Last HCI Read_Link_Quality, 0-255 */
+    int link_grade;         /* bt_qos_grade_t */
 } ps3_bt_ctx_t;
 
 extern ps3_bt_ctx_t g_ps3_bt_ctx;
@@ -120,8 +145,11 @@ int ps3_bt_save_addr(void);
 int ps3_bt_load_addr(void);
 
 /**
- * Connect to PS3 via Bluetooth.
- * @return 0 on success, -1 on failure
+ * Start connecting to the PS3 without blocking: the HID control channel
+ * first, then the interrupt channel once control is up, both completing
+ * on the event loop (a scan is queued to the worker first if no address
+ * is known). Event loop thread only, after ps3_bt_attach().
+ * @return 0 if started, -1 if not disconnected or the connect failed
  */
 int ps3_bt_connect(void);
 
@@ -146,8 +174,10 @@ bt_state_t ps3_bt_get_state(void);
 const char* ps3_bt_state_str(bt_state_t state);
 
 /**
- * Attempt to wake PS3 from standby.
- * @return 0 on success, -1 on failure
+ * Attempt to wake PS3 from standby: connect (up to PS3_BT_WAKE_ATTEMPTS
+ * times), then press PS as soon as the link is up. Runs on the event
+ * loop - returns without waiting. Thread-safe.
+ * @return 0 if queued, -1 if Bluetooth is unavailable
  */
 int ps3_bt_wake(void);
 
@@ -158,20 +188,45 @@ int ps3_bt_wake(void);
  */
 int ps3_bt_get_local_addr(uint8_t* out_mac);
 
+/**
+ * Set the steady-state input report rate.
+ * Input changes are still sent immediately; the rate backs off
+ * automatically when the link is congested.
+ * @param hz Clamped to PS3_BT_MIN_RATE_HZ..PS3_BT_MAX_RATE_HZ
+ */
+void ps3_bt_set_input_rate(int hz);
+
 /* ============================================================================
- * THREAD FUNCTIONS
+ * EVENT LOOP
  * ============================================================================ */
 
 /**
- * Bluetooth management thread.
- * Handles scanning, connection, and control channel.
+ * Run Bluetooth on an event loop: the connection state machine (a
+ * PS3_BT_TICK_MS timer), the non-blocking connects and both sockets,
+ * the wake sequence, and input reports - sent immediately on input
+ * changes, otherwise at the scheduled rate from an absolute timerfd.
+ * Reports start once both channels are up; 0xF4 moves READY to
+ * ENABLED. Handlers run on the loop's thread. Call after ps3_bt_init().
+ * @return 0 on success, -1 on failure
+ */
+int ps3_bt_attach(event_loop_t* loop);
+
+/**
+ * Unregister everything from the loop. The link stays up - call
+ * ps3_bt_disconnect() afterwards to close it.
+ */
+void ps3_bt_detach(void);
+
+/**
+ * Scan worker thread. Runs the inquiry for the PS3 (which blocks for
+ * seconds) when a connect has no address yet, so the event loop never
+ * waits on the radio.
  */
 void* ps3_bt_thread(void* arg);
 
 /**
- * Motion data sending thread.
- * Sends input reports when Bluetooth is enabled.
+ * Wake the worker so it sees g_running == 0 and exits.
  */
-void* ps3_bt_motion_thread(void* arg);
+void ps3_bt_worker_stop(void);
 
 #endif /* ROSETTAPAD_PS3_BT_HID_H */
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * RosettaPad - PS3 Bluetooth Link QoS
+ * ====================================
+ *
+ * Keeps the HID interrupt channel to the PS3 low latency:
+ *
+ * - Socket: top priority, small send buffer, force-active power mode,
+ *   and reports marked flushable, so the controller discards anything
+ *   older than BT_QOS_FLUSH_TIMEOUT_MS instead of retransmitting it.
+ * - Link: sniff disabled by link policy (and left immediately if the
+ *   PS3 puts the link in sniff anyway), automatic flush timeout set.
+ * - Monitoring: RSSI and link quality read every BT_QOS_POLL_MS. HCI
+ *   commands are asynchronous - their completions arrive on the event
+ *   loop, nothing waits on the controller.
+ * - Latest state wins: a report is only sent once the previous one is
+ *   off the host queue (bt_qos_backlog()), so a congested link never
+ *   delivers a backlog of stale input.
+ *
+ * The link grade caps the BT send scheduler's rate (bt_qos_rate_cap()).
+ */
+
+#ifndef ROSETTAPAD_PS3_BT_QOS_H
+#define ROSETTAPAD_PS3_BT_QOS_H
+
+#include <stdint.h>
+
+#include "core/event_loop.h"
+
+/* ============================================================================
+ * CONFIGURATION
+ * ============================================================================ */
+
+#define BT_QOS_PRIORITY             6       /* SO_PRIORITY (HCI queue priority) */
+#define BT_QOS_SNDBUF               1024    /* Kernel raises this to its minimum */
+#define BT_QOS_FLUSH_TIMEOUT_MS     10      /* Controller drops reports older than this */
+#define BT_QOS_POLL_MS              1000    /* RSSI / link quality interval */
+
+/*
+ * HCI Read_RSSI is relative to the golden receive power range (0 = in
+ * range), link quality is 0-255. Below either threshold the rate cap
+ * applies.
+ */
+#define BT_QOS_POOR_RSSI            -8
+#define BT_QOS_BAD_RSSI             -16
+#define BT_QOS_POOR_QUALITY         200
+#define BT_QOS_BAD_QUALITY          128
+
+typedef enum {
+    BT_QOS_GRADE_GOOD = 0,
+    BT_QOS_GRADE_POOR,          /* Rate capped at half the configured maximum */
+    BT_QOS_GRADE_BAD            /* Rate capped at twice the minimum */
+} bt_qos_grade_t;
+
+/* ============================================================================
+ * FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * Apply the low-latency socket options to the interrupt channel.
+ * Call on the new socket before connect().
+ * @return 0 on success, -1 if an option was refused (logged, still usable)
+ */
+int bt_qos_configure_socket(int sock);
+
+/**
+ * Start managing a connected interrupt channel: disable sniff, set the
+ * flush timeout and poll RSSI / link quality from the event loop.
+ * Results land in g_ps3_bt_ctx (rssi, link_quality, link_grade).
+ * @return 0 on success, -1 without HCI access (sending still works)
+ */
+int bt_qos_attach(event_loop_t* loop, int sock);
+
+/**
+ * Stop monitoring (call before the socket is closed).
+ */
+void bt_qos_detach(void);
+
+/**
+ * Bytes of earlier reports still waiting on the host side of the socket.
+ * Anything above 0 means the next send would queue behind stale input.
+ */
+int bt_qos_backlog(int sock);
+
+/**
+ * Highest send rate the current link grade allows.
+ * @param max_hz The configured maximum
+ */
+int bt_qos_rate_cap(int max_hz);
+
+#endif /* ROSETTAPAD_PS3_BT_QOS_H */
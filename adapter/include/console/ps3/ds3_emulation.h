@@ -19,88 +19,38 @@
 #include <stddef.h>
 
 #include "controllers/controller_interface.h"
+#include "rosetta_core/ds3.h"
 
 /* ============================================================================
- * DS3 REPORT CONSTANTS
- * ============================================================================ */
-
-#define DS3_INPUT_REPORT_SIZE   49
-#define DS3_FEATURE_REPORT_SIZE 64
-
-/* Report IDs */
-#define DS3_REPORT_CAPABILITIES 0x01
-#define DS3_REPORT_BT_MAC       0xF2
-#define DS3_REPORT_PAIRING      0xF5
-#define DS3_REPORT_CALIBRATION  0xF7
-#define DS3_REPORT_STATUS       0xF8
-#define DS3_REPORT_EF           0xEF
-
-/* Battery status values */
-#define DS3_BATTERY_SHUTDOWN    0x00
-#define DS3_BATTERY_DYING       0x01
-#define DS3_BATTERY_LOW         0x02
-#define DS3_BATTERY_MEDIUM      0x03
-#define DS3_BATTERY_HIGH        0x04
-#define DS3_BATTERY_FULL        0x05
-#define DS3_BATTERY_CHARGING    0xEE
-#define DS3_BATTERY_CHARGED     0xEF
-
-/* Connection status values */
-#define DS3_STATUS_PLUGGED      0x02
-#define DS3_STATUS_UNPLUGGED    0x03
-#define DS3_CONN_USB            0x12
-#define DS3_CONN_USB_RUMBLE     0x10
-#define DS3_CONN_BT             0x16
-#define DS3_CONN_BT_RUMBLE      0x14
-
-/* ============================================================================
- * DS3 BUTTON MASKS
+ * DS3 FRAMES
+ * 
+ * The input report is built once per controller state generation into a
+ * shared frame that every sender transmits from as is: USB from usb[],
+ * BT from bt[], which already carries the HIDP header in its headroom
+ * and the BT status bytes. Frames are reference counted, so USB, BT and
+ * any other consumer can hold the same frame at once (e.g. both links
+ * during a handover) and a frame is only reused once nobody holds it.
  * ============================================================================ */
 
-/* Byte 2 */
-#define DS3_BTN_SELECT      0x01
-#define DS3_BTN_L3          0x02
-#define DS3_BTN_R3          0x04
-#define DS3_BTN_START       0x08
-#define DS3_BTN_DPAD_UP     0x10
-#define DS3_BTN_DPAD_RIGHT  0x20
-#define DS3_BTN_DPAD_DOWN   0x40
-#define DS3_BTN_DPAD_LEFT   0x80
-
-/* Byte 3 */
-#define DS3_BTN_L2          0x01
-#define DS3_BTN_R2          0x02
-#define DS3_BTN_L1          0x04
-#define DS3_BTN_R1          0x08
-#define DS3_BTN_TRIANGLE    0x10
-#define DS3_BTN_CIRCLE      0x20
-#define DS3_BTN_CROSS       0x40
-#define DS3_BTN_SQUARE      0x80
-
-/* Byte 4 */
-#define DS3_BTN_PS          0x01
-
-/* ============================================================================
- * DS3 REPORT OFFSETS
- * ============================================================================ */
+#define DS3_FRAME_HEADROOM      1       /* BT HIDP header in front of the payload */
+#define DS3_FRAME_BT_HEADER     0xA1    /* HIDP DATA | Input */
+#define DS3_FRAME_BT_SIZE       (DS3_FRAME_HEADROOM + DS3_INPUT_REPORT_SIZE)
 
-#define DS3_OFF_REPORT_ID     0
-#define DS3_OFF_BUTTONS1      2
-#define DS3_OFF_BUTTONS2      3
-#define DS3_OFF_PS_BUTTON     4
-#define DS3_OFF_LX            6
-#define DS3_OFF_LY            7
-#define DS3_OFF_RX            8
-#define DS3_OFF_RY            9
-#define DS3_OFF_L2_PRESSURE   18
-#define DS3_OFF_R2_PRESSURE   19
-#define DS3_OFF_BATTERY       29
-#define DS3_OFF_CHARGE        30
-#define DS3_OFF_CONNECTION    31
-#define DS3_OFF_ACCEL_X       40
-#define DS3_OFF_ACCEL_Y       42
-#define DS3_OFF_ACCEL_Z       44
-#define DS3_OFF_GYRO_Z        46
+/*
+ * Current + one being built + the USB IN queue and its pending report,
+ * with room for transient holders (BT send, loopback, recorders).
+ */
+#define DS3_FRAME_POOL          8
+
+typedef struct {
+    uint32_t seq;           /* Bumped only when the report bytes change */
+    uint32_t generation;    /* State generation the bytes were built from */
+    uint64_t input_ns;      /* That state's timestamp (0 = neutral) */
+    uint64_t built_ns;      /* When the translation started */
+    uint8_t usb[DS3_INPUT_REPORT_SIZE];
+    uint8_t bt[DS3_FRAME_BT_SIZE];
+    uint32_t refs;          /* Holders; owned by ds3_frame_acquire/release */
+} ds3_frame_t;
 
 /* ============================================================================
  * FUNCTIONS
@@ -135,19 +85,47 @@ const uint8_t* ds3_get_feature_report(uint8_t report_id, const char** out_name);
 void ds3_handle_set_report(uint8_t report_id, const uint8_t* data, size_t len);
 
 /**
- * Build DS3 input report from generic controller state.
- * This is the main translation function.
+ * Translate generic controller state into a DS3 input report.
+ * Senders use ds3_frame_acquire() instead, which translates each state
+ * generation once for all of them.
  * 
  * @param state Generic controller state from any controller
- * @param out_report Output buffer (49 bytes)
+ * @param out_report In/out buffer (49 bytes) - holds this caller's previous
+ *                   report, overwritten with the new one
+ * @return 1 if the report bytes changed, 0 if identical to out_report
  */
-void ds3_build_input_report(const controller_state_t* state, uint8_t* out_report);
+int ds3_build_input_report(const controller_state_t* state, uint8_t* out_report);
 
 /**
- * Copy current DS3 report (thread-safe).
- * @param out_buf 49-byte output buffer
+ * Pin the DS3 frame for the current controller state (any thread, never
+ * blocks on readers). The first caller after a state change translates
+ * it; everyone else gets the same frame. Release it once the bytes are no
+ * longer needed - an AIO write can hold it until completion.
+ * @return Pinned frame, never NULL
  */
-void ds3_copy_report(uint8_t* out_buf);
+const ds3_frame_t* ds3_frame_acquire(void);
+
+/**
+ * ds3_frame_acquire() plus the controller state the frame stands for,
+ * for senders that track what the console has seen. If the state keeps
+ * moving (or every frame is held), out_state may be one update older
+ * than the frame after a few tries.
+ * @param out_state Receives the state whose translation is the frame
+ * @return Pinned frame, never NULL
+ */
+const ds3_frame_t* ds3_frame_acquire_state(controller_state_t* out_state);
+
+/**
+ * Pin a frame the caller already holds once more (e.g. per queued transfer).
+ * @return frame
+ */
+const ds3_frame_t* ds3_frame_retain(const ds3_frame_t* frame);
+
+/**
+ * Unpin a frame from ds3_frame_acquire() or ds3_frame_retain(). NULL is
+ * ignored.
+ */
+void ds3_frame_release(const ds3_frame_t* frame);
 
 /**
  * Get PS3's Bluetooth MAC (captured from SET_REPORT 0xF5).
@@ -161,13 +139,22 @@ int ds3_get_ps3_mac(uint8_t* out_mac);
  */
 int ds3_has_ps3_mac(void);
 
+/**
+ * DualSense player LED pattern for a DS3 player number.
+ * 
+ * @param player Player number (1-4)
+ * @return 5-bit LED mask, 0 if out of range
+ */
+uint8_t ds3_player_led_mask(int player);
+
 /**
  * Parse DS3 output report (rumble/LED commands from PS3).
- * Updates the global controller output state.
+ * Updates the output state of the given controller slot.
  * 
+ * @param slot Controller slot the emulated DS3 belongs to
  * @param data Output report data
  * @param len Data length
  */
-void ds3_parse_output_report(const uint8_t* data, size_t len);
+void ds3_parse_output_report(int slot, const uint8_t* data, size_t len);
 
 #endif /* ROSETTAPAD_PS3_DS3_EMULATION_H */
\ No newline at end of file
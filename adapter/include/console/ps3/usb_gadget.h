@@ -11,6 +11,8 @@
 
 #include <stdint.h>
 
+#include "core/event_loop.h"
+
 /* ============================================================================
  * CONFIGURATION
  * ============================================================================ */
@@ -30,6 +32,19 @@
 #define EP_MAX_PACKET       64
 #define EP_INTERVAL         1       /* 1ms polling */
 
+/* Input report pacing */
+#define USB_INPUT_KEEPALIVE_MS  4   /* Repeat last report if no new input */
+
+/* Host-poll-synchronised IN timing (--usb-jit) */
+#define USB_JIT_LEAD_US         250     /* Build this long before the predicted poll */
+#define USB_JIT_MIN_LEAD_US     100
+#define USB_JIT_LEAD_STEP_US    50      /* Added after a missed poll */
+#define USB_JIT_MIN_PERIOD_US   500     /* Faster hosts: queue-on-change is within a poll already */
+
+/* AIO transfers kept queued per endpoint */
+#define USB_AIO_IN_DEPTH        2
+#define USB_AIO_OUT_DEPTH       2
+
 /* ============================================================================
  * GLOBAL STATE
  * ============================================================================ */
@@ -85,25 +100,55 @@ int ps3_usb_open_endpoint(int endpoint_num);
 void ps3_usb_cleanup(void);
 
 /* ============================================================================
- * THREAD FUNCTIONS
+ * CONTROL ENDPOINT
  * ============================================================================ */
 
 /**
- * USB control endpoint (ep0) handler thread.
- * Handles SETUP packets, feature reports, etc.
+ * Register ep0 on an event loop. Handles SETUP packets (feature reports,
+ * SET_REPORT) and ENABLE/DISABLE/SUSPEND/UNBIND on the loop's thread.
+ * Call after ps3_usb_write_descriptors().
+ * @return 0 on success, -1 on failure
  */
-void* ps3_usb_control_thread(void* arg);
+int ps3_usb_ep0_attach(event_loop_t* loop);
 
 /**
- * USB input endpoint (ep1) thread.
- * Sends DS3 input reports to PS3.
+ * Unregister ep0 (the fd stays open - main closes it).
+ */
+void ps3_usb_ep0_detach(void);
+
+/* ============================================================================
+ * ENDPOINT I/O
+ * ============================================================================ */
+
+/**
+ * Time ep1 reports to the host's polls instead of queuing them on input
+ * change. After each ENABLE the host's interrupt-IN cadence is measured
+ * from ep1 completion timestamps (POLL_SYNC_ACQUIRE_SAMPLES back-to-back
+ * polls); from then on a changed report is built from the latest state
+ * USB_JIT_LEAD_US before the next predicted poll. The lead grows after
+ * a missed poll and shrinks back slowly. Hosts polling faster than
+ * USB_JIT_MIN_PERIOD_US stay on queue-on-change. The phase error goes to
+ * the "usb_poll_phase" latency stage. Call before ps3_usb_io_attach().
+ */
+void ps3_usb_set_jit(int enabled);
+
+/**
+ * Open ep1/ep2 and register their AIO completions on an event loop.
+ * 
+ * ep1 (IN) gets a DS3 input report queued as soon as controller state
+ * changes, with a repeat every USB_INPUT_KEEPALIVE_MS while idle.
+ * ep2 (OUT) keeps reads posted and applies LED/rumble commands from the
+ * PS3 as they arrive. Handlers run on the loop's thread.
+ * 
+ * Call from the loop's thread, after ps3_usb_write_descriptors().
+ * @return 0 on success, -1 on failure
  */
-void* ps3_usb_input_thread(void* arg);
+int ps3_usb_io_attach(event_loop_t* loop);
 
 /**
- * USB output endpoint (ep2) thread.
- * Receives LED/rumble commands from PS3.
+ * Unregister from the event loop and cancel queued transfers.
+ * Call from the loop's thread. ep1/ep2 stay open.
  */
-void* ps3_usb_output_thread(void* arg);
+void ps3_usb_io_detach(void);
 
 #endif /* ROSETTAPAD_PS3_USB_GADGET_H */
\ No newline at end of file
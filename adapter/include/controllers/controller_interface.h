@@ -32,10 +32,13 @@
  * 
  * 1. controller_info_t - Static metadata about your controller
  * 2. init() / shutdown() - Lifecycle management
- * 3. find_device() - Locate the controller (hidraw, evdev, etc.)
- * 4. poll_input() - Read and parse input, populate controller_state_t
+ * 3. open_device() - Claim a device node (hidraw, evdev, etc.)
+ * 4. process_input() - Parse input, populate controller_state_t
  * 5. send_output() - Handle rumble, LEDs, etc.
  * 
+ * Several pads can be connected at once, one per slot (player). Keep all
+ * per-pad state in controller_device_t.priv - never in statics.
+ * 
  * See controllers/dualsense/ for a complete reference implementation.
  */
 
@@ -110,6 +113,9 @@
  * reports.
  * ============================================================================ */
 
+/* Console motion channels (DS3: accel X, Y, Z, gyro Z) */
+#define CONTROLLER_MOTION_OUT_AXES  4
+
 typedef struct {
     /* Button states - bitmask using BTN_* defines above */
     uint32_t buttons;
@@ -125,8 +131,8 @@ typedef struct {
     uint8_t right_trigger;
     
     /* Motion sensors (if CONTROLLER_CAP_MOTION) */
-    /* Raw sensor values - controller-specific scaling */
-    /* Console layer handles conversion to target format */
+    /* Raw sensor counts - the driver registers its calibration with
+     * the motion stage (core/motion.h), which does the conversion */
     int16_t accel_x;
     int16_t accel_y;
     int16_t accel_z;
@@ -134,6 +140,11 @@ typedef struct {
     int16_t gyro_y;
     int16_t gyro_z;
     
+    /* Console-native motion channels, filled by the motion stage from
+     * the values above - drivers leave both 0 */
+    uint16_t motion_out[CONTROLLER_MOTION_OUT_AXES];
+    uint8_t motion_valid;   /* 0 = console uses its at-rest values */
+    
     /* Touchpad (if CONTROLLER_CAP_TOUCHPAD) */
     struct {
         uint8_t active;     /* Is finger touching? */
@@ -149,6 +160,12 @@ typedef struct {
     /* Timestamp for input freshness */
     uint64_t timestamp_ms;
     
+    /* CLOCK_MONOTONIC time the raw report was read - set by the input thread */
+    uint64_t timestamp_ns;
+
+    /* Update counter - assigned by controller_state_update(), drivers leave 0 */
+    uint32_t generation;
+
 } controller_state_t;
 
 /* ============================================================================
@@ -196,6 +213,22 @@ typedef struct {
     
 } controller_info_t;
 
+/* ============================================================================
+ * CONTROLLER DEVICE
+ * 
+ * One connected pad. The framework owns the struct and fd; the driver
+ * owns priv, set up in open_device() and released in on_disconnect().
+ * ============================================================================ */
+
+struct controller_driver;
+
+typedef struct controller_device {
+    const struct controller_driver* driver;
+    int fd;                 /* Device fd, -1 if not open */
+    int slot;               /* Player slot, 0-based */
+    void* priv;             /* Driver per-device state */
+} controller_device_t;
+
 /* ============================================================================
  * CONTROLLER DRIVER INTERFACE
  * 
@@ -221,12 +254,15 @@ typedef struct controller_driver {
     void (*shutdown)(void);
     
     /**
-     * Find and open the controller device.
-     * Scan for the controller (hidraw, evdev, etc.) and open it.
+     * Open a device node whose VID/PID matched this driver.
+     * Called from the startup scan and on hotplug. Set dev->fd and
+     * dev->priv; dev->driver and dev->slot are already filled in.
      * 
-     * @return File descriptor on success, -1 if not found
+     * @param dev Device to set up
+     * @param path Device node, e.g. "/dev/hidraw3"
+     * @return 0 on success, -1 on failure (nothing left open)
      */
-    int (*find_device)(void);
+    int (*open_device)(controller_device_t* dev, const char* path);
     
     /**
      * Check if a given VID/PID matches this controller.
@@ -242,35 +278,50 @@ typedef struct controller_driver {
      * Process input data and populate controller state.
      * Called when data is available on the device fd.
      * 
+     * @param dev Device the report came from
      * @param buf Raw input report from device
      * @param len Length of input data
      * @param out_state Output: populated with current controller state
      * @return 0 on success, -1 on parse error
      */
-    int (*process_input)(const uint8_t* buf, size_t len, controller_state_t* out_state);
+    int (*process_input)(controller_device_t* dev, const uint8_t* buf, size_t len,
+                         controller_state_t* out_state);
+    
+    /**
+     * Optional: Minimal parse used while the system is in standby, where
+     * only the home button matters. Without it the framework runs
+     * process_input() and checks BTN_HOME.
+     * 
+     * @param dev Device the report came from
+     * @param buf Raw input report from device
+     * @param len Length of input data
+     * @return 1 if home is pressed, 0 if not, -1 on parse error
+     */
+    int (*process_standby_input)(controller_device_t* dev, const uint8_t* buf, size_t len);
     
     /**
      * Send output (rumble, LEDs) to the controller.
+     * Called from the output thread, concurrently with process_input().
      * 
-     * @param fd Device file descriptor
+     * @param dev Target device
      * @param output Output state to apply
      * @return 0 on success, -1 on error
      */
-    int (*send_output)(int fd, const controller_output_t* output);
+    int (*send_output)(controller_device_t* dev, const controller_output_t* output);
     
     /**
      * Handle controller disconnect.
-     * Clean up any state. The fd will be closed by the framework.
+     * Release dev->priv. The fd will be closed by the framework.
      */
-    void (*on_disconnect)(void);
+    void (*on_disconnect)(controller_device_t* dev);
     
     /**
      * Optional: Enter low-power mode.
-     * Called when entering standby. Turn off LEDs, stop rumble, etc.
+     * Called on shutdown. Turn off LEDs, stop rumble, etc.
      * 
-     * @param fd Device file descriptor
+     * @param dev Target device
      */
-    void (*enter_low_power)(int fd);
+    void (*enter_low_power)(controller_device_t* dev);
     
 } controller_driver_t;
 
@@ -300,20 +351,20 @@ int controller_register(const controller_driver_t* driver);
 const controller_driver_t* controller_find_driver(uint16_t vid, uint16_t pid);
 
 /**
- * Get the currently active controller driver.
+ * Callback for controller_scan_devices(): claim a matching node.
  * 
- * @return Pointer to active driver, or NULL if no controller connected
+ * @return 0 to keep scanning, non-zero to stop
  */
-const controller_driver_t* controller_get_active(void);
+typedef int (*controller_scan_fn)(const char* path, const controller_driver_t* driver,
+                                  void* ctx);
 
 /**
- * Get the current controller state.
- * Thread-safe copy of the latest input state.
+ * Scan /sys/class/hidraw for nodes claimed by a registered driver.
+ * Nodes are identified from sysfs without opening them.
  * 
- * @param out_state Output buffer for state
- * @return 0 on success, -1 if no controller connected
+ * @return Number of matching nodes reported
  */
-int controller_get_state(controller_state_t* out_state);
+int controller_scan_devices(controller_scan_fn fn, void* ctx);
 
 /* ============================================================================
  * UTILITY MACROS
@@ -11,18 +11,21 @@
  * The DualSense communicates via Bluetooth HID with 78-byte input reports.
  * Output reports (rumble, LEDs) are also 78 bytes with CRC32 validation.
  * 
- * LED control uses a hybrid approach:
+ * LED control uses a hybrid approach by default:
  * - Lightbar: Controlled via kernel sysfs (avoids driver conflicts)
  * - Rumble: Sent via hidraw output reports
  * 
  * This split is necessary because the hid-playstation kernel driver
  * manages LEDs, and sending LED commands via hidraw conflicts with it.
+ * DS_LED_BACKEND_HIDRAW instead folds LEDs into the rumble report, for
+ * setups where nothing else drives the LEDs.
  */
 
 #ifndef ROSETTAPAD_DUALSENSE_H
 #define ROSETTAPAD_DUALSENSE_H
 
 #include "controllers/controller_interface.h"
+#include "rosetta_core/dualsense.h"
 
 /* ============================================================================
  * DEVICE IDENTIFICATION
@@ -32,90 +35,13 @@
 #define DUALSENSE_PID     0x0CE6   /* DualSense */
 
 /* ============================================================================
- * BLUETOOTH REPORT FORMAT
+ * LED BACKEND
  * ============================================================================ */
 
-#define DS_BT_REPORT_ID       0x31
-#define DS_BT_INPUT_SIZE      78
-#define DS_BT_OUTPUT_SIZE     78
-
-/* Input report byte offsets */
-#define DS_OFF_REPORT_ID      0
-#define DS_OFF_COUNTER        1
-#define DS_OFF_LX             2
-#define DS_OFF_LY             3
-#define DS_OFF_RX             4
-#define DS_OFF_RY             5
-#define DS_OFF_L2             6
-#define DS_OFF_R2             7
-#define DS_OFF_STATUS         8
-#define DS_OFF_BUTTONS1       9    /* D-pad (low nibble) + face buttons */
-#define DS_OFF_BUTTONS2       10   /* Shoulders, sticks, options/create */
-#define DS_OFF_BUTTONS3       11   /* PS, touchpad, mute */
-#define DS_OFF_GYRO_X         16
-#define DS_OFF_GYRO_Y         18
-#define DS_OFF_GYRO_Z         20
-#define DS_OFF_ACCEL_X        22
-#define DS_OFF_ACCEL_Y        24
-#define DS_OFF_ACCEL_Z        26
-#define DS_OFF_TOUCHPAD       34
-#define DS_OFF_BATTERY        54
-
-/* Button masks - Byte 9 (buttons1) */
-#define DS_BTN1_SQUARE        0x10
-#define DS_BTN1_CROSS         0x20
-#define DS_BTN1_CIRCLE        0x40
-#define DS_BTN1_TRIANGLE      0x80
-
-/* Button masks - Byte 10 (buttons2) */
-#define DS_BTN2_L1            0x01
-#define DS_BTN2_R1            0x02
-#define DS_BTN2_L2            0x04
-#define DS_BTN2_R2            0x08
-#define DS_BTN2_CREATE        0x10
-#define DS_BTN2_OPTIONS       0x20
-#define DS_BTN2_L3            0x40
-#define DS_BTN2_R3            0x80
-
-/* Button masks - Byte 11 (buttons3) */
-#define DS_BTN3_PS            0x01
-#define DS_BTN3_TOUCHPAD      0x02
-#define DS_BTN3_MUTE          0x04
-
-/* Touchpad constants */
-#define DS_TOUCHPAD_WIDTH     1920
-#define DS_TOUCHPAD_HEIGHT    1080
-#define DS_TOUCH_INACTIVE     0x80
-
-/* ============================================================================
- * CALIBRATION DATA
- * 
- * DualSense provides calibration data via Feature Report 0x05 (41 bytes).
- * This data defines the sensor ranges and biases for proper motion scaling.
- * ============================================================================ */
-
-#define DS_FEATURE_REPORT_CALIBRATION       0x05
-#define DS_FEATURE_REPORT_CALIBRATION_SIZE  41
-
-/* DualSense hardware limits (from kernel hid-playstation.c) */
-#define DS_ACC_RES_PER_G       8192   /* Accelerometer resolution per g */
-#define DS_ACC_RANGE           (4 * DS_ACC_RES_PER_G)  /* ±4g range */
-#define DS_GYRO_RES_PER_DEG_S  1024   /* Gyroscope resolution per degree/s */
-#define DS_GYRO_RANGE          (2048 * DS_GYRO_RES_PER_DEG_S)  /* ±2048 deg/s */
-
-/* Per-axis calibration data */
-typedef struct {
-    int16_t bias;       /* Zero offset */
-    int sens_numer;     /* Sensitivity numerator */
-    int sens_denom;     /* Sensitivity denominator */
-} ds_axis_calib_t;
-
-/* Full calibration structure */
-typedef struct {
-    ds_axis_calib_t gyro[3];   /* Pitch, Yaw, Roll */
-    ds_axis_calib_t accel[3];  /* X, Y, Z */
-    int valid;                  /* 1 if calibration loaded successfully */
-} ds_calibration_t;
+typedef enum {
+    DS_LED_BACKEND_SYSFS = 0,   /* Kernel LED class (default) */
+    DS_LED_BACKEND_HIDRAW       /* Lightbar/player LEDs in the output report */
+} ds_led_backend_t;
 
 /* ============================================================================
  * DRIVER INTERFACE
@@ -133,6 +59,12 @@ const controller_driver_t* dualsense_get_driver(void);
  */
 void dualsense_register(void);
 
+/**
+ * Select how lightbar and player LEDs are driven.
+ * Call before the controller is found.
+ */
+void dualsense_set_led_backend(ds_led_backend_t backend);
+
 /* ============================================================================
  * INTERNAL FUNCTIONS (exposed for testing)
  * ============================================================================ */
@@ -149,4 +81,12 @@ uint32_t dualsense_calc_crc32(const uint8_t* data, size_t len);
  */
 void dualsense_parse_dpad(uint8_t buttons1, controller_state_t* out_state);
 
+/**
+ * Give a device driver state without a hidraw node behind it (fd -1),
+ * so process_input() can run offline (benchmarks).
+ * @param calib Motion calibration to use, NULL for raw passthrough
+ * @return 0 on success, -1 on failure. Release with on_disconnect().
+ */
+int dualsense_attach_offline(controller_device_t* dev, const ds_calibration_t* calib);
+
 #endif /* ROSETTAPAD_DUALSENSE_H */
\ No newline at end of file
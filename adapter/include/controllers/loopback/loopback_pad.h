@@ -0,0 +1,70 @@
+/*
+ * RosettaPad - Loopback Virtual DualSense
+ * ========================================
+ *
+ * Input half of the hardware-free loopback test (--loopback). Creates a
+ * uhid device that emits scripted DualSense BT 0x31 reports, so the real
+ * hidraw, hotplug and DualSense parsing paths run without a pad.
+ *
+ * The device uses the pid.codes test ID rather than Sony's, so
+ * hid-playstation leaves it alone and hid-generic exposes a plain hidraw
+ * node. The loopback driver below claims that node and parses it with
+ * the DualSense driver's process_input.
+ *
+ * Every report carries a 16-bit sequence number in the L2/R2 analog
+ * values - both pass through the default remap profile and the DS3
+ * translation unchanged, which lets the console-side sink match each
+ * DS3 report to the moment its input was emitted.
+ */
+
+#ifndef ROSETTAPAD_LOOPBACK_PAD_H
+#define ROSETTAPAD_LOOPBACK_PAD_H
+
+#include <stdint.h>
+
+#include "controllers/controller_interface.h"
+
+#define LOOPBACK_PAD_VID    0x1209  /* pid.codes */
+#define LOOPBACK_PAD_PID    0x0001  /* pid.codes test PID */
+
+/* Sequence number <-> trigger values (0 = not a loopback frame) */
+#define LOOPBACK_SEQ_L2(seq)            ((uint8_t)((seq) & 0xFF))
+#define LOOPBACK_SEQ_R2(seq)            ((uint8_t)((seq) >> 8))
+#define LOOPBACK_SEQ_FROM(l2, r2)       ((uint16_t)((l2) | ((r2) << 8)))
+
+/* Reports per run, so seq never wraps inside a window */
+#define LOOPBACK_MAX_REPORTS            65535
+
+/**
+ * Register the loopback driver with the controller registry.
+ */
+void loopback_pad_register(void);
+
+/**
+ * Create the uhid device. The hidraw node shows up asynchronously and
+ * is picked up by hotplug like a real pad.
+ * @return 0 on success, -1 on failure (no /dev/uhid, no permission)
+ */
+int loopback_pad_create(void);
+
+/**
+ * Destroy the uhid device (the pad disconnects).
+ */
+void loopback_pad_destroy(void);
+
+/**
+ * Emit reports at rate_hz for the given duration, paced by absolute
+ * CLOCK_MONOTONIC deadlines. Blocks the calling thread.
+ * Waits for the adapter to open the hidraw node first. Capped at
+ * LOOPBACK_MAX_REPORTS reports.
+ * @return Reports emitted, -1 if the node was never opened
+ */
+int loopback_pad_run(int rate_hz, int seconds);
+
+/**
+ * CLOCK_MONOTONIC time the report with this sequence number was written
+ * to uhid, 0 if none.
+ */
+uint64_t loopback_pad_sent_ns(uint16_t seq);
+
+#endif /* ROSETTAPAD_LOOPBACK_PAD_H */
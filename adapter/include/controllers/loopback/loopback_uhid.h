@@ -0,0 +1,45 @@
+/*
+ * RosettaPad - Loopback uhid Transport
+ * =====================================
+ *
+ * The /dev/uhid side of the loopback pad (loopback_pad.h): creates the
+ * virtual HID device, emits input reports and tracks whether the adapter
+ * holds the hidraw node open.
+ *
+ * Kept in its own translation unit because <linux/uhid.h> pulls in
+ * <linux/input.h>, whose BTN_* codes clash with controller_interface.h.
+ */
+
+#ifndef ROSETTAPAD_LOOPBACK_UHID_H
+#define ROSETTAPAD_LOOPBACK_UHID_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Create a virtual (BUS_VIRTUAL) HID device.
+ * @param rdesc Report descriptor
+ * @return 0 on success, -1 on failure (no /dev/uhid, no permission)
+ */
+int loopback_uhid_create(const char* name, const char* phys, uint16_t vid, uint16_t pid,
+                         const uint8_t* rdesc, size_t rdesc_size);
+
+/**
+ * Destroy the device and close /dev/uhid.
+ */
+void loopback_uhid_destroy(void);
+
+/**
+ * Process pending uhid events (open/close), waiting up to timeout_ms
+ * for the first one.
+ * @return 1 if the hidraw node is held open, 0 if not
+ */
+int loopback_uhid_poll(int timeout_ms);
+
+/**
+ * Emit one input report.
+ * @return 0 on success, -1 on failure
+ */
+int loopback_uhid_send(const uint8_t* report, size_t len);
+
+#endif /* ROSETTAPAD_LOOPBACK_UHID_H */
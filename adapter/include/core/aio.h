@@ -0,0 +1,51 @@
+/*
+ * RosettaPad - Native AIO
+ * ========================
+ *
+ * Thin wrappers around the Linux io_setup/io_submit/io_getevents
+ * syscalls (no libaio dependency). FunctionFS endpoints support these
+ * natively: transfers are queued in the UDC ahead of the host's polls and
+ * completions are signalled on an eventfd (IOCB_FLAG_RESFD), so they can
+ * be reaped from an event loop.
+ */
+
+#ifndef ROSETTAPAD_CORE_AIO_H
+#define ROSETTAPAD_CORE_AIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/aio_abi.h>
+
+/**
+ * Create an AIO context.
+ * @param max_events Maximum number of in-flight requests
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int aio_ctx_setup(unsigned int max_events, aio_context_t* ctx);
+
+/**
+ * Destroy an AIO context. Cancels and waits for in-flight requests.
+ */
+void aio_ctx_destroy(aio_context_t ctx);
+
+/**
+ * Fill an iocb for a read (IOCB_CMD_PREAD) or write (IOCB_CMD_PWRITE).
+ * @param resfd eventfd signalled on completion, -1 for none
+ * @param data Returned in io_event.data on completion
+ */
+void aio_prep(struct iocb* cb, uint16_t opcode, int fd, void* buf, size_t len,
+              int resfd, void* data);
+
+/**
+ * Submit one request.
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int aio_submit(aio_context_t ctx, struct iocb* cb);
+
+/**
+ * Reap completed requests without blocking.
+ * @return Number of events stored, 0 if none, -1 on error
+ */
+int aio_reap(aio_context_t ctx, struct io_event* events, int max_events);
+
+#endif /* ROSETTAPAD_CORE_AIO_H */
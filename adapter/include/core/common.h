@@ -40,6 +40,56 @@ int system_is_standby(void);
 void system_enter_standby(void);
 void system_exit_standby(void);
 
+#define SYSTEM_STATE_MAX_SUBSCRIBERS 8
+
+/**
+ * Get an eventfd that is signalled on every system state change, so
+ * work that only matters while the PS3 is on can park in standby and
+ * resume on wake. Non-blocking; the caller owns it.
+ * @return fd, or -1 if the subscriber table is full
+ */
+int system_state_subscribe(void);
+
+/**
+ * Drop an fd from system_state_subscribe() before closing it. Returns
+ * once no notifier can still write to it.
+ */
+void system_state_unsubscribe(int fd);
+
+/* ============================================================================
+ * CONTROLLER SLOTS
+ * 
+ * One slot per connected pad (player 1-4). Each slot carries its own input
+ * state, output state and device. Console front-ends pick the slot they
+ * serve; the unsuffixed functions below operate on slot 0 (player 1).
+ * ============================================================================ */
+
+#define MAX_CONTROLLER_SLOTS 4
+
+/**
+ * Bind an opened device to slot dev->slot.
+ * Resets the slot's input state to neutral.
+ * 
+ * @return 0 on success, -1 if the slot is invalid or taken
+ */
+int controller_slot_attach(controller_device_t* dev);
+
+/**
+ * Release a slot. Waits for an in-flight send_output() on it to finish,
+ * so the caller may tear the device down afterwards.
+ */
+void controller_slot_detach(int slot);
+
+/**
+ * Number of slots with a device bound.
+ */
+int controller_slot_count(void);
+
+/**
+ * Put every bound device into low-power mode (shutdown).
+ */
+void controller_slots_enter_low_power(void);
+
 /* ============================================================================
  * CONTROLLER STATE MANAGEMENT
  * 
@@ -47,31 +97,61 @@ void system_exit_standby(void);
  * Controllers write to this; console layers read from it.
  * ============================================================================ */
 
-/* Global controller state - updated by active controller driver */
-extern controller_state_t g_controller_state;
-extern pthread_mutex_t g_controller_state_mutex;
+/*
+ * State is published lock-free (see core/seqlock.h): updates never wait
+ * for readers and copies never block, so a descheduled thread can't stall
+ * the input path. Always go through the functions below.
+ */
 
 /**
- * Update controller state (thread-safe).
+ * Update controller state (thread-safe, lock-free for readers).
  * Called by controller drivers after processing input.
  */
 void controller_state_update(const controller_state_t* state);
 
 /**
- * Copy current controller state (thread-safe).
+ * Copy current controller state (thread-safe, never blocks).
  * Called by console emulation layers.
  */
 void controller_state_copy(controller_state_t* out_state);
 
+/* Maximum number of threads that can wait for state changes */
+#define CONTROLLER_STATE_MAX_SUBSCRIBERS 4
+
+/**
+ * Subscribe to controller state changes.
+ * Returns a non-blocking eventfd that becomes readable after every
+ * controller_state_update(). Consumers poll() it instead of sleeping,
+ * then read() it to re-arm and controller_state_copy() the new state.
+ *
+ * @return eventfd on success, -1 if subscriber table is full or on error
+ */
+int controller_state_subscribe(void);
+
+/**
+ * Drop an fd from controller_state_subscribe() before closing it.
+ * Returns once no state update can still write to it.
+ */
+void controller_state_unsubscribe(int fd);
+
+/**
+ * Get the current state generation (incremented on every update).
+ */
+uint32_t controller_state_generation(void);
+
+/* Per-slot variants - slot must be 0..MAX_CONTROLLER_SLOTS-1 */
+void controller_slot_state_update(int slot, const controller_state_t* state);
+void controller_slot_state_copy(int slot, controller_state_t* out_state);
+int controller_slot_state_subscribe(int slot);
+void controller_slot_state_unsubscribe(int slot, int fd);
+uint32_t controller_slot_state_generation(int slot);
+
 /* ============================================================================
  * OUTPUT STATE MANAGEMENT
  * 
  * Rumble and LED state from console, to be sent to controller.
  * ============================================================================ */
 
-extern controller_output_t g_controller_output;
-extern pthread_mutex_t g_controller_output_mutex;
-
 /**
  * Update output state (thread-safe).
  * Called by console emulation when it receives output commands.
@@ -79,62 +159,62 @@ extern pthread_mutex_t g_controller_output_mutex;
 void controller_output_update(const controller_output_t* output);
 
 /**
- * Copy current output state (thread-safe).
+ * Copy current output state (thread-safe, never blocks).
  * Called by controller output thread.
  */
 void controller_output_copy(controller_output_t* out_output);
 
-/**
- * Check if output has changed since last copy.
- * Avoids unnecessary output sends.
- */
-int controller_output_changed(void);
+/* Per-slot variants - slot must be 0..MAX_CONTROLLER_SLOTS-1 */
+void controller_slot_output_update(int slot, const controller_output_t* output);
+void controller_slot_output_copy(int slot, controller_output_t* out_output);
 
 /* ============================================================================
  * CONTROLLER OUTPUT THREAD
  * 
- * Generic output thread that reads from g_controller_output and calls
- * the active controller's send_output() function.
+ * Generic output thread that reads each slot's output state and calls
+ * the bound device's send_output() function. Event-driven: output
+ * updates wake it immediately.
  * ============================================================================ */
 
+#define OUTPUT_COALESCE_US      1000    /* Merge bursts of updates into one send */
+#define OUTPUT_MIN_SPACING_US   4000    /* Min gap between sends to one pad */
+
 /**
  * Controller output thread function.
- * Monitors output state and forwards to active controller.
+ * Monitors output state and forwards to the device in each slot.
+ * Sleeps without a timeout while idle - see controller_output_wake().
  */
 void* controller_output_thread(void* arg);
 
-/* ============================================================================
- * LIGHTBAR IPC
- * 
- * Web interface can control lightbar via file-based IPC.
- * ============================================================================ */
-
-#define LIGHTBAR_IPC_PATH "/tmp/rosettapad/lightbar_state.json"
-
 /**
- * Read lightbar state from IPC file.
- * Called periodically by output thread.
+ * Wake the output thread, e.g. so it sees g_running == 0 and exits.
  */
-void lightbar_read_ipc(controller_output_t* output);
+void controller_output_wake(void);
 
 /* ============================================================================
  * TOUCHPAD-AS-STICK CONFIGURATION
  * ============================================================================ */
 
-extern volatile int g_touchpad_as_right_stick;  /* 0=disabled, 1=enabled */
+extern volatile int g_touchpad_as_right_stick;  /* 0=disabled, 1=enabled (control plane) */
 
 /* ============================================================================
  * DEBUG UTILITIES
  * ============================================================================ */
 
 /**
- * Print hex dump of data.
+ * Hex dump of data (up to 64 bytes) at LOG_DEBUG; compiled out otherwise.
  */
 void debug_print_hex(const char* label, const uint8_t* data, size_t len);
 
 /**
- * Get current time in milliseconds.
+ * Get current time in milliseconds (CLOCK_MONOTONIC).
  */
 uint64_t time_get_ms(void);
 
+/**
+ * Get current time in nanoseconds (CLOCK_MONOTONIC).
+ * Used for latency measurement.
+ */
+uint64_t time_get_ns(void);
+
 #endif /* ROSETTAPAD_CORE_COMMON_H */
\ No newline at end of file
@@ -0,0 +1,139 @@
+/*
+ * RosettaPad - Control Plane
+ * ===========================
+ *
+ * Shared-memory channel between the adapter and local tools (web config
+ * panel, remapper, debug UIs). CONTROL_SHM_PATH holds one
+ * control_region_t:
+ *
+ *   - config: written by clients, applied by the adapter (lightbar,
+ *     input options, remap/macro profile, motion axis mapping)
+ *   - status: live per-slot input/output state, written by the adapter
+ *
+ * Both sides use the sequence latch from core/seqlock.h directly on the
+ * mapped memory, so nobody ever blocks the adapter and reading live stick
+ * state costs no syscalls.
+ *
+ * Changing config from a client:
+ *   1. seqlatch_write_lock(&r->config_latch)
+ *   2. copy config_copies[0], modify, bump .generation
+ *   3. seqlatch_publish(&r->config_latch, r->config_copies, &cfg, sizeof(cfg))
+ *   4. seqlatch_write_unlock(&r->config_latch)
+ *   5. send any datagram to CONTROL_SOCKET_PATH
+ *
+ * Clients must check magic, version and size before use; the layout only
+ * changes together with CONTROL_VERSION.
+ */
+
+#ifndef ROSETTAPAD_CORE_CONTROL_H
+#define ROSETTAPAD_CORE_CONTROL_H
+
+#include <stdint.h>
+
+#include "core/common.h"
+#include "core/event_loop.h"
+#include "core/motion.h"
+#include "core/remap.h"
+#include "core/seqlock.h"
+
+#define CONTROL_SHM_PATH        "/dev/shm/rosettapad"
+#define CONTROL_SOCKET_PATH     "/tmp/rosettapad/control.sock"
+
+#define CONTROL_MAGIC           0x44415052u     /* "RPAD" */
+#define CONTROL_VERSION         3
+
+/* ============================================================================
+ * CONFIG (clients -> adapter)
+ * ============================================================================ */
+
+typedef struct {
+    uint8_t enabled;            /* 1 = override the lightbar on player 1's pad */
+    uint8_t r, g, b;
+    uint8_t player_leds_enabled;    /* 1 = override player LEDs too */
+    uint8_t player_leds;        /* 5-bit DualSense LED mask */
+    uint8_t player_brightness;  /* 0-255 */
+    uint8_t reserved;
+} control_lightbar_t;
+
+typedef struct {
+    uint8_t touchpad_as_right_stick;    /* 0 = disabled, 1 = enabled */
+    uint8_t reserved[7];
+} control_input_t;
+
+typedef struct {
+    uint32_t generation;        /* Bumped by the client on every change */
+    control_lightbar_t lightbar;
+    control_input_t input;
+    remap_config_t remap;       /* Compiled and hot-swapped on apply */
+    motion_mapping_t motion;    /* IMU axis -> console channel, with signs */
+} control_config_t;
+
+/* ============================================================================
+ * STATUS (adapter -> clients)
+ * ============================================================================ */
+
+typedef struct {
+    seqlatch_t state_latch;
+    controller_state_t state_copies[2];
+    seqlatch_t output_latch;
+    controller_output_t output_copies[2];
+    uint32_t connected;         /* 1 if a pad is bound to the slot */
+} __attribute__((aligned(64))) control_slot_status_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              /* sizeof(control_region_t) */
+    uint32_t adapter_pid;
+    uint32_t system_state;      /* system_state_t */
+    
+    seqlatch_t config_latch __attribute__((aligned(64)));
+    control_config_t config_copies[2];
+    
+    control_slot_status_t slots[MAX_CONTROLLER_SLOTS];
+} control_region_t;
+
+/* ============================================================================
+ * ADAPTER SIDE
+ * ============================================================================ */
+
+/**
+ * Map the control region (creating or resetting it if the layout does
+ * not match) and bind the notification socket. Config left by a
+ * previous run is kept. Without it, everything below is a no-op.
+ * @return 0 on success, -1 on failure
+ */
+int control_init(void);
+
+/**
+ * Stop publishing and remove the notification socket. The region itself
+ * stays (with its config) for the next run.
+ */
+void control_close(void);
+
+/**
+ * Register the notification socket on an event loop. Config is
+ * re-applied on the loop's thread whenever a client pings it.
+ * @return 0 on success, -1 on failure
+ */
+int control_attach(event_loop_t* loop);
+
+/**
+ * Unregister the notification socket (from the loop's thread).
+ */
+void control_detach(void);
+
+/**
+ * Apply the current config (lightbar, touchpad mode, remap profile when
+ * the generation changed). Thread-safe.
+ * Lightbar overrides are skipped in standby.
+ */
+void control_apply(void);
+
+/* Status publication - cheap, lock-free, safe from any thread */
+void control_publish_state(int slot, const controller_state_t* state);
+void control_publish_output(int slot, const controller_output_t* output);
+void control_publish_connected(int slot, int connected);
+void control_publish_system_state(system_state_t state);
+
+#endif /* ROSETTAPAD_CORE_CONTROL_H */
@@ -0,0 +1,61 @@
+/*
+ * RosettaPad - CRC32
+ * ===================
+ *
+ * IEEE 802.3 CRC32 (reflected polynomial 0xEDB88320, as used by zlib and
+ * the DualSense Bluetooth reports).
+ *
+ * crc32_init() picks the fastest implementation for the running CPU:
+ * the ARMv8 CRC32 instructions when the kernel reports them (HWCAP_CRC32),
+ * otherwise a slice-by-8 table walk. All implementations produce identical
+ * results.
+ */
+
+#ifndef ROSETTAPAD_CORE_CRC32_H
+#define ROSETTAPAD_CORE_CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    CRC32_IMPL_BYTEWISE = 0,    /* One 256-entry table lookup per byte */
+    CRC32_IMPL_SLICE8,          /* Eight tables, 8 bytes per step */
+    CRC32_IMPL_HW,              /* ARMv8 __crc32d/__crc32b */
+    CRC32_IMPL_COUNT
+} crc32_impl_t;
+
+/**
+ * Build tables and select the implementation.
+ * Call once at startup, before any thread uses crc32_update().
+ */
+void crc32_init(void);
+
+/**
+ * Continue a CRC32 over more data (zlib semantics).
+ * @param crc 0 to start, or the result of a previous call to chain buffers
+ * @return Updated CRC32
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len);
+
+/**
+ * Same as crc32_update() with an explicit implementation (benchmarks).
+ * Falls back to slice-by-8 if the implementation is not available.
+ */
+uint32_t crc32_update_with(crc32_impl_t impl, uint32_t crc, const uint8_t* data, size_t len);
+
+/**
+ * @return 1 if the implementation can run on this CPU
+ */
+int crc32_impl_available(crc32_impl_t impl);
+
+/**
+ * @return Name of an implementation ("bytewise", "slice8", "hw")
+ */
+const char* crc32_impl_name(crc32_impl_t impl);
+
+/**
+ * @return Implementation selected by crc32_init()
+ */
+crc32_impl_t crc32_active_impl(void);
+
+#endif /* ROSETTAPAD_CORE_CRC32_H */
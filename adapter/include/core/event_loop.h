@@ -0,0 +1,119 @@
+/*
+ * RosettaPad - Event Loop
+ * ========================
+ *
+ * Minimal epoll wrapper. Subsystems register an fd with a handler and the
+ * owning thread blocks in event_loop_run_once() until something is ready,
+ * instead of spinning on read()/usleep().
+ *
+ * A loop is owned by one thread; handlers run on that thread. The adapter
+ * runs one loop (the reactor, on the input thread) that owns the hidraw
+ * nodes, ep0/ep1/ep2, the BT L2CAP sockets, pacing timers and the
+ * shutdown signalfd. Timers and signals are plain fds; the helpers below
+ * create and arm them.
+ */
+
+#ifndef ROSETTAPAD_CORE_EVENT_LOOP_H
+#define ROSETTAPAD_CORE_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#define EVENT_LOOP_MAX_HANDLERS 48
+
+/**
+ * Event handler callback.
+ * @param fd Ready file descriptor
+ * @param events EPOLL* event mask (EPOLLIN, EPOLLHUP, EPOLLERR, ...)
+ * @param ctx Context pointer given at registration
+ */
+typedef void (*event_handler_fn)(int fd, uint32_t events, void* ctx);
+
+typedef struct {
+    int fd;                 /* -1 if slot is free */
+    event_handler_fn fn;
+    void* ctx;
+    uint32_t generation;    /* Bumped on remove; tags this slot's epoll events */
+} event_handler_t;
+
+typedef struct {
+    int epoll_fd;
+    event_handler_t handlers[EVENT_LOOP_MAX_HANDLERS];
+} event_loop_t;
+
+/**
+ * Create an event loop.
+ * @return 0 on success, -1 on failure
+ */
+int event_loop_init(event_loop_t* loop);
+
+/**
+ * Destroy an event loop. Registered fds are not closed.
+ */
+void event_loop_close(event_loop_t* loop);
+
+/**
+ * Register an fd.
+ * @param events EPOLLIN, EPOLLOUT, ... (EPOLLHUP/EPOLLERR are always reported)
+ * @return 0 on success, -1 if the table is full or epoll_ctl fails
+ */
+int event_loop_add(event_loop_t* loop, int fd, uint32_t events,
+                   event_handler_fn fn, void* ctx);
+
+/**
+ * Change the event mask of a registered fd.
+ */
+int event_loop_modify(event_loop_t* loop, int fd, uint32_t events);
+
+/**
+ * Unregister an fd. Safe to call from inside a handler, including for
+ * fds with events still pending in the current dispatch.
+ */
+int event_loop_remove(event_loop_t* loop, int fd);
+
+/**
+ * Wait for events and dispatch handlers.
+ * @param timeout_ms -1 to block indefinitely
+ * @return Number of events dispatched, 0 on timeout, -1 on error
+ */
+int event_loop_run_once(event_loop_t* loop, int timeout_ms);
+
+/* ============================================================================
+ * TIMERS AND SIGNALS
+ * ============================================================================ */
+
+/**
+ * Create a disarmed CLOCK_MONOTONIC timerfd (non-blocking). Register it
+ * with EPOLLIN; the handler reads the expiration count to re-arm it.
+ * @return fd, -1 on failure
+ */
+int event_timer_create(void);
+
+/**
+ * Arm a timer relative to now.
+ * @param delay_ns First expiration, 0 disarms
+ * @param interval_ns Period after that, 0 for one-shot
+ */
+int event_timer_arm(int fd, uint64_t delay_ns, uint64_t interval_ns);
+
+/**
+ * Arm a one-shot timer for an absolute CLOCK_MONOTONIC time (see
+ * time_get_ns()). A deadline already passed fires immediately.
+ */
+int event_timer_arm_at(int fd, uint64_t deadline_ns);
+
+/**
+ * Block the given signals in the calling thread and return a signalfd
+ * for them. Call from main() before any thread is started so every
+ * thread inherits the mask and only the fd ever sees them.
+ * @return fd, -1 on failure
+ */
+int event_signal_open(const int* signals, int count);
+
+/**
+ * Read and drain an eventfd/timerfd counter (handlers for either).
+ * @return The count, 0 if nothing was pending
+ */
+uint64_t event_fd_drain(int fd);
+
+#endif /* ROSETTAPAD_CORE_EVENT_LOOP_H */
@@ -0,0 +1,49 @@
+/*
+ * RosettaPad - Filesystem Helpers
+ * ================================
+ *
+ * Direct-syscall replacements for the "echo > file", "mkdir -p" and
+ * "ln -s" shell-outs used to drive sysfs and configfs. Each system()
+ * forks /bin/sh, which costs tens of milliseconds on a Pi Zero; these
+ * are a handful of syscalls each.
+ */
+
+#ifndef ROSETTAPAD_CORE_FSUTIL_H
+#define ROSETTAPAD_CORE_FSUTIL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * Write a sysfs/configfs attribute (single write, no trailing newline).
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int fs_write_attr(const char* path, const char* value);
+
+/**
+ * Read a sysfs/configfs attribute, trailing newline stripped.
+ * @return Length read, -1 on failure
+ */
+int fs_read_attr(const char* path, char* buf, size_t len);
+
+/**
+ * Create a directory and any missing parents (mkdir -p).
+ * @return 0 on success or if it already exists, -1 on failure
+ */
+int fs_mkdir_p(const char* path, mode_t mode);
+
+/**
+ * Create a symlink; an existing link at linkpath counts as success.
+ * @return 0 on success, -1 on failure
+ */
+int fs_symlink(const char* target, const char* linkpath);
+
+/**
+ * Check whether path is on a filesystem of the given type (i.e. the
+ * mount is already in place).
+ * @param fs_magic statfs f_type, e.g. FUNCTIONFS_MAGIC
+ * @return 1 if mounted, 0 if not
+ */
+int fs_is_mounted(const char* path, unsigned long fs_magic);
+
+#endif /* ROSETTAPAD_CORE_FSUTIL_H */
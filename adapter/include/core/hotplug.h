@@ -0,0 +1,48 @@
+/*
+ * RosettaPad - Hotplug Monitor
+ * =============================
+ *
+ * Listens for kernel uevents (NETLINK_KOBJECT_UEVENT) so hidraw devices
+ * are picked up the moment they appear, instead of rescanning /dev.
+ *
+ * The VID/PID comes from the parent HID device name in DEVPATH
+ * (".../0005:054C:0CE6.0004/hidraw/hidraw3"), so matching never has to
+ * open unrelated devices.
+ */
+
+#ifndef ROSETTAPAD_CORE_HOTPLUG_H
+#define ROSETTAPAD_CORE_HOTPLUG_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef enum {
+    HOTPLUG_ADD = 0,
+    HOTPLUG_REMOVE,
+    HOTPLUG_RESYNC          /* Socket overflowed, events lost - rescan */
+} hotplug_action_t;
+
+typedef struct {
+    hotplug_action_t action;
+    char devnode[64];       /* e.g. "/dev/hidraw3" */
+    dev_t devnum;           /* From MAJOR/MINOR, 0 if absent */
+    uint16_t vendor_id;
+    uint16_t product_id;
+    int has_ids;            /* 1 if VID/PID were parsed from DEVPATH */
+} hotplug_event_t;
+
+/**
+ * Open a non-blocking uevent socket.
+ * @return Socket fd, or -1 if netlink is unavailable
+ */
+int hotplug_open(void);
+
+/**
+ * Read one uevent from the socket.
+ * @param out_event Filled in for hidraw add/remove events and overflows
+ * @return 1 if out_event is valid, 0 if the message was ignored,
+ *         -1 when no more messages are queued (or on error)
+ */
+int hotplug_read(int fd, hotplug_event_t* out_event);
+
+#endif /* ROSETTAPAD_CORE_HOTPLUG_H */
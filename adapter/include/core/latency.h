@@ -0,0 +1,65 @@
+/*
+ * RosettaPad - Input Latency Instrumentation
+ * ===========================================
+ *
+ * Measures the adapter's own added latency, from the hidraw read() of a
+ * controller report to the moment the matching console report is on the
+ * wire. All timestamps come from time_get_ns() (CLOCK_MONOTONIC).
+ *
+ *   read()  ──parse──►  process_input done
+ *      │
+ *      └──handoff──►  DS3 frame built  ──write──►  write()/send() done
+ *      └──────────────────total──────────────────►
+ *
+ * Samples go into lock-free per-stage histograms. Any thread may record;
+ * the main loop periodically dumps p50/p99/max to LATENCY_STATS_PATH.
+ */
+
+#ifndef ROSETTAPAD_CORE_LATENCY_H
+#define ROSETTAPAD_CORE_LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LATENCY_STATS_PATH  "/tmp/rosettapad/latency_stats"
+
+typedef enum {
+    LATENCY_STAGE_PARSE = 0,      /* hidraw read -> process_input done */
+    LATENCY_STAGE_USB_HANDOFF,    /* hidraw read -> USB report build */
+    LATENCY_STAGE_USB_WRITE,      /* USB report build -> ep1 write done */
+    LATENCY_STAGE_USB_TOTAL,      /* hidraw read -> ep1 write done */
+    LATENCY_STAGE_USB_POLL_PHASE, /* |host poll - predicted poll| (--usb-jit) */
+    LATENCY_STAGE_BT_HANDOFF,     /* hidraw read -> BT report build */
+    LATENCY_STAGE_BT_SEND,        /* BT report build -> send() done */
+    LATENCY_STAGE_BT_TOTAL,       /* hidraw read -> send() done */
+    LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+/**
+ * Record one latency sample (thread-safe, lock-free).
+ * @param stage Pipeline stage
+ * @param ns Duration in nanoseconds
+ */
+void latency_record(latency_stage_t stage, uint64_t ns);
+
+/**
+ * Record the span between two time_get_ns() timestamps.
+ * Ignored if start is 0 (input without a read timestamp).
+ */
+void latency_record_span(latency_stage_t stage, uint64_t start_ns, uint64_t end_ns);
+
+/**
+ * Write p50/p99/max for every stage to a stats file.
+ * Written to a temp file and renamed so readers never see partial output.
+ * @return 0 on success, -1 on error
+ */
+int latency_write_stats(const char* path);
+
+/**
+ * Write every stage as a Prometheus histogram (seconds), for
+ * core/metrics.h. Bucket bounds are the nearest histogram bucket edges
+ * at or below each published "le", so counts are never overstated.
+ */
+void latency_write_prometheus(FILE* f);
+
+#endif /* ROSETTAPAD_CORE_LATENCY_H */
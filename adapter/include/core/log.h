@@ -0,0 +1,88 @@
+/*
+ * RosettaPad - Asynchronous Logging
+ * ==================================
+ *
+ * stdout is usually journald through a pipe, and a slow reader there
+ * would block whichever thread holds the stdio lock - including the
+ * reactor. LOG_*() never touches stdio on the calling thread: it
+ * stores a binary record (format string pointer, timestamp and the raw
+ * arguments, with %s strings copied) in the thread's own lock-free ring,
+ * and the drain thread (RT_ROLE_LOG) formats and writes it later.
+ *
+ * Records from all threads come out in timestamp order. A full ring
+ * drops the record and counts it; the drain reports the count, and it
+ * is exported as rosettapad_log_dropped_total (core/metrics.h).
+ *
+ * Before log_thread() runs and after it stops, LOG_*() writes straight
+ * to stdout like printf(). ERROR goes to stderr.
+ *
+ * Levels are compile time: make builds keep INFO and up, "make debug"
+ * (-DDEBUG) adds DEBUG. Calls below LOG_LEVEL compile out, arguments
+ * are still type-checked.
+ */
+
+#ifndef ROSETTAPAD_CORE_LOG_H
+#define ROSETTAPAD_CORE_LOG_H
+
+#include <stdint.h>
+
+#define LOG_LEVEL_ERROR     0
+#define LOG_LEVEL_WARN      1
+#define LOG_LEVEL_INFO      2
+#define LOG_LEVEL_DEBUG     3
+
+#ifndef LOG_LEVEL
+#ifdef DEBUG
+#define LOG_LEVEL           LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL           LOG_LEVEL_INFO
+#endif
+#endif
+
+#define LOG_MAX_THREADS     16      /* Rings; threads past this drop (counted) */
+#define LOG_RING_SIZE       8192    /* Bytes per thread, power of two */
+#define LOG_RECORD_MAX      512     /* One record, header and strings included */
+#define LOG_MAX_ARGS        16
+#define LOG_LINE_MAX        1024    /* Formatted line */
+
+#define LOG_AT(level, ...) do { \
+        if ((level) <= LOG_LEVEL) log_write((level), __VA_ARGS__); \
+    } while (0)
+
+#define LOG_ERROR(...)      LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)       LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)       LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)      LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/**
+ * Queue one message (any thread, never blocks). fmt must be a string
+ * literal or otherwise outlive the drain; the usual printf conversions
+ * are supported except %n and long double.
+ */
+void log_write(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Set up the rings and wake-up eventfd. Call once from main() before
+ * starting log_thread(). Registers log_flush() with atexit().
+ * @return 0 on success, -1 on error (LOG_*() stays synchronous)
+ */
+int log_init(void);
+
+/**
+ * Drain thread: formats queued records until log_stop(). Start with
+ * RT_ROLE_LOG.
+ */
+void* log_thread(void* arg);
+
+/**
+ * Have log_thread() drain what is queued and return. Later messages are
+ * written synchronously.
+ */
+void log_stop(void);
+
+/**
+ * Write out everything queued so far, from the calling thread.
+ */
+void log_flush(void);
+
+#endif /* ROSETTAPAD_CORE_LOG_H */
@@ -0,0 +1,107 @@
+/*
+ * RosettaPad - Runtime Metrics
+ * =============================
+ *
+ * One registry for the adapter's health numbers, served in Prometheus
+ * text format (version 0.0.4) so a fleet can be watched without logging
+ * in to each adapter:
+ *
+ *   curl --unix-socket /tmp/rosettapad/metrics.sock http://localhost/metrics
+ *
+ * or, with --metrics-port, over TCP from a Prometheus server directly.
+ *
+ * Counters are lock-free per-thread blocks: each thread claims its own
+ * cache-line-aligned block on its first increment and only ever adds to
+ * it, so the hot path never shares a line with another writer. A scrape
+ * sums every block. Gauges are single values set where they change.
+ *
+ * A scrape also carries the per-stage latency histograms (core/latency.h)
+ * and each thread's CPU time from /proc/self/task.
+ *
+ * The server runs on its own SCHED_OTHER thread (RT_ROLE_METRICS) and
+ * never touches the reactor.
+ */
+
+#ifndef ROSETTAPAD_CORE_METRICS_H
+#define ROSETTAPAD_CORE_METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define METRICS_SOCKET_PATH     "/tmp/rosettapad/metrics.sock"
+#define METRICS_MAX_THREADS     16      /* Counter blocks; later threads share the last */
+#define METRICS_REQUEST_TIMEOUT_MS  1000
+#define METRICS_REQUEST_MAX     2048
+
+typedef enum {
+    METRIC_HIDRAW_REPORTS = 0,      /* Reports read from a controller */
+    METRIC_HIDRAW_PARSE_ERRORS,     /* Reports the driver rejected */
+    METRIC_CONTROLLER_CONNECTS,
+    METRIC_CONTROLLER_DISCONNECTS,
+    METRIC_USB_REPORTS_SENT,        /* IN transfers the PS3 polled */
+    METRIC_USB_REPORTS_FAILED,      /* IN transfers that failed or could not be queued */
+    METRIC_USB_REPORTS_DROPPED,     /* Pending reports replaced by newer input */
+    METRIC_USB_OUTPUT_REPORTS,      /* OUT reports (rumble, LEDs) from the PS3 */
+    METRIC_USB_SUSPENDS,
+    METRIC_BT_REPORTS_SENT,
+    METRIC_BT_REPORTS_FAILED,
+    METRIC_BT_REPORTS_DROPPED,      /* Skipped while the link had a backlog */
+    METRIC_BT_CONNECTS,
+    METRIC_BT_CONNECT_FAILURES,
+    METRIC_OUTPUT_REPORTS,          /* Rumble / LED reports sent to controllers */
+    METRIC_OUTPUT_FAILURES,
+    METRIC_STATE_TRANSITIONS,       /* system_set_state() calls */
+    METRIC_LOG_DROPPED,             /* Log records lost to a full ring (core/log.h) */
+    METRIC_COUNT
+} metric_t;
+
+typedef enum {
+    METRIC_GAUGE_SYSTEM_STATE = 0,  /* system_state_t */
+    METRIC_GAUGE_CONTROLLERS,       /* Controllers connected */
+    METRIC_GAUGE_USB_ENABLED,
+    METRIC_GAUGE_BT_STATE,          /* bt_state_t */
+    METRIC_GAUGE_BT_RATE_HZ,
+    METRIC_GAUGE_BT_RSSI,           /* dB relative to the golden range */
+    METRIC_GAUGE_BT_LINK_QUALITY,   /* 0-255 */
+    METRIC_GAUGE_BT_LINK_GRADE,     /* bt_qos grade */
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+/**
+ * Add to a counter (any thread, lock-free).
+ */
+void metrics_add(metric_t metric, uint64_t n);
+
+static inline void metrics_inc(metric_t metric) {
+    metrics_add(metric, 1);
+}
+
+/**
+ * Set a gauge (any thread).
+ */
+void metrics_gauge_set(metric_gauge_t gauge, int64_t value);
+
+/**
+ * Write every metric in Prometheus text format.
+ * @return 0 on success, -1 on write error
+ */
+int metrics_write_prometheus(FILE* f);
+
+/**
+ * Open the metrics socket, plus a TCP listener on all interfaces if
+ * tcp_port is non-zero. Call before starting metrics_thread().
+ * @return 0 on success, -1 if nothing could be opened (logged)
+ */
+int metrics_server_open(int tcp_port);
+
+/**
+ * Serve scrapes until metrics_server_stop(). Start with RT_ROLE_METRICS.
+ */
+void* metrics_thread(void* arg);
+
+/**
+ * Wake metrics_thread() and have it close its sockets and return.
+ */
+void metrics_server_stop(void);
+
+#endif /* ROSETTAPAD_CORE_METRICS_H */
@@ -0,0 +1,105 @@
+/*
+ * RosettaPad - Motion Conversion Stage
+ * =====================================
+ *
+ * Turns raw IMU samples into console-native motion values once per input
+ * report, right after process_input(). Drivers fill the accel/gyro fields with
+ * raw sensor counts and register their calibration per slot; the console
+ * registers what its motion channels look like. Both are folded, with
+ * the axis mapping, into one fixed-point multiply, round and shift per
+ * output channel:
+ *
+ *   out = clamp(center + (((raw - bias) * mul + round) >> MOTION_FRAC_BITS))
+ *
+ * where mul = sign * calib_numer * target_numer / (calib_denom * target_denom),
+ * computed when a calibration, mapping or target is loaded. The result
+ * lands in controller_state_t.motion_out and every sender (USB, BT)
+ * reuses it - nothing on the send side divides or re-derives motion.
+ *
+ * Compiled tables are swapped in per slot through a triple buffer, like
+ * core/remap.h, so the hot path never waits on a writer.
+ */
+
+#ifndef ROSETTAPAD_CORE_MOTION_H
+#define ROSETTAPAD_CORE_MOTION_H
+
+#include <stdint.h>
+
+#include "controllers/controller_interface.h"
+
+#define MOTION_FRAC_BITS        20
+
+/* Canonical units calibrations convert to (same as the DualSense's) */
+#define MOTION_ACC_RES_PER_G        8192
+#define MOTION_GYRO_RES_PER_DEG_S   1024
+
+/* Raw sensor axes, in controller_state_t field order */
+typedef enum {
+    MOTION_SRC_ACCEL_X = 0,
+    MOTION_SRC_ACCEL_Y,
+    MOTION_SRC_ACCEL_Z,
+    MOTION_SRC_GYRO_X,
+    MOTION_SRC_GYRO_Y,
+    MOTION_SRC_GYRO_Z,
+    MOTION_SRC_COUNT
+} motion_source_t;
+
+#define MOTION_SRC_IS_GYRO(src)     ((src) >= MOTION_SRC_GYRO_X)
+
+/* Raw -> canonical: (raw - bias) * numer / denom */
+typedef struct {
+    int16_t bias[MOTION_SRC_COUNT];
+    int32_t numer[MOTION_SRC_COUNT];
+    int32_t denom[MOTION_SRC_COUNT];
+} motion_calib_t;
+
+/* Canonical -> console counts, per output channel (see motion_out) */
+typedef struct {
+    uint16_t center[CONTROLLER_MOTION_OUT_AXES];    /* Output at rest */
+    uint16_t max;                       /* Outputs clamp to 0..max */
+    int32_t accel_numer, accel_denom;   /* Counts per canonical accel unit */
+    int32_t gyro_numer, gyro_denom;     /* Counts per canonical gyro unit */
+} motion_target_t;
+
+/* Which raw axis feeds each output channel, and its sign */
+typedef struct {
+    uint8_t source[CONTROLLER_MOTION_OUT_AXES];     /* motion_source_t */
+    uint8_t invert[CONTROLLER_MOTION_OUT_AXES];     /* 1 = flip sign */
+} motion_mapping_t;
+
+/**
+ * Fill a mapping with the console's natural order (accel X/Y/Z, gyro Z),
+ * no inversion.
+ */
+void motion_mapping_default(motion_mapping_t* map);
+
+/**
+ * Reset every slot to raw passthrough calibration and the default
+ * mapping. Call once before any input is processed.
+ */
+void motion_init(void);
+
+/**
+ * Set the console's output channels (console init). Thread-safe.
+ */
+void motion_set_target(const motion_target_t* target);
+
+/**
+ * Set a slot's calibration, NULL for raw passthrough (disconnect, not yet
+ * loaded). Thread-safe; takes effect on the next motion_apply().
+ */
+void motion_set_calibration(int slot, const motion_calib_t* calib);
+
+/**
+ * Set the axis mapping for all slots. Thread-safe.
+ * @return 0 on success, -1 if a source is out of range (nothing changes)
+ */
+int motion_set_mapping(const motion_mapping_t* map);
+
+/**
+ * Fill state->motion_out from its raw accel/gyro values. Single
+ * consumer: only call from the input thread.
+ */
+void motion_apply(int slot, controller_state_t* state);
+
+#endif /* ROSETTAPAD_CORE_MOTION_H */
@@ -0,0 +1,69 @@
+/*
+ * RosettaPad - Host Poll Synchronisation
+ * =======================================
+ *
+ * Tracks the cadence and phase of a host that polls an endpoint (the
+ * PS3 reading ep1) from transfer completion timestamps, so a report can
+ * be built just before the next poll instead of whenever input arrived.
+ *
+ * Every completion of a queued IN transfer is a host poll. Acquisition
+ * keeps the endpoint queued back to back for POLL_SYNC_ACQUIRE_SAMPLES
+ * polls and takes the mean interval as the period. Tracking then accepts
+ * any later completion (k polls after the last one), nudges phase and
+ * period towards it - a simple PLL - and drops the lock after
+ * POLL_SYNC_MAX_MISSES samples in a row land far from the prediction.
+ *
+ * Single owner, no locking. Times are time_get_ns() values.
+ */
+
+#ifndef ROSETTAPAD_CORE_POLL_SYNC_H
+#define ROSETTAPAD_CORE_POLL_SYNC_H
+
+#include <stdint.h>
+
+#define POLL_SYNC_ACQUIRE_SAMPLES   64
+#define POLL_SYNC_MAX_MISSES        8
+
+typedef struct {
+    int64_t period_q8;          /* Poll period, ns << 8 */
+    uint64_t anchor_ns;         /* Filtered time of the last poll: whole ns... */
+    int64_t anchor_frac_q8;     /* ...plus 0-255 in 1/256 ns */
+    int64_t last_error_ns;      /* Signed phase error of the last tracked poll */
+    uint32_t misses;            /* Consecutive samples outside period / 4 */
+    int locked;
+
+    /* Acquisition window */
+    uint64_t acq_first_ns;
+    uint64_t acq_last_ns;
+    uint32_t acq_count;
+} poll_sync_t;
+
+/**
+ * Drop any lock and start a new acquisition window.
+ */
+void poll_sync_reset(poll_sync_t* ps);
+
+/**
+ * Feed one poll from a back-to-back queued endpoint.
+ * @return 1 once locked (period known), 0 while still acquiring
+ */
+int poll_sync_acquire(poll_sync_t* ps, uint64_t poll_ns);
+
+/**
+ * Feed one poll while locked; sets last_error_ns.
+ * @return 0 if tracked, -1 if the lock was lost (acquire again)
+ */
+int poll_sync_track(poll_sync_t* ps, uint64_t poll_ns);
+
+/**
+ * Predicted time of the first poll at or after a given time.
+ * @return 0 if not locked
+ */
+uint64_t poll_sync_next(const poll_sync_t* ps, uint64_t after_ns);
+
+/**
+ * Current period estimate in ns (0 if not locked).
+ */
+uint64_t poll_sync_period_ns(const poll_sync_t* ps);
+
+#endif /* ROSETTAPAD_CORE_POLL_SYNC_H */
@@ -0,0 +1,52 @@
+/*
+ * RosettaPad - Standby Power
+ * ==========================
+ *
+ * What the adapter does for power while the PS3 is off: an optional
+ * CPU governor switch (--standby-governor, e.g. "powersave") for the
+ * standby period, and a wakeup count for each ACTIVE / STANDBY period
+ * so idle cost can be compared.
+ *
+ * Wakeups are the process's voluntary context switches (getrusage),
+ * i.e. every time a thread blocked and was woken again. Each period
+ * is logged when it ends:
+ *
+ *   [Power] Standby for 3600 s: 251.3 wakeups/s, CPU 0.41%
+ *
+ * The rest of standby is parked through system_state_subscribe(): timers
+ * that only matter while the PS3 is on are disarmed, and pads get a
+ * home-button-only parse.
+ *
+ * Called from system_enter_standby() / system_exit_standby().
+ */
+
+#ifndef ROSETTAPAD_CORE_POWER_H
+#define ROSETTAPAD_CORE_POWER_H
+
+#define POWER_MAX_CPUS          8
+#define POWER_GOVERNOR_MAX      32
+
+/**
+ * Start the first ACTIVE period. Call once from main().
+ */
+void power_init(void);
+
+/**
+ * Switch every CPU to this cpufreq governor while in standby and back
+ * afterwards. NULL (the default) leaves the governor alone. Call before
+ * the first standby.
+ */
+void power_set_standby_governor(const char* governor);
+
+/**
+ * Log the active period's wakeups and apply the standby governor.
+ */
+void power_enter_standby(void);
+
+/**
+ * Put the saved governors back and log the standby period's wakeups.
+ * Safe to call when not in standby (shutdown path).
+ */
+void power_exit_standby(void);
+
+#endif /* ROSETTAPAD_CORE_POWER_H */
@@ -0,0 +1,143 @@
+/*
+ * RosettaPad - Input Recorder / Replayer
+ * =======================================
+ *
+ * Records every parsed controller_state_t (and optionally the raw hidraw
+ * report it came from) to a preallocated, mmap'd file, and plays a
+ * recording back into the controller slots. Groundwork for TAS and for
+ * reproducing field bug reports.
+ *
+ * FILE FORMAT (little-endian):
+ *
+ *   record_header_t, then a stream of records:
+ *
+ *     u8      tag        type << 4 | slot
+ *     varint  dt_us      microseconds since the previous record (any slot)
+ *
+ *     RECORD_TYPE_STATE:
+ *     varint  mask       bit i set = field i changed
+ *     varint  delta[]    zigzag(value - previous value) per changed field,
+ *                        in field order (see record.c); the first state
+ *                        of a slot is relative to all-zero
+ *
+ *     RECORD_TYPE_RAW:
+ *     varint  len
+ *     u8      data[len]  report exactly as read from hidraw
+ *
+ *   A zero tag (or header.used) marks the end of the stream.
+ *
+ * Recording runs on the input thread: encoding is a few dozen bytes of
+ * arithmetic into a stack buffer and one memcpy into the mapping, with no
+ * allocation, syscalls or logging. When the file fills up, recording
+ * stops; the file stays valid at every point, even after a crash.
+ */
+
+#ifndef ROSETTAPAD_CORE_RECORD_H
+#define ROSETTAPAD_CORE_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "controllers/controller_interface.h"
+#include "core/event_loop.h"
+
+#define RECORD_MAGIC    0x43455250  /* "PREC" */
+#define RECORD_VERSION  2
+
+/* Preallocated file size - ~20 bytes per 250 Hz state with motion */
+#define RECORD_DEFAULT_SIZE_MB 32
+
+#define RECORD_TYPE_STATE  1
+#define RECORD_TYPE_RAW    2
+
+/* record_start() / header flags */
+#define RECORD_FLAG_RAW    0x0001  /* Raw hidraw reports are included */
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;             /* RECORD_FLAG_* */
+    uint64_t capacity;          /* Bytes available after the header */
+    uint64_t used;              /* Bytes of record data written */
+    uint64_t start_realtime_s;  /* Wall clock at record_start(), for reports */
+    uint32_t record_count;
+    uint8_t reserved[28];
+} record_header_t;
+
+/* ============================================================================
+ * RECORDING
+ * ============================================================================ */
+
+/**
+ * Create and map a recording file of size_mb megabytes.
+ * @param flags RECORD_FLAG_RAW to also capture raw reports
+ * @return 0 on success, -1 on failure
+ */
+int record_start(const char* path, size_t size_mb, int flags);
+
+/**
+ * Finish the recording: trim the file to its used length and unmap.
+ * Must run on the recording (input) thread or after it has stopped.
+ */
+void record_stop(void);
+
+/**
+ * Append a parsed state for a slot. Timestamped from state->timestamp_ns.
+ * No-op when not recording.
+ */
+void record_state(int slot, const controller_state_t* state);
+
+/**
+ * Append a raw report for a slot, read at read_ns (CLOCK_MONOTONIC).
+ * No-op unless recording with RECORD_FLAG_RAW.
+ */
+void record_raw(int slot, const uint8_t* buf, size_t len, uint64_t read_ns);
+
+/* ============================================================================
+ * REPLAY
+ * ============================================================================ */
+
+/* replay_open() flags */
+#define REPLAY_FLAG_RAW       0x0001  /* Feed raw reports through the driver */
+#define REPLAY_FLAG_SYNC_USB  0x0002  /* Advance on PS3 USB polls, not a timer */
+
+/**
+ * Raw report sink - runs the report through the slot's driver as if it
+ * had just been read from hidraw.
+ */
+typedef void (*replay_raw_fn)(int slot, const uint8_t* buf, size_t len, void* ctx);
+
+/**
+ * Map a recording for playback.
+ * @return 0 on success, -1 if missing, invalid, or REPLAY_FLAG_RAW is
+ *         requested for a recording without raw reports
+ */
+int replay_open(const char* path, int flags);
+
+/**
+ * Start playback on the input thread's event loop.
+ * Without REPLAY_FLAG_SYNC_USB, records are released by an absolute
+ * CLOCK_MONOTONIC timerfd at their recorded offsets.
+ * @return 0 on success, -1 on failure
+ */
+int replay_attach(event_loop_t* loop, replay_raw_fn raw_fn, void* ctx);
+
+/**
+ * Stop playback and unmap the recording.
+ */
+void replay_detach(void);
+
+/**
+ * 1 while a recording is being played back. Live controller input is
+ * dropped meanwhile so it doesn't fight the replayed states.
+ */
+int replay_is_active(void);
+
+/**
+ * PS3 host poll hook (ep1 IN completion at poll_ns). With
+ * REPLAY_FLAG_SYNC_USB, releases every record due by the time of this
+ * poll so the next report carries it; the clock starts at the first poll.
+ */
+void replay_host_poll(uint64_t poll_ns);
+
+#endif /* ROSETTAPAD_CORE_RECORD_H */
@@ -0,0 +1,103 @@
+/*
+ * RosettaPad - Remap / Macro Stage
+ * =================================
+ *
+ * Per-frame transform between the controller driver and the console
+ * layer: controller_state_t goes in after process_input() and comes out
+ * just before controller_slot_state_update().
+ *
+ * A remap_config_t (the user-facing description, carried in the control
+ * plane) is compiled into lookup tables:
+ *
+ *   - buttons: three 256-entry tables indexed by a byte of the input
+ *     mask each, OR'd together - any many-to-many button mapping costs
+ *     three loads
+ *   - axes: one 256-entry response curve per axis with deadzone,
+ *     anti-deadzone, sensitivity and inversion baked in
+ *   - macros: preallocated step sequences started by a trigger button
+ *
+ * Compiled tables are swapped in through a triple buffer, so a new
+ * profile takes effect atomically on the next frame and the hot path
+ * never waits, allocates or sees a half-built table.
+ */
+
+#ifndef ROSETTAPAD_CORE_REMAP_H
+#define ROSETTAPAD_CORE_REMAP_H
+
+#include <stdint.h>
+
+#include "controllers/controller_interface.h"
+
+#define REMAP_MAX_MACROS        4
+#define REMAP_MAX_MACRO_STEPS   16
+
+/* macro trigger value for an unused macro */
+#define REMAP_BTN_NONE          0xFF
+
+/* Default stick deadzone (raw units either side of center) */
+#define REMAP_DEFAULT_DEADZONE  6
+
+typedef enum {
+    REMAP_AXIS_LX = 0,
+    REMAP_AXIS_LY,
+    REMAP_AXIS_RX,
+    REMAP_AXIS_RY,
+    REMAP_AXIS_L2,
+    REMAP_AXIS_R2,
+    REMAP_AXIS_COUNT
+} remap_axis_id_t;
+
+typedef struct {
+    uint8_t deadzone;           /* Sticks: from center, triggers: from 0 */
+    uint8_t anti_deadzone;      /* Output starts here once past the deadzone */
+    uint8_t sensitivity;        /* Percent of full scale, 100 = linear */
+    uint8_t invert;             /* 1 = flip direction */
+} remap_axis_t;
+
+typedef struct {
+    uint32_t buttons;           /* BTN_* mask held during this step */
+    uint16_t duration_ms;
+    uint16_t reserved;
+} remap_macro_step_t;
+
+typedef struct {
+    uint8_t trigger;            /* BTN_* that starts it, REMAP_BTN_NONE = unused */
+    uint8_t step_count;
+    uint8_t repeat;             /* 1 = loop while the trigger is held */
+    uint8_t reserved;
+    remap_macro_step_t steps[REMAP_MAX_MACRO_STEPS];
+} remap_macro_t;
+
+typedef struct {
+    /* Output BTN_* mask for each input button, 0 = disabled.
+       A macro's trigger is consumed and never reaches the output. */
+    uint32_t button_map[BTN_COUNT];
+    remap_axis_t axes[REMAP_AXIS_COUNT];
+    remap_macro_t macros[REMAP_MAX_MACROS];
+} remap_config_t;
+
+/**
+ * Fill a config with the pass-through profile (identity buttons, linear
+ * axes, REMAP_DEFAULT_DEADZONE on the sticks, no macros).
+ */
+void remap_config_default(remap_config_t* cfg);
+
+/**
+ * Install the default profile. Call once before any input is processed.
+ */
+void remap_init(void);
+
+/**
+ * Compile a config and swap it in. Thread-safe; takes effect on the
+ * next remap_apply().
+ * @return 0 on success, -1 if the config is invalid (nothing changes)
+ */
+int remap_load(const remap_config_t* cfg);
+
+/**
+ * Transform one frame in place. Single consumer: only call from the
+ * input thread. Macro timing follows state->timestamp_ns.
+ */
+void remap_apply(int slot, controller_state_t* state);
+
+#endif /* ROSETTAPAD_CORE_REMAP_H */
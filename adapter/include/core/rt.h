@@ -0,0 +1,58 @@
+/*
+ * RosettaPad - Real-Time Threads
+ * ===============================
+ *
+ * Opt-in real-time mode (--realtime). Every adapter thread is started
+ * through rt_thread_create() with a role; in real-time mode the role's
+ * entry in the table in rt.c gives it a SCHED_FIFO priority and a CPU
+ * affinity, so the input -> USB path is not queued behind the web panel
+ * and system daemons. Most work runs on the reactor (the input thread's
+ * event loop); the other threads only do work that may block.
+ *
+ * rt_init() locks all memory (mlockall) and disables malloc trimming,
+ * and each thread prefaults its stack before running, so the hot path
+ * never takes a page fault. Thread stacks are kept small in this mode,
+ * since locked memory is resident memory.
+ *
+ * Without the privileges (root, CAP_SYS_NICE / CAP_IPC_LOCK or matching
+ * RLIMIT_RTPRIO / RLIMIT_MEMLOCK), the missing parts are logged once at
+ * startup and threads run as they would without --realtime.
+ *
+ * Best results come with the reactor core kept free of other work, e.g.
+ * isolcpus=3 on the kernel command line.
+ */
+
+#ifndef ROSETTAPAD_CORE_RT_H
+#define ROSETTAPAD_CORE_RT_H
+
+#include <pthread.h>
+
+/* Stack per thread and how much of it is prefaulted (real-time mode) */
+#define RT_STACK_SIZE           (256 * 1024)
+#define RT_STACK_PREFAULT       (64 * 1024)
+
+typedef enum {
+    RT_ROLE_REACTOR = 0,        /* hidraw, USB ep0/ep1/ep2, BT sockets, timers */
+    RT_ROLE_OUTPUT,             /* Rumble / LED forwarding */
+    RT_ROLE_BT,                 /* Blocking BT scan worker */
+    RT_ROLE_METRICS,            /* Metrics scrapes (core/metrics.h) */
+    RT_ROLE_LOG,                /* Log drain, the only stdout writer (core/log.h) */
+    RT_ROLE_COUNT
+} rt_role_t;
+
+/**
+ * Enter real-time mode: check privileges, lock memory and log the
+ * thread table. Call once from main() before any thread is started.
+ * @return 0 if everything was applied, -1 if something is missing (logged)
+ */
+int rt_init(void);
+
+/**
+ * pthread_create() for an adapter thread. Outside real-time mode this
+ * only names the thread. Falls back to default attributes if the
+ * scheduling attributes are refused.
+ * @return 0 on success, an errno value on failure (like pthread_create)
+ */
+int rt_thread_create(pthread_t* tid, rt_role_t role, void* (*fn)(void*), void* arg);
+
+#endif /* ROSETTAPAD_CORE_RT_H */
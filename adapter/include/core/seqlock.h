@@ -0,0 +1,105 @@
+/*
+ * RosettaPad - Sequence Latch
+ * ============================
+ *
+ * Lock-free publication of small structs between threads.
+ *
+ * This is a "latched" seqlock (same scheme as the kernel's
+ * raw_write_seqcount_latch): the writer keeps two copies and flips the
+ * sequence counter before updating each one, so there is always a stable
+ * copy for readers to use.
+ *
+ * - Readers never block and never take a lock. They only retry if a whole
+ *   update completed while they were copying (rare, and bounded).
+ * - Writers never wait for readers. Multiple writers serialize through a
+ *   tiny spinlock that readers never touch.
+ *
+ * Usage:
+ *   static seqlatch_t g_latch = SEQLATCH_INIT;
+ *   static my_type_t g_copies[2];
+ *
+ *   seqlatch_write(&g_latch, g_copies, &value, sizeof(value));
+ *   seqlatch_read(&g_latch, g_copies, &out, sizeof(out));
+ */
+
+#ifndef ROSETTAPAD_CORE_SEQLOCK_H
+#define ROSETTAPAD_CORE_SEQLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t sequence;      /* Bumped twice per write; low bit selects copy */
+    int write_lock;         /* Serializes writers only */
+} seqlatch_t;
+
+#define SEQLATCH_INIT { .sequence = 0, .write_lock = 0 }
+
+static inline void seqlatch_cpu_relax(void) {
+#if defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause" ::: "memory");
+#endif
+}
+
+static inline void seqlatch_write_lock(seqlatch_t* latch) {
+    while (__atomic_exchange_n(&latch->write_lock, 1, __ATOMIC_ACQUIRE)) {
+        seqlatch_cpu_relax();
+    }
+}
+
+static inline void seqlatch_write_unlock(seqlatch_t* latch) {
+    __atomic_store_n(&latch->write_lock, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Publish new data. Caller must hold the write lock (or be the only writer).
+ * @param copies Array of two objects of `size` bytes
+ */
+static inline void seqlatch_publish(seqlatch_t* latch, void* copies,
+                                    const void* src, size_t size) {
+    uint8_t* base = (uint8_t*)copies;
+    uint32_t seq = __atomic_load_n(&latch->sequence, __ATOMIC_RELAXED);
+
+    /* Odd: readers move to copy[1] while copy[0] is rewritten */
+    __atomic_store_n(&latch->sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(base, src, size);
+
+    /* Even: readers move back to copy[0] while copy[1] catches up */
+    __atomic_store_n(&latch->sequence, seq + 2, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(base + size, src, size);
+}
+
+/**
+ * Publish new data, serializing against other writers.
+ */
+static inline void seqlatch_write(seqlatch_t* latch, void* copies,
+                                  const void* src, size_t size) {
+    seqlatch_write_lock(latch);
+    seqlatch_publish(latch, copies, src, size);
+    seqlatch_write_unlock(latch);
+}
+
+/**
+ * Read the latest published data. Never blocks.
+ * @return Sequence number the copy was taken at
+ */
+static inline uint32_t seqlatch_read(const seqlatch_t* latch, const void* copies,
+                                     void* dst, size_t size) {
+    const uint8_t* base = (const uint8_t*)copies;
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&latch->sequence, __ATOMIC_ACQUIRE);
+        memcpy(dst, base + (seq & 1) * size, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&latch->sequence, __ATOMIC_RELAXED) != seq);
+
+    return seq;
+}
+
+#endif /* ROSETTAPAD_CORE_SEQLOCK_H */
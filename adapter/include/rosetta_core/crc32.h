@@ -0,0 +1,48 @@
+/*
+ * RosettaPad Core - CRC32
+ * ========================
+ *
+ * Portable IEEE 802.3 CRC32 (reflected polynomial 0xEDB88320, zlib
+ * semantics) over caller-owned tables. Part of librosetta_core: no OS,
+ * heap or stdio (see rosetta_core/rosetta_core.h).
+ *
+ * The daemon dispatches to the ARMv8 CRC instructions on top of this
+ * (core/crc32.h); a microcontroller port uses it directly.
+ */
+
+#ifndef ROSETTAPAD_RC_CRC32_H
+#define ROSETTAPAD_RC_CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* tables[0] is the classic bytewise table; [k] advances k more bytes */
+typedef struct {
+    uint32_t tables[8][256];
+} rc_crc32_t;
+
+/**
+ * CRC function a core context calls for report checks: zlib semantics,
+ * any implementation (core/crc32.h's crc32_update() fits).
+ */
+typedef uint32_t (*rc_crc32_fn)(uint32_t crc, const uint8_t* data, size_t len);
+
+/**
+ * Fill the tables. Call once before any update.
+ */
+void rc_crc32_init(rc_crc32_t* crc);
+
+/**
+ * Continue a CRC32 over more data, slice-by-8.
+ * @param value 0 to start, or the result of a previous call to chain buffers
+ * @return Updated CRC32
+ */
+uint32_t rc_crc32_update(const rc_crc32_t* crc, uint32_t value, const uint8_t* data, size_t len);
+
+/**
+ * Same result as rc_crc32_update(), one table lookup per byte.
+ */
+uint32_t rc_crc32_update_bytewise(const rc_crc32_t* crc, uint32_t value,
+                                  const uint8_t* data, size_t len);
+
+#endif /* ROSETTAPAD_RC_CRC32_H */
@@ -0,0 +1,204 @@
+/*
+ * RosettaPad Core - DualShock 3 Protocol
+ * =======================================
+ *
+ * Generic controller state -> DS3 input report, the DS3 feature reports
+ * and SET_REPORT handling, and DS3 output report (rumble/LED) decoding.
+ * Part of librosetta_core: the translation tables, feature reports and
+ * captured console MAC live in a caller-owned rc_ds3_t (see
+ * rosetta_core/rosetta_core.h).
+ *
+ * console/ps3/ds3_emulation wraps one context for the daemon and adds
+ * the shared report frames, logging and the controller output plumbing.
+ */
+
+#ifndef ROSETTAPAD_RC_DS3_H
+#define ROSETTAPAD_RC_DS3_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "controllers/controller_interface.h"
+
+/* ============================================================================
+ * DS3 REPORT CONSTANTS
+ * ============================================================================ */
+
+#define DS3_INPUT_REPORT_SIZE   49
+#define DS3_FEATURE_REPORT_SIZE 64
+
+/* Report IDs */
+#define DS3_REPORT_CAPABILITIES 0x01
+#define DS3_REPORT_BT_MAC       0xF2
+#define DS3_REPORT_PAIRING      0xF5
+#define DS3_REPORT_CALIBRATION  0xF7
+#define DS3_REPORT_STATUS       0xF8
+#define DS3_REPORT_EF           0xEF
+
+/* Battery status values */
+#define DS3_BATTERY_SHUTDOWN    0x00
+#define DS3_BATTERY_DYING       0x01
+#define DS3_BATTERY_LOW         0x02
+#define DS3_BATTERY_MEDIUM      0x03
+#define DS3_BATTERY_HIGH        0x04
+#define DS3_BATTERY_FULL        0x05
+#define DS3_BATTERY_CHARGING    0xEE
+#define DS3_BATTERY_CHARGED     0xEF
+
+/* Connection status values */
+#define DS3_STATUS_PLUGGED      0x02
+#define DS3_STATUS_UNPLUGGED    0x03
+#define DS3_CONN_USB            0x12
+#define DS3_CONN_USB_RUMBLE     0x10
+#define DS3_CONN_BT             0x16
+#define DS3_CONN_BT_RUMBLE      0x14
+
+/* ============================================================================
+ * DS3 BUTTON MASKS
+ * ============================================================================ */
+
+/* Byte 2 */
+#define DS3_BTN_SELECT      0x01
+#define DS3_BTN_L3          0x02
+#define DS3_BTN_R3          0x04
+#define DS3_BTN_START       0x08
+#define DS3_BTN_DPAD_UP     0x10
+#define DS3_BTN_DPAD_RIGHT  0x20
+#define DS3_BTN_DPAD_DOWN   0x40
+#define DS3_BTN_DPAD_LEFT   0x80
+
+/* Byte 3 */
+#define DS3_BTN_L2          0x01
+#define DS3_BTN_R2          0x02
+#define DS3_BTN_L1          0x04
+#define DS3_BTN_R1          0x08
+#define DS3_BTN_TRIANGLE    0x10
+#define DS3_BTN_CIRCLE      0x20
+#define DS3_BTN_CROSS       0x40
+#define DS3_BTN_SQUARE      0x80
+
+/* Byte 4 */
+#define DS3_BTN_PS          0x01
+
+/* ============================================================================
+ * DS3 REPORT OFFSETS
+ * ============================================================================ */
+
+#define DS3_OFF_REPORT_ID     0
+#define DS3_OFF_BUTTONS1      2
+#define DS3_OFF_BUTTONS2      3
+#define DS3_OFF_PS_BUTTON     4
+#define DS3_OFF_LX            6
+#define DS3_OFF_LY            7
+#define DS3_OFF_RX            8
+#define DS3_OFF_RY            9
+#define DS3_OFF_L2_PRESSURE   18
+#define DS3_OFF_R2_PRESSURE   19
+#define DS3_OFF_BATTERY       29
+#define DS3_OFF_CHARGE        30
+#define DS3_OFF_CONNECTION    31
+#define DS3_OFF_ACCEL_X       40
+#define DS3_OFF_ACCEL_Y       42
+#define DS3_OFF_ACCEL_Z       44
+#define DS3_OFF_GYRO_Z        46
+
+/* DS3 motion channels at rest (accel X, Y, Z, gyro Z), 10-bit unsigned */
+#define DS3_MOTION_MAX          1023
+#define DS3_MOTION_CENTER_ACCEL 512
+#define DS3_MOTION_CENTER_GYRO  498
+
+/* ============================================================================
+ * CONTEXT
+ * ============================================================================ */
+
+/*
+ * The 19-bit generic button mask is looked up in 7/7/5-bit chunks; each
+ * entry holds its contribution to bytes 2-4 packed as
+ * buttons1 | buttons2 << 8 | ps << 16.
+ */
+#define DS3_BTN_CHUNK_BITS      7
+#define DS3_BTN_CHUNKS          3
+
+typedef struct {
+    /* Translation tables, built by rc_ds3_init() */
+    uint32_t button_lut[DS3_BTN_CHUNKS][1 << DS3_BTN_CHUNK_BITS];
+    uint8_t dpad_pressure_lut[16][4];   /* Buttons1 >> 4 -> bytes 10-13 */
+    uint8_t face_pressure_lut[64][6];   /* Buttons2 >> 2 -> bytes 20-25 */
+    uint8_t battery_lut[256];           /* battery_level -> charge byte */
+    
+    /* Feature reports as GET_REPORT returns them */
+    uint8_t report_01[DS3_FEATURE_REPORT_SIZE];
+    uint8_t report_f2[DS3_FEATURE_REPORT_SIZE];
+    uint8_t report_f5[DS3_FEATURE_REPORT_SIZE];
+    uint8_t report_f7[DS3_FEATURE_REPORT_SIZE];
+    uint8_t report_f8[DS3_FEATURE_REPORT_SIZE];
+    uint8_t report_ef[DS3_FEATURE_REPORT_SIZE];
+    
+    /* Console Bluetooth MAC (from SET_REPORT 0xF5) */
+    uint8_t ps3_mac[6];
+    int ps3_mac_valid;
+} rc_ds3_t;
+
+/* rc_ds3_handle_set_report() results */
+#define RC_DS3_SET_IGNORED      0
+#define RC_DS3_SET_STORED       1       /* Report kept for GET_REPORT */
+#define RC_DS3_SET_PS3_MAC      2       /* Console MAC captured */
+
+/* ============================================================================
+ * FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * Build the tables and reset the feature reports.
+ */
+void rc_ds3_init(rc_ds3_t* ds3);
+
+/**
+ * Translate generic controller state into a DS3 input report (USB
+ * layout: plugged/USB status bytes).
+ * @param out_report DS3_INPUT_REPORT_SIZE bytes
+ */
+void rc_ds3_translate(const rc_ds3_t* ds3, const controller_state_t* state, uint8_t* out_report);
+
+/**
+ * Copy the report an idle, centered pad produces.
+ * @param out_report DS3_INPUT_REPORT_SIZE bytes
+ */
+void rc_ds3_neutral_report(uint8_t* out_report);
+
+/**
+ * Put the host (adapter) Bluetooth MAC into reports 0xF5 and 0xF2.
+ * @param mac 6-byte MAC address
+ */
+void rc_ds3_set_host_mac(rc_ds3_t* ds3, const uint8_t* mac);
+
+/**
+ * Get a feature report by ID.
+ * @param out_name Optional output for the report name
+ * @return DS3_FEATURE_REPORT_SIZE bytes, or NULL if unknown
+ */
+const uint8_t* rc_ds3_feature_report(const rc_ds3_t* ds3, uint8_t report_id,
+                                     const char** out_name);
+
+/**
+ * Apply a SET_REPORT from the console.
+ * @return RC_DS3_SET_* result
+ */
+int rc_ds3_handle_set_report(rc_ds3_t* ds3, uint8_t report_id, const uint8_t* data, size_t len);
+
+/**
+ * DualSense player LED pattern for a DS3 player number.
+ * @param player Player number (1-4)
+ * @return 5-bit LED mask, 0 if out of range
+ */
+uint8_t rc_ds3_player_led_mask(int player);
+
+/**
+ * Decode a DS3 output report into rumble and player LEDs. Fields the
+ * report doesn't carry keep their value.
+ * @param output In/out: the slot's current output state
+ * @return 0 on success, -1 if too short
+ */
+int rc_ds3_parse_output_report(const uint8_t* data, size_t len, controller_output_t* output);
+
+#endif /* ROSETTAPAD_RC_DS3_H */
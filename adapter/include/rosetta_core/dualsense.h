@@ -0,0 +1,202 @@
+/*
+ * RosettaPad Core - DualSense Protocol
+ * =====================================
+ *
+ * DualSense Bluetooth report 0x31 decoding, output report encoding and
+ * Feature Report 0x05 calibration parsing. Part of librosetta_core: all
+ * per-pad state lives in a caller-owned rc_ds_t, nothing here touches
+ * the OS (see rosetta_core/rosetta_core.h).
+ *
+ * controllers/dualsense does the hidraw, sysfs and calibration-cache I/O
+ * around it.
+ */
+
+#ifndef ROSETTAPAD_RC_DUALSENSE_H
+#define ROSETTAPAD_RC_DUALSENSE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "controllers/controller_interface.h"
+#include "rosetta_core/crc32.h"
+
+/* ============================================================================
+ * BLUETOOTH REPORT FORMAT
+ * ============================================================================ */
+
+#define DS_BT_REPORT_ID       0x31
+#define DS_BT_INPUT_SIZE      78
+#define DS_BT_OUTPUT_SIZE     78
+#define DS_BT_INPUT_HEADER    0xA1    /* HIDP DATA | INPUT, covered by the CRC */
+#define DS_BT_OUTPUT_HEADER   0xA2    /* HIDP DATA | OUTPUT, covered by the CRC */
+#define DS_BT_CRC_OFFSET      74      /* CRC32 (LE) in the last 4 bytes */
+
+/* Input report byte offsets */
+#define DS_OFF_REPORT_ID      0
+#define DS_OFF_COUNTER        1
+#define DS_OFF_LX             2
+#define DS_OFF_LY             3
+#define DS_OFF_RX             4
+#define DS_OFF_RY             5
+#define DS_OFF_L2             6
+#define DS_OFF_R2             7
+#define DS_OFF_STATUS         8
+#define DS_OFF_BUTTONS1       9    /* D-pad (low nibble) + face buttons */
+#define DS_OFF_BUTTONS2       10   /* Shoulders, sticks, options/create */
+#define DS_OFF_BUTTONS3       11   /* PS, touchpad, mute */
+#define DS_OFF_GYRO_X         16
+#define DS_OFF_GYRO_Y         18
+#define DS_OFF_GYRO_Z         20
+#define DS_OFF_ACCEL_X        22
+#define DS_OFF_ACCEL_Y        24
+#define DS_OFF_ACCEL_Z        26
+#define DS_OFF_TOUCHPAD       34
+#define DS_OFF_BATTERY        54
+
+/* Button masks - Byte 9 (buttons1) */
+#define DS_BTN1_SQUARE        0x10
+#define DS_BTN1_CROSS         0x20
+#define DS_BTN1_CIRCLE        0x40
+#define DS_BTN1_TRIANGLE      0x80
+
+/* Button masks - Byte 10 (buttons2) */
+#define DS_BTN2_L1            0x01
+#define DS_BTN2_R1            0x02
+#define DS_BTN2_L2            0x04
+#define DS_BTN2_R2            0x08
+#define DS_BTN2_CREATE        0x10
+#define DS_BTN2_OPTIONS       0x20
+#define DS_BTN2_L3            0x40
+#define DS_BTN2_R3            0x80
+
+/* Button masks - Byte 11 (buttons3) */
+#define DS_BTN3_PS            0x01
+#define DS_BTN3_TOUCHPAD      0x02
+#define DS_BTN3_MUTE          0x04
+
+/* Output report byte offsets (BT report 0x31) */
+#define DS_OUT_OFF_VALID_FLAG1      4
+#define DS_OUT_OFF_VALID_FLAG2      41
+#define DS_OUT_OFF_LIGHTBAR_SETUP   44
+#define DS_OUT_OFF_LED_BRIGHTNESS   45
+#define DS_OUT_OFF_PLAYER_LEDS      46
+#define DS_OUT_OFF_LIGHTBAR_R       47
+#define DS_OUT_OFF_LIGHTBAR_G       48
+#define DS_OUT_OFF_LIGHTBAR_B       49
+
+/* Output valid flags */
+#define DS_OUT_FLAG1_LIGHTBAR       0x04
+#define DS_OUT_FLAG1_PLAYER_LEDS    0x10
+#define DS_OUT_FLAG2_LIGHTBAR_SETUP 0x02
+#define DS_LIGHTBAR_SETUP_LIGHT_OUT 0x02   /* Fade out the boot light */
+
+/* Touchpad constants */
+#define DS_TOUCHPAD_WIDTH     1920
+#define DS_TOUCHPAD_HEIGHT    1080
+#define DS_TOUCH_INACTIVE     0x80
+
+/* ============================================================================
+ * CALIBRATION DATA
+ * 
+ * DualSense provides calibration data via Feature Report 0x05 (41 bytes).
+ * This data defines the sensor ranges and biases for proper motion scaling.
+ * ============================================================================ */
+
+#define DS_FEATURE_REPORT_CALIBRATION       0x05
+#define DS_FEATURE_REPORT_CALIBRATION_SIZE  41
+
+/* DualSense hardware limits (from kernel hid-playstation.c) */
+#define DS_ACC_RES_PER_G       8192   /* Accelerometer resolution per g */
+#define DS_ACC_RANGE           (4 * DS_ACC_RES_PER_G)  /* ±4g range */
+#define DS_GYRO_RES_PER_DEG_S  1024   /* Gyroscope resolution per degree/s */
+#define DS_GYRO_RANGE          (2048 * DS_GYRO_RES_PER_DEG_S)  /* ±2048 deg/s */
+
+/* Per-axis calibration data */
+typedef struct {
+    int16_t bias;       /* Zero offset */
+    int sens_numer;     /* Sensitivity numerator */
+    int sens_denom;     /* Sensitivity denominator */
+} ds_axis_calib_t;
+
+/* Full calibration structure */
+typedef struct {
+    ds_axis_calib_t gyro[3];   /* Pitch, Yaw, Roll */
+    ds_axis_calib_t accel[3];  /* X, Y, Z */
+    int valid;                  /* 1 if calibration loaded successfully */
+} ds_calibration_t;
+
+/* ============================================================================
+ * PER-PAD CONTEXT
+ * ============================================================================ */
+
+/* Touchpad-as-right-stick: this many pixels of swipe = full deflection */
+#define DS_TOUCH_STICK_SPAN     400
+
+typedef struct {
+    /* Report CRCs: crc32 if set, else a slice-by-8 walk of crc_table */
+    rc_crc32_fn crc32;
+    const rc_crc32_t* crc_table;
+    
+    int touchpad_as_right_stick;    /* Option, may change between reports */
+    
+    /* Touchpad-as-stick anchor */
+    int touch_initial_x;
+    int touch_initial_y;
+    int touch_was_active;
+    
+    uint8_t output_seq;             /* Output report sequence (4 bits) */
+    uint32_t crc_errors;            /* Input reports dropped for a bad CRC */
+} rc_ds_t;
+
+/* rc_ds_build_output() flags */
+#define RC_DS_OUT_LEDS              (1u << 0)   /* Lightbar + player LEDs in the report */
+#define RC_DS_OUT_LIGHTBAR_SETUP    (1u << 1)   /* Also release the boot light fade */
+
+/* ============================================================================
+ * FUNCTIONS
+ * ============================================================================ */
+
+/**
+ * Reset a pad context.
+ * @param crc32 CRC implementation for report checks, NULL to use crc_table
+ * @param crc_table Initialized tables (rc_crc32_init()), used if crc32 is NULL
+ */
+void rc_ds_init(rc_ds_t* ds, rc_crc32_fn crc32, const rc_crc32_t* crc_table);
+
+/**
+ * Decode a Bluetooth 0x31 input report into generic state. Motion stays
+ * in raw counts, timestamps are left 0 for the caller.
+ * @return 0 on success, -1 if not a 0x31 report or the CRC is wrong
+ *         (ds->crc_errors counts the latter)
+ */
+int rc_ds_parse_input(rc_ds_t* ds, const uint8_t* buf, size_t len, controller_state_t* out_state);
+
+/**
+ * Standby check: only the PS button matters, and the CRC only runs when
+ * it reads as pressed.
+ * @return 1 if PS is pressed, 0 if not, -1 if not a valid 0x31 report
+ */
+int rc_ds_parse_standby_input(const rc_ds_t* ds, const uint8_t* buf, size_t len);
+
+/**
+ * D-pad nibble of buttons1 -> BTN_DPAD_* bits in out_state.
+ */
+void rc_ds_parse_dpad(uint8_t buttons1, controller_state_t* out_state);
+
+/**
+ * Encode a Bluetooth output report (rumble, and LEDs with RC_DS_OUT_LEDS),
+ * CRC included. Advances the output sequence.
+ * @param out_report DS_BT_OUTPUT_SIZE bytes
+ */
+void rc_ds_build_output(rc_ds_t* ds, const controller_output_t* output, uint32_t flags,
+                        uint8_t* out_report);
+
+/**
+ * Parse Feature Report 0x05 (report ID in buf[0]). Axes with a zero
+ * range fall back to raw passthrough scaling.
+ * @param len Bytes in buf, at least DS_FEATURE_REPORT_CALIBRATION_SIZE
+ * @return Bitmask of replaced axes (gyro 0-2, accel 3-5), -1 if too short
+ */
+int rc_ds_parse_calibration(const uint8_t* buf, size_t len, ds_calibration_t* calib);
+
+#endif /* ROSETTAPAD_RC_DUALSENSE_H */
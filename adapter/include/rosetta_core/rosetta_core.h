@@ -0,0 +1,33 @@
+/*
+ * RosettaPad Core Library (librosetta_core)
+ * ==========================================
+ *
+ * The translation logic, separated from the Linux daemon so it can run
+ * on a microcontroller (the planned Pico 2W port) unchanged:
+ *
+ *   rosetta_core/crc32.h       CRC32 for the DualSense BT reports
+ *   rosetta_core/dualsense.h   DualSense input/output/calibration reports
+ *   rosetta_core/ds3.h         DS3 input translation, feature and output reports
+ *
+ * Rules for everything in src/rosetta_core:
+ *   - No OS: C library use is limited to memcpy/memset/memcmp. No
+ *     threads, clocks, files, heap or printf.
+ *   - No hidden state: every mutable byte lives in a context struct the
+ *     caller owns and passes in. No globals, no function statics;
+ *     constant tables only.
+ *   - Fixed sizes: buffers are the protocol sizes, nothing grows.
+ *
+ * "make core" builds build/librosetta_core.a on its own with strict
+ * warnings, rejects any other external symbol and any function using
+ * more than CORE_STACK_MAX bytes of stack, and prints code size and
+ * per-function stack usage. The daemon links the same archive.
+ */
+
+#ifndef ROSETTAPAD_ROSETTA_CORE_H
+#define ROSETTAPAD_ROSETTA_CORE_H
+
+#include "rosetta_core/crc32.h"
+#include "rosetta_core/dualsense.h"
+#include "rosetta_core/ds3.h"
+
+#endif /* ROSETTAPAD_ROSETTA_CORE_H */
@@ -0,0 +1,130 @@
+/*
+ * RosettaPad - Loopback Console Sink
+ * ===================================
+ *
+ * DS3 report consumer that measures instead of sending (see
+ * console/loopback/loopback_sink.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "core/common.h"
+#include "core/log.h"
+#include "console/ps3/ds3_emulation.h"
+#include "console/loopback/loopback_sink.h"
+#include "controllers/loopback/loopback_pad.h"
+
+static event_loop_t* g_sink_loop = NULL;
+static int g_sink_fd = -1;
+static uint32_t g_last_seq = 0;
+
+/* Window state, shared with the thread running the sweep */
+static pthread_mutex_t g_sink_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_window_open = 0;
+static uint8_t g_seen[65536 / 8];
+static uint64_t g_samples[LOOPBACK_MAX_SAMPLES];
+static uint32_t g_sample_count = 0;
+static uint32_t g_received = 0;
+static uint32_t g_duplicated = 0;
+
+static void on_state(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0) return;
+
+    /* Same steps as the ep1 path: take the frame, ship it if the bytes changed */
+    const ds3_frame_t* frame = ds3_frame_acquire();
+    uint64_t built_ns = time_get_ns();
+    int changed = frame->seq != g_last_seq;
+    g_last_seq = frame->seq;
+    uint16_t seq = LOOPBACK_SEQ_FROM(frame->usb[DS3_OFF_L2_PRESSURE],
+                                     frame->usb[DS3_OFF_R2_PRESSURE]);
+    ds3_frame_release(frame);
+    if (!changed) return;
+    if (seq == 0) return;   /* Neutral state on attach/detach */
+
+    uint64_t sent_ns = loopback_pad_sent_ns(seq);
+
+    pthread_mutex_lock(&g_sink_lock);
+    if (g_window_open && sent_ns) {
+        uint8_t bit = (uint8_t)(1u << (seq & 7));
+        if (g_seen[seq >> 3] & bit) {
+            g_duplicated++;
+        } else {
+            g_seen[seq >> 3] |= bit;
+            g_received++;
+            if (g_sample_count < LOOPBACK_MAX_SAMPLES) {
+                g_samples[g_sample_count++] = built_ns - sent_ns;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_sink_lock);
+}
+
+int loopback_sink_attach(event_loop_t* loop) {
+    g_sink_fd = controller_state_subscribe();
+    if (g_sink_fd < 0) {
+        LOG_ERROR("[Loopback] Error: No state subscriber slot for the sink\n");
+        return -1;
+    }
+    if (event_loop_add(loop, g_sink_fd, EPOLLIN, on_state, NULL) < 0) {
+        controller_state_unsubscribe(g_sink_fd);
+        close(g_sink_fd);
+        g_sink_fd = -1;
+        return -1;
+    }
+    g_sink_loop = loop;
+    LOG_INFO("[Loopback] Console sink attached (replaces ep1)\n");
+    return 0;
+}
+
+void loopback_sink_detach(void) {
+    if (g_sink_fd >= 0) {
+        if (g_sink_loop) event_loop_remove(g_sink_loop, g_sink_fd);
+        controller_state_unsubscribe(g_sink_fd);
+        close(g_sink_fd);
+        g_sink_fd = -1;
+    }
+    g_sink_loop = NULL;
+}
+
+void loopback_sink_begin(void) {
+    pthread_mutex_lock(&g_sink_lock);
+    memset(g_seen, 0, sizeof(g_seen));
+    g_sample_count = 0;
+    g_received = 0;
+    g_duplicated = 0;
+    g_window_open = 1;
+    pthread_mutex_unlock(&g_sink_lock);
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void loopback_sink_end(uint32_t sent, loopback_result_t* out) {
+    pthread_mutex_lock(&g_sink_lock);
+    g_window_open = 0;
+
+    memset(out, 0, sizeof(*out));
+    out->sent = sent;
+    out->received = g_received;
+    out->dropped = sent > g_received ? sent - g_received : 0;
+    out->duplicated = g_duplicated;
+
+    uint32_t n = g_sample_count;
+    if (n > 0) {
+        qsort(g_samples, n, sizeof(g_samples[0]), cmp_u64);
+        out->p50_ns = g_samples[n / 2];
+        out->p90_ns = g_samples[(uint64_t)n * 90 / 100];
+        out->p99_ns = g_samples[(uint64_t)n * 99 / 100];
+        out->max_ns = g_samples[n - 1];
+    }
+    pthread_mutex_unlock(&g_sink_lock);
+}
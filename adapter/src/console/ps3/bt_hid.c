@@ -5,24 +5,30 @@
  * L2CAP HID connections for motion data and wake functionality.
  */
 
+#define _GNU_SOURCE     /* strcasestr */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <poll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
-#include <sys/time.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/l2cap.h>
 #include <bluetooth/hci.h>
 #include <bluetooth/hci_lib.h>
 
 #include "core/common.h"
+#include "core/latency.h"
+#include "core/metrics.h"
+#include "core/log.h"
 #include "console/ps3/ds3_emulation.h"
 #include "console/ps3/bt_hid.h"
+#include "console/ps3/bt_qos.h"
 #include "console/ps3/usb_gadget.h"
 
 /* ============================================================================
@@ -36,11 +42,27 @@ ps3_bt_ctx_t g_ps3_bt_ctx = {
     .ps3_addr_valid = 0,
     .packets_sent = 0,
     .packets_dropped = 0,
-    .reconnect_count = 0
+    .reconnect_count = 0,
+    .input_rate_hz = PS3_BT_DEFAULT_RATE_HZ
 };
 
 static int g_bt_adapter_ready = 0;
 
+static void bt_set_state(bt_state_t state) {
+    g_ps3_bt_ctx.state = state;
+    metrics_gauge_set(METRIC_GAUGE_BT_STATE, state);
+}
+
+/* Scan worker jobs (bitmask), posted through g_bt_job_fd */
+#define BT_JOB_SCAN     0x01
+
+static int g_bt_job_fd = -1;        /* Reactor -> worker, blocking eventfd */
+static int g_bt_notify_fd = -1;     /* Worker / ps3_bt_wake() -> reactor */
+static int g_bt_jobs = 0;
+static int g_bt_busy = 0;           /* Worker owns the link while set */
+static int g_bt_scan_done = 0;
+static int g_bt_wake_requested = 0;
+
 /* Sony OUI prefixes */
 static const uint8_t SONY_OUI[][3] = {
     {0x00, 0x1E, 0xA9}, {0x00, 0x19, 0xC1}, {0x00, 0x1D, 0xD9},
@@ -127,7 +149,7 @@ int ps3_bt_save_addr(void) {
     fprintf(f, "%s\n", mac);
     fclose(f);
     
-    printf("[BT] Saved PS3 MAC: %s\n", mac);
+    LOG_INFO("[BT] Saved PS3 MAC: %s\n", mac);
     return 0;
 }
 
@@ -142,7 +164,7 @@ int ps3_bt_load_addr(void) {
         
         if (str2ba(mac, &g_ps3_bt_ctx.ps3_addr) == 0) {
             g_ps3_bt_ctx.ps3_addr_valid = 1;
-            printf("[BT] Loaded PS3 MAC: %s\n", mac);
+            LOG_INFO("[BT] Loaded PS3 MAC: %s\n", mac);
             fclose(f);
             return 0;
         }
@@ -170,17 +192,17 @@ int ps3_bt_get_local_addr(uint8_t* out_mac) {
  * ============================================================================ */
 
 static int configure_adapter(void) {
-    printf("[BT] Configuring adapter...\n");
+    LOG_INFO("[BT] Configuring adapter...\n");
     
     int dev_id = hci_get_route(NULL);
     if (dev_id < 0) {
-        perror("[BT] No Bluetooth adapter");
+        LOG_ERROR("[BT] No Bluetooth adapter: %s\n", strerror(errno));
         return -1;
     }
     
     int sock = hci_open_dev(dev_id);
     if (sock < 0) {
-        perror("[BT] Failed to open HCI device");
+        LOG_ERROR("[BT] Failed to open HCI device: %s\n", strerror(errno));
         return -1;
     }
     
@@ -193,14 +215,14 @@ static int configure_adapter(void) {
     
     /* Read local address */
     if (hci_read_bd_addr(sock, &g_ps3_bt_ctx.local_addr, 1000) < 0) {
-        perror("[BT] Failed to read local address");
+        LOG_ERROR("[BT] Failed to read local address: %s\n", strerror(errno));
         hci_close_dev(sock);
         return -1;
     }
     
     char addr_str[18];
     ba2str(&g_ps3_bt_ctx.local_addr, addr_str);
-    printf("[BT] Local adapter: %s\n", addr_str);
+    LOG_INFO("[BT] Local adapter: %s\n", addr_str);
     
     /* Set Pi's MAC in DS3 Report 0xF5 */
     uint8_t mac[6];
@@ -217,8 +239,8 @@ static int configure_adapter(void) {
  * ============================================================================ */
 
 int ps3_bt_scan(int timeout_sec) {
-    printf("[BT] Scanning for PS3 (%d seconds)...\n", timeout_sec);
-    g_ps3_bt_ctx.state = BT_STATE_SCANNING;
+    LOG_INFO("[BT] Scanning for PS3 (%d seconds)...\n", timeout_sec);
+    bt_set_state(BT_STATE_SCANNING);
     
     int dev_id = hci_get_route(NULL);
     if (dev_id < 0) return -1;
@@ -248,14 +270,14 @@ int ps3_bt_scan(int timeout_sec) {
             
             char addr[18];
             ba2str(&devices[i].bdaddr, addr);
-            printf("[BT] Found PS3: %s\n", addr);
+            LOG_INFO("[BT] Found PS3: %s\n", addr);
             ps3_bt_save_addr();
         }
     }
     
     free(devices);
     hci_close_dev(sock);
-    g_ps3_bt_ctx.state = BT_STATE_DISCONNECTED;
+    bt_set_state(BT_STATE_DISCONNECTED);
     
     return found ? 0 : -1;
 }
@@ -265,15 +287,20 @@ int ps3_bt_scan(int timeout_sec) {
  * ============================================================================ */
 
 static int create_l2cap_socket(uint16_t psm, const bdaddr_t* dest) {
-    int sock = socket(AF_BLUETOOTH, SOCK_SEQPACKET, BTPROTO_L2CAP);
+    /* Non-blocking: connect() returns at once, EPOLLOUT reports the result */
+    int sock = socket(AF_BLUETOOTH, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, BTPROTO_L2CAP);
     if (sock < 0) return -1;
     
     /* Socket options for low latency */
-    int priority = 6;
-    setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority));
-    
-    int sndbuf = 0;
-    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    if (psm == L2CAP_PSM_HID_INTERRUPT) {
+        bt_qos_configure_socket(sock);
+    } else {
+        int priority = 6;
+        setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority));
+        
+        int sndbuf = 0;
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    }
     
     struct l2cap_options opts = {0};
     socklen_t optlen = sizeof(opts);
@@ -284,10 +311,6 @@ static int create_l2cap_socket(uint16_t psm, const bdaddr_t* dest) {
         setsockopt(sock, SOL_L2CAP, L2CAP_OPTIONS, &opts, sizeof(opts));
     }
     
-    struct timeval tv = {.tv_sec = 5, .tv_usec = 0};
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-    
     struct sockaddr_l2 local = {
         .l2_family = AF_BLUETOOTH,
         .l2_psm = 0
@@ -295,7 +318,9 @@ static int create_l2cap_socket(uint16_t psm, const bdaddr_t* dest) {
     bacpy(&local.l2_bdaddr, &g_ps3_bt_ctx.local_addr);
     
     if (bind(sock, (struct sockaddr*)&local, sizeof(local)) < 0) {
+        int err = errno;
         close(sock);
+        errno = err;
         return -1;
     }
     
@@ -305,14 +330,19 @@ static int create_l2cap_socket(uint16_t psm, const bdaddr_t* dest) {
     };
     bacpy(&remote.l2_bdaddr, dest);
     
-    if (connect(sock, (struct sockaddr*)&remote, sizeof(remote)) < 0) {
+    if (connect(sock, (struct sockaddr*)&remote, sizeof(remote)) < 0 && errno != EINPROGRESS) {
+        int err = errno;
         close(sock);
+        errno = err;
         return -1;
     }
     
     return sock;
 }
 
+/* READY -> ENABLED and start the send timer (defined below) */
+static void bt_enable(void);
+
 /* ============================================================================
  * CONTROL CHANNEL PROTOCOL
  * ============================================================================ */
@@ -367,12 +397,10 @@ static int handle_get_report(int sock, uint8_t report_id) {
 static int process_control(void) {
     if (g_ps3_bt_ctx.ctrl_sock < 0) return -1;
     
-    struct pollfd pfd = {.fd = g_ps3_bt_ctx.ctrl_sock, .events = POLLIN};
-    if (poll(&pfd, 1, 0) <= 0) return 0;
-    
     uint8_t buf[128];
     ssize_t n = recv(g_ps3_bt_ctx.ctrl_sock, buf, sizeof(buf), MSG_DONTWAIT);
-    if (n <= 0) return (errno == EAGAIN) ? 0 : -1;
+    if (n == 0) return -1;  /* Closed by the PS3 */
+    if (n < 0) return (errno == EAGAIN) ? 0 : -1;
     
     uint8_t trans = buf[0];
     
@@ -386,8 +414,7 @@ static int process_control(void) {
             last_ef_config = buf[8];
         }
         else if (report_id == 0xF4) {
-            printf("[BT] *** Received F4 ENABLE ***\n");
-            g_ps3_bt_ctx.state = BT_STATE_ENABLED;
+            bt_enable();
         }
         
         uint8_t ack = 0x00;
@@ -401,56 +428,152 @@ static int process_control(void) {
  * INTERRUPT CHANNEL
  * ============================================================================ */
 
-static uint64_t g_last_send_time = 0;
+/*
+ * Send scheduler
+ * 
+ * Button/stick/trigger changes go out immediately (but never closer than
+ * PS3_BT_MIN_GAP_US apart); motion and idle state ride a steady rate.
+ * When the L2CAP send queue is full (EAGAIN) or still holds the previous
+ * report, the steady rate is halved, and it climbs back towards the
+ * configured maximum - or the link grade's cap, if that is lower - after
+ * a run of clean sends.
+ */
+typedef struct {
+    int max_rate_hz;            /* Configured steady-state rate */
+    int rate_hz;                /* Current (backed-off) rate */
+    uint64_t last_send_ns;
+    int clean_sends;            /* Successful sends since last backoff */
+    int change_pending;         /* Digital/analog input changed since last send */
+    controller_state_t last_sent;
+} bt_send_sched_t;
+
+static bt_send_sched_t g_bt_sched = {
+    .max_rate_hz = PS3_BT_DEFAULT_RATE_HZ,
+    .rate_hz = PS3_BT_DEFAULT_RATE_HZ,
+};
 
-static int send_input(void) {
-    if (g_ps3_bt_ctx.state != BT_STATE_ENABLED || g_ps3_bt_ctx.intr_sock < 0) {
+void ps3_bt_set_input_rate(int hz) {
+    if (hz < PS3_BT_MIN_RATE_HZ) hz = PS3_BT_MIN_RATE_HZ;
+    if (hz > PS3_BT_MAX_RATE_HZ) hz = PS3_BT_MAX_RATE_HZ;
+    g_bt_sched.max_rate_hz = hz;
+    g_bt_sched.rate_hz = hz;
+    g_ps3_bt_ctx.input_rate_hz = hz;
+    metrics_gauge_set(METRIC_GAUGE_BT_RATE_HZ, hz);
+    LOG_INFO("[BT] Input rate: %d Hz\n", hz);
+}
+
+/* Inputs that justify sending ahead of the steady rate */
+static int input_changed(const controller_state_t* a, const controller_state_t* b) {
+    return a->buttons != b->buttons ||
+           a->left_stick_x != b->left_stick_x ||
+           a->left_stick_y != b->left_stick_y ||
+           a->right_stick_x != b->right_stick_x ||
+           a->right_stick_y != b->right_stick_y ||
+           a->left_trigger != b->left_trigger ||
+           a->right_trigger != b->right_trigger;
+}
+
+static void sched_on_result(int sent) {
+    int ceiling = bt_qos_rate_cap(g_bt_sched.max_rate_hz);
+    
+    if (sent) {
+        if (++g_bt_sched.clean_sends >= PS3_BT_RECOVER_SENDS &&
+            g_bt_sched.rate_hz < ceiling) {
+            g_bt_sched.rate_hz += g_bt_sched.rate_hz / 4 + 1;
+            if (g_bt_sched.rate_hz > ceiling) {
+                g_bt_sched.rate_hz = ceiling;
+            }
+            g_bt_sched.clean_sends = 0;
+            g_ps3_bt_ctx.input_rate_hz = g_bt_sched.rate_hz;
+        } else if (g_bt_sched.rate_hz > ceiling) {
+            /* Link got worse */
+            g_bt_sched.rate_hz = ceiling;
+            g_ps3_bt_ctx.input_rate_hz = ceiling;
+        }
+    } else {
+        /* Link congested - back off */
+        g_bt_sched.rate_hz /= 2;
+        if (g_bt_sched.rate_hz < PS3_BT_MIN_RATE_HZ) {
+            g_bt_sched.rate_hz = PS3_BT_MIN_RATE_HZ;
+        }
+        g_bt_sched.clean_sends = 0;
+        g_ps3_bt_ctx.input_rate_hz = g_bt_sched.rate_hz;
+    }
+    metrics_gauge_set(METRIC_GAUGE_BT_RATE_HZ, g_bt_sched.rate_hz);
+}
+
+/* Absolute time of the next send slot */
+static uint64_t sched_next_send_ns(void) {
+    uint64_t gap = g_bt_sched.change_pending ?
+                   (uint64_t)PS3_BT_MIN_GAP_US * 1000ULL :
+                   1000000000ULL / g_bt_sched.rate_hz;
+    return g_bt_sched.last_send_ns + gap;
+}
+
+/**
+ * Send the input report for the current state.
+ * @param out_state Receives the state the report was built from
+ * @return 1 if sent, 0 if dropped (previous report still queued), -1 on error
+ */
+static int send_input(controller_state_t* out_state) {
+    if ((g_ps3_bt_ctx.state != BT_STATE_READY && g_ps3_bt_ctx.state != BT_STATE_ENABLED) ||
+        g_ps3_bt_ctx.intr_sock < 0) {
         return -1;
     }
     
-    uint64_t now = time_get_ms();
-    if (now - g_last_send_time < 40) return 0;  /* 25Hz */
-    
-    /* Get current controller state and build DS3 report */
-    controller_state_t state;
-    controller_state_copy(&state);
-    
-    uint8_t ds3_report[DS3_INPUT_REPORT_SIZE];
-    ds3_build_input_report(&state, ds3_report);
+    /* Latest state wins - never queue behind a report the link hasn't taken */
+    if (bt_qos_backlog(g_ps3_bt_ctx.intr_sock) > 0) {
+        g_ps3_bt_ctx.packets_dropped++;
+        metrics_inc(METRIC_BT_REPORTS_DROPPED);
+        return 0;
+    }
     
-    /* Build BT report */
-    uint8_t report[DS3_BT_INPUT_REPORT_SIZE];
-    report[0] = BT_HIDP_DATA_RTYPE_INPUT;
-    memcpy(&report[1], ds3_report, DS3_INPUT_REPORT_SIZE);
+    /* Shared with USB; bt[] already has the HIDP header and BT status bytes */
+    static uint32_t last_seq = 0;
+    const ds3_frame_t* frame = ds3_frame_acquire_state(out_state);
     
-    /* Override status for BT connection */
-    report[30] = DS3_STATUS_UNPLUGGED;
-    report[32] = DS3_CONN_BT;
+    /* Only time reports carrying new input, not repeats of the same bytes */
+    uint64_t input_ns = 0;
+    uint64_t build_ns = frame->built_ns;
+    if (frame->seq != last_seq && frame->input_ns) {
+        input_ns = frame->input_ns;
+        latency_record_span(LATENCY_STAGE_BT_HANDOFF, input_ns, build_ns);
+    }
+    last_seq = frame->seq;
     
-    ssize_t sent = send(g_ps3_bt_ctx.intr_sock, report, sizeof(report), MSG_DONTWAIT | MSG_NOSIGNAL);
-    g_last_send_time = now;
+    ssize_t sent = send(g_ps3_bt_ctx.intr_sock, frame->bt, sizeof(frame->bt),
+                        MSG_DONTWAIT | MSG_NOSIGNAL);
+    ds3_frame_release(frame);
+    g_ps3_bt_ctx.last_send_time = time_get_ms();
     
     if (sent < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
             g_ps3_bt_ctx.packets_dropped++;
+            metrics_inc(METRIC_BT_REPORTS_DROPPED);
             return 0;
         }
+        metrics_inc(METRIC_BT_REPORTS_FAILED);
         return -1;
     }
     
     g_ps3_bt_ctx.packets_sent++;
-    return 0;
+    metrics_inc(METRIC_BT_REPORTS_SENT);
+    
+    if (input_ns) {
+        uint64_t done_ns = time_get_ns();
+        latency_record_span(LATENCY_STAGE_BT_SEND, build_ns, done_ns);
+        latency_record_span(LATENCY_STAGE_BT_TOTAL, input_ns, done_ns);
+    }
+    return 1;
 }
 
 static int process_interrupt(void) {
     if (g_ps3_bt_ctx.intr_sock < 0) return -1;
     
-    struct pollfd pfd = {.fd = g_ps3_bt_ctx.intr_sock, .events = POLLIN};
-    if (poll(&pfd, 1, 0) <= 0) return 0;
-    
     uint8_t buf[64];
     ssize_t n = recv(g_ps3_bt_ctx.intr_sock, buf, sizeof(buf), MSG_DONTWAIT);
-    if (n <= 0) return (errno == EAGAIN) ? 0 : -1;
+    if (n == 0) return -1;  /* Closed by the PS3 */
+    if (n < 0) return (errno == EAGAIN) ? 0 : -1;
     
     /* Handle rumble from PS3 */
     if (n >= 7 && buf[0] == BT_HIDP_DATA_RTYPE_OUTPUT && buf[1] == 0x01) {
@@ -469,85 +592,35 @@ static int process_interrupt(void) {
  * ============================================================================ */
 
 int ps3_bt_init(void) {
-    printf("[BT] Initializing...\n");
-    
-    if (configure_adapter() < 0) return -1;
-    
-    ps3_bt_load_addr();
-    g_ps3_bt_ctx.state = BT_STATE_DISCONNECTED;
-    return 0;
-}
-
-int ps3_bt_connect(void) {
-    /* Try to get PS3 MAC from USB handshake first */
-    if (!g_ps3_bt_ctx.ps3_addr_valid && ds3_has_ps3_mac()) {
-        uint8_t mac[6];
-        ds3_get_ps3_mac(mac);
-        
-        g_ps3_bt_ctx.ps3_addr.b[5] = mac[0];
-        g_ps3_bt_ctx.ps3_addr.b[4] = mac[1];
-        g_ps3_bt_ctx.ps3_addr.b[3] = mac[2];
-        g_ps3_bt_ctx.ps3_addr.b[2] = mac[3];
-        g_ps3_bt_ctx.ps3_addr.b[1] = mac[4];
-        g_ps3_bt_ctx.ps3_addr.b[0] = mac[5];
-        g_ps3_bt_ctx.ps3_addr_valid = 1;
-        
-        ps3_bt_save_addr();
-    }
-    
-    if (!g_ps3_bt_ctx.ps3_addr_valid) {
-        if (ps3_bt_scan(8) < 0) return -1;
-    }
-    
-    if (g_ps3_bt_ctx.state != BT_STATE_DISCONNECTED) return -1;
-    
-    g_ps3_bt_ctx.state = BT_STATE_CONNECTING;
+    LOG_INFO("[BT] Initializing...\n");
     
-    g_ps3_bt_ctx.ctrl_sock = create_l2cap_socket(L2CAP_PSM_HID_CONTROL, &g_ps3_bt_ctx.ps3_addr);
-    if (g_ps3_bt_ctx.ctrl_sock < 0) {
-        g_ps3_bt_ctx.state = BT_STATE_ERROR;
+    /* Worker blocks on its job fd; only the reactor polls the notify fd */
+    if (g_bt_job_fd < 0) g_bt_job_fd = eventfd(0, EFD_CLOEXEC);
+    if (g_bt_notify_fd < 0) g_bt_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_bt_job_fd < 0 || g_bt_notify_fd < 0) {
+        LOG_ERROR("[BT] eventfd: %s\n", strerror(errno));
         return -1;
     }
     
-    usleep(20000);
-    
-    g_ps3_bt_ctx.intr_sock = create_l2cap_socket(L2CAP_PSM_HID_INTERRUPT, &g_ps3_bt_ctx.ps3_addr);
-    if (g_ps3_bt_ctx.intr_sock < 0) {
-        close(g_ps3_bt_ctx.ctrl_sock);
-        g_ps3_bt_ctx.ctrl_sock = -1;
-        g_ps3_bt_ctx.state = BT_STATE_ERROR;
-        return -1;
-    }
-    
-    g_ps3_bt_ctx.state = BT_STATE_READY;
-    g_ps3_bt_ctx.connect_time = time_get_ms();
-    
-    printf("[BT] Connected to PS3\n");
-    
-    /* Send initial reports */
-    controller_state_t state;
-    controller_state_copy(&state);
-    uint8_t ds3_report[DS3_INPUT_REPORT_SIZE];
-    ds3_build_input_report(&state, ds3_report);
-    
-    uint8_t init_report[DS3_BT_INPUT_REPORT_SIZE];
-    init_report[0] = BT_HIDP_DATA_RTYPE_INPUT;
-    memcpy(&init_report[1], ds3_report, DS3_INPUT_REPORT_SIZE);
-    
-    for (int i = 0; i < 3; i++) {
-        send(g_ps3_bt_ctx.intr_sock, init_report, sizeof(init_report), MSG_NOSIGNAL);
-        usleep(20000);
-    }
+    if (configure_adapter() < 0) return -1;
     
+    ps3_bt_load_addr();
+    bt_set_state(BT_STATE_DISCONNECTED);
     return 0;
 }
 
+/* Reactor side of the link (defined below) */
+static void bt_sockets_detach(void);
+
 void ps3_bt_disconnect(void) {
     if (g_ps3_bt_ctx.state == BT_STATE_DISCONNECTED) {
         return;  /* Already disconnected */
     }
     
-    printf("[BT] Disconnecting...\n");
+    LOG_INFO("[BT] Disconnecting...\n");
+    
+    /* Out of the reactor before the fds can be reused */
+    bt_sockets_detach();
     
     /* Clear rumble */
     controller_output_t output;
@@ -566,7 +639,7 @@ void ps3_bt_disconnect(void) {
         g_ps3_bt_ctx.ctrl_sock = -1;
     }
     
-    g_ps3_bt_ctx.state = BT_STATE_DISCONNECTED;
+    bt_set_state(BT_STATE_DISCONNECTED);
 }
 
 int ps3_bt_is_enabled(void) {
@@ -578,161 +651,544 @@ bt_state_t ps3_bt_get_state(void) {
 }
 
 int ps3_bt_wake(void) {
-    printf("[BT] Attempting to wake PS3...\n");
+    if (g_bt_notify_fd < 0) return -1;
+    __atomic_store_n(&g_bt_wake_requested, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    ssize_t ret = write(g_bt_notify_fd, &one, sizeof(one));
+    (void)ret;
+    return 0;
+}
+
+/* ============================================================================
+ * SCAN WORKER
+ * 
+ * Inquiry blocks for seconds and libbluetooth has no asynchronous form
+ * of it, so it runs here. The reactor posts the job and keeps its hands
+ * off the link until the worker reports back through the notify fd.
+ * ============================================================================ */
+
+static void bt_request(int job) {
+    __atomic_or_fetch(&g_bt_jobs, job, __ATOMIC_ACQ_REL);
+    uint64_t one = 1;
+    ssize_t ret = write(g_bt_job_fd, &one, sizeof(one));
+    (void)ret;
+}
+
+void ps3_bt_worker_stop(void) {
+    if (g_bt_job_fd >= 0) bt_request(0);
+}
+
+void* ps3_bt_thread(void* arg) {
+    (void)arg;
+    if (g_bt_job_fd < 0) return NULL;
+    LOG_INFO("[BT] Scan worker started\n");
     
-    for (int attempt = 0; attempt < 5; attempt++) {
-        if (g_ps3_bt_ctx.state == BT_STATE_ERROR) {
-            ps3_bt_disconnect();
+    while (g_running) {
+        uint64_t count;
+        if (read(g_bt_job_fd, &count, sizeof(count)) < 0) {
+            if (errno == EINTR) continue;
+            break;
         }
+        if (!g_running) break;
         
-        if (g_ps3_bt_ctx.state == BT_STATE_DISCONNECTED) {
-            if (ps3_bt_connect() == 0) break;
+        int jobs = __atomic_exchange_n(&g_bt_jobs, 0, __ATOMIC_ACQ_REL);
+        if (!(jobs & BT_JOB_SCAN)) continue;
+        
+        __atomic_store_n(&g_bt_busy, 1, __ATOMIC_RELEASE);
+        if (!system_is_standby()) {
+            ps3_bt_scan(8);
         }
+        __atomic_store_n(&g_bt_busy, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&g_bt_scan_done, 1, __ATOMIC_RELEASE);
         
-        usleep(1500000);
+        uint64_t one = 1;
+        ssize_t ret = write(g_bt_notify_fd, &one, sizeof(one));
+        (void)ret;
     }
     
-    if (g_ps3_bt_ctx.intr_sock < 0) return -1;
+    LOG_INFO("[BT] Scan worker exiting\n");
+    return NULL;
+}
+
+/* ============================================================================
+ * REACTOR
+ * 
+ * The connection state machine, both sockets and the input report
+ * pacing all run on the owner's event loop. Both L2CAP connects are
+ * started at once without blocking; each completes as EPOLLOUT on its
+ * socket. Every phase is timed and logged so the delays can be tuned.
+ * ============================================================================ */
+
+static event_loop_t* g_bt_loop = NULL;
+static int g_bt_state_fd = -1;      /* Controller state changes */
+static int g_bt_send_fd = -1;       /* timerfd, next send slot (absolute) */
+static int g_bt_tick_fd = -1;       /* timerfd, state machine */
+static int g_bt_timeout_fd = -1;    /* timerfd, connect deadline */
+static int g_bt_release_fd = -1;    /* timerfd, wake PS button release */
+static int g_bt_system_fd = -1;     /* System state changes (standby) */
+static int g_bt_socks_attached = 0;
+
+/* Connect progress */
+#define BT_CHAN_CTRL    0x01
+#define BT_CHAN_INTR    0x02
+#define BT_CHAN_BOTH    (BT_CHAN_CTRL | BT_CHAN_INTR)
+
+static int g_chans_up = 0;
+static int g_enable_early = 0;              /* 0xF4 before the interrupt channel */
+static int g_scan_pending = 0;
+static uint64_t g_connect_start_ms = 0;
+
+/* State machine */
+static int g_connect_requested = 0;
+static int g_was_usb_connected = 0;
+static uint64_t g_usb_disconnect_ms = 0;
+static uint64_t g_retry_after_ms = 0;       /* Backoff after a failed connect */
+static int g_retry_delay_ms = 0;            /* 0 = last connect succeeded */
+static uint64_t g_usb_stable_since_ms = 0;
+
+/* Wake sequence */
+static int g_wake_attempts = 0;             /* Connects left for a pending wake */
+static int g_wake_holding = 0;              /* PS button down, reports paused */
+static uint64_t g_wake_request_ms = 0;
+
+static void bt_link_lost(void) {
+    ps3_bt_disconnect();
+    g_connect_requested = 0;
+}
+
+static int bt_streaming(void) {
+    return (g_ps3_bt_ctx.state == BT_STATE_READY || g_ps3_bt_ctx.state == BT_STATE_ENABLED) &&
+           !g_wake_holding;
+}
+
+static void bt_arm_send(void) {
+    if (g_bt_send_fd >= 0) event_timer_arm_at(g_bt_send_fd, sched_next_send_ns());
+}
+
+static void bt_enable(void) {
+    if (g_ps3_bt_ctx.state != BT_STATE_READY) {
+        g_enable_early = 1;     /* bt_connected() finishes the job */
+        return;
+    }
+    bt_set_state(BT_STATE_ENABLED);
+    LOG_INFO("[BT] *** Received F4 ENABLE *** (%llu ms after connect)\n",
+             (unsigned long long)(time_get_ms() - g_ps3_bt_ctx.connect_time));
+}
+
+/* A connect (or the scan before it) failed - back off exponentially */
+static void bt_connect_failed(const char* what, int err) {
+    uint64_t now = time_get_ms();
+    
+    metrics_inc(METRIC_BT_CONNECT_FAILURES);
+    g_retry_delay_ms = g_retry_delay_ms ? g_retry_delay_ms * 2 : PS3_BT_RETRY_MIN_MS;
+    if (g_retry_delay_ms > PS3_BT_RETRY_MAX_MS) g_retry_delay_ms = PS3_BT_RETRY_MAX_MS;
     
-    /* Send PS button press */
+    LOG_INFO("[BT] %s failed after %llu ms: %s - retry in %d ms\n", what,
+             (unsigned long long)(now - g_connect_start_ms), strerror(err), g_retry_delay_ms);
+    
+    bt_link_lost();
+    g_retry_after_ms = now + g_retry_delay_ms;
+    
+    if (g_wake_attempts > 0 && --g_wake_attempts == 0) {
+        LOG_WARN("[BT] Warning: Wake signal failed\n");
+    }
+}
+
+/* ============================================================================
+ * WAKE SEQUENCE
+ * ============================================================================ */
+
+static void bt_wake_send(uint8_t buttons) {
     uint8_t wake_report[DS3_BT_INPUT_REPORT_SIZE] = {0};
     wake_report[0] = BT_HIDP_DATA_RTYPE_INPUT;
     wake_report[1] = 0x01;
-    wake_report[5] = DS3_BTN_PS;
+    wake_report[5] = buttons;
     wake_report[7] = 0x80;
     wake_report[8] = 0x80;
     wake_report[9] = 0x80;
     wake_report[10] = 0x80;
     
-    send(g_ps3_bt_ctx.intr_sock, wake_report, sizeof(wake_report), 0);
-    usleep(150000);
+    send(g_ps3_bt_ctx.intr_sock, wake_report, sizeof(wake_report), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+/* Link is up - press PS now, on_wake_release() lets go */
+static void bt_wake_press(void) {
+    g_wake_attempts = 0;
+    g_wake_holding = 1;
+    bt_wake_send(DS3_BTN_PS);
+    event_timer_arm(g_bt_release_fd, (uint64_t)PS3_BT_WAKE_HOLD_MS * 1000000ULL, 0);
+}
+
+static void on_wake_release(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    if (!g_wake_holding) return;
+    
+    g_wake_holding = 0;
+    bt_wake_send(0);
+    LOG_INFO("[BT] Wake signal sent (%llu ms after request)\n",
+             (unsigned long long)(time_get_ms() - g_wake_request_ms));
+    bt_arm_send();
+}
+
+static void bt_wake_start(void) {
+    LOG_INFO("[BT] Attempting to wake PS3...\n");
+    g_wake_request_ms = time_get_ms();
     
-    wake_report[5] = 0;
-    send(g_ps3_bt_ctx.intr_sock, wake_report, sizeof(wake_report), 0);
+    if (bt_streaming()) {
+        bt_wake_press();
+        return;
+    }
+    if (g_wake_holding) return;
     
-    printf("[BT] Wake signal sent\n");
-    return 0;
+    /* A wake skips the USB wait and any backoff */
+    g_wake_attempts = PS3_BT_WAKE_ATTEMPTS;
+    g_retry_delay_ms = 0;
+    g_retry_after_ms = 0;
+    if (g_ps3_bt_ctx.state == BT_STATE_DISCONNECTED) {
+        ps3_bt_connect();
+    }
+    /* Otherwise a connect is in flight - bt_connected() presses PS */
 }
 
 /* ============================================================================
- * THREAD FUNCTIONS
+ * CONNECT
  * ============================================================================ */
 
-void* ps3_bt_thread(void* arg) {
-    (void)arg;
-    printf("[BT] Management thread started\n");
+static void on_ctrl_event(int fd, uint32_t events, void* ctx);
+static void on_intr_event(int fd, uint32_t events, void* ctx);
+
+/* Both channels are up */
+static void bt_connected(void) {
+    event_timer_arm(g_bt_timeout_fd, 0, 0);
     
-    int connect_requested = 0;
-    int was_usb_connected = 0;
-    uint64_t usb_disconnect_time = 0;
+    bt_set_state(BT_STATE_READY);
+    g_ps3_bt_ctx.connect_time = time_get_ms();
+    g_retry_delay_ms = 0;
+    metrics_inc(METRIC_BT_CONNECTS);
+    LOG_INFO("[BT] Connected to PS3 in %llu ms\n",
+             (unsigned long long)(g_ps3_bt_ctx.connect_time - g_connect_start_ms));
     
-    /* Delay before attempting BT connection after USB disconnect (ms) */
-    #define BT_CONNECT_DELAY_MS 1000
+    bt_qos_attach(g_bt_loop, g_ps3_bt_ctx.intr_sock);
     
-    while (g_running) {
-        if (system_is_standby()) {
-            usleep(100000);
-            continue;
-        }
+    if (g_enable_early) {
+        g_enable_early = 0;
+        bt_enable();
+    }
+    
+    /* Report right away, like a DS3 does; 0xF4 follows */
+    if (g_wake_attempts > 0) {
+        bt_wake_press();
+    } else {
+        bt_arm_send();
+    }
+}
+
+/* HID requires control before interrupt - PSM 19 opens once PSM 17 is up */
+static int bt_open_interrupt(void) {
+    g_ps3_bt_ctx.intr_sock = create_l2cap_socket(L2CAP_PSM_HID_INTERRUPT, &g_ps3_bt_ctx.ps3_addr);
+    if (g_ps3_bt_ctx.intr_sock < 0) {
+        bt_connect_failed("Interrupt channel", errno);
+        return -1;
+    }
+    if (event_loop_add(g_bt_loop, g_ps3_bt_ctx.intr_sock, EPOLLOUT, on_intr_event, NULL) < 0) {
+        bt_connect_failed("Interrupt channel", ENOSPC);
+        return -1;
+    }
+    return 0;
+}
+
+/* EPOLLOUT/EPOLLERR on a channel whose connect is still in flight */
+static void bt_channel_event(int fd, int chan, uint32_t events) {
+    const char* name = (chan == BT_CHAN_CTRL) ? "Control channel" : "Interrupt channel";
+    
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) err = errno;
+    if (!err && (events & (EPOLLERR | EPOLLHUP))) err = ECONNRESET;
+    if (err) {
+        bt_connect_failed(name, err);
+        return;
+    }
+    if (!(events & EPOLLOUT)) return;
+    
+    g_chans_up |= chan;
+    event_loop_modify(g_bt_loop, fd, EPOLLIN);
+    LOG_INFO("[BT] %s up: %llu ms\n", name,
+             (unsigned long long)(time_get_ms() - g_connect_start_ms));
+    
+    if (g_chans_up == BT_CHAN_BOTH) {
+        bt_connected();
+    } else {
+        bt_set_state(BT_STATE_CONTROL_CONNECTED);
+        bt_open_interrupt();
+    }
+}
+
+int ps3_bt_connect(void) {
+    if (g_ps3_bt_ctx.state != BT_STATE_DISCONNECTED || !g_bt_loop || g_scan_pending) return -1;
+    g_connect_start_ms = time_get_ms();
+    
+    /* Try to get PS3 MAC from USB handshake first */
+    if (!g_ps3_bt_ctx.ps3_addr_valid && ds3_has_ps3_mac()) {
+        uint8_t mac[6];
+        ds3_get_ps3_mac(mac);
         
-        switch (g_ps3_bt_ctx.state) {
-            case BT_STATE_DISCONNECTED:
-                if (g_usb_enabled) {
-                    was_usb_connected = 1;
-                    usb_disconnect_time = 0;
-                }
-                
-                /* Track when USB disconnected */
-                if (was_usb_connected && !g_usb_enabled && usb_disconnect_time == 0) {
-                    usb_disconnect_time = time_get_ms();
-                }
-                
-                /* Connect after USB has been disconnected for a while */
-                if (was_usb_connected && !g_usb_enabled && !connect_requested && 
-                    ds3_has_ps3_mac() && usb_disconnect_time > 0) {
-                    
-                    uint64_t elapsed = time_get_ms() - usb_disconnect_time;
-                    if (elapsed >= BT_CONNECT_DELAY_MS) {
-                        if (!system_is_standby() && ps3_bt_connect() == 0) {
-                            connect_requested = 1;
-                        }
-                    }
-                }
-                usleep(100000);
-                break;
-                
-            case BT_STATE_READY:
-            case BT_STATE_ENABLED:
-                /* Auto-enable after timeout */
-                if (g_ps3_bt_ctx.state == BT_STATE_READY) {
-                    static int ready_count = 0;
-                    if (++ready_count >= 50) {
-                        g_ps3_bt_ctx.state = BT_STATE_ENABLED;
-                        ready_count = 0;
-                    }
-                }
-                
-                if (process_control() < 0 || process_interrupt() < 0) {
-                    ps3_bt_disconnect();
-                    connect_requested = 0;
-                    continue;
-                }
-                usleep(10000);
-                break;
-                
-            case BT_STATE_ERROR:
-                ps3_bt_disconnect();
-                connect_requested = 0;
-                sleep(5);
-                break;
-                
-            default:
-                usleep(100000);
-                break;
-        }
+        g_ps3_bt_ctx.ps3_addr.b[5] = mac[0];
+        g_ps3_bt_ctx.ps3_addr.b[4] = mac[1];
+        g_ps3_bt_ctx.ps3_addr.b[3] = mac[2];
+        g_ps3_bt_ctx.ps3_addr.b[2] = mac[3];
+        g_ps3_bt_ctx.ps3_addr.b[1] = mac[4];
+        g_ps3_bt_ctx.ps3_addr.b[0] = mac[5];
+        g_ps3_bt_ctx.ps3_addr_valid = 1;
         
-        /* Disconnect BT if USB reconnects (with hysteresis) */
-        if (g_usb_enabled && g_ps3_bt_ctx.state >= BT_STATE_READY) {
-            /* Wait a bit to make sure USB is stable before disconnecting BT */
-            static int usb_stable_count = 0;
-            usb_stable_count++;
-            
-            if (usb_stable_count >= 10) {  /* 100ms at 10ms loop rate */
-                printf("[BT] USB reconnected, disconnecting BT\n");
-                ps3_bt_disconnect();
-                connect_requested = 0;
-                was_usb_connected = 1;
-                usb_stable_count = 0;
-            }
+        ps3_bt_save_addr();
+    }
+    
+    if (!g_ps3_bt_ctx.ps3_addr_valid) {
+        g_scan_pending = 1;
+        bt_request(BT_JOB_SCAN);
+        return 0;
+    }
+    
+    bt_set_state(BT_STATE_CONNECTING);
+    g_chans_up = 0;
+    g_enable_early = 0;
+    
+    /* Control first; bt_channel_event() opens interrupt once it is up */
+    g_ps3_bt_ctx.ctrl_sock = create_l2cap_socket(L2CAP_PSM_HID_CONTROL, &g_ps3_bt_ctx.ps3_addr);
+    if (g_ps3_bt_ctx.ctrl_sock < 0) {
+        bt_connect_failed("Connect", errno);
+        return -1;
+    }
+    if (event_loop_add(g_bt_loop, g_ps3_bt_ctx.ctrl_sock, EPOLLOUT, on_ctrl_event, NULL) < 0) {
+        bt_connect_failed("Connect", ENOSPC);
+        return -1;
+    }
+    g_bt_socks_attached = 1;
+    event_timer_arm(g_bt_timeout_fd, (uint64_t)PS3_BT_CONNECT_TIMEOUT_MS * 1000000ULL, 0);
+    
+    LOG_INFO("[BT] Connecting to PS3 (control, then interrupt)...\n");
+    return 0;
+}
+
+static void on_connect_timeout(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    if (g_ps3_bt_ctx.state >= BT_STATE_CONNECTING && g_ps3_bt_ctx.state < BT_STATE_READY) {
+        bt_connect_failed("Connect", ETIMEDOUT);
+    }
+}
+
+static void on_ctrl_event(int fd, uint32_t events, void* ctx) {
+    (void)ctx;
+    if (!(g_chans_up & BT_CHAN_CTRL)) {
+        bt_channel_event(fd, BT_CHAN_CTRL, events);
+    } else if ((events & (EPOLLERR | EPOLLHUP)) || process_control() < 0) {
+        bt_link_lost();
+    }
+}
+
+static void on_intr_event(int fd, uint32_t events, void* ctx) {
+    (void)ctx;
+    if (!(g_chans_up & BT_CHAN_INTR)) {
+        bt_channel_event(fd, BT_CHAN_INTR, events);
+    } else if ((events & (EPOLLERR | EPOLLHUP)) || process_interrupt() < 0) {
+        bt_link_lost();
+    }
+}
+
+static void bt_sockets_detach(void) {
+    if (!g_bt_socks_attached) return;
+    bt_qos_detach();
+    event_loop_remove(g_bt_loop, g_ps3_bt_ctx.ctrl_sock);
+    if (g_ps3_bt_ctx.intr_sock >= 0) event_loop_remove(g_bt_loop, g_ps3_bt_ctx.intr_sock);
+    event_timer_arm(g_bt_send_fd, 0, 0);
+    event_timer_arm(g_bt_timeout_fd, 0, 0);
+    event_timer_arm(g_bt_release_fd, 0, 0);
+    g_bt_socks_attached = 0;
+    g_chans_up = 0;
+    g_wake_holding = 0;
+}
+
+/* The scan worker finished, or ps3_bt_wake() was called */
+static void on_notify(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    
+    if (__atomic_exchange_n(&g_bt_scan_done, 0, __ATOMIC_ACQ_REL)) {
+        g_scan_pending = 0;
+        if (g_ps3_bt_ctx.ps3_addr_valid) {
+            ps3_bt_connect();
         } else {
-            /* Reset counter if USB not enabled */
-            static int usb_stable_count = 0;
-            usb_stable_count = 0;
+            bt_connect_failed("Scan", EHOSTUNREACH);
         }
     }
-    
-    ps3_bt_disconnect();
-    printf("[BT] Management thread exiting\n");
-    return NULL;
+    if (__atomic_exchange_n(&g_bt_wake_requested, 0, __ATOMIC_ACQ_REL)) {
+        bt_wake_start();
+    }
 }
 
-void* ps3_bt_motion_thread(void* arg) {
-    (void)arg;
-    printf("[BT] Motion thread started\n");
+static void bt_tick(void) {
+    if (system_is_standby() || __atomic_load_n(&g_bt_busy, __ATOMIC_ACQUIRE)) return;
+    uint64_t now = time_get_ms();
     
-    while (g_running) {
-        if (system_is_standby()) {
-            usleep(100000);
-            continue;
+    if (g_ps3_bt_ctx.state == BT_STATE_DISCONNECTED && !g_scan_pending) {
+        if (g_usb_enabled) {
+            g_was_usb_connected = 1;
+            g_usb_disconnect_ms = 0;
         }
         
-        if (g_ps3_bt_ctx.state == BT_STATE_ENABLED) {
-            send_input();
+        /* Track when USB disconnected */
+        if (g_was_usb_connected && !g_usb_enabled && g_usb_disconnect_ms == 0) {
+            g_usb_disconnect_ms = now;
         }
         
-        usleep(500);  /* Fast poll for responsive input */
+        if (g_wake_attempts > 0) {
+            /* Wake retry */
+            if (now >= g_retry_after_ms) ps3_bt_connect();
+        } else if (g_was_usb_connected && !g_usb_enabled && !g_connect_requested &&
+                   ds3_has_ps3_mac() && g_usb_disconnect_ms > 0 &&
+                   now - g_usb_disconnect_ms >= PS3_BT_CONNECT_DELAY_MS &&
+                   now >= g_retry_after_ms) {
+            /* Connect after USB has been disconnected for a while */
+            LOG_INFO("[BT] USB gone for %llu ms - connecting over Bluetooth\n",
+                     (unsigned long long)(now - g_usb_disconnect_ms));
+            g_connect_requested = 1;
+            ps3_bt_connect();
+        }
     }
     
-    printf("[BT] Motion thread exiting\n");
-    return NULL;
-}
\ No newline at end of file
+    /* Disconnect BT if USB reconnects (with hysteresis) */
+    if (g_usb_enabled && g_ps3_bt_ctx.state >= BT_STATE_CONNECTING) {
+        /* Wait a bit to make sure USB is stable before disconnecting BT */
+        if (g_usb_stable_since_ms == 0) {
+            g_usb_stable_since_ms = now;
+        } else if (now - g_usb_stable_since_ms >= PS3_BT_USB_STABLE_MS) {
+            LOG_INFO("[BT] USB reconnected, disconnecting BT\n");
+            g_wake_attempts = 0;    /* The PS3 is evidently awake */
+            bt_link_lost();
+            g_was_usb_connected = 1;
+            g_usb_stable_since_ms = 0;
+        }
+    } else {
+        g_usb_stable_since_ms = 0;
+    }
+}
+
+static void on_tick(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    bt_tick();
+}
+
+/* Nothing to do while the PS3 is off - park the tick until wake */
+static void bt_tick_arm(void) {
+    uint64_t tick_ns = system_is_standby() ? 0 : (uint64_t)PS3_BT_TICK_MS * 1000000ULL;
+    event_timer_arm(g_bt_tick_fd, tick_ns, tick_ns);
+}
+
+static void on_system_state(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    bt_tick_arm();
+}
+
+/* New controller input: pull the next send forward if it matters */
+static void on_state_change(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    if (!bt_streaming() || g_bt_sched.change_pending) return;
+    
+    controller_state_t state;
+    controller_state_copy(&state);
+    if (input_changed(&state, &g_bt_sched.last_sent)) {
+        g_bt_sched.change_pending = 1;
+        bt_arm_send();
+    }
+}
+
+static void on_send_slot(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    if (!bt_streaming() || system_is_standby()) return;
+    
+    /* What the PS3 now has - may be newer than on_state_change() saw */
+    controller_state_t state;
+    int ret = send_input(&state);
+    g_bt_sched.last_send_ns = time_get_ns();
+    if (ret >= 0) {
+        sched_on_result(ret);
+    }
+    if (ret > 0) {
+        g_bt_sched.last_sent = state;
+        g_bt_sched.change_pending = 0;
+    }
+    bt_arm_send();
+}
+
+int ps3_bt_attach(event_loop_t* loop) {
+    if (g_bt_notify_fd < 0) return -1;
+    
+    g_bt_state_fd = controller_state_subscribe();
+    g_bt_send_fd = event_timer_create();
+    g_bt_tick_fd = event_timer_create();
+    g_bt_timeout_fd = event_timer_create();
+    g_bt_release_fd = event_timer_create();
+    g_bt_system_fd = system_state_subscribe();
+    if (g_bt_state_fd < 0 || g_bt_send_fd < 0 || g_bt_tick_fd < 0 ||
+        g_bt_timeout_fd < 0 || g_bt_release_fd < 0 || g_bt_system_fd < 0) {
+        LOG_ERROR("[BT] Failed to create event fds\n");
+        goto fail;
+    }
+    
+    g_bt_loop = loop;
+    if (event_loop_add(loop, g_bt_notify_fd, EPOLLIN, on_notify, NULL) < 0 ||
+        event_loop_add(loop, g_bt_state_fd, EPOLLIN, on_state_change, NULL) < 0 ||
+        event_loop_add(loop, g_bt_send_fd, EPOLLIN, on_send_slot, NULL) < 0 ||
+        event_loop_add(loop, g_bt_tick_fd, EPOLLIN, on_tick, NULL) < 0 ||
+        event_loop_add(loop, g_bt_timeout_fd, EPOLLIN, on_connect_timeout, NULL) < 0 ||
+        event_loop_add(loop, g_bt_release_fd, EPOLLIN, on_wake_release, NULL) < 0 ||
+        event_loop_add(loop, g_bt_system_fd, EPOLLIN, on_system_state, NULL) < 0) {
+        goto fail;
+    }
+    
+    g_ps3_bt_ctx.input_rate_hz = g_bt_sched.rate_hz;
+    metrics_gauge_set(METRIC_GAUGE_BT_RATE_HZ, g_bt_sched.rate_hz);
+    bt_tick_arm();
+    
+    LOG_INFO("[BT] Attached to event loop\n");
+    return 0;
+    
+fail:
+    ps3_bt_detach();
+    return -1;
+}
+
+void ps3_bt_detach(void) {
+    if (g_bt_loop) {
+        bt_sockets_detach();
+        event_loop_remove(g_bt_loop, g_bt_notify_fd);
+    }
+    
+    /* Out of the notifier tables before the numbers can be reused */
+    controller_state_unsubscribe(g_bt_state_fd);
+    system_state_unsubscribe(g_bt_system_fd);
+    
+    int* fds[] = { &g_bt_state_fd, &g_bt_send_fd, &g_bt_tick_fd,
+                   &g_bt_timeout_fd, &g_bt_release_fd, &g_bt_system_fd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] < 0) continue;
+        if (g_bt_loop) event_loop_remove(g_bt_loop, *fds[i]);
+        close(*fds[i]);
+        *fds[i] = -1;
+    }
+    g_bt_loop = NULL;
+}
@@ -0,0 +1,285 @@
+/*
+ * RosettaPad - PS3 Bluetooth Link QoS
+ * ====================================
+ *
+ * Interrupt channel tuning, asynchronous HCI link monitoring and the
+ * latest-state-wins check (see console/ps3/bt_qos.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/hci_lib.h>
+#include <bluetooth/l2cap.h>
+
+#include "core/common.h"
+#include "core/metrics.h"
+#include "core/log.h"
+#include "console/ps3/bt_hid.h"
+#include "console/ps3/bt_qos.h"
+
+/* HCI flush timeout unit is 0.625 ms */
+#define BT_QOS_FLUSH_TIMEOUT_SLOTS  ((BT_QOS_FLUSH_TIMEOUT_MS * 1000 + 624) / 625)
+
+#define HCI_MODE_SNIFF  0x02    /* Mode Change event: current mode */
+
+static event_loop_t* g_qos_loop = NULL;
+static int g_hci_fd = -1;           /* Raw HCI socket, command completions */
+static int g_poll_fd = -1;          /* timerfd, RSSI / link quality reads */
+static uint16_t g_handle = 0;       /* ACL connection handle to the PS3 */
+static int g_sndbuf = 0;            /* Effective SO_SNDBUF of the socket */
+
+static const char* grade_names[] = { "good", "poor", "bad" };
+
+/* ============================================================================
+ * SOCKET OPTIONS
+ * ============================================================================ */
+
+int bt_qos_configure_socket(int sock) {
+    int status = 0;
+    
+    int priority = BT_QOS_PRIORITY;
+    if (setsockopt(sock, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0) {
+        status = -1;
+    }
+    
+    int sndbuf = BT_QOS_SNDBUF;
+    if (setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+        status = -1;
+    }
+    
+    /* Lets the controller's automatic flush drop reports nobody wants anymore */
+    int flushable = BT_FLUSHABLE_ON;
+    if (setsockopt(sock, SOL_BLUETOOTH, BT_FLUSHABLE, &flushable, sizeof(flushable)) < 0) {
+        status = -1;
+    }
+    
+    /* Leave sniff before every send rather than waiting for the next anchor */
+    struct bt_power power = {.force_active = BT_POWER_FORCE_ACTIVE_ON};
+    if (setsockopt(sock, SOL_BLUETOOTH, BT_POWER, &power, sizeof(power)) < 0) {
+        status = -1;
+    }
+    
+    if (status < 0) {
+        LOG_WARN("[BT] Warning: Some interrupt channel QoS options refused: %s\n",
+                 strerror(errno));
+    }
+    return status;
+}
+
+int bt_qos_backlog(int sock) {
+    /* TIOCOUTQ on Bluetooth sockets is the free send space */
+    int free_space = 0;
+    if (g_sndbuf <= 0 || ioctl(sock, TIOCOUTQ, &free_space) < 0) return 0;
+    
+    int queued = g_sndbuf - free_space;
+    return queued > 0 ? queued : 0;
+}
+
+/* ============================================================================
+ * LINK GRADE
+ * ============================================================================ */
+
+static void update_grade(void) {
+    int rssi = g_ps3_bt_ctx.rssi;
+    int quality = g_ps3_bt_ctx.link_quality;
+    
+    bt_qos_grade_t grade = BT_QOS_GRADE_GOOD;
+    if (rssi <= BT_QOS_BAD_RSSI || quality < BT_QOS_BAD_QUALITY) {
+        grade = BT_QOS_GRADE_BAD;
+    } else if (rssi <= BT_QOS_POOR_RSSI || quality < BT_QOS_POOR_QUALITY) {
+        grade = BT_QOS_GRADE_POOR;
+    }
+    
+    metrics_gauge_set(METRIC_GAUGE_BT_RSSI, rssi);
+    metrics_gauge_set(METRIC_GAUGE_BT_LINK_QUALITY, quality);
+    metrics_gauge_set(METRIC_GAUGE_BT_LINK_GRADE, grade);
+    
+    if ((int)grade != g_ps3_bt_ctx.link_grade) {
+        g_ps3_bt_ctx.link_grade = grade;
+        LOG_INFO("[BT] Link %s (RSSI %d dB, quality %d) - rate limit %d Hz\n",
+                 grade_names[grade], rssi, quality, bt_qos_rate_cap(PS3_BT_MAX_RATE_HZ));
+    }
+}
+
+int bt_qos_rate_cap(int max_hz) {
+    int cap = max_hz;
+    switch (g_ps3_bt_ctx.link_grade) {
+        case BT_QOS_GRADE_POOR:
+            cap = max_hz / 2;
+            break;
+        case BT_QOS_GRADE_BAD:
+            cap = PS3_BT_MIN_RATE_HZ * 2;
+            break;
+        default:
+            break;
+    }
+    if (cap > max_hz) cap = max_hz;
+    if (cap < PS3_BT_MIN_RATE_HZ) cap = PS3_BT_MIN_RATE_HZ;
+    return cap;
+}
+
+/* ============================================================================
+ * HCI (asynchronous)
+ * ============================================================================ */
+
+static void send_cmd(uint16_t ogf, uint16_t ocf, uint8_t len, void* param) {
+    if (hci_send_cmd(g_hci_fd, ogf, ocf, len, param) < 0 && errno != EAGAIN) {
+        LOG_WARN("[BT] Warning: HCI command 0x%04x failed: %s\n",
+                 cmd_opcode_pack(ogf, ocf), strerror(errno));
+    }
+}
+
+static void on_cmd_complete(const uint8_t* ptr, int len) {
+    if (len < EVT_CMD_COMPLETE_SIZE + 1) return;
+    
+    const evt_cmd_complete* cc = (const evt_cmd_complete*)ptr;
+    const uint8_t* rp = ptr + EVT_CMD_COMPLETE_SIZE;
+    len -= EVT_CMD_COMPLETE_SIZE;
+    
+    switch (btohs(cc->opcode)) {
+        case cmd_opcode_pack(OGF_STATUS_PARAM, OCF_READ_RSSI): {
+            const read_rssi_rp* r = (const read_rssi_rp*)rp;
+            if (len < READ_RSSI_RP_SIZE || r->status || btohs(r->handle) != g_handle) break;
+            g_ps3_bt_ctx.rssi = r->rssi;
+            update_grade();
+            break;
+        }
+        case cmd_opcode_pack(OGF_STATUS_PARAM, OCF_READ_LINK_QUALITY): {
+            const read_link_quality_rp* r = (const read_link_quality_rp*)rp;
+            if (len < READ_LINK_QUALITY_RP_SIZE || r->status || btohs(r->handle) != g_handle) break;
+            g_ps3_bt_ctx.link_quality = r->link_quality;
+            update_grade();
+            break;
+        }
+        case cmd_opcode_pack(OGF_LINK_POLICY, OCF_WRITE_LINK_POLICY):
+            if (rp[0]) LOG_WARN("[BT] Warning: Controller refused link policy (0x%02x)\n", rp[0]);
+            break;
+        case cmd_opcode_pack(OGF_HOST_CTL, OCF_WRITE_AUTOMATIC_FLUSH_TIMEOUT):
+            if (rp[0]) LOG_WARN("[BT] Warning: Controller refused flush timeout (0x%02x)\n", rp[0]);
+            break;
+        default:
+            break;
+    }
+}
+
+static void on_mode_change(const uint8_t* ptr, int len) {
+    if (len < EVT_MODE_CHANGE_SIZE) return;
+    
+    const evt_mode_change* mc = (const evt_mode_change*)ptr;
+    if (mc->status || btohs(mc->handle) != g_handle || mc->mode != HCI_MODE_SNIFF) return;
+    
+    LOG_INFO("[BT] PS3 put the link in sniff mode - leaving it\n");
+    exit_sniff_mode_cp cp = {.handle = htobs(g_handle)};
+    send_cmd(OGF_LINK_POLICY, OCF_EXIT_SNIFF_MODE, EXIT_SNIFF_MODE_CP_SIZE, &cp);
+}
+
+static void on_hci_event(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    
+    uint8_t buf[HCI_MAX_EVENT_SIZE];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 1 + HCI_EVENT_HDR_SIZE || buf[0] != HCI_EVENT_PKT) return;
+    
+    const hci_event_hdr* hdr = (const hci_event_hdr*)&buf[1];
+    const uint8_t* ptr = &buf[1 + HCI_EVENT_HDR_SIZE];
+    int len = (int)n - 1 - HCI_EVENT_HDR_SIZE;
+    
+    if (hdr->evt == EVT_CMD_COMPLETE) {
+        on_cmd_complete(ptr, len);
+    } else if (hdr->evt == EVT_MODE_CHANGE) {
+        on_mode_change(ptr, len);
+    }
+}
+
+static void on_poll(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    
+    uint16_t handle = htobs(g_handle);
+    send_cmd(OGF_STATUS_PARAM, OCF_READ_RSSI, 2, &handle);
+    send_cmd(OGF_STATUS_PARAM, OCF_READ_LINK_QUALITY, 2, &handle);
+}
+
+/* ============================================================================
+ * ATTACH / DETACH
+ * ============================================================================ */
+
+int bt_qos_attach(event_loop_t* loop, int sock) {
+    socklen_t len = sizeof(g_sndbuf);
+    if (getsockopt(sock, SOL_SOCKET, SO_SNDBUF, &g_sndbuf, &len) < 0) g_sndbuf = 0;
+    
+    g_ps3_bt_ctx.rssi = 0;
+    g_ps3_bt_ctx.link_quality = 255;
+    g_ps3_bt_ctx.link_grade = BT_QOS_GRADE_GOOD;
+    update_grade();
+    
+    struct l2cap_conninfo info;
+    len = sizeof(info);
+    if (getsockopt(sock, SOL_L2CAP, L2CAP_CONNINFO, &info, &len) < 0) {
+        LOG_ERROR("[BT] L2CAP_CONNINFO: %s\n", strerror(errno));
+        return -1;
+    }
+    g_handle = info.hci_handle;
+    
+    g_hci_fd = hci_open_dev(hci_get_route(NULL));
+    if (g_hci_fd < 0) {
+        LOG_WARN("[BT] Warning: No HCI access - link not tuned or monitored\n");
+        return -1;
+    }
+    fcntl(g_hci_fd, F_SETFL, fcntl(g_hci_fd, F_GETFL) | O_NONBLOCK);
+    
+    struct hci_filter flt;
+    hci_filter_clear(&flt);
+    hci_filter_set_ptype(HCI_EVENT_PKT, &flt);
+    hci_filter_set_event(EVT_CMD_COMPLETE, &flt);
+    hci_filter_set_event(EVT_MODE_CHANGE, &flt);
+    setsockopt(g_hci_fd, SOL_HCI, HCI_FILTER, &flt, sizeof(flt));
+    
+    g_poll_fd = event_timer_create();
+    g_qos_loop = loop;
+    if (g_poll_fd < 0 ||
+        event_loop_add(loop, g_hci_fd, EPOLLIN, on_hci_event, NULL) < 0 ||
+        event_loop_add(loop, g_poll_fd, EPOLLIN, on_poll, NULL) < 0) {
+        bt_qos_detach();
+        return -1;
+    }
+    
+    /* Role switch only - no hold, sniff or park while we are connected */
+    write_link_policy_cp policy = {.handle = htobs(g_handle), .policy = htobs(HCI_LP_RSWITCH)};
+    send_cmd(OGF_LINK_POLICY, OCF_WRITE_LINK_POLICY, WRITE_LINK_POLICY_CP_SIZE, &policy);
+    
+    write_automatic_flush_timeout_cp flush = {
+        .handle = htobs(g_handle),
+        .timeout = htobs(BT_QOS_FLUSH_TIMEOUT_SLOTS)
+    };
+    send_cmd(OGF_HOST_CTL, OCF_WRITE_AUTOMATIC_FLUSH_TIMEOUT,
+             WRITE_AUTOMATIC_FLUSH_TIMEOUT_CP_SIZE, &flush);
+    
+    uint64_t interval_ns = (uint64_t)BT_QOS_POLL_MS * 1000000ULL;
+    event_timer_arm(g_poll_fd, interval_ns, interval_ns);
+    
+    LOG_INFO("[BT] Link QoS: handle 0x%04x, sniff off, flush timeout %d ms, sndbuf %d\n",
+             g_handle, BT_QOS_FLUSH_TIMEOUT_MS, g_sndbuf);
+    return 0;
+}
+
+void bt_qos_detach(void) {
+    int* fds[] = { &g_hci_fd, &g_poll_fd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] < 0) continue;
+        if (g_qos_loop) event_loop_remove(g_qos_loop, *fds[i]);
+        close(*fds[i]);
+        *fds[i] = -1;
+    }
+    g_qos_loop = NULL;
+    g_sndbuf = 0;
+}
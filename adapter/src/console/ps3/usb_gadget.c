@@ -12,10 +12,24 @@
 #include <unistd.h>
 #include <errno.h>
 #include <dirent.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
 #include <linux/usb/functionfs.h>
 #include <linux/usb/ch9.h>
 
 #include "core/common.h"
+#include "core/latency.h"
+#include "core/fsutil.h"
+#include "core/aio.h"
+#include "core/record.h"
+#include "core/poll_sync.h"
+#include "core/metrics.h"
+#include "core/log.h"
 #include "console/ps3/ds3_emulation.h"
 #include "console/ps3/usb_gadget.h"
 
@@ -38,6 +52,10 @@ static uint64_t g_last_enable_time = 0;
 /* Number of consecutive suspends needed before entering standby */
 #define SUSPEND_THRESHOLD 3
 
+/* Startup timing - reported on the first ENABLE */
+static uint64_t g_init_start_ms = 0;
+static int g_enumerated = 0;
+
 /* ============================================================================
  * USB DESCRIPTORS
  * ============================================================================ */
@@ -151,7 +169,7 @@ static char g_udc_name[64] = "";
 static int detect_udc(void) {
     DIR* dir = opendir("/sys/class/udc");
     if (!dir) {
-        perror("[USB] Failed to open /sys/class/udc");
+        LOG_ERROR("[USB] Failed to open /sys/class/udc: %s\n", strerror(errno));
         return -1;
     }
     
@@ -163,68 +181,180 @@ static int detect_udc(void) {
         /* Found a UDC */
         strncpy(g_udc_name, entry->d_name, sizeof(g_udc_name) - 1);
         g_udc_name[sizeof(g_udc_name) - 1] = '\0';
-        printf("[USB] Auto-detected UDC: %s\n", g_udc_name);
+        LOG_INFO("[USB] Auto-detected UDC: %s\n", g_udc_name);
         closedir(dir);
         return 0;
     }
     
     closedir(dir);
-    fprintf(stderr, "[USB] No UDC found in /sys/class/udc/\n");
+    LOG_ERROR("[USB] No UDC found in /sys/class/udc/\n");
     return -1;
 }
 
 /* ============================================================================
  * GADGET SETUP
+ * 
+ * Plain open/write/mkdirat/symlinkat/mount(2) - no shell. A gadget left
+ * behind by a previous run is detected and reused as-is.
  * ============================================================================ */
 
+#ifndef FUNCTIONFS_MAGIC
+#define FUNCTIONFS_MAGIC    0xa647361
+#endif
+
+#define USB_FFS_FUNCTION    "functions/ffs.usb0"
+#define USB_CONFIG          "configs/c.1"
+
+typedef struct {
+    const char* attr;       /* Relative to USB_GADGET_PATH */
+    const char* value;
+} gadget_attr_t;
+
+static const gadget_attr_t gadget_attrs[] = {
+    { "bcdDevice",                              "0x0100" },
+    { "bcdUSB",                                 "0x0200" },
+    { "strings/0x409/serialnumber",             "123456" },
+    { "strings/0x409/manufacturer",             "Sony" },
+    { "strings/0x409/product",                  "PLAYSTATION(R)3 Controller" },
+    { USB_CONFIG "/strings/0x409/configuration", "DS3 Config" },
+    { USB_CONFIG "/MaxPower",                   "500" },
+};
+
+static const char* gadget_dirs[] = {
+    "strings/0x409",
+    USB_CONFIG "/strings/0x409",
+    USB_FFS_FUNCTION,
+};
+
+static int gadget_write(const char* attr, const char* value) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s", USB_GADGET_PATH, attr);
+    if (fs_write_attr(path, value) < 0) {
+        LOG_ERROR("[USB] Failed to write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int gadget_mkdir(const char* dir) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/%s", USB_GADGET_PATH, dir);
+    if (fs_mkdir_p(path, 0755) < 0) {
+        LOG_ERROR("[USB] Failed to create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* modprobe without a shell, and only if the module isn't loaded (or built in) */
+static void load_module(const char* name) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/module/%s", name);
+    if (access(path, F_OK) == 0) return;
+    
+    char* const argv[] = { "modprobe", "-q", (char*)name, NULL };
+    pid_t pid;
+    if (posix_spawnp(&pid, "modprobe", NULL, NULL, argv, NULL) != 0) return;
+    
+    int status;
+    waitpid(pid, &status, 0);
+}
+
+/* Same VID/PID and function linked - left over from a previous run */
+static int gadget_is_configured(void) {
+    char value[16];
+    unsigned int vid = 0, pid = 0;
+    
+    if (fs_read_attr(USB_GADGET_PATH "/idVendor", value, sizeof(value)) < 0 ||
+        sscanf(value, "%x", &vid) != 1 || vid != DS3_USB_VID) {
+        return 0;
+    }
+    if (fs_read_attr(USB_GADGET_PATH "/idProduct", value, sizeof(value)) < 0 ||
+        sscanf(value, "%x", &pid) != 1 || pid != DS3_USB_PID) {
+        return 0;
+    }
+    
+    struct stat st;
+    return lstat(USB_GADGET_PATH "/" USB_CONFIG "/ffs.usb0", &st) == 0;
+}
+
+static int gadget_create(void) {
+    LOG_INFO("[USB] Creating gadget configuration...\n");
+    
+    if (fs_mkdir_p(USB_GADGET_PATH, 0755) < 0) {
+        LOG_ERROR("[USB] Failed to create %s: %s\n", USB_GADGET_PATH, strerror(errno));
+        return -1;
+    }
+    
+    char value[16];
+    snprintf(value, sizeof(value), "0x%04x", DS3_USB_VID);
+    if (gadget_write("idVendor", value) < 0) return -1;
+    snprintf(value, sizeof(value), "0x%04x", DS3_USB_PID);
+    if (gadget_write("idProduct", value) < 0) return -1;
+    
+    for (size_t i = 0; i < sizeof(gadget_dirs) / sizeof(gadget_dirs[0]); i++) {
+        if (gadget_mkdir(gadget_dirs[i]) < 0) return -1;
+    }
+    
+    for (size_t i = 0; i < sizeof(gadget_attrs) / sizeof(gadget_attrs[0]); i++) {
+        if (gadget_write(gadget_attrs[i].attr, gadget_attrs[i].value) < 0) return -1;
+    }
+    
+    if (fs_symlink(USB_GADGET_PATH "/" USB_FFS_FUNCTION,
+                   USB_GADGET_PATH "/" USB_CONFIG "/ffs.usb0") < 0) {
+        LOG_ERROR("[USB] Failed to link function: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    return 0;
+}
+
+static int mount_functionfs(void) {
+    if (fs_is_mounted(USB_FFS_PATH, FUNCTIONFS_MAGIC)) {
+        LOG_INFO("[USB] FunctionFS already mounted\n");
+        return 0;
+    }
+    
+    if (fs_mkdir_p(USB_FFS_PATH, 0755) < 0) {
+        LOG_ERROR("[USB] Failed to create " USB_FFS_PATH ": %s\n", strerror(errno));
+        return -1;
+    }
+    if (mount("usb0", USB_FFS_PATH, "functionfs", 0, NULL) < 0) {
+        LOG_ERROR("[USB] Failed to mount FunctionFS: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
 int ps3_usb_init(void) {
-    printf("[USB] Initializing USB gadget...\n");
+    g_init_start_ms = time_get_ms();
+    LOG_INFO("[USB] Initializing USB gadget...\n");
     
     /* Auto-detect UDC */
     if (detect_udc() < 0) {
-        fprintf(stderr, "[USB] No USB Device Controller found. Is dwc2 loaded?\n");
-        fprintf(stderr, "[USB] Check: dtoverlay=dwc2,dr_mode=peripheral in /boot/firmware/config.txt\n");
+        LOG_ERROR("[USB] No USB Device Controller found. Is dwc2 loaded?\n");
+        LOG_ERROR("[USB] Check: dtoverlay=dwc2,dr_mode=peripheral in /boot/firmware/config.txt\n");
         return -1;
     }
     
-    /* Load kernel modules */
-    system("modprobe libcomposite 2>/dev/null");
-    system("modprobe usb_f_fs 2>/dev/null");
-    
-    /* Create gadget if needed */
-    if (access(USB_GADGET_PATH, F_OK) != 0) {
-        printf("[USB] Creating gadget configuration...\n");
-        
-        system("mkdir -p " USB_GADGET_PATH);
-        
-        char cmd[256];
-        snprintf(cmd, sizeof(cmd), "echo 0x%04x > %s/idVendor", DS3_USB_VID, USB_GADGET_PATH);
-        system(cmd);
-        snprintf(cmd, sizeof(cmd), "echo 0x%04x > %s/idProduct", DS3_USB_PID, USB_GADGET_PATH);
-        system(cmd);
-        
-        system("echo 0x0100 > " USB_GADGET_PATH "/bcdDevice");
-        system("echo 0x0200 > " USB_GADGET_PATH "/bcdUSB");
-        
-        system("mkdir -p " USB_GADGET_PATH "/strings/0x409");
-        system("echo '123456' > " USB_GADGET_PATH "/strings/0x409/serialnumber");
-        system("echo 'Sony' > " USB_GADGET_PATH "/strings/0x409/manufacturer");
-        system("echo 'PLAYSTATION(R)3 Controller' > " USB_GADGET_PATH "/strings/0x409/product");
+    /* Create gadget if needed (warm restarts reuse the previous one) */
+    int reused = gadget_is_configured();
+    if (reused) {
+        LOG_INFO("[USB] Reusing existing gadget configuration\n");
+    } else {
+        /* Load kernel modules */
+        load_module("libcomposite");
+        load_module("usb_f_fs");
         
-        system("mkdir -p " USB_GADGET_PATH "/configs/c.1/strings/0x409");
-        system("echo 'DS3 Config' > " USB_GADGET_PATH "/configs/c.1/strings/0x409/configuration");
-        system("echo 500 > " USB_GADGET_PATH "/configs/c.1/MaxPower");
-        
-        system("mkdir -p " USB_GADGET_PATH "/functions/ffs.usb0");
-        system("ln -sf " USB_GADGET_PATH "/functions/ffs.usb0 " USB_GADGET_PATH "/configs/c.1/ 2>/dev/null");
+        if (gadget_create() < 0) return -1;
     }
     
     /* Mount FunctionFS */
-    system("mkdir -p " USB_FFS_PATH);
-    system("umount " USB_FFS_PATH " 2>/dev/null");
-    system("mount -t functionfs usb0 " USB_FFS_PATH);
+    if (mount_functionfs() < 0) return -1;
     
-    printf("[USB] Gadget initialized\n");
+    LOG_INFO("[USB] Gadget initialized in %llu ms (%s)\n",
+             (unsigned long long)(time_get_ms() - g_init_start_ms),
+             reused ? "reused" : "created");
     return 0;
 }
 
@@ -233,40 +363,44 @@ int ps3_usb_write_descriptors(int ep0_fd) {
     
     written = write(ep0_fd, &usb_descriptors, sizeof(usb_descriptors));
     if (written != sizeof(usb_descriptors)) {
-        perror("[USB] Failed to write descriptors");
+        LOG_ERROR("[USB] Failed to write descriptors: %s\n", strerror(errno));
         return -1;
     }
     
     written = write(ep0_fd, &usb_strings, sizeof(usb_strings));
     if (written != sizeof(usb_strings)) {
-        perror("[USB] Failed to write strings");
+        LOG_ERROR("[USB] Failed to write strings: %s\n", strerror(errno));
         return -1;
     }
     
-    printf("[USB] Descriptors written\n");
+    LOG_INFO("[USB] Descriptors written\n");
     return 0;
 }
 
 int ps3_usb_bind(void) {
     if (g_udc_name[0] == '\0') {
-        fprintf(stderr, "[USB] No UDC detected, cannot bind\n");
+        LOG_ERROR("[USB] No UDC detected, cannot bind\n");
         return -1;
     }
     
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "echo '%s' > %s/UDC", g_udc_name, USB_GADGET_PATH);
-    int ret = system(cmd);
-    if (ret == 0) {
-        printf("[USB] Bound to UDC %s\n", g_udc_name);
+    /* Still bound after an unclean exit - writing again would fail with EBUSY */
+    char current[64];
+    if (fs_read_attr(USB_GADGET_PATH "/UDC", current, sizeof(current)) > 0 &&
+        strcmp(current, g_udc_name) == 0) {
+        LOG_INFO("[USB] Already bound to UDC %s\n", g_udc_name);
+        return 0;
+    }
+    
+    if (gadget_write("UDC", g_udc_name) < 0) {
+        return -1;
     }
-    return ret == 0 ? 0 : -1;
+    LOG_INFO("[USB] Bound to UDC %s\n", g_udc_name);
+    return 0;
 }
 
 int ps3_usb_unbind(void) {
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "echo '' > %s/UDC", USB_GADGET_PATH);
-    system(cmd);
-    printf("[USB] Unbound from UDC\n");
+    gadget_write("UDC", "\n");
+    LOG_INFO("[USB] Unbound from UDC\n");
     return 0;
 }
 
@@ -276,7 +410,7 @@ int ps3_usb_open_endpoint(int endpoint_num) {
     
     int fd = open(path, O_RDWR);
     if (fd < 0) {
-        perror(path);
+        LOG_ERROR("%s: %s\n", path, strerror(errno));
     }
     return fd;
 }
@@ -285,208 +419,647 @@ void ps3_usb_cleanup(void) {
     ps3_usb_unbind();
 }
 
+/* Wake the endpoint I/O handlers after ENABLE/DISABLE (defined below) */
+static void usb_io_kick(void);
+
 /* ============================================================================
- * THREAD FUNCTIONS
+ * CONTROL ENDPOINT (ep0)
+ * 
+ * ep0 stays blocking (FunctionFS needs that for the data stage of a
+ * SETUP) but is only read once epoll reports an event queued, so the
+ * event read never waits and the data stage follows straight after.
  * ============================================================================ */
 
-void* ps3_usb_control_thread(void* arg) {
-    (void)arg;
+static event_loop_t* g_ep0_loop = NULL;
+
+static void on_ep0_event(int fd, uint32_t events, void* ctx) {
+    (void)ctx;
     
-    printf("[USB] Control thread started\n");
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        LOG_INFO("[USB] ep0 hung up\n");
+        ps3_usb_ep0_detach();
+        return;
+    }
     
-    while (g_running) {
-        struct usb_functionfs_event event;
-        
-        if (read(g_ep0_fd, &event, sizeof(event)) < 0) {
-            if (errno == EINTR) continue;
-            perror("[USB] read ep0");
-            break;
+    struct usb_functionfs_event event;
+    if (read(fd, &event, sizeof(event)) < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            LOG_ERROR("[USB] read ep0: %s\n", strerror(errno));
+            ps3_usb_ep0_detach();
         }
-        
-        switch (event.type) {
-            case FUNCTIONFS_SETUP: {
-                uint8_t bRequest = event.u.setup.bRequest;
-                uint16_t wValue = event.u.setup.wValue;
-                uint16_t wLength = event.u.setup.wLength;
-                uint8_t report_id = wValue & 0xFF;
+        return;
+    }
+    
+    switch (event.type) {
+        case FUNCTIONFS_SETUP: {
+            uint8_t bRequest = event.u.setup.bRequest;
+            uint16_t wValue = event.u.setup.wValue;
+            uint16_t wLength = event.u.setup.wLength;
+            uint8_t report_id = wValue & 0xFF;
+            
+            if (bRequest == 0x0A) {
+                /* SET_IDLE */
+                read(g_ep0_fd, NULL, 0);
+            }
+            else if (bRequest == 0x01) {
+                /* GET_REPORT */
+                const char* name = NULL;
+                const uint8_t* data = ds3_get_feature_report(report_id, &name);
                 
-                if (bRequest == 0x0A) {
-                    /* SET_IDLE */
-                    read(g_ep0_fd, NULL, 0);
-                }
-                else if (bRequest == 0x01) {
-                    /* GET_REPORT */
-                    const char* name = NULL;
-                    const uint8_t* data = ds3_get_feature_report(report_id, &name);
-                    
-                    if (data) {
-                        size_t send_len = (DS3_FEATURE_REPORT_SIZE < wLength) ?
-                                          DS3_FEATURE_REPORT_SIZE : wLength;
-                        write(g_ep0_fd, data, send_len);
-                    } else {
-                        read(g_ep0_fd, NULL, 0);  /* Stall */
-                    }
+                if (data) {
+                    size_t send_len = (DS3_FEATURE_REPORT_SIZE < wLength) ?
+                                      DS3_FEATURE_REPORT_SIZE : wLength;
+                    write(g_ep0_fd, data, send_len);
+                } else {
+                    read(g_ep0_fd, NULL, 0);  /* Stall */
                 }
-                else if (bRequest == 0x09) {
-                    /* SET_REPORT */
-                    uint8_t buf[64] = {0};
-                    ssize_t r = 0;
-                    
-                    if (wLength > 0) {
-                        r = read(g_ep0_fd, buf, wLength < 64 ? wLength : 64);
-                        if (r > 0) {
-                            ds3_handle_set_report(report_id, buf, r);
-                        }
+            }
+            else if (bRequest == 0x09) {
+                /* SET_REPORT */
+                uint8_t buf[64] = {0};
+                ssize_t r = 0;
+                
+                if (wLength > 0) {
+                    r = read(g_ep0_fd, buf, wLength < 64 ? wLength : 64);
+                    if (r > 0) {
+                        ds3_handle_set_report(report_id, buf, r);
                     }
-                    write(g_ep0_fd, NULL, 0);  /* ACK */
                 }
-                else {
-                    read(g_ep0_fd, NULL, 0);  /* Stall unknown requests */
-                }
-                break;
+                write(g_ep0_fd, NULL, 0);  /* ACK */
+            }
+            else {
+                read(g_ep0_fd, NULL, 0);  /* Stall unknown requests */
             }
+            break;
+        }
+        
+        case FUNCTIONFS_ENABLE:
+            LOG_INFO("[USB] *** ENABLED - PS3 connected ***\n");
+            if (!g_enumerated) {
+                struct timespec boot;
+                clock_gettime(CLOCK_BOOTTIME, &boot);
+                LOG_INFO("[USB] Enumerated %llu ms after gadget init (%ld.%03ld s after boot)\n",
+                         (unsigned long long)(time_get_ms() - g_init_start_ms),
+                         (long)boot.tv_sec, boot.tv_nsec / 1000000);
+                g_enumerated = 1;
+            }
+            g_usb_enabled = 1;
+            metrics_gauge_set(METRIC_GAUGE_USB_ENABLED, 1);
+            g_suspend_count = 0;  /* Reset suspend counter */
+            g_last_enable_time = time_get_ms();
             
-            case FUNCTIONFS_ENABLE:
-                printf("[USB] *** ENABLED - PS3 connected ***\n");
-                g_usb_enabled = 1;
-                g_suspend_count = 0;  /* Reset suspend counter */
-                g_last_enable_time = time_get_ms();
-                
-                if (system_get_state() == SYSTEM_STATE_WAKING) {
-                    printf("[USB] PS3 responded to wake\n");
-                    system_set_state(SYSTEM_STATE_ACTIVE);
-                }
-                break;
+            if (system_get_state() == SYSTEM_STATE_WAKING) {
+                LOG_INFO("[USB] PS3 responded to wake\n");
+                system_set_state(SYSTEM_STATE_ACTIVE);
+            }
+            usb_io_kick();
+            break;
+            
+        case FUNCTIONFS_DISABLE:
+            LOG_INFO("[USB] *** DISABLED - PS3 disconnected ***\n");
+            g_usb_enabled = 0;
+            metrics_gauge_set(METRIC_GAUGE_USB_ENABLED, 0);
+            usb_io_kick();
+            
+            /* Clear rumble */
+            controller_output_t output;
+            controller_output_copy(&output);
+            output.rumble_left = 0;
+            output.rumble_right = 0;
+            controller_output_update(&output);
+            break;
+            
+        case FUNCTIONFS_SUSPEND: {
+            g_suspend_count++;
+            metrics_inc(METRIC_USB_SUSPENDS);
+            uint64_t now = time_get_ms();
+            uint64_t time_since_enable = now - g_last_enable_time;
+            
+            LOG_INFO("[USB] SUSPEND event #%d (USB stable for %llu ms)\n", 
+                     g_suspend_count, (unsigned long long)time_since_enable);
+            
+            /* 
+             * Only enter standby if:
+             * 1. USB has been stable for a while (not just during initial connection)
+             * 2. We've seen multiple suspend events (not just a glitch)
+             * 3. We're currently in ACTIVE state
+             */
+            if (time_since_enable >= USB_STABLE_TIME_MS && 
+                g_suspend_count >= SUSPEND_THRESHOLD &&
+                system_get_state() == SYSTEM_STATE_ACTIVE) {
                 
-            case FUNCTIONFS_DISABLE:
-                printf("[USB] *** DISABLED - PS3 disconnected ***\n");
+                LOG_INFO("[USB] *** SUSPEND confirmed - entering standby ***\n");
                 g_usb_enabled = 0;
-                
-                /* Clear rumble */
-                controller_output_t output;
-                controller_output_copy(&output);
-                output.rumble_left = 0;
-                output.rumble_right = 0;
-                controller_output_update(&output);
-                break;
-                
-            case FUNCTIONFS_SUSPEND: {
-                g_suspend_count++;
-                uint64_t now = time_get_ms();
-                uint64_t time_since_enable = now - g_last_enable_time;
-                
-                printf("[USB] SUSPEND event #%d (USB stable for %llu ms)\n", 
-                       g_suspend_count, (unsigned long long)time_since_enable);
-                
-                /* 
-                 * Only enter standby if:
-                 * 1. USB has been stable for a while (not just during initial connection)
-                 * 2. We've seen multiple suspend events (not just a glitch)
-                 * 3. We're currently in ACTIVE state
-                 */
-                if (time_since_enable >= USB_STABLE_TIME_MS && 
-                    g_suspend_count >= SUSPEND_THRESHOLD &&
-                    system_get_state() == SYSTEM_STATE_ACTIVE) {
-                    
-                    printf("[USB] *** SUSPEND confirmed - entering standby ***\n");
-                    g_usb_enabled = 0;
-                    system_enter_standby();
-                } else {
-                    printf("[USB] SUSPEND ignored (not stable or threshold not met)\n");
-                }
-                break;
+                metrics_gauge_set(METRIC_GAUGE_USB_ENABLED, 0);
+                system_enter_standby();
+            } else {
+                LOG_INFO("[USB] SUSPEND ignored (not stable or threshold not met)\n");
             }
-                
-            case FUNCTIONFS_UNBIND:
-                printf("[USB] UNBIND\n");
-                g_running = 0;
-                break;
-                
-            default:
-                break;
+            break;
         }
+            
+        case FUNCTIONFS_UNBIND:
+            LOG_INFO("[USB] UNBIND\n");
+            g_running = 0;
+            break;
+            
+        default:
+            break;
+    }
+}
+
+int ps3_usb_ep0_attach(event_loop_t* loop) {
+    if (g_ep0_fd < 0) return -1;
+    if (event_loop_add(loop, g_ep0_fd, EPOLLIN, on_ep0_event, NULL) < 0) {
+        LOG_INFO("[USB] Failed to register ep0\n");
+        return -1;
+    }
+    g_ep0_loop = loop;
+    LOG_INFO("[USB] Control endpoint attached\n");
+    return 0;
+}
+
+void ps3_usb_ep0_detach(void) {
+    if (g_ep0_loop) event_loop_remove(g_ep0_loop, g_ep0_fd);
+    g_ep0_loop = NULL;
+}
+
+/* ============================================================================
+ * ENDPOINT I/O (AIO)
+ * 
+ * ep1/ep2 transfers are submitted with io_submit and complete on an
+ * eventfd reaped by the owning event loop - no threads blocked in
+ * write()/read().
+ * 
+ * IN (ep1): a fresh report is queued the moment input changes, up to
+ * USB_AIO_IN_DEPTH deep, so the UDC answers the host's next poll straight
+ * from the queue. When all transfers are in flight the newest input is
+ * held back and queued as soon as one completes. A keepalive repeat is
+ * queued only when nothing has gone out for USB_INPUT_KEEPALIVE_MS -
+ * the high-speed interrupt interval is 125us, so keeping duplicates
+ * queued permanently would cost 8000 completions a second for nothing.
+ * 
+ * OUT (ep2): USB_AIO_OUT_DEPTH reads stay posted while enabled, so
+ * rumble/LED reports are parsed the instant they land.
+ * 
+ * With --usb-jit a changed report is not queued at once but built from
+ * the newest state just before the host's next poll, as predicted from
+ * the IN completion timestamps (core/poll_sync.h).
+ * ============================================================================ */
+
+typedef struct {
+    struct iocb cb;
+    uint8_t buf[EP_MAX_PACKET];     /* OUT only - IN writes straight from the frame */
+    const ds3_frame_t* frame;       /* IN: pinned until completion */
+    int busy;
+    int is_in;
+    uint64_t input_ns;      /* Latency timestamps (0 = keepalive repeat) */
+    uint64_t build_ns;
+    uint64_t poll_ns;       /* JIT: the predicted poll it was built for */
+} usb_xfer_t;
+
+static usb_xfer_t g_in_xfers[USB_AIO_IN_DEPTH];
+static usb_xfer_t g_out_xfers[USB_AIO_OUT_DEPTH];
+
+static aio_context_t g_aio_ctx = 0;
+static event_loop_t* g_io_loop = NULL;
+static int g_aio_event_fd = -1;     /* Completions */
+static int g_state_fd = -1;         /* Controller state changes */
+static int g_keepalive_fd = -1;     /* timerfd, armed while enabled */
+static int g_kick_fd = -1;          /* ENABLE/DISABLE from the ep0 handler */
+static int g_system_fd = -1;        /* System state changes (standby) */
+
+static const ds3_frame_t* g_in_frame = NULL;   /* Last frame queued (pinned), NULL after (re)connect */
+static uint32_t g_in_seq = 0;       /* seq of the last frame taken, kept across reconnects */
+static int g_in_pending = 0;        /* g_in_frame waiting for a free transfer */
+static uint64_t g_pending_input_ns = 0;
+static uint64_t g_pending_build_ns = 0;
+static uint64_t g_last_in_submit_ms = 0;
+
+/* Host-poll-synchronised IN timing */
+typedef enum {
+    USB_JIT_OFF = 0,        /* Queue on change */
+    USB_JIT_ACQUIRE,        /* Keeping ep1 queued back to back to measure */
+    USB_JIT_LOCKED          /* Building just before each predicted poll */
+} usb_jit_state_t;
+
+static int g_jit_requested = 0;
+static usb_jit_state_t g_jit_state = USB_JIT_OFF;
+static poll_sync_t g_poll_sync;
+static int g_jit_fd = -1;           /* timerfd, build slot before the next poll */
+static int g_jit_armed = 0;
+static int g_jit_repeat = 0;        /* Keepalive due at the armed slot */
+static uint64_t g_jit_poll_ns = 0;  /* Poll the armed build slot aims at */
+static uint64_t g_jit_lead_ns = USB_JIT_LEAD_US * 1000ULL;
+static uint32_t g_jit_hits = 0;     /* Polls made since the lead last moved */
+
+static void usb_io_kick(void) {
+    if (g_kick_fd < 0) return;
+    uint64_t one = 1;
+    ssize_t ret = write(g_kick_fd, &one, sizeof(one));
+    (void)ret;
+}
+
+static void drain_eventfd(int fd) {
+    uint64_t count;
+    ssize_t ret = read(fd, &count, sizeof(count));
+    (void)ret;
+}
+
+static usb_xfer_t* free_xfer(usb_xfer_t* xfers, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!xfers[i].busy) return &xfers[i];
     }
-    
     return NULL;
 }
 
-void* ps3_usb_input_thread(void* arg) {
-    (void)arg;
+static int in_xfers_busy(void) {
+    int busy = 0;
+    for (int i = 0; i < USB_AIO_IN_DEPTH; i++) busy += g_in_xfers[i].busy;
+    return busy;
+}
+
+static int xfer_submit(usb_xfer_t* x, uint16_t opcode, int fd, void* buf, size_t len) {
+    aio_prep(&x->cb, opcode, fd, buf, len, g_aio_event_fd, x);
+    if (aio_submit(g_aio_ctx, &x->cb) < 0) {
+        return -1;
+    }
+    x->busy = 1;
+    return 0;
+}
+
+/* Queue g_in_frame on ep1 */
+static usb_xfer_t* in_submit(uint64_t input_ns, uint64_t build_ns) {
+    usb_xfer_t* x = free_xfer(g_in_xfers, USB_AIO_IN_DEPTH);
+    if (!x) {
+        /* Only the newest state goes out - a pending one is superseded */
+        if (g_in_pending) metrics_inc(METRIC_USB_REPORTS_DROPPED);
+        g_in_pending = 1;
+        g_pending_input_ns = input_ns;
+        g_pending_build_ns = build_ns;
+        return NULL;
+    }
+    
+    x->input_ns = input_ns;
+    x->build_ns = build_ns;
+    x->poll_ns = 0;
+    if (xfer_submit(x, IOCB_CMD_PWRITE, g_ep1_fd, (void*)g_in_frame->usb,
+                    DS3_INPUT_REPORT_SIZE) < 0) {
+        metrics_inc(METRIC_USB_REPORTS_FAILED);
+        return NULL;
+    }
+    x->frame = ds3_frame_retain(g_in_frame);
+    
+    g_in_pending = 0;
+    g_last_in_submit_ms = time_get_ms();
+    return x;
+}
+
+/*
+ * Take the frame for the current state and queue it if the DS3 bytes changed.
+ * @return The queued transfer, NULL if nothing went out
+ */
+static usb_xfer_t* in_submit_fresh(void) {
+    if (!g_usb_enabled || system_is_standby()) return NULL;
     
-    g_ep1_fd = ps3_usb_open_endpoint(1);
-    if (g_ep1_fd < 0) {
-        printf("[USB] Failed to open ep1\n");
+    const ds3_frame_t* frame = ds3_frame_acquire();
+    
+    /*
+     * Same frame as last time: the state moved but the DS3 bytes didn't
+     * (touchpad, mute, ...) - nothing to tell the PS3 until the keepalive.
+     */
+    if (g_in_frame && frame->seq == g_in_frame->seq) {
+        ds3_frame_release(frame);
         return NULL;
     }
     
-    printf("[USB] Input thread started\n");
+    /* A reconnect resends the last frame; only time frames carrying new input */
+    int fresh = frame->seq != g_in_seq && frame->input_ns;
+    g_in_seq = frame->seq;
+    ds3_frame_release(g_in_frame);
+    g_in_frame = frame;
+    if (!fresh) return in_submit(0, 0);
     
-    uint8_t report[DS3_INPUT_REPORT_SIZE];
+    latency_record_span(LATENCY_STAGE_USB_HANDOFF, frame->input_ns, frame->built_ns);
+    return in_submit(frame->input_ns, frame->built_ns);
+}
+
+/* ============================================================================
+ * HOST POLL TIMING (--usb-jit)
+ * ============================================================================ */
+
+void ps3_usb_set_jit(int enabled) {
+    g_jit_requested = enabled;
+}
+
+static void jit_disarm(void) {
+    if (g_jit_armed) event_timer_arm(g_jit_fd, 0, 0);
+    g_jit_armed = 0;
+    g_jit_repeat = 0;
+}
+
+/* Keep every IN transfer queued so each poll completes one */
+static void jit_fill_queue(void) {
+    while (g_usb_enabled && g_in_frame && free_xfer(g_in_xfers, USB_AIO_IN_DEPTH)) {
+        if (!in_submit(0, 0)) break;
+    }
+}
+
+static void jit_acquire(void) {
+    jit_disarm();
+    poll_sync_reset(&g_poll_sync);
+    g_jit_state = USB_JIT_ACQUIRE;
+    g_jit_lead_ns = USB_JIT_LEAD_US * 1000ULL;
+    g_jit_hits = 0;
+}
+
+/* Input changed: arm the build slot ahead of the next poll we can make */
+static void jit_schedule(void) {
+    if (g_jit_armed || !g_usb_enabled || system_is_standby()) return;
     
-    while (g_running) {
-        if (system_is_standby()) {
-            usleep(100000);
-            continue;
-        }
+    uint64_t now = time_get_ns();
+    g_jit_poll_ns = poll_sync_next(&g_poll_sync, now + g_jit_lead_ns);
+    event_timer_arm_at(g_jit_fd, g_jit_poll_ns - g_jit_lead_ns);
+    g_jit_armed = 1;
+}
+
+static void on_jit_slot(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    drain_eventfd(fd);
+    g_jit_armed = 0;
+    
+    if (g_jit_state != USB_JIT_LOCKED) return;
+    usb_xfer_t* x = in_submit_fresh();
+    if (!x && g_jit_repeat && in_xfers_busy() == 0) x = in_submit(0, 0);
+    g_jit_repeat = 0;
+    if (x) x->poll_ns = g_jit_poll_ns;
+}
+
+/* One IN completion = one host poll */
+static void jit_on_poll(const usb_xfer_t* x, uint64_t done_ns) {
+    if (g_jit_state == USB_JIT_ACQUIRE) {
+        if (!poll_sync_acquire(&g_poll_sync, done_ns)) return;
         
-        if (g_usb_enabled) {
-            /* Get current controller state */
-            controller_state_t state;
-            controller_state_copy(&state);
-            
-            /* Build DS3 report from generic state */
-            ds3_build_input_report(&state, report);
-            
-            /* Send to PS3 */
-            write(g_ep1_fd, report, DS3_INPUT_REPORT_SIZE);
+        uint64_t period_ns = poll_sync_period_ns(&g_poll_sync);
+        if (period_ns < USB_JIT_MIN_PERIOD_US * 1000ULL) {
+            LOG_INFO("[USB] Host polls every %.1f us - too fast to time, queuing on change\n",
+                     period_ns / 1e3);
+            g_jit_state = USB_JIT_OFF;
+            return;
         }
-        
-        usleep(4000);  /* ~250Hz */
+        LOG_INFO("[USB] Host polls every %.1f us - reports timed to each poll\n",
+                 period_ns / 1e3);
+        g_jit_state = USB_JIT_LOCKED;
+        return;
     }
+    if (g_jit_state != USB_JIT_LOCKED) return;
     
-    return NULL;
+    if (poll_sync_track(&g_poll_sync, done_ns) < 0) {
+        LOG_INFO("[USB] Lost host poll timing - measuring again\n");
+        jit_acquire();
+        return;
+    }
+    int64_t phase_ns = g_poll_sync.last_error_ns;
+    latency_record(LATENCY_STAGE_USB_POLL_PHASE,
+                   (uint64_t)(phase_ns < 0 ? -phase_ns : phase_ns));
+    
+    if (!x->poll_ns) return;
+    
+    /* Built for a poll that went by without it - start earlier */
+    uint64_t period_ns = poll_sync_period_ns(&g_poll_sync);
+    if (done_ns > x->poll_ns + period_ns / 2) {
+        g_jit_lead_ns += USB_JIT_LEAD_STEP_US * 1000ULL;
+        if (g_jit_lead_ns > period_ns / 2) g_jit_lead_ns = period_ns / 2;
+        g_jit_hits = 0;
+    } else if (++g_jit_hits >= 256 && g_jit_lead_ns > USB_JIT_MIN_LEAD_US * 1000ULL) {
+        /* Made every poll for a while - try a little closer */
+        g_jit_lead_ns -= 10000ULL;
+        g_jit_hits = 0;
+    }
+}
+
+static void out_post_all(void) {
+    usb_xfer_t* x;
+    while (g_usb_enabled && (x = free_xfer(g_out_xfers, USB_AIO_OUT_DEPTH)) != NULL) {
+        if (xfer_submit(x, IOCB_CMD_PREAD, g_ep2_fd, x->buf, sizeof(x->buf)) < 0) break;
+    }
 }
 
-void* ps3_usb_output_thread(void* arg) {
-    (void)arg;
+static void handle_out_report(const uint8_t* buf, ssize_t n) {
+    static int output_log_count = 0;
     
-    g_ep2_fd = ps3_usb_open_endpoint(2);
-    if (g_ep2_fd < 0) {
-        printf("[USB] Failed to open ep2\n");
-        return NULL;
+    /* Debug: log first few output reports to see structure */
+    if (++output_log_count <= 10) {
+        debug_print_hex("[USB] Output report", buf, (size_t)n);
     }
     
-    printf("[USB] Output thread started\n");
+    metrics_inc(METRIC_USB_OUTPUT_REPORTS);
     
-    uint8_t buf[EP_MAX_PACKET];
-    static int output_log_count = 0;
+    /* Parse and update output state */
+    if (n >= 6) {
+        ds3_parse_output_report(0, buf, n);
+    }
+}
+
+static void on_aio_complete(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    drain_eventfd(fd);
+    
+    struct io_event done[USB_AIO_IN_DEPTH + USB_AIO_OUT_DEPTH];
+    int n = aio_reap(g_aio_ctx, done, USB_AIO_IN_DEPTH + USB_AIO_OUT_DEPTH);
+    uint64_t done_ns = time_get_ns();
     
-    while (g_running) {
-        ssize_t n = read(g_ep2_fd, buf, sizeof(buf));
+    for (int i = 0; i < n; i++) {
+        usb_xfer_t* x = (usb_xfer_t*)(uintptr_t)done[i].data;
+        int64_t res = done[i].res;
+        x->busy = 0;
         
-        if (n <= 0) {
-            if (errno == EAGAIN) {
-                usleep(1000);
-                continue;
+        if (x->is_in) {
+            ds3_frame_release(x->frame);
+            x->frame = NULL;
+            if (res > 0 && x->input_ns) {
+                latency_record_span(LATENCY_STAGE_USB_WRITE, x->build_ns, done_ns);
+                latency_record_span(LATENCY_STAGE_USB_TOTAL, x->input_ns, done_ns);
             }
-            continue;
-        }
-        
-        /* Debug: log first few output reports to see structure */
-        if (++output_log_count <= 10) {
-            printf("[USB] Output report (%zd bytes):", n);
-            for (ssize_t i = 0; i < n && i < 16; i++) {
-                printf(" %02X", buf[i]);
+            /* Host just polled - a USB-synced replay steps here */
+            if (res > 0) {
+                metrics_inc(METRIC_USB_REPORTS_SENT);
+                replay_host_poll(done_ns);
+                jit_on_poll(x, done_ns);
+            } else if (res != -ESHUTDOWN) {
+                metrics_inc(METRIC_USB_REPORTS_FAILED);
             }
-            if (n > 16) printf(" ...");
-            printf("\n");
+        } else if (res > 0) {
+            handle_out_report(x->buf, (ssize_t)res);
         }
-        
-        /* Parse and update output state */
-        if (n >= 6) {
-            ds3_parse_output_report(buf, n);
+        /* res < 0: -ESHUTDOWN on DISABLE, reposted on the next ENABLE */
+    }
+    
+    /* Input that arrived while the queue was full goes out now */
+    if (g_in_pending && g_usb_enabled) in_submit(g_pending_input_ns, g_pending_build_ns);
+    if (g_jit_state == USB_JIT_ACQUIRE) jit_fill_queue();
+    out_post_all();
+}
+
+static void on_state_change(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    drain_eventfd(fd);
+    if (g_jit_state == USB_JIT_LOCKED) {
+        jit_schedule();
+    } else {
+        in_submit_fresh();
+    }
+}
+
+static void on_keepalive(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    drain_eventfd(fd);  /* timerfd expirations read like an eventfd count */
+    
+    if (!g_usb_enabled || system_is_standby() || !g_in_frame) return;
+    
+    /* Repeat the last report if nothing has gone out for a while */
+    if (in_xfers_busy() == 0 &&
+        time_get_ms() - g_last_in_submit_ms >= USB_INPUT_KEEPALIVE_MS) {
+        if (g_jit_state == USB_JIT_LOCKED) {
+            /* Lined up with the next poll like everything else */
+            g_jit_repeat = 1;
+            jit_schedule();
+        } else {
+            in_submit(0, 0);
         }
     }
+}
+
+static void on_kick(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    drain_eventfd(fd);
     
-    return NULL;
-}
\ No newline at end of file
+    struct itimerspec its = {0};
+    if (g_usb_enabled && !system_is_standby()) {
+        its.it_value.tv_nsec = USB_INPUT_KEEPALIVE_MS * 1000000L;
+        its.it_interval.tv_nsec = USB_INPUT_KEEPALIVE_MS * 1000000L;
+    }
+    timerfd_settime(g_keepalive_fd, 0, &its, NULL);
+    
+    /* Host poll timing is measured again on every connect */
+    if (g_jit_requested && g_usb_enabled) {
+        jit_acquire();
+    } else {
+        jit_disarm();
+        g_jit_state = USB_JIT_OFF;
+    }
+    
+    if (g_usb_enabled) {
+        /* Host just (re)connected - send full state */
+        ds3_frame_release(g_in_frame);
+        g_in_frame = NULL;
+        in_submit_fresh();
+        if (g_jit_state == USB_JIT_ACQUIRE) jit_fill_queue();
+        out_post_all();
+    }
+}
+
+/* Standby parks the keepalive and poll timing; the next ENABLE kick resumes them */
+static void on_system_state(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    drain_eventfd(fd);
+    if (!system_is_standby()) return;
+    
+    struct itimerspec its = {0};
+    timerfd_settime(g_keepalive_fd, 0, &its, NULL);
+    jit_disarm();
+    g_jit_state = USB_JIT_OFF;
+}
+
+static int open_nonblock_endpoint(int endpoint_num) {
+    int fd = ps3_usb_open_endpoint(endpoint_num);
+    if (fd >= 0) {
+        /* AIO must never wait for ENABLE inside io_submit() */
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return fd;
+}
+
+int ps3_usb_io_attach(event_loop_t* loop) {
+    g_ep1_fd = open_nonblock_endpoint(1);
+    g_ep2_fd = open_nonblock_endpoint(2);
+    if (g_ep1_fd < 0 || g_ep2_fd < 0) {
+        LOG_INFO("[USB] Failed to open ep1/ep2\n");
+        goto fail;
+    }
+    
+    if (aio_ctx_setup(USB_AIO_IN_DEPTH + USB_AIO_OUT_DEPTH, &g_aio_ctx) < 0) {
+        LOG_ERROR("[USB] io_setup: %s\n", strerror(errno));
+        goto fail;
+    }
+    
+    g_aio_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    g_kick_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    g_keepalive_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    g_jit_fd = event_timer_create();
+    g_state_fd = controller_state_subscribe();
+    g_system_fd = system_state_subscribe();
+    if (g_aio_event_fd < 0 || g_kick_fd < 0 || g_keepalive_fd < 0 || g_jit_fd < 0 ||
+        g_state_fd < 0 || g_system_fd < 0) {
+        LOG_ERROR("[USB] Failed to create I/O event fds\n");
+        goto fail;
+    }
+    
+    for (int i = 0; i < USB_AIO_IN_DEPTH; i++) g_in_xfers[i].is_in = 1;
+    
+    g_io_loop = loop;
+    if (event_loop_add(loop, g_aio_event_fd, EPOLLIN, on_aio_complete, NULL) < 0 ||
+        event_loop_add(loop, g_state_fd, EPOLLIN, on_state_change, NULL) < 0 ||
+        event_loop_add(loop, g_keepalive_fd, EPOLLIN, on_keepalive, NULL) < 0 ||
+        event_loop_add(loop, g_kick_fd, EPOLLIN, on_kick, NULL) < 0 ||
+        event_loop_add(loop, g_jit_fd, EPOLLIN, on_jit_slot, NULL) < 0 ||
+        event_loop_add(loop, g_system_fd, EPOLLIN, on_system_state, NULL) < 0) {
+        goto fail;
+    }
+    
+    /* Enabled before we got here - pick it up on the first loop pass */
+    usb_io_kick();
+    
+    LOG_INFO("[USB] Endpoint I/O attached (AIO, %d IN / %d OUT queued%s)\n",
+             USB_AIO_IN_DEPTH, USB_AIO_OUT_DEPTH, g_jit_requested ? ", poll-timed" : "");
+    return 0;
+    
+fail:
+    ps3_usb_io_detach();
+    return -1;
+}
+
+void ps3_usb_io_detach(void) {
+    /* Out of the notifier tables before the numbers can be reused */
+    controller_state_unsubscribe(g_state_fd);
+    system_state_unsubscribe(g_system_fd);
+    
+    int* fds[] = { &g_aio_event_fd, &g_state_fd, &g_keepalive_fd, &g_kick_fd, &g_jit_fd,
+                   &g_system_fd };
+    
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] < 0) continue;
+        if (g_io_loop) event_loop_remove(g_io_loop, *fds[i]);
+        close(*fds[i]);
+        *fds[i] = -1;
+    }
+    g_io_loop = NULL;
+    g_jit_armed = 0;
+    g_jit_state = USB_JIT_OFF;
+    
+    /* Cancels and waits for anything still queued */
+    aio_ctx_destroy(g_aio_ctx);
+    g_aio_ctx = 0;
+    for (int i = 0; i < USB_AIO_IN_DEPTH; i++) ds3_frame_release(g_in_xfers[i].frame);
+    ds3_frame_release(g_in_frame);
+    g_in_frame = NULL;
+    g_in_pending = 0;
+    memset(g_in_xfers, 0, sizeof(g_in_xfers));
+    memset(g_out_xfers, 0, sizeof(g_out_xfers));
+}
@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <dirent.h>
 
 #include "controllers/controller_interface.h"
 #include "controllers/dualsense/dualsense.h"
@@ -38,7 +39,6 @@
 
 static const controller_driver_t* g_drivers[MAX_DRIVERS];
 static int g_driver_count = 0;
-static const controller_driver_t* g_active_driver = NULL;
 
 int controller_register(const controller_driver_t* driver) {
     if (g_driver_count >= MAX_DRIVERS) {
@@ -69,14 +69,6 @@ const controller_driver_t* controller_find_driver(uint16_t vid, uint16_t pid) {
     return NULL;
 }
 
-const controller_driver_t* controller_get_active(void) {
-    return g_active_driver;
-}
-
-void controller_set_active_driver(const controller_driver_t* driver) {
-    g_active_driver = driver;
-}
-
 /* ============================================================================
  * REGISTRY INITIALIZATION
  * 
@@ -125,26 +117,52 @@ void controller_drivers_shutdown(void) {
  * DEVICE SCANNING
  * ============================================================================ */
 
-/**
- * Scan for any supported controller.
- * Tries each registered driver's find_device() function.
- * 
- * @param out_driver Output: the driver that matched
- * @return File descriptor on success, -1 if no controller found
- */
-int controller_scan_devices(const controller_driver_t** out_driver) {
-    for (int i = 0; i < g_driver_count; i++) {
-        if (g_drivers[i]->find_device) {
-            int fd = g_drivers[i]->find_device();
-            if (fd >= 0) {
-                if (out_driver) *out_driver = g_drivers[i];
-                return fd;
-            }
+/* HID_ID=0005:0000054C:00000CE6 from /sys/class/hidraw/<node>/device/uevent */
+static int read_hid_ids(const char* node, uint16_t* vid, uint16_t* pid) {
+    char path[320];
+    snprintf(path, sizeof(path), "/sys/class/hidraw/%s/device/uevent", node);
+    
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    
+    char line[128];
+    int found = -1;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned int bus, v, p;
+        if (sscanf(line, "HID_ID=%x:%x:%x", &bus, &v, &p) == 3) {
+            *vid = (uint16_t)v;
+            *pid = (uint16_t)p;
+            found = 0;
+            break;
         }
     }
+    fclose(f);
+    return found;
+}
+
+int controller_scan_devices(controller_scan_fn fn, void* ctx) {
+    DIR* dir = opendir("/sys/class/hidraw");
+    if (!dir) return 0;
+    
+    int matched = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "hidraw", 6) != 0) continue;
+        
+        uint16_t vid, pid;
+        if (read_hid_ids(entry->d_name, &vid, &pid) < 0) continue;
+        
+        const controller_driver_t* driver = controller_find_driver(vid, pid);
+        if (!driver) continue;
+        
+        char devnode[300];
+        snprintf(devnode, sizeof(devnode), "/dev/%s", entry->d_name);
+        matched++;
+        if (fn(devnode, driver, ctx) != 0) break;
+    }
     
-    if (out_driver) *out_driver = NULL;
-    return -1;
+    closedir(dir);
+    return matched;
 }
 
 /* ============================================================================
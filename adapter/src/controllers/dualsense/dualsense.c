@@ -7,7 +7,7 @@
  * This file demonstrates how to implement a controller driver:
  * 
  * 1. Define controller info (VID, PID, capabilities)
- * 2. Implement find_device() to locate the controller
+ * 2. Implement open_device() to claim a device node (per-pad state in priv)
  * 3. Implement process_input() to parse hardware-specific reports
  * 4. Implement send_output() for rumble/LED control
  * 5. Register the driver at startup
@@ -17,6 +17,8 @@
  * - Handle both Bluetooth and USB connections if applicable
  * - Use sysfs for LED control if kernel driver manages them
  * - Calculate CRC for Bluetooth output reports if required
+ * - Keep per-pad state in dev->priv, never in statics, so several
+ *   controllers of the same type can be connected at once
  */
 
 #include <stdio.h>
@@ -26,10 +28,14 @@
 #include <unistd.h>
 #include <errno.h>
 #include <dirent.h>
+#include <pthread.h>
 #include <linux/hidraw.h>
 #include <sys/ioctl.h>
 
 #include "core/common.h"
+#include "core/crc32.h"
+#include "core/motion.h"
+#include "core/log.h"
 #include "controllers/dualsense/dualsense.h"
 
 /* ============================================================================
@@ -39,28 +45,74 @@
  * Other controllers may not need this.
  * ============================================================================ */
 
-static uint32_t crc32_table[256];
-static int crc32_initialized = 0;
+uint32_t dualsense_calc_crc32(const uint8_t* data, size_t len) {
+    return crc32_update(0, data, len);
+}
 
-static void init_crc32_table(void) {
-    if (crc32_initialized) return;
-    
-    for (uint32_t i = 0; i < 256; i++) {
-        uint32_t crc = i;
-        for (int j = 0; j < 8; j++) {
-            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
-        }
-        crc32_table[i] = crc;
+/* ============================================================================
+ * PER-DEVICE STATE
+ * 
+ * Everything belonging to one connected pad, hung off dev->priv.
+ * Reference counted: a connect job still running keeps it alive after
+ * the pad disconnects.
+ * ============================================================================ */
+
+#define DS_PLAYER_LED_COUNT     5
+
+typedef struct {
+    int refcount;
+    int connected;              /* Cleared on disconnect - jobs drop results */
+    char hid_name[32];          /* Parent HID device, e.g. "0005:054C:0CE6.0004" */
+    int slot;                   /* Player slot the calibration is published for */
+    
+    /* Serializes calibration publishing against disconnect */
+    pthread_mutex_t calib_mutex;
+    
+    /* LED sysfs fds - used by the output thread and the connect job */
+    pthread_mutex_t led_mutex;
+    int lightbar_intensity_fd;
+    int player_led_fds[DS_PLAYER_LED_COUNT];
+    uint8_t player_led_written;  /* Mask last written to sysfs */
+    uint64_t led_last_scan_ms;
+    
+    /* Output report state */
+    int led_refresh_counter;
+    uint8_t last_led_r, last_led_g, last_led_b;
+    uint8_t last_player_leds;
+    int last_rumble_left, last_rumble_right;    /* -1 = unknown */
+    int lightbar_setup_done;    /* hidraw LED mode: boot fade released */
+    
+    rc_ds_t core;               /* Report decoding state (rosetta_core/dualsense.h) */
+} ds_device_t;
+
+static ds_device_t* ds_device_alloc(void) {
+    ds_device_t* ds = calloc(1, sizeof(*ds));
+    if (!ds) return NULL;
+    
+    ds->refcount = 1;
+    ds->connected = 1;
+    pthread_mutex_init(&ds->calib_mutex, NULL);
+    pthread_mutex_init(&ds->led_mutex, NULL);
+    ds->lightbar_intensity_fd = -1;
+    for (int i = 0; i < DS_PLAYER_LED_COUNT; i++) {
+        ds->player_led_fds[i] = -1;
     }
-    crc32_initialized = 1;
+    ds->last_led_r = ds->last_led_g = ds->last_led_b = 255;
+    ds->last_player_leds = 0xFF;
+    ds->last_rumble_left = ds->last_rumble_right = -1;
+    rc_ds_init(&ds->core, crc32_update, NULL);
+    return ds;
 }
 
-uint32_t dualsense_calc_crc32(const uint8_t* data, size_t len) {
-    uint32_t crc = 0xFFFFFFFF;
-    for (size_t i = 0; i < len; i++) {
-        crc = (crc >> 8) ^ crc32_table[(crc ^ data[i]) & 0xFF];
-    }
-    return ~crc;
+static void close_led_sysfs(ds_device_t* ds);
+
+static void ds_device_put(ds_device_t* ds) {
+    if (__atomic_sub_fetch(&ds->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+    
+    close_led_sysfs(ds);
+    pthread_mutex_destroy(&ds->calib_mutex);
+    pthread_mutex_destroy(&ds->led_mutex);
+    free(ds);
 }
 
 /* ============================================================================
@@ -68,134 +120,201 @@ uint32_t dualsense_calc_crc32(const uint8_t* data, size_t len) {
  * 
  * DualSense provides per-controller calibration via Feature Report 0x05.
  * This data is used to normalize motion sensor readings.
+ * 
+ * The feature report round trip is slow over BT, so it never runs on the
+ * connect path. A known pad (by MAC) loads its cached report up front;
+ * otherwise a background job reads it and hands it to the motion stage
+ * (core/motion.h), which folds it into the console conversion. Until
+ * then motion is passed through raw.
  * ============================================================================ */
 
-static ds_calibration_t g_ds_calibration = { .valid = 0 };
+#define DS_CALIB_CACHE_DIR      "/tmp/rosettapad"
+#define DS_CALIB_CACHE_MAGIC    0x42494C43u     /* "CLIB" */
 
-/* Read calibration data from controller */
-static int dualsense_read_calibration(int fd) {
-    uint8_t buf[DS_FEATURE_REPORT_CALIBRATION_SIZE + 1] = {0};
-    buf[0] = DS_FEATURE_REPORT_CALIBRATION;
-    
-    int ret = ioctl(fd, HIDIOCGFEATURE(sizeof(buf)), buf);
-    if (ret < 0) {
-        printf("[DualSense] Failed to read calibration: %s\n", strerror(errno));
-        /* Use default calibration */
-        g_ds_calibration.valid = 0;
+/* Publish unless the pad it was loaded for has disconnected */
+static int publish_calibration(ds_device_t* ds, const ds_calibration_t* calib) {
+    pthread_mutex_lock(&ds->calib_mutex);
+    if (!ds->connected) {
+        pthread_mutex_unlock(&ds->calib_mutex);
         return -1;
     }
     
-    printf("[DualSense] Calibration report (%d bytes):", ret);
-    for (int i = 0; i < ret && i < 20; i++) {
-        printf(" %02X", buf[i]);
+    /* Gyro pitch/yaw/roll are the state's gyro x/y/z */
+    motion_calib_t mc;
+    for (int i = 0; i < 3; i++) {
+        mc.bias[MOTION_SRC_ACCEL_X + i] = calib->accel[i].bias;
+        mc.numer[MOTION_SRC_ACCEL_X + i] = calib->accel[i].sens_numer;
+        mc.denom[MOTION_SRC_ACCEL_X + i] = calib->accel[i].sens_denom;
+        mc.bias[MOTION_SRC_GYRO_X + i] = calib->gyro[i].bias;
+        mc.numer[MOTION_SRC_GYRO_X + i] = calib->gyro[i].sens_numer;
+        mc.denom[MOTION_SRC_GYRO_X + i] = calib->gyro[i].sens_denom;
     }
-    printf(" ...\n");
-    
-    /* Parse gyroscope calibration (Bluetooth format) */
-    int16_t gyro_pitch_bias  = (int16_t)(buf[1] | (buf[2] << 8));
-    int16_t gyro_yaw_bias    = (int16_t)(buf[3] | (buf[4] << 8));
-    int16_t gyro_roll_bias   = (int16_t)(buf[5] | (buf[6] << 8));
-    int16_t gyro_pitch_plus  = (int16_t)(buf[7] | (buf[8] << 8));
-    int16_t gyro_yaw_plus    = (int16_t)(buf[9] | (buf[10] << 8));
-    int16_t gyro_roll_plus   = (int16_t)(buf[11] | (buf[12] << 8));
-    int16_t gyro_pitch_minus = (int16_t)(buf[13] | (buf[14] << 8));
-    int16_t gyro_yaw_minus   = (int16_t)(buf[15] | (buf[16] << 8));
-    int16_t gyro_roll_minus  = (int16_t)(buf[17] | (buf[18] << 8));
-    int16_t gyro_speed_plus  = (int16_t)(buf[19] | (buf[20] << 8));
-    int16_t gyro_speed_minus = (int16_t)(buf[21] | (buf[22] << 8));
-    
-    /* Parse accelerometer calibration */
-    int16_t acc_x_plus  = (int16_t)(buf[23] | (buf[24] << 8));
-    int16_t acc_x_minus = (int16_t)(buf[25] | (buf[26] << 8));
-    int16_t acc_y_plus  = (int16_t)(buf[27] | (buf[28] << 8));
-    int16_t acc_y_minus = (int16_t)(buf[29] | (buf[30] << 8));
-    int16_t acc_z_plus  = (int16_t)(buf[31] | (buf[32] << 8));
-    int16_t acc_z_minus = (int16_t)(buf[33] | (buf[34] << 8));
-    
-    printf("[DualSense] Gyro: pitch_bias=%d yaw_bias=%d roll_bias=%d\n",
-           gyro_pitch_bias, gyro_yaw_bias, gyro_roll_bias);
-    printf("[DualSense] Gyro: pitch +/- = %d/%d, yaw +/- = %d/%d, roll +/- = %d/%d\n",
-           gyro_pitch_plus, gyro_pitch_minus, gyro_yaw_plus, gyro_yaw_minus,
-           gyro_roll_plus, gyro_roll_minus);
-    printf("[DualSense] Gyro speed: +/- = %d/%d\n", gyro_speed_plus, gyro_speed_minus);
-    printf("[DualSense] Accel X: +/- = %d/%d, Y: +/- = %d/%d, Z: +/- = %d/%d\n",
-           acc_x_plus, acc_x_minus, acc_y_plus, acc_y_minus, acc_z_plus, acc_z_minus);
-    
-    /* Calculate gyro calibration (same formula as kernel driver) */
-    int speed_2x = gyro_speed_plus + gyro_speed_minus;
-    
-    g_ds_calibration.gyro[0].bias = gyro_pitch_bias;
-    g_ds_calibration.gyro[0].sens_numer = speed_2x * DS_GYRO_RES_PER_DEG_S;
-    g_ds_calibration.gyro[0].sens_denom = gyro_pitch_plus - gyro_pitch_minus;
-    
-    g_ds_calibration.gyro[1].bias = gyro_yaw_bias;
-    g_ds_calibration.gyro[1].sens_numer = speed_2x * DS_GYRO_RES_PER_DEG_S;
-    g_ds_calibration.gyro[1].sens_denom = gyro_yaw_plus - gyro_yaw_minus;
-    
-    g_ds_calibration.gyro[2].bias = gyro_roll_bias;
-    g_ds_calibration.gyro[2].sens_numer = speed_2x * DS_GYRO_RES_PER_DEG_S;
-    g_ds_calibration.gyro[2].sens_denom = gyro_roll_plus - gyro_roll_minus;
-    
-    /* Calculate accel calibration */
-    int range_2g;
-    
-    range_2g = acc_x_plus - acc_x_minus;
-    g_ds_calibration.accel[0].bias = acc_x_plus - range_2g / 2;
-    g_ds_calibration.accel[0].sens_numer = 2 * DS_ACC_RES_PER_G;
-    g_ds_calibration.accel[0].sens_denom = range_2g;
-    
-    range_2g = acc_y_plus - acc_y_minus;
-    g_ds_calibration.accel[1].bias = acc_y_plus - range_2g / 2;
-    g_ds_calibration.accel[1].sens_numer = 2 * DS_ACC_RES_PER_G;
-    g_ds_calibration.accel[1].sens_denom = range_2g;
-    
-    range_2g = acc_z_plus - acc_z_minus;
-    g_ds_calibration.accel[2].bias = acc_z_plus - range_2g / 2;
-    g_ds_calibration.accel[2].sens_numer = 2 * DS_ACC_RES_PER_G;
-    g_ds_calibration.accel[2].sens_denom = range_2g;
-    
-    /* Sanity check - avoid division by zero */
+    motion_set_calibration(ds->slot, &mc);
+    pthread_mutex_unlock(&ds->calib_mutex);
+    return 0;
+}
+
+/* Parse Feature Report 0x05 into calibration */
+static int dualsense_parse_calibration(const uint8_t* buf, ds_calibration_t* calib) {
+    int replaced = rc_ds_parse_calibration(buf, DS_FEATURE_REPORT_CALIBRATION_SIZE, calib);
+    if (replaced < 0) return -1;
+    
     for (int i = 0; i < 3; i++) {
-        if (g_ds_calibration.gyro[i].sens_denom == 0) {
-            printf("[DualSense] WARNING: Invalid gyro calibration for axis %d\n", i);
-            g_ds_calibration.gyro[i].bias = 0;
-            g_ds_calibration.gyro[i].sens_numer = DS_GYRO_RANGE;
-            g_ds_calibration.gyro[i].sens_denom = 32767;
+        const ds_axis_calib_t* g = &calib->gyro[i];
+        const ds_axis_calib_t* a = &calib->accel[i];
+        LOG_INFO("[DualSense] Axis %d: gyro bias=%d scale=%d/%d, accel bias=%d scale=%d/%d\n",
+                 i, g->bias, g->sens_numer, g->sens_denom, a->bias, a->sens_numer, a->sens_denom);
+        if (replaced & (1 << i)) {
+            LOG_WARN("[DualSense] WARNING: Invalid gyro calibration for axis %d\n", i);
         }
-        if (g_ds_calibration.accel[i].sens_denom == 0) {
-            printf("[DualSense] WARNING: Invalid accel calibration for axis %d\n", i);
-            g_ds_calibration.accel[i].bias = 0;
-            g_ds_calibration.accel[i].sens_numer = DS_ACC_RANGE;
-            g_ds_calibration.accel[i].sens_denom = 32767;
+        if (replaced & (1 << (3 + i))) {
+            LOG_WARN("[DualSense] WARNING: Invalid accel calibration for axis %d\n", i);
         }
     }
+    return 0;
+}
+
+/* Read Feature Report 0x05 from the controller (slow over BT) */
+static int dualsense_read_calibration_report(int fd, uint8_t* buf) {
+    memset(buf, 0, DS_FEATURE_REPORT_CALIBRATION_SIZE + 1);
+    buf[0] = DS_FEATURE_REPORT_CALIBRATION;
+    
+    int ret = ioctl(fd, HIDIOCGFEATURE(DS_FEATURE_REPORT_CALIBRATION_SIZE + 1), buf);
+    if (ret < 0) {
+        LOG_INFO("[DualSense] Failed to read calibration: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    debug_print_hex("[DualSense] Calibration report", buf, (size_t)ret);
+    return 0;
+}
+
+/* ============================================================================
+ * CALIBRATION CACHE
+ * 
+ * Raw Feature Report 0x05 keyed by controller MAC, so reconnecting a known
+ * pad needs no feature report at all.
+ * ============================================================================ */
+
+#ifndef HIDIOCGRAWUNIQ
+#define HIDIOCGRAWUNIQ(len) _IOC(_IOC_READ, 'H', 0x08, len)
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint8_t report[DS_FEATURE_REPORT_CALIBRATION_SIZE + 1];
+    uint32_t crc;       /* CRC32 of report */
+} ds_calib_cache_t;
+
+/* Controller MAC as 12 hex digits, from the HID uniq string */
+static int get_controller_id(int fd, char* out, size_t out_len) {
+    char uniq[64] = "";
+    if (ioctl(fd, HIDIOCGRAWUNIQ(sizeof(uniq)), uniq) < 0) return -1;
+    
+    size_t n = 0;
+    for (const char* p = uniq; *p && n + 1 < out_len; p++) {
+        if ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f') || (*p >= 'A' && *p <= 'F')) {
+            out[n++] = *p;
+        }
+    }
+    out[n] = '\0';
+    return (n == 12) ? 0 : -1;
+}
+
+static void calib_cache_path(const char* id, char* path, size_t len) {
+    snprintf(path, len, "%s/ds_calib_%s.bin", DS_CALIB_CACHE_DIR, id);
+}
+
+static int calib_cache_load(const char* id, uint8_t* report) {
+    char path[128];
+    calib_cache_path(id, path, sizeof(path));
+    
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    ds_calib_cache_t entry;
+    ssize_t n = read(fd, &entry, sizeof(entry));
+    close(fd);
+    
+    if (n != (ssize_t)sizeof(entry) || entry.magic != DS_CALIB_CACHE_MAGIC ||
+        crc32_update(0, entry.report, sizeof(entry.report)) != entry.crc) {
+        return -1;
+    }
     
-    g_ds_calibration.valid = 1;
-    printf("[DualSense] Calibration loaded successfully\n");
+    memcpy(report, entry.report, sizeof(entry.report));
     return 0;
 }
 
-/* Apply calibration to raw sensor value */
-static inline int32_t apply_calibration(int16_t raw, const ds_axis_calib_t* calib) {
-    /* calibrated = (raw - bias) * sens_numer / sens_denom */
-    return ((int32_t)(raw - calib->bias) * calib->sens_numer) / calib->sens_denom;
+static void calib_cache_store(const char* id, const uint8_t* report) {
+    char path[128];
+    char tmp_path[136];
+    calib_cache_path(id, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    
+    ds_calib_cache_t entry;
+    entry.magic = DS_CALIB_CACHE_MAGIC;
+    memcpy(entry.report, report, sizeof(entry.report));
+    entry.crc = crc32_update(0, entry.report, sizeof(entry.report));
+    
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    
+    ssize_t n = write(fd, &entry, sizeof(entry));
+    close(fd);
+    
+    if (n == (ssize_t)sizeof(entry)) {
+        rename(tmp_path, path);
+    } else {
+        unlink(tmp_path);
+    }
 }
 
+
 /* ============================================================================
  * LED SYSFS CONTROL
  * 
  * The kernel hid-playstation driver exposes LEDs via sysfs.
  * We use sysfs for LED control to avoid conflicts with the driver.
+ * 
+ * Attribute fds are opened once at discovery and written with pwrite(),
+ * so a lightbar change is a single syscall. Writing multi_intensity makes
+ * the LED class re-apply the current brightness, which is set to 255 once
+ * when the fds are opened.
  * ============================================================================ */
 
-static char g_lightbar_path[512] = "";
-static char g_player_led_paths[5][512] = {"", "", "", "", ""};
+#define DS_LED_RESCAN_MS        1000    /* Min interval between sysfs rescans */
 
-static void find_led_sysfs_paths(void) {
-    g_lightbar_path[0] = '\0';
-    for (int i = 0; i < 5; i++) {
-        g_player_led_paths[i][0] = '\0';
+static ds_led_backend_t g_led_backend = DS_LED_BACKEND_SYSFS;
+
+/* Caller holds led_mutex (or owns the last reference) */
+static void close_led_sysfs(ds_device_t* ds) {
+    if (ds->lightbar_intensity_fd >= 0) {
+        close(ds->lightbar_intensity_fd);
+        ds->lightbar_intensity_fd = -1;
+    }
+    for (int i = 0; i < DS_PLAYER_LED_COUNT; i++) {
+        if (ds->player_led_fds[i] >= 0) {
+            close(ds->player_led_fds[i]);
+            ds->player_led_fds[i] = -1;
+        }
     }
+    ds->player_led_written = 0;
+}
+
+static int write_led_attr(int fd, const char* value) {
+    return (pwrite(fd, value, strlen(value), 0) < 0) ? -1 : 0;
+}
+
+/* Does this LED class device hang off our pad? */
+static int led_belongs_to(const ds_device_t* ds, const char* led_link) {
+    if (ds->hid_name[0]) return strstr(led_link, ds->hid_name) != NULL;
+    return strstr(led_link, "054C") && strstr(led_link, "0CE6");
+}
+
+/* Caller holds led_mutex */
+static void open_led_sysfs(ds_device_t* ds) {
+    close_led_sysfs(ds);
+    ds->led_last_scan_ms = time_get_ms();
     
     DIR* led_dir = opendir("/sys/class/leds");
     if (!led_dir) return;
@@ -208,30 +327,48 @@ static void find_led_sysfs_paths(void) {
         char led_link[512];
         snprintf(led_path, sizeof(led_path), "/sys/class/leds/%s", entry->d_name);
         
-        /* Check if this LED belongs to a DualSense */
+        /* Check if this LED belongs to this DualSense */
         ssize_t len = readlink(led_path, led_link, sizeof(led_link) - 1);
         if (len <= 0) continue;
         led_link[len] = '\0';
         
-        if (!strstr(led_link, "054C") || !strstr(led_link, "0CE6")) continue;
+        if (!led_belongs_to(ds, led_link)) continue;
+        
+        char attr_path[576];
         
         /* Lightbar */
         if (strstr(entry->d_name, "rgb:indicator")) {
-            snprintf(g_lightbar_path, sizeof(g_lightbar_path), 
-                     "/sys/class/leds/%s", entry->d_name);
-            printf("[DualSense] Found lightbar: %s\n", g_lightbar_path);
+            snprintf(attr_path, sizeof(attr_path), "%s/multi_intensity", led_path);
+            int fd = open(attr_path, O_WRONLY | O_CLOEXEC);
+            if (fd < 0) continue;
+            
+            /* Brightness stays at full - colour changes only touch intensities */
+            snprintf(attr_path, sizeof(attr_path), "%s/brightness", led_path);
+            int bfd = open(attr_path, O_WRONLY | O_CLOEXEC);
+            if (bfd >= 0) {
+                write_led_attr(bfd, "255");
+                close(bfd);
+            }
+            
+            if (ds->lightbar_intensity_fd >= 0) close(ds->lightbar_intensity_fd);
+            ds->lightbar_intensity_fd = fd;
+            LOG_INFO("[DualSense] Found lightbar: %s\n", led_path);
         }
         /* Player LEDs */
         else if (strstr(entry->d_name, ":white:player-")) {
             int player_num = 0;
             const char* p = strstr(entry->d_name, "player-");
             if (p && sscanf(p, "player-%d", &player_num) == 1) {
-                if (player_num >= 1 && player_num <= 5) {
-                    snprintf(g_player_led_paths[player_num - 1], 
-                             sizeof(g_player_led_paths[0]),
-                             "/sys/class/leds/%s", entry->d_name);
-                    printf("[DualSense] Found player LED %d: %s\n", 
-                           player_num, g_player_led_paths[player_num - 1]);
+                if (player_num >= 1 && player_num <= DS_PLAYER_LED_COUNT) {
+                    snprintf(attr_path, sizeof(attr_path), "%s/brightness", led_path);
+                    int fd = open(attr_path, O_WRONLY | O_CLOEXEC);
+                    if (fd < 0) continue;
+                    
+                    if (ds->player_led_fds[player_num - 1] >= 0) {
+                        close(ds->player_led_fds[player_num - 1]);
+                    }
+                    ds->player_led_fds[player_num - 1] = fd;
+                    LOG_INFO("[DualSense] Found player LED %d: %s\n", player_num, led_path);
                 }
             }
         }
@@ -240,65 +377,65 @@ static void find_led_sysfs_paths(void) {
     closedir(led_dir);
 }
 
-static void set_lightbar_sysfs(uint8_t r, uint8_t g, uint8_t b) {
-    if (g_lightbar_path[0] == '\0') {
-        find_led_sysfs_paths();
-        if (g_lightbar_path[0] == '\0') return;
-    }
-    
-    char path[576];
-    FILE* f;
-    
-    /* Set color intensities */
-    snprintf(path, sizeof(path), "%s/multi_intensity", g_lightbar_path);
-    f = fopen(path, "w");
-    if (f) {
-        fprintf(f, "%d %d %d", r, g, b);
-        fclose(f);
-    } else {
-        g_lightbar_path[0] = '\0';  /* Path stale, search again */
-        return;
-    }
-    
-    /* Set brightness to trigger update */
-    snprintf(path, sizeof(path), "%s/brightness", g_lightbar_path);
-    f = fopen(path, "w");
-    if (f) {
-        fprintf(f, "255");
-        fclose(f);
+/* Rescan, rate limited - LEDs can register shortly after the hidraw node.
+ * Caller holds led_mutex. */
+static int ensure_led_sysfs(ds_device_t* ds) {
+    if (ds->lightbar_intensity_fd >= 0) return 0;
+    if (!ds->connected) return -1;
+    if (time_get_ms() - ds->led_last_scan_ms < DS_LED_RESCAN_MS) return -1;
+    open_led_sysfs(ds);
+    return (ds->lightbar_intensity_fd >= 0) ? 0 : -1;
+}
+
+static void set_lightbar_sysfs(ds_device_t* ds, uint8_t r, uint8_t g, uint8_t b) {
+    pthread_mutex_lock(&ds->led_mutex);
+    if (ensure_led_sysfs(ds) == 0) {
+        char value[16];
+        snprintf(value, sizeof(value), "%d %d %d", r, g, b);
+        
+        if (write_led_attr(ds->lightbar_intensity_fd, value) < 0) {
+            close_led_sysfs(ds);  /* fds stale (device gone), search again later */
+        }
     }
+    pthread_mutex_unlock(&ds->led_mutex);
 }
 
-static void set_player_leds_sysfs(uint8_t player_mask) {
+static void set_player_leds_sysfs(ds_device_t* ds, uint8_t player_mask, int force) {
     static int pled_log_count = 0;
     if (++pled_log_count <= 10) {
-        printf("[DualSense] Setting player LEDs: 0x%02X\n", player_mask);
+        LOG_DEBUG("[DualSense] Setting player LEDs: 0x%02X\n", player_mask);
     }
     
-    int leds_set = 0;
-    for (int i = 0; i < 5; i++) {
-        if (g_player_led_paths[i][0] == '\0') continue;
-        
-        char path[576];
-        snprintf(path, sizeof(path), "%s/brightness", g_player_led_paths[i]);
+    pthread_mutex_lock(&ds->led_mutex);
+    ensure_led_sysfs(ds);
+    
+    /* Only touch LEDs whose state actually changes */
+    uint8_t dirty = force ? 0x1F : (player_mask ^ ds->player_led_written);
+    int leds_found = 0;
+    
+    for (int i = 0; i < DS_PLAYER_LED_COUNT; i++) {
+        if (ds->player_led_fds[i] < 0) continue;
+        leds_found++;
+        if (!(dirty & (1 << i))) continue;
         
-        FILE* f = fopen(path, "w");
-        if (f) {
-            int on = (player_mask & (1 << i)) ? 255 : 0;
-            fprintf(f, "%d", on);
-            fclose(f);
-            leds_set++;
-            if (pled_log_count <= 5) {
-                printf("[DualSense] LED %d = %d (path: %s)\n", i+1, on, path);
-            }
+        int on = (player_mask & (1 << i)) != 0;
+        if (write_led_attr(ds->player_led_fds[i], on ? "255" : "0") == 0) {
+            ds->player_led_written = (ds->player_led_written & ~(1 << i)) | (on << i);
         }
     }
+    pthread_mutex_unlock(&ds->led_mutex);
     
-    if (pled_log_count <= 5 && leds_set == 0) {
-        printf("[DualSense] WARNING: No player LED paths found!\n");
+    if (pled_log_count <= 5 && leds_found == 0) {
+        LOG_WARN("[DualSense] WARNING: No player LED paths found!\n");
     }
 }
 
+void dualsense_set_led_backend(ds_led_backend_t backend) {
+    g_led_backend = backend;
+    LOG_INFO("[DualSense] LED backend: %s\n",
+             backend == DS_LED_BACKEND_HIDRAW ? "hidraw output report" : "sysfs");
+}
+
 /* ============================================================================
  * CONTROLLER INFO
  * 
@@ -330,355 +467,290 @@ static const controller_info_t dualsense_info = {
  * ============================================================================ */
 
 static int dualsense_init(void) {
-    init_crc32_table();
-    printf("[DualSense] Driver initialized\n");
+    crc32_init();
+    LOG_INFO("[DualSense] Driver initialized\n");
     return 0;
 }
 
 static void dualsense_shutdown(void) {
-    printf("[DualSense] Driver shutdown\n");
+    LOG_INFO("[DualSense] Driver shutdown\n");
 }
 
-static int dualsense_find_device(void) {
-    DIR* dir = opendir("/dev");
-    if (!dir) return -1;
+/* ============================================================================
+ * CONNECT JOB
+ * 
+ * Slow per-device setup that must not hold up the first input reports:
+ * calibration feature report (on cache miss) and LED sysfs discovery.
+ * ============================================================================ */
+
+typedef struct {
+    ds_device_t* ds;        /* Reference held by the job */
+    int fd;                 /* dup() of the device fd, owned by the job */
+    int need_calibration;
+    char id[16];            /* Controller MAC, "" if unknown */
+} ds_connect_job_t;
+
+static void* dualsense_connect_job(void* arg) {
+    ds_connect_job_t* job = arg;
+    ds_device_t* ds = job->ds;
     
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strncmp(entry->d_name, "hidraw", 6) != 0) continue;
+    if (job->need_calibration) {
+        uint8_t report[DS_FEATURE_REPORT_CALIBRATION_SIZE + 1];
+        ds_calibration_t calib;
         
-        char path[272];
-        snprintf(path, sizeof(path), "/dev/%s", entry->d_name);
-        
-        int fd = open(path, O_RDWR);
-        if (fd < 0) continue;
-        
-        struct hidraw_devinfo info;
-        if (ioctl(fd, HIDIOCGRAWINFO, &info) < 0) {
-            close(fd);
-            continue;
+        if (dualsense_read_calibration_report(job->fd, report) == 0 &&
+            dualsense_parse_calibration(report, &calib) == 0) {
+            if (publish_calibration(ds, &calib) == 0) {
+                LOG_INFO("[DualSense] Calibration loaded successfully\n");
+            }
+            if (job->id[0]) calib_cache_store(job->id, report);
         }
+    }
+    
+    /* Open LED sysfs attributes once for this device */
+    if (g_led_backend == DS_LED_BACKEND_SYSFS && ds->connected) {
+        pthread_mutex_lock(&ds->led_mutex);
+        open_led_sysfs(ds);
+        pthread_mutex_unlock(&ds->led_mutex);
         
-        if (info.vendor == DUALSENSE_VID && info.product == DUALSENSE_PID) {
-            char name[256] = "";
-            ioctl(fd, HIDIOCGRAWNAME(sizeof(name)), name);
-            printf("[DualSense] Found: %s (%s) bus=%d\n", name, path, info.bustype);
-            
-            /* Read calibration data from controller */
-            dualsense_read_calibration(fd);
-            
-            /* Find LED sysfs paths */
-            find_led_sysfs_paths();
-            
-            /* Set initial lightbar color */
-            set_lightbar_sysfs(255, 0, 0);  /* Red */
-            
-            closedir(dir);
-            return fd;
-        }
-        close(fd);
+        /* Set initial lightbar color */
+        set_lightbar_sysfs(ds, 255, 0, 0);  /* Red */
     }
     
-    closedir(dir);
-    return -1;
+    close(job->fd);
+    ds_device_put(ds);
+    free(job);
+    return NULL;
 }
 
-static int dualsense_match_device(uint16_t vid, uint16_t pid) {
-    return (vid == DUALSENSE_VID && pid == DUALSENSE_PID);
+static void start_connect_job(ds_device_t* ds, int fd, int need_calibration, const char* id) {
+    ds_connect_job_t* job = calloc(1, sizeof(*job));
+    if (!job) return;
+    
+    job->ds = ds;
+    job->fd = dup(fd);
+    job->need_calibration = need_calibration;
+    snprintf(job->id, sizeof(job->id), "%s", id);
+    __atomic_add_fetch(&ds->refcount, 1, __ATOMIC_ACQ_REL);
+    
+    pthread_t tid;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    
+    if (job->fd < 0 || pthread_create(&tid, &attr, dualsense_connect_job, job) != 0) {
+        LOG_WARN("[DualSense] Warning: Connect job failed to start\n");
+        if (job->fd >= 0) close(job->fd);
+        ds_device_put(ds);
+        free(job);
+    }
+    pthread_attr_destroy(&attr);
 }
 
-/* D-pad parsing helper */
-void dualsense_parse_dpad(uint8_t buttons1, controller_state_t* out_state) {
-    uint8_t dpad = buttons1 & 0x0F;
-    
-    switch (dpad) {
-        case 0: /* N */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_UP);
-            break;
-        case 1: /* NE */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_UP);
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_RIGHT);
-            break;
-        case 2: /* E */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_RIGHT);
-            break;
-        case 3: /* SE */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_DOWN);
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_RIGHT);
-            break;
-        case 4: /* S */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_DOWN);
-            break;
-        case 5: /* SW */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_DOWN);
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_LEFT);
-            break;
-        case 6: /* W */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_LEFT);
-            break;
-        case 7: /* NW */
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_UP);
-            CONTROLLER_BTN_SET(out_state, BTN_DPAD_LEFT);
-            break;
-        /* 8+ = centered, no buttons */
-    }
+/* "/dev/hidraw3" -> "0005:054C:0CE6.0004" via /sys/class/hidraw/hidraw3/device */
+static void get_hid_name(const char* path, char* out, size_t out_len) {
+    out[0] = '\0';
+    
+    const char* node = strrchr(path, '/');
+    node = node ? node + 1 : path;
+    
+    char link_path[128];
+    char target[256];
+    snprintf(link_path, sizeof(link_path), "/sys/class/hidraw/%s/device", node);
+    ssize_t len = readlink(link_path, target, sizeof(target) - 1);
+    if (len <= 0) return;
+    target[len] = '\0';
+    
+    const char* name = strrchr(target, '/');
+    snprintf(out, out_len, "%.*s", (int)out_len - 1, name ? name + 1 : target);
 }
 
-static int dualsense_process_input(const uint8_t* buf, size_t len, 
-                                   controller_state_t* out_state) {
-    if (len < 12 || buf[DS_OFF_REPORT_ID] != DS_BT_REPORT_ID) {
+static int dualsense_open_device(controller_device_t* dev, const char* path) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    struct hidraw_devinfo info;
+    if (ioctl(fd, HIDIOCGRAWINFO, &info) < 0 ||
+        info.vendor != DUALSENSE_VID || info.product != DUALSENSE_PID) {
+        close(fd);
         return -1;
     }
     
-    /* Clear state */
-    memset(out_state, 0, sizeof(*out_state));
-    out_state->left_stick_x = 128;
-    out_state->left_stick_y = 128;
-    out_state->right_stick_x = 128;
-    out_state->right_stick_y = 128;
-    
-    /* Analog sticks */
-    out_state->left_stick_x = buf[DS_OFF_LX];
-    out_state->left_stick_y = buf[DS_OFF_LY];
-    out_state->right_stick_x = buf[DS_OFF_RX];
-    out_state->right_stick_y = buf[DS_OFF_RY];
-    
-    /* Apply deadzone */
-    #define DEADZONE 6
-    out_state->left_stick_x = CONTROLLER_APPLY_DEADZONE(out_state->left_stick_x, DEADZONE);
-    out_state->left_stick_y = CONTROLLER_APPLY_DEADZONE(out_state->left_stick_y, DEADZONE);
-    out_state->right_stick_x = CONTROLLER_APPLY_DEADZONE(out_state->right_stick_x, DEADZONE);
-    out_state->right_stick_y = CONTROLLER_APPLY_DEADZONE(out_state->right_stick_y, DEADZONE);
-    
-    /* Triggers */
-    out_state->left_trigger = buf[DS_OFF_L2];
-    out_state->right_trigger = buf[DS_OFF_R2];
-    
-    /* Buttons */
-    uint8_t buttons1 = buf[DS_OFF_BUTTONS1];
-    uint8_t buttons2 = buf[DS_OFF_BUTTONS2];
-    uint8_t buttons3 = buf[DS_OFF_BUTTONS3];
-    
-    /* D-pad */
-    dualsense_parse_dpad(buttons1, out_state);
-    
-    /* Face buttons */
-    if (buttons1 & DS_BTN1_CROSS)    CONTROLLER_BTN_SET(out_state, BTN_SOUTH);
-    if (buttons1 & DS_BTN1_CIRCLE)   CONTROLLER_BTN_SET(out_state, BTN_EAST);
-    if (buttons1 & DS_BTN1_SQUARE)   CONTROLLER_BTN_SET(out_state, BTN_WEST);
-    if (buttons1 & DS_BTN1_TRIANGLE) CONTROLLER_BTN_SET(out_state, BTN_NORTH);
-    
-    /* Shoulder buttons */
-    if (buttons2 & DS_BTN2_L1) CONTROLLER_BTN_SET(out_state, BTN_L1);
-    if (buttons2 & DS_BTN2_R1) CONTROLLER_BTN_SET(out_state, BTN_R1);
-    if (buttons2 & DS_BTN2_L2) CONTROLLER_BTN_SET(out_state, BTN_L2);
-    if (buttons2 & DS_BTN2_R2) CONTROLLER_BTN_SET(out_state, BTN_R2);
-    
-    /* Stick clicks */
-    if (buttons2 & DS_BTN2_L3) CONTROLLER_BTN_SET(out_state, BTN_L3);
-    if (buttons2 & DS_BTN2_R3) CONTROLLER_BTN_SET(out_state, BTN_R3);
-    
-    /* Center buttons */
-    if (buttons2 & DS_BTN2_CREATE)  CONTROLLER_BTN_SET(out_state, BTN_SELECT);
-    if (buttons2 & DS_BTN2_OPTIONS) CONTROLLER_BTN_SET(out_state, BTN_START);
-    if (buttons3 & DS_BTN3_PS)      CONTROLLER_BTN_SET(out_state, BTN_HOME);
-    if (buttons3 & DS_BTN3_TOUCHPAD) CONTROLLER_BTN_SET(out_state, BTN_TOUCHPAD);
-    if (buttons3 & DS_BTN3_MUTE)    CONTROLLER_BTN_SET(out_state, BTN_MUTE);
-    
-    /* Motion sensors */
-    if (len >= 28) {
-        int16_t raw_gyro_x  = (int16_t)(buf[DS_OFF_GYRO_X] | (buf[DS_OFF_GYRO_X + 1] << 8));
-        int16_t raw_gyro_y  = (int16_t)(buf[DS_OFF_GYRO_Y] | (buf[DS_OFF_GYRO_Y + 1] << 8));
-        int16_t raw_gyro_z  = (int16_t)(buf[DS_OFF_GYRO_Z] | (buf[DS_OFF_GYRO_Z + 1] << 8));
-        int16_t raw_accel_x = (int16_t)(buf[DS_OFF_ACCEL_X] | (buf[DS_OFF_ACCEL_X + 1] << 8));
-        int16_t raw_accel_y = (int16_t)(buf[DS_OFF_ACCEL_Y] | (buf[DS_OFF_ACCEL_Y + 1] << 8));
-        int16_t raw_accel_z = (int16_t)(buf[DS_OFF_ACCEL_Z] | (buf[DS_OFF_ACCEL_Z + 1] << 8));
-        
-        if (g_ds_calibration.valid) {
-            /* Apply calibration: output is in DS_GYRO_RES_PER_DEG_S (1024) units per deg/s
-             * and DS_ACC_RES_PER_G (8192) units per g */
-            out_state->gyro_x  = (int16_t)apply_calibration(raw_gyro_x, &g_ds_calibration.gyro[0]);
-            out_state->gyro_y  = (int16_t)apply_calibration(raw_gyro_y, &g_ds_calibration.gyro[1]);
-            out_state->gyro_z  = (int16_t)apply_calibration(raw_gyro_z, &g_ds_calibration.gyro[2]);
-            out_state->accel_x = (int16_t)apply_calibration(raw_accel_x, &g_ds_calibration.accel[0]);
-            out_state->accel_y = (int16_t)apply_calibration(raw_accel_y, &g_ds_calibration.accel[1]);
-            out_state->accel_z = (int16_t)apply_calibration(raw_accel_z, &g_ds_calibration.accel[2]);
-        } else {
-            /* No calibration - use raw values */
-            out_state->gyro_x  = raw_gyro_x;
-            out_state->gyro_y  = raw_gyro_y;
-            out_state->gyro_z  = raw_gyro_z;
-            out_state->accel_x = raw_accel_x;
-            out_state->accel_y = raw_accel_y;
-            out_state->accel_z = raw_accel_z;
-        }
+    ds_device_t* ds = ds_device_alloc();
+    if (!ds) {
+        close(fd);
+        return -1;
     }
     
-    /* Touchpad */
-    if (len >= DS_OFF_TOUCHPAD + 4) {
-        const uint8_t* touch = &buf[DS_OFF_TOUCHPAD];
-        
-        for (int i = 0; i < 2; i++) {
-            uint8_t contact = touch[i * 4];
-            out_state->touch[i].active = !(contact & DS_TOUCH_INACTIVE);
-            
-            if (out_state->touch[i].active) {
-                out_state->touch[i].x = touch[i * 4 + 1] | ((touch[i * 4 + 2] & 0x0F) << 8);
-                out_state->touch[i].y = (touch[i * 4 + 2] >> 4) | (touch[i * 4 + 3] << 4);
-            }
-        }
-        
-        /* --- Touchpad-as-R3 Feature --- */
-        /* Swipe on touchpad controls right stick (for controllers without R3 drift issues) */
-        static int touch_initial_x = 0;
-        static int touch_initial_y = 0;
-        static int touch_was_active = 0;
-        
-        if (out_state->touch[0].active) {
-            int touch_x = out_state->touch[0].x;
-            int touch_y = out_state->touch[0].y;
-            
-            if (!touch_was_active) {
-                /* Touch just started - record initial position */
-                touch_initial_x = touch_x;
-                touch_initial_y = touch_y;
-                touch_was_active = 1;
-            }
-            
-            /* Calculate delta from initial touch position */
-            int delta_x = touch_x - touch_initial_x;
-            int delta_y = touch_y - touch_initial_y;
-            
-            /* Convert to stick value (sensitivity: 400 pixels = full deflection) */
-            int sensitivity = 400;
-            int stick_x = 128 + (delta_x * 127) / sensitivity;
-            int stick_y = 128 + (delta_y * 127) / sensitivity;
-            
-            /* Clamp to 0-255 */
-            if (stick_x < 0) stick_x = 0;
-            if (stick_x > 255) stick_x = 255;
-            if (stick_y < 0) stick_y = 0;
-            if (stick_y > 255) stick_y = 255;
-            
-            /* Override right stick with touchpad values */
-            out_state->right_stick_x = (uint8_t)stick_x;
-            out_state->right_stick_y = (uint8_t)stick_y;
-        } else {
-            touch_was_active = 0;
+    char name[256] = "";
+    ioctl(fd, HIDIOCGRAWNAME(sizeof(name)), name);
+    get_hid_name(path, ds->hid_name, sizeof(ds->hid_name));
+    ds->slot = dev->slot;
+    LOG_INFO("[DualSense] Found: %s (%s) bus=%d slot=%d\n", name, path, info.bustype, dev->slot);
+    
+    /* Known pad: cached calibration, no feature report round trip */
+    char id[16] = "";
+    int need_calibration = 1;
+    if (get_controller_id(fd, id, sizeof(id)) == 0) {
+        uint8_t report[DS_FEATURE_REPORT_CALIBRATION_SIZE + 1];
+        ds_calibration_t calib;
+        if (calib_cache_load(id, report) == 0 &&
+            dualsense_parse_calibration(report, &calib) == 0 &&
+            publish_calibration(ds, &calib) == 0) {
+            LOG_INFO("[DualSense] Calibration loaded from cache (%s)\n", id);
+            need_calibration = 0;
         }
+    } else {
+        id[0] = '\0';
     }
     
-    /* Battery */
-    if (len >= 55) {
-        uint8_t battery_byte = buf[DS_OFF_BATTERY];
-        
-        /* Low 4 bits = battery level (0-10, where 10 = 100%) */
-        uint8_t battery_data = battery_byte & 0x0F;
-        out_state->battery_level = (battery_data > 10) ? 100 : battery_data * 10;
-        
-        /* High 4 bits = charging status */
-        /* 0x0 = discharging, 0x1 = charging, 0x2 = full */
-        uint8_t charging_status = (battery_byte >> 4) & 0x0F;
-        out_state->battery_charging = (charging_status == 0x1 || charging_status == 0x2) ? 1 : 0;
-        
-        /* Store full status for more accurate reporting */
-        out_state->battery_full = (charging_status == 0x2) ? 1 : 0;
-    }
+    dev->fd = fd;
+    dev->priv = ds;
     
-    out_state->timestamp_ms = time_get_ms();
+    /* Everything slow happens while input is already streaming */
+    start_connect_job(ds, fd, need_calibration, id);
     
     return 0;
 }
 
-/* Output report sequence counter */
-static uint8_t output_seq = 0;
+static int dualsense_match_device(uint16_t vid, uint16_t pid) {
+    return (vid == DUALSENSE_VID && pid == DUALSENSE_PID);
+}
+
+void dualsense_parse_dpad(uint8_t buttons1, controller_state_t* out_state) {
+    rc_ds_parse_dpad(buttons1, out_state);
+}
 
-/* Cached LED state for change detection */
-static uint8_t last_led_r = 255, last_led_g = 255, last_led_b = 255;
-static uint8_t last_player_leds = 0xFF;
+/* CRC mismatch logging: the first DS_CRC_LOG_FIRST, then every DS_CRC_LOG_EVERY-th */
+#define DS_CRC_LOG_FIRST    10
+#define DS_CRC_LOG_EVERY    1000
 
-static int dualsense_send_output(int fd, const controller_output_t* output) {
+static int dualsense_process_input(controller_device_t* dev, const uint8_t* buf, size_t len,
+                                   controller_state_t* out_state) {
+    ds_device_t* ds = dev->priv;
+    uint32_t crc_errors = ds->core.crc_errors;
+    
+    ds->core.touchpad_as_right_stick = g_touchpad_as_right_stick;
+    if (rc_ds_parse_input(&ds->core, buf, len, out_state) < 0) {
+        /* First few, then a running total - a bad link mismatches every report */
+        uint32_t total = ds->core.crc_errors;
+        if (total != crc_errors && (total <= DS_CRC_LOG_FIRST || (total % DS_CRC_LOG_EVERY) == 0)) {
+            LOG_WARN("[DualSense] Warning: Slot %d input CRC mismatch - report dropped (%u total)\n",
+                     dev->slot, total);
+        }
+        return -1;
+    }
+    
+    out_state->timestamp_ms = time_get_ms();
+    return 0;
+}
+
+static int dualsense_send_output(controller_device_t* dev, const controller_output_t* output) {
+    ds_device_t* ds = dev->priv;
+    
     /* 
-     * LED control via sysfs.
-     * We refresh every call to fight against the kernel driver's defaults.
+     * Refresh periodically to fight against the kernel driver's defaults.
      * The kernel hid-playstation driver sets blue + player 1, so we override.
      */
-    static int led_refresh_counter = 0;
-    led_refresh_counter++;
+    ds->led_refresh_counter++;
     
-    /* Force refresh every 10 calls (~100ms at 100Hz) to fight kernel driver */
-    int force_refresh = (led_refresh_counter >= 10);
+    /* Force refresh every 10 calls to fight kernel driver */
+    int force_refresh = (ds->led_refresh_counter >= 10);
     if (force_refresh) {
-        led_refresh_counter = 0;
+        ds->led_refresh_counter = 0;
     }
     
-    if (force_refresh || 
-        output->led_r != last_led_r || 
-        output->led_g != last_led_g || 
-        output->led_b != last_led_b) {
-        set_lightbar_sysfs(output->led_r, output->led_g, output->led_b);
-        last_led_r = output->led_r;
-        last_led_g = output->led_g;
-        last_led_b = output->led_b;
-    }
+    int hidraw_leds = (g_led_backend == DS_LED_BACKEND_HIDRAW);
     
-    if (force_refresh || output->player_leds != last_player_leds) {
-        set_player_leds_sysfs(output->player_leds);
-        last_player_leds = output->player_leds;
+    /* LED control via sysfs */
+    if (!hidraw_leds) {
+        if (force_refresh || 
+            output->led_r != ds->last_led_r || 
+            output->led_g != ds->last_led_g || 
+            output->led_b != ds->last_led_b) {
+            set_lightbar_sysfs(ds, output->led_r, output->led_g, output->led_b);
+        }
+        
+        if (force_refresh || output->player_leds != ds->last_player_leds) {
+            set_player_leds_sysfs(ds, output->player_leds, force_refresh);
+        }
     }
     
-    /* Rumble via hidraw */
-    if (fd < 0) return -1;
+    ds->last_led_r = output->led_r;
+    ds->last_led_g = output->led_g;
+    ds->last_led_b = output->led_b;
+    ds->last_player_leds = output->player_leds;
     
-    uint8_t report[DS_BT_OUTPUT_SIZE] = {0};
+    /* Rumble (and LEDs in hidraw mode) via hidraw */
+    int fd = dev->fd;
+    if (fd < 0) return -1;
     
-    report[0] = 0x31;  /* Report ID */
-    report[1] = (output_seq << 4) & 0xF0;
-    output_seq = (output_seq + 1) & 0x0F;
-    report[2] = 0x10;  /* Tag */
-    report[3] = 0x03;  /* Valid flags: rumble + haptics */
-    report[4] = 0;     /* No LED flags (using sysfs) */
-    report[5] = output->rumble_right;
-    report[6] = output->rumble_left;
+    /* Nothing for the output report to carry - skip the write */
+    if (!hidraw_leds &&
+        output->rumble_left == ds->last_rumble_left &&
+        output->rumble_right == ds->last_rumble_right) {
+        return 0;
+    }
     
-    /* Calculate CRC32 */
-    uint8_t crc_buf[75];
-    crc_buf[0] = 0xA2;  /* BT output report header */
-    memcpy(&crc_buf[1], report, 74);
-    uint32_t crc = dualsense_calc_crc32(crc_buf, 75);
+    uint32_t flags = 0;
+    if (hidraw_leds) {
+        flags |= RC_DS_OUT_LEDS;
+        if (!ds->lightbar_setup_done) flags |= RC_DS_OUT_LIGHTBAR_SETUP;
+    }
     
-    report[74] = crc & 0xFF;
-    report[75] = (crc >> 8) & 0xFF;
-    report[76] = (crc >> 16) & 0xFF;
-    report[77] = (crc >> 24) & 0xFF;
+    uint8_t report[DS_BT_OUTPUT_SIZE];
+    rc_ds_build_output(&ds->core, output, flags, report);
     
     ssize_t written = write(fd, report, sizeof(report));
-    return (written > 0) ? 0 : -1;
+    if (written <= 0) return -1;
+    
+    ds->last_rumble_left = output->rumble_left;
+    ds->last_rumble_right = output->rumble_right;
+    if (hidraw_leds) ds->lightbar_setup_done = 1;
+    return 0;
 }
 
-static void dualsense_on_disconnect(void) {
-    printf("[DualSense] Disconnected\n");
+static void dualsense_on_disconnect(controller_device_t* dev) {
+    ds_device_t* ds = dev->priv;
+    LOG_INFO("[DualSense] Slot %d disconnected\n", dev->slot);
+    if (!ds) return;
+    
+    /* Stop a connect job still in flight from publishing */
+    pthread_mutex_lock(&ds->calib_mutex);
+    ds->connected = 0;
+    motion_set_calibration(ds->slot, NULL);
+    pthread_mutex_unlock(&ds->calib_mutex);
     
-    /* Reset LED cache */
-    last_led_r = 255;
-    last_led_g = 255;
-    last_led_b = 255;
-    last_player_leds = 0xFF;
+    /* Close sysfs fds (device might get new input number on reconnect) */
+    pthread_mutex_lock(&ds->led_mutex);
+    close_led_sysfs(ds);
+    pthread_mutex_unlock(&ds->led_mutex);
     
-    /* Clear sysfs paths (device might get new input number on reconnect) */
-    g_lightbar_path[0] = '\0';
+    dev->priv = NULL;
+    ds_device_put(ds);
 }
 
-static void dualsense_enter_low_power(int fd) {
-    printf("[DualSense] Entering low power mode\n");
+/* Standby: one byte decides, the CRC only runs when PS reads as pressed */
+static int dualsense_process_standby_input(controller_device_t* dev, const uint8_t* buf,
+                                           size_t len) {
+    ds_device_t* ds = dev->priv;
+    return rc_ds_parse_standby_input(&ds->core, buf, len);
+}
+
+static void dualsense_enter_low_power(controller_device_t* dev) {
+    ds_device_t* ds = dev->priv;
+    LOG_INFO("[DualSense] Slot %d entering low power mode\n", dev->slot);
     
     /* Turn off LEDs */
-    set_lightbar_sysfs(0, 0, 0);
-    set_player_leds_sysfs(0);
+    if (g_led_backend == DS_LED_BACKEND_SYSFS) {
+        set_lightbar_sysfs(ds, 0, 0, 0);
+        set_player_leds_sysfs(ds, 0, 1);
+    }
     
-    /* Stop rumble */
+    /* Stop rumble (and LEDs in hidraw mode) */
     controller_output_t off = {0};
-    dualsense_send_output(fd, &off);
+    ds->last_rumble_left = -1;
+    dualsense_send_output(dev, &off);
 }
 
 /* ============================================================================
@@ -689,9 +761,10 @@ static const controller_driver_t dualsense_driver = {
     .info = &dualsense_info,
     .init = dualsense_init,
     .shutdown = dualsense_shutdown,
-    .find_device = dualsense_find_device,
+    .open_device = dualsense_open_device,
     .match_device = dualsense_match_device,
     .process_input = dualsense_process_input,
+    .process_standby_input = dualsense_process_standby_input,
     .send_output = dualsense_send_output,
     .on_disconnect = dualsense_on_disconnect,
     .enter_low_power = dualsense_enter_low_power
@@ -701,7 +774,20 @@ const controller_driver_t* dualsense_get_driver(void) {
     return &dualsense_driver;
 }
 
+int dualsense_attach_offline(controller_device_t* dev, const ds_calibration_t* calib) {
+    ds_device_t* ds = ds_device_alloc();
+    if (!ds) return -1;
+    
+    ds->slot = dev->slot;
+    if (calib) publish_calibration(ds, calib);
+    
+    dev->driver = &dualsense_driver;
+    dev->fd = -1;
+    dev->priv = ds;
+    return 0;
+}
+
 void dualsense_register(void) {
     controller_register(&dualsense_driver);
-    printf("[DualSense] Driver registered\n");
+    LOG_INFO("[DualSense] Driver registered\n");
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+/*
+ * RosettaPad - Loopback Virtual DualSense
+ * ========================================
+ *
+ * Scripted report source (over loopback_uhid.c) plus a thin driver that
+ * reuses the DualSense parser.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/hidraw.h>
+#include <sys/ioctl.h>
+
+#include "core/common.h"
+#include "core/crc32.h"
+#include "core/log.h"
+#include "controllers/dualsense/dualsense.h"
+#include "controllers/loopback/loopback_pad.h"
+#include "controllers/loopback/loopback_uhid.h"
+
+#define LOOPBACK_OPEN_TIMEOUT_MS 3000
+
+/* One vendor-defined 77-byte input report with ID 0x31 */
+static const uint8_t loopback_rdesc[] = {
+    0x06, 0x00, 0xFF,   /* Usage Page (Vendor 0xFF00) */
+    0x09, 0x01,         /* Usage (0x01) */
+    0xA1, 0x01,         /* Collection (Application) */
+    0x85, DS_BT_REPORT_ID,  /* Report ID (0x31) */
+    0x09, 0x01,         /*   Usage (0x01) */
+    0x15, 0x00,         /*   Logical Minimum (0) */
+    0x26, 0xFF, 0x00,   /*   Logical Maximum (255) */
+    0x75, 0x08,         /*   Report Size (8) */
+    0x95, DS_BT_INPUT_SIZE - 1,  /* Report Count (77) */
+    0x81, 0x02,         /*   Input (Data, Var, Abs) */
+    0xC0                /* End Collection */
+};
+
+static uint16_t g_next_seq = 1;
+static uint64_t g_sent_ns[65536];
+
+/* ============================================================================
+ * UHID DEVICE
+ * ============================================================================ */
+
+int loopback_pad_create(void) {
+    if (loopback_uhid_create("RosettaPad Loopback Pad", "rosettapad/loopback",
+                             LOOPBACK_PAD_VID, LOOPBACK_PAD_PID,
+                             loopback_rdesc, sizeof(loopback_rdesc)) < 0) {
+        return -1;
+    }
+
+    LOG_INFO("[Loopback] Virtual pad created (%04X:%04X)\n", LOOPBACK_PAD_VID, LOOPBACK_PAD_PID);
+    return 0;
+}
+
+void loopback_pad_destroy(void) {
+    loopback_uhid_destroy();
+}
+
+/* ============================================================================
+ * REPORT SCRIPT
+ * ============================================================================ */
+
+static void put_le16(uint8_t* p, int v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/* Frame n of the script: sticks sweep, motion drifts, seq in the triggers */
+static void build_report(uint8_t* r, uint32_t n, uint16_t seq) {
+    memset(r, 0, DS_BT_INPUT_SIZE);
+
+    r[DS_OFF_REPORT_ID] = DS_BT_REPORT_ID;
+    r[DS_OFF_COUNTER] = (uint8_t)(n << 4);
+    r[DS_OFF_LX] = (uint8_t)(n * 3);
+    r[DS_OFF_LY] = (uint8_t)(255 - n * 3);
+    r[DS_OFF_RX] = (uint8_t)(128 + (int)(n % 64) - 32);
+    r[DS_OFF_RY] = 128;
+    r[DS_OFF_L2] = LOOPBACK_SEQ_L2(seq);
+    r[DS_OFF_R2] = LOOPBACK_SEQ_R2(seq);
+    r[DS_OFF_BUTTONS1] = (uint8_t)(0x08 | ((n / 64) % 2 ? 0x20 : 0));  /* Cross toggles */
+    put_le16(&r[DS_OFF_GYRO_X], (int)(n % 200) - 100);
+    put_le16(&r[DS_OFF_GYRO_Y], (int)(n % 150) - 75);
+    put_le16(&r[DS_OFF_GYRO_Z], (int)(n % 100) - 50);
+    put_le16(&r[DS_OFF_ACCEL_X], (int)(n % 300) - 150);
+    put_le16(&r[DS_OFF_ACCEL_Y], 8192);
+    put_le16(&r[DS_OFF_ACCEL_Z], (int)(n % 250) - 125);
+    r[DS_OFF_TOUCHPAD] = DS_TOUCH_INACTIVE;
+    r[DS_OFF_TOUCHPAD + 4] = DS_TOUCH_INACTIVE;
+    r[DS_OFF_BATTERY] = 0x08;
+
+    /* BT CRC over the implicit 0xA1 HIDP input header */
+    uint8_t header = 0xA1;
+    uint32_t crc = crc32_update(0, &header, 1);
+    crc = crc32_update(crc, r, DS_BT_INPUT_SIZE - 4);
+    r[74] = (uint8_t)crc;
+    r[75] = (uint8_t)(crc >> 8);
+    r[76] = (uint8_t)(crc >> 16);
+    r[77] = (uint8_t)(crc >> 24);
+}
+
+uint64_t loopback_pad_sent_ns(uint16_t seq) {
+    return __atomic_load_n(&g_sent_ns[seq], __ATOMIC_ACQUIRE);
+}
+
+int loopback_pad_run(int rate_hz, int seconds) {
+    if (rate_hz <= 0) return -1;
+
+    /* The adapter opens the node once hotplug sees it */
+    int opened = 0;
+    for (int waited = 0; !opened && waited < LOOPBACK_OPEN_TIMEOUT_MS; waited += 50) {
+        opened = loopback_uhid_poll(50);
+    }
+    if (!opened) {
+        LOG_WARN("[Loopback] Warning: Virtual pad was never opened by the adapter\n");
+        return -1;
+    }
+
+    uint64_t period_ns = 1000000000ULL / (uint64_t)rate_hz;
+    uint32_t total = (uint32_t)rate_hz * (uint32_t)seconds;
+    if (total > LOOPBACK_MAX_REPORTS) total = LOOPBACK_MAX_REPORTS;
+
+    /* Each run numbers from 1 so a window never sees a wrapped seq */
+    memset(g_sent_ns, 0, sizeof(g_sent_ns));
+    g_next_seq = 1;
+    uint64_t next = time_get_ns();
+
+    uint8_t report[DS_BT_INPUT_SIZE];
+
+    uint32_t sent = 0;
+    for (uint32_t n = 0; n < total && g_running; n++) {
+        next += period_ns;
+        struct timespec ts = {
+            .tv_sec = (time_t)(next / 1000000000ULL),
+            .tv_nsec = (long)(next % 1000000000ULL),
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+        uint16_t seq = g_next_seq++;
+        build_report(report, n, seq);
+
+        __atomic_store_n(&g_sent_ns[seq], time_get_ns(), __ATOMIC_RELEASE);
+        if (loopback_uhid_send(report, sizeof(report)) < 0) break;
+        sent++;
+
+        /* Keep the (tiny) uhid event queue from overflowing */
+        if ((n & 63) == 0) loopback_uhid_poll(0);
+    }
+    return (int)sent;
+}
+
+/* ============================================================================
+ * DRIVER
+ * ============================================================================ */
+
+static const controller_info_t loopback_info = {
+    .name = "Loopback DualSense",
+    .manufacturer = "RosettaPad",
+    .vendor_id = LOOPBACK_PAD_VID,
+    .product_id = LOOPBACK_PAD_PID,
+    .capabilities = (
+        CONTROLLER_CAP_BUTTONS |
+        CONTROLLER_CAP_ANALOG_STICKS |
+        CONTROLLER_CAP_TRIGGERS |
+        CONTROLLER_CAP_MOTION
+    ),
+    .supports_bluetooth = 0,
+    .supports_usb = 0
+};
+
+static const controller_driver_t loopback_driver;
+
+static int loopback_open_device(controller_device_t* dev, const char* path) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct hidraw_devinfo info;
+    if (ioctl(fd, HIDIOCGRAWINFO, &info) < 0 ||
+        info.vendor != LOOPBACK_PAD_VID || (uint16_t)info.product != LOOPBACK_PAD_PID) {
+        close(fd);
+        return -1;
+    }
+
+    /* DualSense parser state, no calibration (motion passes through raw) */
+    if (dualsense_attach_offline(dev, NULL) < 0) {
+        close(fd);
+        return -1;
+    }
+    dev->driver = &loopback_driver;
+    dev->fd = fd;
+
+    LOG_INFO("[Loopback] Virtual pad opened: %s (slot %d)\n", path, dev->slot);
+    return 0;
+}
+
+static int loopback_match_device(uint16_t vid, uint16_t pid) {
+    return vid == LOOPBACK_PAD_VID && pid == LOOPBACK_PAD_PID;
+}
+
+static int loopback_process_input(controller_device_t* dev, const uint8_t* buf, size_t len,
+                                  controller_state_t* out_state) {
+    return dualsense_get_driver()->process_input(dev, buf, len, out_state);
+}
+
+static int loopback_send_output(controller_device_t* dev, const controller_output_t* output) {
+    (void)dev;
+    (void)output;
+    return 0;   /* Nothing to rumble */
+}
+
+static void loopback_on_disconnect(controller_device_t* dev) {
+    dualsense_get_driver()->on_disconnect(dev);
+}
+
+static const controller_driver_t loopback_driver = {
+    .info = &loopback_info,
+    .open_device = loopback_open_device,
+    .match_device = loopback_match_device,
+    .process_input = loopback_process_input,
+    .send_output = loopback_send_output,
+    .on_disconnect = loopback_on_disconnect,
+};
+
+void loopback_pad_register(void) {
+    controller_register(&loopback_driver);
+}
@@ -0,0 +1,97 @@
+/*
+ * RosettaPad - Loopback uhid Transport
+ * =====================================
+ *
+ * /dev/uhid writes and open/close tracking for the loopback pad.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <linux/uhid.h>
+
+#include "core/log.h"
+#include "controllers/loopback/loopback_uhid.h"
+
+static int g_uhid_fd = -1;
+static int g_opened = 0;                /* hidraw node held open by the adapter */
+static struct uhid_event g_input_ev;    /* Reused for every report */
+
+static int uhid_write(const struct uhid_event* ev) {
+    ssize_t n = write(g_uhid_fd, ev, sizeof(*ev));
+    if (n != (ssize_t)sizeof(*ev)) {
+        LOG_ERROR("[Loopback] uhid write failed: %s\n", n < 0 ? strerror(errno) : "short");
+        return -1;
+    }
+    return 0;
+}
+
+int loopback_uhid_create(const char* name, const char* phys, uint16_t vid, uint16_t pid,
+                         const uint8_t* rdesc, size_t rdesc_size) {
+    struct uhid_event ev;
+    if (rdesc_size > sizeof(ev.u.create2.rd_data)) return -1;
+
+    g_uhid_fd = open("/dev/uhid", O_RDWR | O_CLOEXEC | O_NONBLOCK);
+    if (g_uhid_fd < 0) {
+        LOG_ERROR("[Loopback] Cannot open /dev/uhid: %s (modprobe uhid?)\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_CREATE2;
+    snprintf((char*)ev.u.create2.name, sizeof(ev.u.create2.name), "%s", name);
+    snprintf((char*)ev.u.create2.phys, sizeof(ev.u.create2.phys), "%s", phys);
+    ev.u.create2.rd_size = (uint16_t)rdesc_size;
+    ev.u.create2.bus = BUS_VIRTUAL;
+    ev.u.create2.vendor = vid;
+    ev.u.create2.product = pid;
+    memcpy(ev.u.create2.rd_data, rdesc, rdesc_size);
+
+    if (uhid_write(&ev) < 0) {
+        close(g_uhid_fd);
+        g_uhid_fd = -1;
+        return -1;
+    }
+
+    memset(&g_input_ev, 0, sizeof(g_input_ev));
+    g_input_ev.type = UHID_INPUT2;
+    return 0;
+}
+
+void loopback_uhid_destroy(void) {
+    if (g_uhid_fd < 0) return;
+
+    struct uhid_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_DESTROY;
+    uhid_write(&ev);
+
+    close(g_uhid_fd);
+    g_uhid_fd = -1;
+    g_opened = 0;
+}
+
+/* Track open/close; output and report requests are not used */
+int loopback_uhid_poll(int timeout_ms) {
+    struct pollfd pfd = {.fd = g_uhid_fd, .events = POLLIN};
+    struct uhid_event ev;
+
+    while (poll(&pfd, 1, timeout_ms) > 0) {
+        if (read(g_uhid_fd, &ev, sizeof(ev)) <= 0) break;
+        if (ev.type == UHID_OPEN) g_opened = 1;
+        if (ev.type == UHID_CLOSE) g_opened = 0;
+        timeout_ms = 0;
+    }
+    return g_opened;
+}
+
+int loopback_uhid_send(const uint8_t* report, size_t len) {
+    if (g_uhid_fd < 0 || len > sizeof(g_input_ev.u.input2.data)) return -1;
+
+    g_input_ev.u.input2.size = (uint16_t)len;
+    memcpy(g_input_ev.u.input2.data, report, len);
+    return uhid_write(&g_input_ev);
+}
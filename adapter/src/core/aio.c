@@ -0,0 +1,49 @@
+/*
+ * RosettaPad - Native AIO
+ * ========================
+ *
+ * Raw syscall wrappers - glibc has no io_* functions.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "core/aio.h"
+
+int aio_ctx_setup(unsigned int max_events, aio_context_t* ctx) {
+    *ctx = 0;
+    return (int)syscall(__NR_io_setup, max_events, ctx);
+}
+
+void aio_ctx_destroy(aio_context_t ctx) {
+    if (ctx) syscall(__NR_io_destroy, ctx);
+}
+
+void aio_prep(struct iocb* cb, uint16_t opcode, int fd, void* buf, size_t len,
+              int resfd, void* data) {
+    memset(cb, 0, sizeof(*cb));
+    cb->aio_lio_opcode = opcode;
+    cb->aio_fildes = (uint32_t)fd;
+    cb->aio_buf = (uint64_t)(uintptr_t)buf;
+    cb->aio_nbytes = len;
+    cb->aio_data = (uint64_t)(uintptr_t)data;
+    if (resfd >= 0) {
+        cb->aio_flags = IOCB_FLAG_RESFD;
+        cb->aio_resfd = (uint32_t)resfd;
+    }
+}
+
+int aio_submit(aio_context_t ctx, struct iocb* cb) {
+    struct iocb* list[1] = { cb };
+    long ret = syscall(__NR_io_submit, ctx, 1L, list);
+    if (ret == 0) errno = EAGAIN;
+    return (ret == 1) ? 0 : -1;
+}
+
+int aio_reap(aio_context_t ctx, struct io_event* events, int max_events) {
+    struct timespec zero = {0, 0};
+    return (int)syscall(__NR_io_getevents, ctx, 0L, (long)max_events, events, &zero);
+}
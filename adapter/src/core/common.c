@@ -5,13 +5,24 @@
  * Shared state management and utilities.
  */
 
+#define _GNU_SOURCE     /* ppoll */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
+#include <time.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <errno.h>
 
 #include "core/common.h"
+#include "core/seqlock.h"
+#include "core/control.h"
+#include "core/power.h"
+#include "core/metrics.h"
+#include "core/log.h"
 
 /* ============================================================================
  * GLOBAL STATE
@@ -19,6 +30,39 @@
 
 volatile int g_running = 1;
 
+/* ============================================================================
+ * SUBSCRIBER TABLES
+ * 
+ * Notifiers walk a table without a lock; subscribe/unsubscribe serialize
+ * on the owner's mutex. Unsubscribe swaps the last entry into the hole,
+ * then waits for notifiers already inside the walk so the caller can
+ * close() the fd without a late write landing on a reused fd number.
+ * ============================================================================ */
+
+static void subscribers_notify(const int* fds, const int* count, int* notifying) {
+    __atomic_add_fetch(notifying, 1, __ATOMIC_SEQ_CST);
+    int n = __atomic_load_n(count, __ATOMIC_SEQ_CST);
+    uint64_t one = 1;
+    for (int i = 0; i < n; i++) {
+        ssize_t ret = write(__atomic_load_n(&fds[i], __ATOMIC_RELAXED), &one, sizeof(one));
+        (void)ret;
+    }
+    __atomic_sub_fetch(notifying, 1, __ATOMIC_RELEASE);
+}
+
+/* Caller holds the table's mutex; returns -1 if fd was not subscribed */
+static int subscribers_remove(int* fds, int* count, const int* notifying, int fd) {
+    int n = *count;
+    for (int i = 0; i < n; i++) {
+        if (fds[i] != fd) continue;
+        __atomic_store_n(&fds[i], fds[n - 1], __ATOMIC_RELAXED);
+        __atomic_store_n(count, n - 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(notifying, __ATOMIC_SEQ_CST)) sched_yield();
+        return 0;
+    }
+    return -1;
+}
+
 /* ============================================================================
  * SYSTEM STATE MACHINE
  * ============================================================================ */
@@ -32,6 +76,11 @@ static uint64_t g_last_state_change_time = 0;
 
 static const char* state_names[] = {"ACTIVE", "STANDBY", "WAKING"};
 
+/* State change subscribers (eventfds) - fd is stored before count is bumped */
+static int g_system_subscribers[SYSTEM_STATE_MAX_SUBSCRIBERS];
+static int g_system_subscriber_count = 0;
+static int g_system_notifying = 0;
+
 void system_set_state(system_state_t state) {
     pthread_mutex_lock(&g_system_state_mutex);
     system_state_t old_state = g_system_state;
@@ -39,7 +88,44 @@ void system_set_state(system_state_t state) {
     g_last_state_change_time = time_get_ms();
     pthread_mutex_unlock(&g_system_state_mutex);
     
-    printf("[System] State: %s -> %s\n", state_names[old_state], state_names[state]);
+    control_publish_system_state(state);
+    metrics_inc(METRIC_STATE_TRANSITIONS);
+    metrics_gauge_set(METRIC_GAUGE_SYSTEM_STATE, state);
+    
+    LOG_INFO("[System] State: %s -> %s\n", state_names[old_state], state_names[state]);
+    
+    subscribers_notify(g_system_subscribers, &g_system_subscriber_count, &g_system_notifying);
+}
+
+int system_state_subscribe(void) {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("[System] eventfd: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    pthread_mutex_lock(&g_system_state_mutex);
+    int count = g_system_subscriber_count;
+    if (count >= SYSTEM_STATE_MAX_SUBSCRIBERS) {
+        pthread_mutex_unlock(&g_system_state_mutex);
+        LOG_ERROR("[System] Error: State subscriber table full\n");
+        close(fd);
+        return -1;
+    }
+    __atomic_store_n(&g_system_subscribers[count], fd, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_system_subscriber_count, count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_system_state_mutex);
+    
+    return fd;
+}
+
+void system_state_unsubscribe(int fd) {
+    if (fd < 0) return;
+    pthread_mutex_lock(&g_system_state_mutex);
+    int ret = subscribers_remove(g_system_subscribers, &g_system_subscriber_count,
+                                 &g_system_notifying, fd);
+    pthread_mutex_unlock(&g_system_state_mutex);
+    if (ret < 0) LOG_WARN("[System] Warning: fd %d was not subscribed\n", fd);
 }
 
 system_state_t system_get_state(void) {
@@ -63,6 +149,10 @@ static int can_change_state(void) {
     return elapsed >= STATE_CHANGE_DEBOUNCE_MS;
 }
 
+/* Output read-modify-write helpers (defined below) */
+static void output_modify_begin(int slot, controller_output_t* output);
+static void output_modify_end(int slot, const controller_output_t* output);
+
 /* Forward declarations for console-specific functions */
 extern void ps3_bt_disconnect(void);
 extern int ps3_bt_wake(void);
@@ -70,269 +160,514 @@ extern int ps3_bt_wake(void);
 void system_enter_standby(void) {
     /* Debounce - don't enter standby if we just changed state */
     if (!can_change_state()) {
-        printf("[System] Ignoring standby request (debounce)\n");
+        LOG_INFO("[System] Ignoring standby request (debounce)\n");
         return;
     }
     
     /* Don't enter standby if we're already in standby or waking */
     system_state_t current = system_get_state();
     if (current != SYSTEM_STATE_ACTIVE) {
-        printf("[System] Ignoring standby request (not active, state=%s)\n", 
-               state_names[current]);
+        LOG_INFO("[System] Ignoring standby request (not active, state=%s)\n", 
+                 state_names[current]);
         return;
     }
     
-    printf("[System] *** ENTERING STANDBY MODE ***\n");
+    LOG_INFO("[System] *** ENTERING STANDBY MODE ***\n");
     
+    power_enter_standby();
     system_set_state(SYSTEM_STATE_STANDBY);
     
     /* Disconnect Bluetooth to PS3 */
     ps3_bt_disconnect();
     
-    /* Set dim amber lightbar to indicate standby */
-    pthread_mutex_lock(&g_controller_output_mutex);
-    g_controller_output.rumble_left = 0;
-    g_controller_output.rumble_right = 0;
-    g_controller_output.led_r = 30;
-    g_controller_output.led_g = 15;
-    g_controller_output.led_b = 0;
-    g_controller_output.player_leds = 0;
-    pthread_mutex_unlock(&g_controller_output_mutex);
+    /* Set dim amber lightbar on every pad to indicate standby */
+    for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+        controller_output_t output;
+        output_modify_begin(slot, &output);
+        output.rumble_left = 0;
+        output.rumble_right = 0;
+        output.led_r = 30;
+        output.led_g = 15;
+        output.led_b = 0;
+        output.player_leds = 0;
+        output_modify_end(slot, &output);
+    }
     
-    printf("[System] Standby active - press PS button to wake\n");
+    LOG_INFO("[System] Standby active - press PS button to wake\n");
 }
 
 void system_exit_standby(void) {
     /* Debounce - don't wake if we just changed state */
     if (!can_change_state()) {
-        printf("[System] Ignoring wake request (debounce)\n");
+        LOG_INFO("[System] Ignoring wake request (debounce)\n");
         return;
     }
     
     /* Only exit standby if we're actually in standby */
     if (system_get_state() != SYSTEM_STATE_STANDBY) {
-        printf("[System] Ignoring wake request (not in standby)\n");
+        LOG_INFO("[System] Ignoring wake request (not in standby)\n");
         return;
     }
     
-    printf("[System] *** EXITING STANDBY MODE ***\n");
+    LOG_INFO("[System] *** EXITING STANDBY MODE ***\n");
     
+    power_exit_standby();
     system_set_state(SYSTEM_STATE_WAKING);
     
     /* Restore normal lightbar (red) */
-    pthread_mutex_lock(&g_controller_output_mutex);
-    g_controller_output.led_r = 255;
-    g_controller_output.led_g = 0;
-    g_controller_output.led_b = 0;
-    pthread_mutex_unlock(&g_controller_output_mutex);
-    
-    /* Try to wake PS3 via Bluetooth */
-    printf("[System] Sending wake signal to PS3...\n");
+    for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+        controller_output_t output;
+        output_modify_begin(slot, &output);
+        output.led_r = 255;
+        output.led_g = 0;
+        output.led_b = 0;
+        output_modify_end(slot, &output);
+    }
+    
+    /* Try to wake PS3 via Bluetooth (the BT worker connects in the background) */
+    LOG_INFO("[System] Sending wake signal to PS3...\n");
     if (ps3_bt_wake() < 0) {
-        printf("[System] Warning: Wake signal failed\n");
+        LOG_WARN("[System] Warning: Wake signal failed\n");
     }
     
     system_set_state(SYSTEM_STATE_ACTIVE);
+    
+    /* Put back any lightbar override from the control plane */
+    control_apply();
 }
 
 /* ============================================================================
- * CONTROLLER STATE MANAGEMENT
+ * CONTROLLER SLOTS
+ * 
+ * Each slot sits on its own cache lines so players' input threads,
+ * console readers and the output thread don't false-share.
+ * 
+ * State is published through a sequence latch: the input thread never
+ * waits for readers, and readers (USB, BT, output) never block on the
+ * input thread. Several threads post output (USB ep2, BT interrupt,
+ * standby handling), so output writers serialize on the latch's write
+ * lock. Readers never block.
  * ============================================================================ */
 
-controller_state_t g_controller_state = {
-    .buttons = 0,
-    .left_stick_x = 128,
-    .left_stick_y = 128,
-    .right_stick_x = 128,
-    .right_stick_y = 128,
-    .left_trigger = 0,
-    .right_trigger = 0,
-    .accel_x = 0,
-    .accel_y = 0,
-    .accel_z = 0,
-    .gyro_x = 0,
-    .gyro_y = 0,
-    .gyro_z = 0,
-    .touch = {{0, 0, 0}, {0, 0, 0}},
-    .battery_level = 100,
-    .battery_charging = 0,
-    .timestamp_ms = 0
-};
-pthread_mutex_t g_controller_state_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-void controller_state_update(const controller_state_t* state) {
-    pthread_mutex_lock(&g_controller_state_mutex);
-    memcpy(&g_controller_state, state, sizeof(controller_state_t));
-    pthread_mutex_unlock(&g_controller_state_mutex);
+#define NEUTRAL_STATE { \
+    .buttons = 0, \
+    .left_stick_x = 128, \
+    .left_stick_y = 128, \
+    .right_stick_x = 128, \
+    .right_stick_y = 128, \
+    .left_trigger = 0, \
+    .right_trigger = 0, \
+    .accel_x = 0, \
+    .accel_y = 0, \
+    .accel_z = 0, \
+    .gyro_x = 0, \
+    .gyro_y = 0, \
+    .gyro_z = 0, \
+    .touch = {{0, 0, 0}, {0, 0, 0}}, \
+    .battery_level = 100, \
+    .battery_charging = 0, \
+    .timestamp_ms = 0, \
+    .timestamp_ns = 0, \
+    .generation = 0 \
 }
 
-void controller_state_copy(controller_state_t* out_state) {
-    pthread_mutex_lock(&g_controller_state_mutex);
-    memcpy(out_state, &g_controller_state, sizeof(controller_state_t));
-    pthread_mutex_unlock(&g_controller_state_mutex);
+#define DEFAULT_OUTPUT { \
+    .rumble_left = 0, \
+    .rumble_right = 0, \
+    .led_r = 255, \
+    .led_g = 0, \
+    .led_b = 0, \
+    .player_leds = 0, \
+    .player_brightness = 255 \
 }
 
-/* ============================================================================
- * OUTPUT STATE MANAGEMENT
- * ============================================================================ */
-
-controller_output_t g_controller_output = {
-    .rumble_left = 0,
-    .rumble_right = 0,
-    .led_r = 255,
-    .led_g = 0,
-    .led_b = 0,
-    .player_leds = 0,
-    .player_brightness = 255
+typedef struct {
+    /* Input - written by the input thread */
+    seqlatch_t state_latch;
+    controller_state_t state_copies[2];
+    uint32_t state_generation;
+    
+    /* State change subscribers (eventfds) - fd is stored before count is bumped */
+    int subscribers[CONTROLLER_STATE_MAX_SUBSCRIBERS];
+    int subscriber_count;
+    int subscribers_notifying;  /* Notifiers inside the walk */
+    
+    /* Output - written by console threads */
+    seqlatch_t output_latch __attribute__((aligned(64)));
+    controller_output_t output_copies[2];
+    int output_changed;         /* Set by writers, consumed by the output thread */
+    
+    /* Bound device - device_lock held across send_output() */
+    pthread_mutex_t device_lock __attribute__((aligned(64)));
+    controller_device_t* device;
+    uint32_t attach_generation; /* Bumped per attach, under device_lock */
+} __attribute__((aligned(64))) controller_slot_t;
+
+static controller_slot_t g_slots[MAX_CONTROLLER_SLOTS] = {
+    [0 ... MAX_CONTROLLER_SLOTS - 1] = {
+        .state_latch = SEQLATCH_INIT,
+        .state_copies = { NEUTRAL_STATE, NEUTRAL_STATE },
+        .output_latch = SEQLATCH_INIT,
+        .output_copies = { DEFAULT_OUTPUT, DEFAULT_OUTPUT },
+        .device_lock = PTHREAD_MUTEX_INITIALIZER,
+        .device = NULL
+    }
 };
-pthread_mutex_t g_controller_output_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static int g_output_changed = 0;
+static pthread_mutex_t g_state_subscriber_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-void controller_output_update(const controller_output_t* output) {
-    pthread_mutex_lock(&g_controller_output_mutex);
+/* Wakes the output thread - created by the thread itself, -1 until then */
+static int g_output_event_fd = -1;
+
+void controller_output_wake(void) {
+    int fd = __atomic_load_n(&g_output_event_fd, __ATOMIC_ACQUIRE);
+    if (fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ret = write(fd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+static void output_notify(controller_slot_t* s) {
+    __atomic_store_n(&s->output_changed, 1, __ATOMIC_RELEASE);
+    controller_output_wake();
+}
+
+int controller_slot_attach(controller_device_t* dev) {
+    int slot = dev->slot;
+    if (slot < 0 || slot >= MAX_CONTROLLER_SLOTS) return -1;
+    controller_slot_t* s = &g_slots[slot];
     
-    /* Check if anything changed */
-    if (memcmp(&g_controller_output, output, sizeof(controller_output_t)) != 0) {
-        memcpy(&g_controller_output, output, sizeof(controller_output_t));
-        g_output_changed = 1;
+    pthread_mutex_lock(&s->device_lock);
+    if (s->device) {
+        pthread_mutex_unlock(&s->device_lock);
+        return -1;
     }
+    __atomic_store_n(&s->device, dev, __ATOMIC_RELEASE);
+    s->attach_generation++;
+    pthread_mutex_unlock(&s->device_lock);
     
-    pthread_mutex_unlock(&g_controller_output_mutex);
+    /* New pad gets the slot's full output state */
+    output_notify(s);
+    control_publish_connected(slot, 1);
+    
+    /* A new pad starts from neutral, not the last player's sticks */
+    controller_state_t neutral = NEUTRAL_STATE;
+    controller_slot_state_update(slot, &neutral);
+    return 0;
 }
 
-void controller_output_copy(controller_output_t* out_output) {
-    pthread_mutex_lock(&g_controller_output_mutex);
-    memcpy(out_output, &g_controller_output, sizeof(controller_output_t));
-    pthread_mutex_unlock(&g_controller_output_mutex);
+void controller_slot_detach(int slot) {
+    if (slot < 0 || slot >= MAX_CONTROLLER_SLOTS) return;
+    controller_slot_t* s = &g_slots[slot];
+    
+    pthread_mutex_lock(&s->device_lock);
+    __atomic_store_n(&s->device, NULL, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&s->device_lock);
+    control_publish_connected(slot, 0);
+    
+    controller_state_t neutral = NEUTRAL_STATE;
+    controller_slot_state_update(slot, &neutral);
 }
 
-int controller_output_changed(void) {
-    pthread_mutex_lock(&g_controller_output_mutex);
-    int changed = g_output_changed;
-    g_output_changed = 0;
-    pthread_mutex_unlock(&g_controller_output_mutex);
-    return changed;
+int controller_slot_count(void) {
+    int count = 0;
+    for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+        if (__atomic_load_n(&g_slots[slot].device, __ATOMIC_ACQUIRE)) count++;
+    }
+    return count;
+}
+
+void controller_slots_enter_low_power(void) {
+    for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+        controller_slot_t* s = &g_slots[slot];
+        
+        pthread_mutex_lock(&s->device_lock);
+        controller_device_t* dev = s->device;
+        if (dev && dev->driver->enter_low_power && dev->fd >= 0) {
+            dev->driver->enter_low_power(dev);
+        }
+        pthread_mutex_unlock(&s->device_lock);
+    }
 }
 
 /* ============================================================================
- * LIGHTBAR IPC
+ * CONTROLLER STATE MANAGEMENT
  * ============================================================================ */
 
-void lightbar_read_ipc(controller_output_t* output) {
-    /* Don't read IPC in standby - we control the lightbar */
-    if (system_is_standby()) {
-        return;
+void controller_slot_state_update(int slot, const controller_state_t* state) {
+    controller_slot_t* s = &g_slots[slot];
+    controller_state_t published = *state;
+    
+    seqlatch_write_lock(&s->state_latch);
+    published.generation = s->state_generation + 1;
+    seqlatch_publish(&s->state_latch, s->state_copies, &published, sizeof(published));
+    __atomic_store_n(&s->state_generation, published.generation, __ATOMIC_RELEASE);
+    seqlatch_write_unlock(&s->state_latch);
+    
+    /* Live view for the control plane - no syscalls */
+    control_publish_state(slot, &published);
+    
+    /* Wake waiting consumers - eventfd writes never block */
+    subscribers_notify(s->subscribers, &s->subscriber_count, &s->subscribers_notifying);
+}
+
+int controller_slot_state_subscribe(int slot) {
+    controller_slot_t* s = &g_slots[slot];
+    
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("[State] eventfd: %s\n", strerror(errno));
+        return -1;
     }
     
-    FILE* f = fopen(LIGHTBAR_IPC_PATH, "r");
-    if (!f) return;
+    pthread_mutex_lock(&g_state_subscriber_mutex);
+    int count = s->subscriber_count;
+    if (count >= CONTROLLER_STATE_MAX_SUBSCRIBERS) {
+        pthread_mutex_unlock(&g_state_subscriber_mutex);
+        LOG_ERROR("[State] Error: Subscriber table full (slot %d)\n", slot);
+        close(fd);
+        return -1;
+    }
+    __atomic_store_n(&s->subscribers[count], fd, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->subscriber_count, count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_state_subscriber_mutex);
     
-    char buf[256];
-    if (fgets(buf, sizeof(buf), f)) {
-        /* Simple JSON parsing */
-        const char* ptr;
-        
-        ptr = strstr(buf, "\"r\":");
-        if (ptr) output->led_r = (uint8_t)atoi(ptr + 4);
-        
-        ptr = strstr(buf, "\"g\":");
-        if (ptr) output->led_g = (uint8_t)atoi(ptr + 4);
-        
-        ptr = strstr(buf, "\"b\":");
-        if (ptr) output->led_b = (uint8_t)atoi(ptr + 4);
-        
-        ptr = strstr(buf, "\"player_leds\":");
-        if (ptr) output->player_leds = (uint8_t)atoi(ptr + 14);
-        
-        ptr = strstr(buf, "\"player_led_brightness\":");
-        if (ptr) {
-            float brightness = atof(ptr + 24);
-            output->player_brightness = (uint8_t)(brightness * 255);
-        }
+    return fd;
+}
+
+void controller_slot_state_unsubscribe(int slot, int fd) {
+    if (fd < 0) return;
+    controller_slot_t* s = &g_slots[slot];
+    
+    pthread_mutex_lock(&g_state_subscriber_mutex);
+    int ret = subscribers_remove(s->subscribers, &s->subscriber_count,
+                                 &s->subscribers_notifying, fd);
+    pthread_mutex_unlock(&g_state_subscriber_mutex);
+    if (ret < 0) LOG_WARN("[State] Warning: fd %d was not subscribed (slot %d)\n", fd, slot);
+}
+
+uint32_t controller_slot_state_generation(int slot) {
+    return __atomic_load_n(&g_slots[slot].state_generation, __ATOMIC_ACQUIRE);
+}
+
+void controller_slot_state_copy(int slot, controller_state_t* out_state) {
+    controller_slot_t* s = &g_slots[slot];
+    seqlatch_read(&s->state_latch, s->state_copies, out_state, sizeof(*out_state));
+}
+
+void controller_state_update(const controller_state_t* state) {
+    controller_slot_state_update(0, state);
+}
+
+int controller_state_subscribe(void) {
+    return controller_slot_state_subscribe(0);
+}
+
+void controller_state_unsubscribe(int fd) {
+    controller_slot_state_unsubscribe(0, fd);
+}
+
+uint32_t controller_state_generation(void) {
+    return controller_slot_state_generation(0);
+}
+
+void controller_state_copy(controller_state_t* out_state) {
+    controller_slot_state_copy(0, out_state);
+}
+
+/* ============================================================================
+ * OUTPUT STATE MANAGEMENT
+ * ============================================================================ */
+
+/* Caller holds the write lock - both copies are stable and identical */
+static void output_publish_locked(controller_slot_t* s, const controller_output_t* output) {
+    if (memcmp(&s->output_copies[0], output, sizeof(*output)) != 0) {
+        seqlatch_publish(&s->output_latch, s->output_copies, output, sizeof(*output));
+        output_notify(s);
+        control_publish_output((int)(s - g_slots), output);
     }
-    fclose(f);
+}
+
+static void output_modify_begin(int slot, controller_output_t* output) {
+    controller_slot_t* s = &g_slots[slot];
+    seqlatch_write_lock(&s->output_latch);
+    *output = s->output_copies[0];
+}
+
+static void output_modify_end(int slot, const controller_output_t* output) {
+    controller_slot_t* s = &g_slots[slot];
+    output_publish_locked(s, output);
+    seqlatch_write_unlock(&s->output_latch);
+}
+
+void controller_slot_output_update(int slot, const controller_output_t* output) {
+    controller_slot_t* s = &g_slots[slot];
+    seqlatch_write_lock(&s->output_latch);
+    output_publish_locked(s, output);
+    seqlatch_write_unlock(&s->output_latch);
+}
+
+void controller_slot_output_copy(int slot, controller_output_t* out_output) {
+    controller_slot_t* s = &g_slots[slot];
+    seqlatch_read(&s->output_latch, s->output_copies, out_output, sizeof(*out_output));
+}
+
+void controller_output_update(const controller_output_t* output) {
+    controller_slot_output_update(0, output);
+}
+
+void controller_output_copy(controller_output_t* out_output) {
+    controller_slot_output_copy(0, out_output);
 }
 
 /* ============================================================================
  * CONTROLLER OUTPUT THREAD
  * ============================================================================ */
 
-/* Forward declaration - set by controller driver when connected */
-static int g_controller_fd = -1;
-static const controller_driver_t* g_active_driver = NULL;
-
-void controller_set_active(int fd, const controller_driver_t* driver) {
-    g_controller_fd = fd;
-    g_active_driver = driver;
+static int output_differs(const controller_output_t* a, const controller_output_t* b) {
+    return a->rumble_left != b->rumble_left ||
+           a->rumble_right != b->rumble_right ||
+           a->led_r != b->led_r ||
+           a->led_g != b->led_g ||
+           a->led_b != b->led_b ||
+           a->player_leds != b->player_leds;
 }
 
-void controller_clear_active(void) {
-    g_controller_fd = -1;
-    g_active_driver = NULL;
+/* Send one slot's output if it moved; returns 0 on success or nothing to do */
+static int output_send_slot(int slot, uint32_t* last_attach,
+                            controller_output_t* last_output, int* consecutive_failures) {
+    controller_slot_t* s = &g_slots[slot];
+    
+    /* Get current output state */
+    controller_output_t output;
+    controller_slot_output_copy(slot, &output);
+    
+    /* Held across send_output() so detach waits for us */
+    pthread_mutex_lock(&s->device_lock);
+    controller_device_t* dev = s->device;
+    
+    /*
+     * A newly bound pad gets the full state once. Keyed on the attach
+     * generation, not the pointer: a pad reconnecting on the same slot
+     * comes back with the same controller_device_t.
+     */
+    if (dev && s->attach_generation != *last_attach) {
+        memset(last_output, 0, sizeof(*last_output));
+        last_output->led_r = ~output.led_r;
+        *last_attach = s->attach_generation;
+    }
+    
+    int ret = 0;
+    if (dev && output_differs(&output, last_output)) {
+        ret = dev->driver->send_output ? dev->driver->send_output(dev, &output) : 0;
+        if (ret < 0) {
+            metrics_inc(METRIC_OUTPUT_FAILURES);
+            (*consecutive_failures)++;
+            /* Only log after several failures to reduce noise */
+            if (*consecutive_failures == 5) {
+                LOG_WARN("[Output] Warning: Multiple output send failures (slot %d)\n", slot);
+            }
+            /* Don't update last_output so we retry */
+        } else {
+            if (*consecutive_failures >= 5) {
+                LOG_INFO("[Output] Output send recovered (slot %d)\n", slot);
+            }
+            metrics_inc(METRIC_OUTPUT_REPORTS);
+            *consecutive_failures = 0;
+            *last_output = output;
+        }
+    }
+    pthread_mutex_unlock(&s->device_lock);
+    return ret;
 }
 
 void* controller_output_thread(void* arg) {
     (void)arg;
     
-    printf("[Output] Controller output thread started\n");
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+        LOG_ERROR("[Output] eventfd: %s\n", strerror(errno));
+        return NULL;
+    }
+    __atomic_store_n(&g_output_event_fd, event_fd, __ATOMIC_RELEASE);
+    
+    LOG_INFO("[Output] Controller output thread started\n");
     
-    controller_output_t last_output = {0};
-    int ipc_counter = 0;
-    int consecutive_failures = 0;
+    /* Per slot: what the bound device last accepted, and send pacing */
+    controller_output_t last_output[MAX_CONTROLLER_SLOTS] = {{0}};
+    uint32_t last_attach[MAX_CONTROLLER_SLOTS] = {0};   /* 0 = never sent */
+    int consecutive_failures[MAX_CONTROLLER_SLOTS] = {0};
+    uint64_t dirty_since_ns[MAX_CONTROLLER_SLOTS] = {0};    /* 0 = clean */
+    uint64_t last_send_ns[MAX_CONTROLLER_SLOTS] = {0};
     
     while (g_running) {
-        /* Check for lightbar IPC updates every ~500ms */
-        if (++ipc_counter >= 50) {
-            ipc_counter = 0;
-            
-            controller_output_t output;
-            controller_output_copy(&output);
-            lightbar_read_ipc(&output);
-            controller_output_update(&output);
-        }
-        
-        /* Get current output state */
-        controller_output_t output;
-        controller_output_copy(&output);
+        uint64_t now_ns = time_get_ns();
         
-        /* Check if anything changed */
-        int changed = (
-            output.rumble_left != last_output.rumble_left ||
-            output.rumble_right != last_output.rumble_right ||
-            output.led_r != last_output.led_r ||
-            output.led_g != last_output.led_g ||
-            output.led_b != last_output.led_b ||
-            output.player_leds != last_output.player_leds
-        );
+        /*
+         * A change opens a short coalescing window so a burst of rumble
+         * updates becomes one report, and sends to a pad are spaced at
+         * least OUTPUT_MIN_SPACING_US apart to keep its BT link clear.
+         */
+        uint64_t wake_ns = UINT64_MAX;
         
-        /* Send output if changed and we have an active controller */
-        if (changed && g_active_driver && g_controller_fd >= 0) {
-            if (g_active_driver->send_output) {
-                int ret = g_active_driver->send_output(g_controller_fd, &output);
-                if (ret < 0) {
-                    consecutive_failures++;
-                    /* Only log after several failures to reduce noise */
-                    if (consecutive_failures == 5) {
-                        printf("[Output] Warning: Multiple output send failures\n");
-                    }
-                    /* Don't update last_output so we retry */
+        for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+            controller_slot_t* s = &g_slots[slot];
+            
+            if (__atomic_exchange_n(&s->output_changed, 0, __ATOMIC_ACQ_REL) &&
+                dirty_since_ns[slot] == 0) {
+                dirty_since_ns[slot] = now_ns;
+            }
+            if (dirty_since_ns[slot] == 0) continue;
+            
+            /* Cheap skip for empty slots - no lock */
+            if (!__atomic_load_n(&s->device, __ATOMIC_ACQUIRE)) {
+                dirty_since_ns[slot] = 0;
+                continue;
+            }
+            
+            uint64_t due_ns = dirty_since_ns[slot] + OUTPUT_COALESCE_US * 1000ULL;
+            uint64_t spaced_ns = last_send_ns[slot] + OUTPUT_MIN_SPACING_US * 1000ULL;
+            if (spaced_ns > due_ns) due_ns = spaced_ns;
+            
+            if (now_ns >= due_ns) {
+                if (output_send_slot(slot, &last_attach[slot], &last_output[slot],
+                                     &consecutive_failures[slot]) < 0) {
+                    /* Retry once the spacing allows */
+                    dirty_since_ns[slot] = now_ns;
                 } else {
-                    if (consecutive_failures >= 5) {
-                        printf("[Output] Output send recovered\n");
-                    }
-                    consecutive_failures = 0;
-                    last_output = output;
+                    dirty_since_ns[slot] = 0;
                 }
-            } else {
-                last_output = output;
+                last_send_ns[slot] = now_ns;
+                due_ns = now_ns + OUTPUT_MIN_SPACING_US * 1000ULL;
+                if (dirty_since_ns[slot] == 0) continue;
             }
+            
+            if (due_ns < wake_ns) wake_ns = due_ns;
         }
         
-        usleep(10000);  /* 100Hz */
+        /* Sleep until a writer signals, the next deadline, or shutdown */
+        struct timespec timeout;
+        const struct timespec* timeout_ptr = NULL;
+        if (wake_ns != UINT64_MAX) {
+            now_ns = time_get_ns();
+            uint64_t wait_ns = (wake_ns > now_ns) ? wake_ns - now_ns : 0;
+            timeout.tv_sec = (time_t)(wait_ns / 1000000000ULL);
+            timeout.tv_nsec = (long)(wait_ns % 1000000000ULL);
+            timeout_ptr = &timeout;
+        }
+        struct pollfd pfd = {.fd = event_fd, .events = POLLIN};
+        if (ppoll(&pfd, 1, timeout_ptr, NULL) > 0) {
+            uint64_t count;
+            ssize_t ret = read(event_fd, &count, sizeof(count));
+            (void)ret;
+        }
     }
     
-    printf("[Output] Controller output thread exiting\n");
+    __atomic_store_n(&g_output_event_fd, -1, __ATOMIC_RELEASE);
+    close(event_fd);
+    
+    LOG_INFO("[Output] Controller output thread exiting\n");
     return NULL;
 }
 
@@ -347,17 +682,28 @@ volatile int g_touchpad_as_right_stick = 1;  /* Enabled by default */
  * ============================================================================ */
 
 void debug_print_hex(const char* label, const uint8_t* data, size_t len) {
-    printf("%s (%zu bytes):\n  ", label, len);
-    for (size_t i = 0; i < len && i < 64; i++) {
-        printf("%02x ", data[i]);
-        if ((i + 1) % 16 == 0 && i + 1 < len) printf("\n  ");
+    if (LOG_LEVEL < LOG_LEVEL_DEBUG) return;
+    
+    LOG_DEBUG("%s (%zu bytes):\n", label, len);
+    
+    /* One record per row of 16, formatted here so the drain copies a string */
+    for (size_t row = 0; row < len && row < 64; row += 16) {
+        char line[16 * 3 + 1];
+        size_t n = 0;
+        for (size_t i = row; i < len && i < row + 16 && i < 64; i++) {
+            n += (size_t)snprintf(line + n, sizeof(line) - n, "%02x ", data[i]);
+        }
+        line[n] = '\0';
+        LOG_DEBUG("  %s\n", line);
     }
-    printf("\n");
-    fflush(stdout);
 }
 
 uint64_t time_get_ms(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000;
+    return time_get_ns() / 1000000ULL;
+}
+
+uint64_t time_get_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+ * RosettaPad - Control Plane
+ * ===========================
+ *
+ * mmap'd /dev/shm region plus a unix datagram socket for change pings.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "core/control.h"
+#include "core/log.h"
+
+static control_region_t* g_control = NULL;
+static int g_control_sock = -1;
+static event_loop_t* g_control_loop = NULL;
+
+/* Last config generation applied (for logging) */
+static uint32_t g_applied_generation = 0;
+
+/* ============================================================================
+ * REGION SETUP
+ * ============================================================================ */
+
+static void region_reset(control_region_t* r) {
+    memset(r, 0, sizeof(*r));
+    
+    control_config_t cfg = {0};
+    cfg.generation = 1;
+    cfg.lightbar.player_brightness = 255;
+    cfg.input.touchpad_as_right_stick = (uint8_t)g_touchpad_as_right_stick;
+    remap_config_default(&cfg.remap);
+    motion_mapping_default(&cfg.motion);
+    r->config_copies[0] = cfg;
+    r->config_copies[1] = cfg;
+    
+    r->size = sizeof(*r);
+    r->version = CONTROL_VERSION;
+    
+    /* Magic last - clients treat the region as valid from here on */
+    __atomic_store_n(&r->magic, CONTROL_MAGIC, __ATOMIC_RELEASE);
+}
+
+static int region_valid(const control_region_t* r) {
+    return r->magic == CONTROL_MAGIC && r->version == CONTROL_VERSION &&
+           r->size == sizeof(*r);
+}
+
+static int socket_open(void) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("[Control] socket: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", CONTROL_SOCKET_PATH);
+    unlink(CONTROL_SOCKET_PATH);
+    
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LOG_ERROR("[Control] bind: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    chmod(CONTROL_SOCKET_PATH, 0660);
+    return fd;
+}
+
+int control_init(void) {
+    int fd = open(CONTROL_SHM_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+    if (fd < 0) {
+        LOG_ERROR("[Control] open " CONTROL_SHM_PATH ": %s\n", strerror(errno));
+        return -1;
+    }
+    
+    struct stat st;
+    int fresh = (fstat(fd, &st) < 0 || st.st_size != (off_t)sizeof(control_region_t));
+    if (fresh && ftruncate(fd, sizeof(control_region_t)) < 0) {
+        LOG_ERROR("[Control] ftruncate: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    void* mem = mmap(NULL, sizeof(control_region_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        LOG_ERROR("[Control] mmap: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    control_region_t* r = mem;
+    if (fresh || !region_valid(r)) {
+        region_reset(r);
+        LOG_INFO("[Control] Created %s (v%d, %zu bytes)\n", CONTROL_SHM_PATH,
+                 CONTROL_VERSION, sizeof(*r));
+    } else {
+        /* Keep the clients' config, drop the previous run's live state */
+        memset(r->slots, 0, sizeof(r->slots));
+        LOG_INFO("[Control] Reusing config in %s\n", CONTROL_SHM_PATH);
+    }
+    r->adapter_pid = (uint32_t)getpid();
+    
+    g_control_sock = socket_open();
+    __atomic_store_n(&g_control, r, __ATOMIC_RELEASE);
+    
+    control_apply();
+    return 0;
+}
+
+void control_close(void) {
+    control_region_t* r = __atomic_exchange_n(&g_control, NULL, __ATOMIC_ACQ_REL);
+    
+    if (g_control_sock >= 0) {
+        close(g_control_sock);
+        g_control_sock = -1;
+        unlink(CONTROL_SOCKET_PATH);
+    }
+    /* Left mapped - other threads may still publish until exit */
+    if (r) {
+        r->adapter_pid = 0;
+    }
+}
+
+/* ============================================================================
+ * CONFIG
+ * ============================================================================ */
+
+void control_apply(void) {
+    control_region_t* r = __atomic_load_n(&g_control, __ATOMIC_ACQUIRE);
+    if (!r) return;
+    
+    control_config_t cfg;
+    seqlatch_read(&r->config_latch, r->config_copies, &cfg, sizeof(cfg));
+    
+    if (__atomic_exchange_n(&g_applied_generation, cfg.generation, __ATOMIC_RELAXED) !=
+        cfg.generation) {
+        LOG_INFO("[Control] Applying config generation %u\n", cfg.generation);
+        
+        /* A rejected profile leaves the previous one active */
+        if (remap_load(&cfg.remap) < 0) {
+            LOG_WARN("[Control] Warning: Remap profile rejected\n");
+        }
+        if (motion_set_mapping(&cfg.motion) < 0) {
+            LOG_WARN("[Control] Warning: Motion mapping rejected\n");
+        }
+    }
+    
+    g_touchpad_as_right_stick = cfg.input.touchpad_as_right_stick ? 1 : 0;
+    
+    /* Standby owns the lightbar (dim amber) */
+    if (system_is_standby()) return;
+    
+    if (cfg.lightbar.enabled || cfg.lightbar.player_leds_enabled) {
+        controller_output_t output;
+        controller_output_copy(&output);
+        if (cfg.lightbar.enabled) {
+            output.led_r = cfg.lightbar.r;
+            output.led_g = cfg.lightbar.g;
+            output.led_b = cfg.lightbar.b;
+        }
+        if (cfg.lightbar.player_leds_enabled) {
+            output.player_leds = cfg.lightbar.player_leds & 0x1F;
+            output.player_brightness = cfg.lightbar.player_brightness;
+        }
+        controller_output_update(&output);
+    }
+}
+
+static void on_control_ping(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    
+    /* Any datagram means "config changed" - drain and apply once */
+    char buf[64];
+    while (recv(fd, buf, sizeof(buf), 0) >= 0) {
+    }
+    control_apply();
+}
+
+int control_attach(event_loop_t* loop) {
+    if (g_control_sock < 0) return -1;
+    if (event_loop_add(loop, g_control_sock, EPOLLIN, on_control_ping, NULL) < 0) {
+        return -1;
+    }
+    g_control_loop = loop;
+    return 0;
+}
+
+void control_detach(void) {
+    if (g_control_loop && g_control_sock >= 0) {
+        event_loop_remove(g_control_loop, g_control_sock);
+    }
+    g_control_loop = NULL;
+}
+
+/* ============================================================================
+ * STATUS
+ * ============================================================================ */
+
+void control_publish_state(int slot, const controller_state_t* state) {
+    control_region_t* r = __atomic_load_n(&g_control, __ATOMIC_ACQUIRE);
+    if (!r) return;
+    
+    control_slot_status_t* s = &r->slots[slot];
+    seqlatch_write(&s->state_latch, s->state_copies, state, sizeof(*state));
+}
+
+void control_publish_output(int slot, const controller_output_t* output) {
+    control_region_t* r = __atomic_load_n(&g_control, __ATOMIC_ACQUIRE);
+    if (!r) return;
+    
+    control_slot_status_t* s = &r->slots[slot];
+    seqlatch_write(&s->output_latch, s->output_copies, output, sizeof(*output));
+}
+
+void control_publish_connected(int slot, int connected) {
+    control_region_t* r = __atomic_load_n(&g_control, __ATOMIC_ACQUIRE);
+    if (!r) return;
+    __atomic_store_n(&r->slots[slot].connected, (uint32_t)connected, __ATOMIC_RELEASE);
+}
+
+void control_publish_system_state(system_state_t state) {
+    control_region_t* r = __atomic_load_n(&g_control, __ATOMIC_ACQUIRE);
+    if (!r) return;
+    __atomic_store_n(&r->system_state, (uint32_t)state, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,121 @@
+/*
+ * RosettaPad - CRC32
+ * ===================
+ *
+ * Bytewise, slice-by-8 and ARMv8 hardware CRC32 with runtime dispatch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "core/crc32.h"
+#include "rosetta_core/crc32.h"
+
+/* ============================================================================
+ * IMPLEMENTATIONS
+ *
+ * The table walks are librosetta_core's (rosetta_core/crc32.h) over one
+ * shared set of tables. All operate on the non-inverted register;
+ * crc32_update() handles the initial/final XOR.
+ * ============================================================================ */
+
+static rc_crc32_t g_crc32_tables;
+
+static uint32_t crc32_bytewise(uint32_t crc, const uint8_t* data, size_t len) {
+    return ~rc_crc32_update_bytewise(&g_crc32_tables, ~crc, data, len);
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t* data, size_t len) {
+    return ~rc_crc32_update(&g_crc32_tables, ~crc, data, len);
+}
+
+#if defined(__aarch64__)
+
+__attribute__((target("+crc")))
+static uint32_t crc32_hw(uint32_t crc, const uint8_t* data, size_t len) {
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));  /* Unaligned-safe, little endian */
+        crc = __crc32d(crc, word);
+        data += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *data++);
+    }
+    return crc;
+}
+
+static int hw_crc_supported(void) {
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#else
+
+/* No hardware path on this architecture */
+#define crc32_hw crc32_slice8
+
+static int hw_crc_supported(void) {
+    return 0;
+}
+
+#endif
+
+/* ============================================================================
+ * DISPATCH
+ * ============================================================================ */
+
+typedef uint32_t (*crc32_fn)(uint32_t crc, const uint8_t* data, size_t len);
+
+static const crc32_fn crc32_impls[CRC32_IMPL_COUNT] = {
+    crc32_bytewise,
+    crc32_slice8,
+    crc32_hw
+};
+
+static const char* crc32_impl_names[CRC32_IMPL_COUNT] = {
+    "bytewise",
+    "slice8",
+    "hw"
+};
+
+static crc32_impl_t g_crc32_impl = CRC32_IMPL_SLICE8;
+static int g_crc32_initialized = 0;
+
+void crc32_init(void) {
+    if (g_crc32_initialized) return;
+    
+    rc_crc32_init(&g_crc32_tables);
+    g_crc32_impl = hw_crc_supported() ? CRC32_IMPL_HW : CRC32_IMPL_SLICE8;
+    g_crc32_initialized = 1;
+    
+    printf("[CRC32] Using %s implementation\n", crc32_impl_names[g_crc32_impl]);
+}
+
+int crc32_impl_available(crc32_impl_t impl) {
+    if (impl == CRC32_IMPL_HW) return hw_crc_supported();
+    return impl < CRC32_IMPL_COUNT;
+}
+
+const char* crc32_impl_name(crc32_impl_t impl) {
+    return (impl < CRC32_IMPL_COUNT) ? crc32_impl_names[impl] : "unknown";
+}
+
+crc32_impl_t crc32_active_impl(void) {
+    return g_crc32_impl;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
+    return ~crc32_impls[g_crc32_impl](~crc, data, len);
+}
+
+uint32_t crc32_update_with(crc32_impl_t impl, uint32_t crc, const uint8_t* data, size_t len) {
+    if (!crc32_impl_available(impl)) impl = CRC32_IMPL_SLICE8;
+    return ~crc32_impls[impl](~crc, data, len);
+}
@@ -0,0 +1,177 @@
+/*
+ * RosettaPad - Event Loop
+ * ========================
+ *
+ * epoll-based fd dispatch.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "core/event_loop.h"
+#include "core/log.h"
+
+int event_loop_init(event_loop_t* loop) {
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        LOG_ERROR("[Event] epoll_create1: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < EVENT_LOOP_MAX_HANDLERS; i++) {
+        loop->handlers[i].fd = -1;
+        loop->handlers[i].fn = NULL;
+        loop->handlers[i].ctx = NULL;
+        loop->handlers[i].generation = 0;
+    }
+    return 0;
+}
+
+void event_loop_close(event_loop_t* loop) {
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+        loop->epoll_fd = -1;
+    }
+}
+
+/*
+ * epoll data carries the slot index and its generation, not a pointer: a
+ * slot freed and reused within one batch would otherwise receive the old
+ * fd's still-queued events.
+ */
+static uint64_t handler_tag(const event_loop_t* loop, const event_handler_t* h) {
+    return (uint64_t)h->generation << 32 | (uint64_t)(h - loop->handlers);
+}
+
+static event_handler_t* find_handler(event_loop_t* loop, int fd) {
+    for (int i = 0; i < EVENT_LOOP_MAX_HANDLERS; i++) {
+        if (loop->handlers[i].fd == fd) return &loop->handlers[i];
+    }
+    return NULL;
+}
+
+int event_loop_add(event_loop_t* loop, int fd, uint32_t events,
+                   event_handler_fn fn, void* ctx) {
+    event_handler_t* h = find_handler(loop, -1);
+    if (!h) {
+        LOG_ERROR("[Event] Error: Handler table full\n");
+        return -1;
+    }
+
+    struct epoll_event ev = {.events = events, .data.u64 = handler_tag(loop, h)};
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        LOG_ERROR("[Event] epoll_ctl ADD: %s\n", strerror(errno));
+        return -1;
+    }
+
+    h->fd = fd;
+    h->fn = fn;
+    h->ctx = ctx;
+    return 0;
+}
+
+int event_loop_modify(event_loop_t* loop, int fd, uint32_t events) {
+    event_handler_t* h = find_handler(loop, fd);
+    if (!h) return -1;
+
+    struct epoll_event ev = {.events = events, .data.u64 = handler_tag(loop, h)};
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+int event_loop_remove(event_loop_t* loop, int fd) {
+    event_handler_t* h = find_handler(loop, fd);
+    if (!h) return -1;
+
+    /* fd may already be closed - the handler slot is what matters */
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    /* Pending events for this slot no longer match its generation */
+    h->fd = -1;
+    h->fn = NULL;
+    h->ctx = NULL;
+    h->generation++;
+    return 0;
+}
+
+int event_loop_run_once(event_loop_t* loop, int timeout_ms) {
+    struct epoll_event events[EVENT_LOOP_MAX_HANDLERS];
+
+    int n = epoll_wait(loop->epoll_fd, events, EVENT_LOOP_MAX_HANDLERS, timeout_ms);
+    if (n < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        uint64_t tag = events[i].data.u64;
+        event_handler_t* h = &loop->handlers[(uint32_t)tag];
+        /* Removed earlier in this batch, possibly re-added for another fd */
+        if (h->generation != (uint32_t)(tag >> 32) || h->fd < 0 || !h->fn) continue;
+        h->fn(h->fd, events[i].events, h->ctx);
+    }
+
+    return n;
+}
+
+/* ============================================================================
+ * TIMERS AND SIGNALS
+ * ============================================================================ */
+
+int event_timer_create(void) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) LOG_ERROR("[Event] timerfd_create: %s\n", strerror(errno));
+    return fd;
+}
+
+static struct timespec ns_to_timespec(uint64_t ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(ns / 1000000000ULL),
+        .tv_nsec = (long)(ns % 1000000000ULL)
+    };
+    return ts;
+}
+
+int event_timer_arm(int fd, uint64_t delay_ns, uint64_t interval_ns) {
+    struct itimerspec its = {
+        .it_value = ns_to_timespec(delay_ns),
+        .it_interval = ns_to_timespec(interval_ns)
+    };
+    return timerfd_settime(fd, 0, &its, NULL);
+}
+
+int event_timer_arm_at(int fd, uint64_t deadline_ns) {
+    /* 0 would disarm - the earliest real deadline still fires at once */
+    if (deadline_ns == 0) deadline_ns = 1;
+    struct itimerspec its = {.it_value = ns_to_timespec(deadline_ns)};
+    return timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+int event_signal_open(const int* signals, int count) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int i = 0; i < count; i++) {
+        sigaddset(&mask, signals[i]);
+    }
+    sigset_t old_mask;
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        int err = errno;
+        /* Nobody would read them - let the default handlers fire again */
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+        LOG_ERROR("[Event] signalfd: %s\n", strerror(err));
+    }
+    return fd;
+}
+
+uint64_t event_fd_drain(int fd) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) return 0;
+    return count;
+}
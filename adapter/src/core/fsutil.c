@@ -0,0 +1,93 @@
+/*
+ * RosettaPad - Filesystem Helpers
+ * ================================
+ *
+ * open/write, mkdirat and symlinkat wrappers for sysfs and configfs.
+ */
+
+#define _GNU_SOURCE     /* O_PATH */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+#include "core/fsutil.h"
+
+int fs_write_attr(const char* path, const char* value) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    size_t len = strlen(value);
+    ssize_t written = write(fd, value, len);
+    int saved_errno = errno;
+    close(fd);
+    
+    if (written != (ssize_t)len) {
+        errno = (written < 0) ? saved_errno : EIO;
+        return -1;
+    }
+    return 0;
+}
+
+int fs_read_attr(const char* path, char* buf, size_t len) {
+    if (len == 0) return -1;
+    
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    
+    ssize_t n = read(fd, buf, len - 1);
+    close(fd);
+    if (n < 0) return -1;
+    
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) n--;
+    buf[n] = '\0';
+    return (int)n;
+}
+
+int fs_mkdir_p(const char* path, mode_t mode) {
+    char buf[256];
+    if (snprintf(buf, sizeof(buf), "%s", path) >= (int)sizeof(buf)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    
+    /* Walk one component at a time relative to its parent's fd */
+    int dirfd = open(buf[0] == '/' ? "/" : ".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) return -1;
+    
+    char* save = NULL;
+    for (char* name = strtok_r(buf, "/", &save); name; name = strtok_r(NULL, "/", &save)) {
+        if (mkdirat(dirfd, name, mode) < 0 && errno != EEXIST) {
+            close(dirfd);
+            return -1;
+        }
+        
+        int next = openat(dirfd, name, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        close(dirfd);
+        if (next < 0) return -1;
+        dirfd = next;
+    }
+    
+    close(dirfd);
+    return 0;
+}
+
+int fs_symlink(const char* target, const char* linkpath) {
+    if (symlinkat(target, AT_FDCWD, linkpath) == 0) return 0;
+    
+    struct stat st;
+    if (errno == EEXIST && lstat(linkpath, &st) == 0 && S_ISLNK(st.st_mode)) {
+        return 0;
+    }
+    return -1;
+}
+
+int fs_is_mounted(const char* path, unsigned long fs_magic) {
+    struct statfs sfs;
+    if (statfs(path, &sfs) < 0) return 0;
+    return (unsigned long)sfs.f_type == fs_magic;
+}
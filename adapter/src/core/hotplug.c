@@ -0,0 +1,128 @@
+/*
+ * RosettaPad - Hotplug Monitor
+ * =============================
+ *
+ * Kernel uevent parsing for hidraw add/remove.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/sysmacros.h>
+#include <linux/netlink.h>
+
+#include "core/hotplug.h"
+#include "core/log.h"
+
+#define UEVENT_BUFFER_SIZE  4096
+#define UEVENT_RCVBUF_SIZE  (128 * 1024)    /* Bursts when a BT stack resets */
+
+int hotplug_open(void) {
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        LOG_ERROR("[Hotplug] socket: %s\n", strerror(errno));
+        return -1;
+    }
+    
+    int rcvbuf = UEVENT_RCVBUF_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_pid = 0,
+        .nl_groups = 1      /* Kernel uevents (udev rebroadcasts on group 2) */
+    };
+    
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LOG_ERROR("[Hotplug] bind: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    
+    LOG_INFO("[Hotplug] Listening for hidraw uevents\n");
+    return fd;
+}
+
+/* Find "BBBB:VVVV:PPPP.IIII" in DEVPATH - the parent HID device */
+static int parse_hid_ids(const char* devpath, uint16_t* vid, uint16_t* pid) {
+    const char* p = devpath;
+    while ((p = strchr(p, '/')) != NULL) {
+        p++;
+        unsigned int bus, v, d, inst;
+        char tail;
+        if (sscanf(p, "%4x:%4x:%4x.%4x%c", &bus, &v, &d, &inst, &tail) == 5 && tail == '/') {
+            *vid = (uint16_t)v;
+            *pid = (uint16_t)d;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int hotplug_read(int fd, hotplug_event_t* out_event) {
+    char buf[UEVENT_BUFFER_SIZE];
+    struct sockaddr_nl src;
+    struct iovec iov = {.iov_base = buf, .iov_len = sizeof(buf) - 1};
+    struct msghdr msg = {
+        .msg_name = &src,
+        .msg_namelen = sizeof(src),
+        .msg_iov = &iov,
+        .msg_iovlen = 1
+    };
+    
+    ssize_t len = recvmsg(fd, &msg, 0);
+    if (len < 0) {
+        if (errno == ENOBUFS) {
+            /* Dropped events - caller rescans to cover the gap */
+            LOG_WARN("[Hotplug] Warning: uevent queue overflow\n");
+            memset(out_event, 0, sizeof(*out_event));
+            out_event->action = HOTPLUG_RESYNC;
+            return 1;
+        }
+        return -1;
+    }
+    
+    /* Only trust messages from the kernel itself */
+    if (src.nl_pid != 0 || len == 0) return 0;
+    buf[len] = '\0';
+    
+    /* Payload: "action@devpath\0KEY=VALUE\0KEY=VALUE\0..." */
+    const char* action = NULL;
+    const char* subsystem = NULL;
+    const char* devname = NULL;
+    const char* devpath = NULL;
+    int major = -1, minor = -1;
+    
+    for (char* p = buf; p < buf + len; p += strlen(p) + 1) {
+        if (strncmp(p, "ACTION=", 7) == 0)         action = p + 7;
+        else if (strncmp(p, "SUBSYSTEM=", 10) == 0) subsystem = p + 10;
+        else if (strncmp(p, "DEVNAME=", 8) == 0)   devname = p + 8;
+        else if (strncmp(p, "DEVPATH=", 8) == 0)   devpath = p + 8;
+        else if (strncmp(p, "MAJOR=", 6) == 0)     major = atoi(p + 6);
+        else if (strncmp(p, "MINOR=", 6) == 0)     minor = atoi(p + 6);
+    }
+    
+    if (!action || !subsystem || !devname || strcmp(subsystem, "hidraw") != 0) {
+        return 0;
+    }
+    
+    if (strcmp(action, "add") == 0) {
+        out_event->action = HOTPLUG_ADD;
+    } else if (strcmp(action, "remove") == 0) {
+        out_event->action = HOTPLUG_REMOVE;
+    } else {
+        return 0;
+    }
+    
+    /* DEVNAME is relative to /dev */
+    snprintf(out_event->devnode, sizeof(out_event->devnode), "/dev/%s", devname);
+    out_event->devnum = (major >= 0 && minor >= 0) ? makedev(major, minor) : 0;
+    out_event->has_ids = devpath &&
+        parse_hid_ids(devpath, &out_event->vendor_id, &out_event->product_id) == 0;
+    
+    return 1;
+}
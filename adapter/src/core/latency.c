@@ -0,0 +1,186 @@
+/*
+ * RosettaPad - Input Latency Instrumentation
+ * ===========================================
+ *
+ * Log-linear histograms: 8 sub-buckets per power of two over 64ns units,
+ * giving ~12% resolution from 64ns up to several seconds.
+ */
+
+#include <stdio.h>
+
+#include "core/latency.h"
+
+/* ============================================================================
+ * HISTOGRAMS
+ * ============================================================================ */
+
+#define LATENCY_UNIT_SHIFT  6       /* 64ns base unit */
+#define LATENCY_SUB_BITS    3       /* 8 sub-buckets per power of two */
+#define LATENCY_BUCKETS     192
+
+typedef struct {
+    uint64_t buckets[LATENCY_BUCKETS];
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} latency_hist_t;
+
+static latency_hist_t g_latency[LATENCY_STAGE_COUNT];
+
+static const char* stage_names[LATENCY_STAGE_COUNT] = {
+    "parse",
+    "usb_handoff",
+    "usb_write",
+    "usb_total",
+    "usb_poll_phase",
+    "bt_handoff",
+    "bt_send",
+    "bt_total"
+};
+
+static int bucket_index(uint64_t ns) {
+    uint64_t v = ns >> LATENCY_UNIT_SHIFT;
+    if (v < (2u << LATENCY_SUB_BITS)) return (int)v;
+
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - LATENCY_SUB_BITS;
+    int index = (shift << LATENCY_SUB_BITS) + (int)(v >> shift);
+    return (index < LATENCY_BUCKETS) ? index : LATENCY_BUCKETS - 1;
+}
+
+/* Upper bound (inclusive) of a bucket in nanoseconds */
+static uint64_t bucket_upper_ns(int index) {
+    uint64_t v;
+    if (index < (2 << LATENCY_SUB_BITS)) {
+        v = (uint64_t)index;
+    } else {
+        int shift = (index >> LATENCY_SUB_BITS) - 1;
+        uint64_t top = (index & ((1 << LATENCY_SUB_BITS) - 1)) + (1 << LATENCY_SUB_BITS);
+        v = ((top + 1) << shift) - 1;
+    }
+    return ((v + 1) << LATENCY_UNIT_SHIFT) - 1;
+}
+
+void latency_record(latency_stage_t stage, uint64_t ns) {
+    if (stage >= LATENCY_STAGE_COUNT) return;
+    latency_hist_t* h = &g_latency[stage];
+
+    __atomic_fetch_add(&h->buckets[bucket_index(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, ns, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > max &&
+           !__atomic_compare_exchange_n(&h->max_ns, &max, ns, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        /* max reloaded by failed CAS */
+    }
+}
+
+void latency_record_span(latency_stage_t stage, uint64_t start_ns, uint64_t end_ns) {
+    if (start_ns == 0 || end_ns < start_ns) return;
+    latency_record(stage, end_ns - start_ns);
+}
+
+/* ============================================================================
+ * STATS OUTPUT
+ * ============================================================================ */
+
+static uint64_t percentile_ns(const uint64_t* buckets, uint64_t count, int pct) {
+    uint64_t target = (count * pct + 99) / 100;
+    uint64_t seen = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) return bucket_upper_ns(i);
+    }
+    return bucket_upper_ns(LATENCY_BUCKETS - 1);
+}
+
+int latency_write_stats(const char* path) {
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* f = fopen(tmp_path, "w");
+    if (!f) return -1;
+
+    fprintf(f, "# stage          samples    mean_us     p50_us     p99_us     max_us\n");
+
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) {
+        const latency_hist_t* h = &g_latency[s];
+
+        /* Snapshot buckets - concurrent updates may skew a sample or two */
+        uint64_t buckets[LATENCY_BUCKETS];
+        uint64_t count = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            buckets[i] = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+            count += buckets[i];
+        }
+
+        if (count == 0) {
+            fprintf(f, "%-14s %9d %10s %10s %10s %10s\n", stage_names[s], 0,
+                    "-", "-", "-", "-");
+            continue;
+        }
+
+        uint64_t sum = __atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+        
+        /* Bucket bounds are approximate - never report above the true max */
+        uint64_t p50 = percentile_ns(buckets, count, 50);
+        uint64_t p99 = percentile_ns(buckets, count, 99);
+        if (p50 > max) p50 = max;
+        if (p99 > max) p99 = max;
+
+        fprintf(f, "%-14s %9llu %10.1f %10.1f %10.1f %10.1f\n",
+                stage_names[s],
+                (unsigned long long)count,
+                (double)sum / count / 1000.0,
+                p50 / 1000.0,
+                p99 / 1000.0,
+                max / 1000.0);
+    }
+
+    fclose(f);
+    return rename(tmp_path, path);
+}
+
+/* ============================================================================
+ * PROMETHEUS EXPORT
+ * ============================================================================ */
+
+/* Published bucket bounds in microseconds */
+static const uint32_t prom_le_us[] = {
+    50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000, 50000, 100000
+};
+
+void latency_write_prometheus(FILE* f) {
+    fprintf(f, "# HELP rosettapad_latency_seconds Adapter-added input latency per stage\n");
+    fprintf(f, "# TYPE rosettapad_latency_seconds histogram\n");
+
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++) {
+        const latency_hist_t* h = &g_latency[s];
+        uint64_t buckets[LATENCY_BUCKETS];
+        uint64_t count = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            buckets[i] = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+            count += buckets[i];
+        }
+
+        /* Cumulative: every bucket that ends at or below the bound */
+        uint64_t seen = 0;
+        int i = 0;
+        for (size_t b = 0; b < sizeof(prom_le_us) / sizeof(prom_le_us[0]); b++) {
+            uint64_t le_ns = (uint64_t)prom_le_us[b] * 1000ULL;
+            while (i < LATENCY_BUCKETS && bucket_upper_ns(i) <= le_ns) {
+                seen += buckets[i++];
+            }
+            fprintf(f, "rosettapad_latency_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n",
+                    stage_names[s], prom_le_us[b] / 1e6, (unsigned long long)seen);
+        }
+        fprintf(f, "rosettapad_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+                stage_names[s], (unsigned long long)count);
+        fprintf(f, "rosettapad_latency_seconds_sum{stage=\"%s\"} %.9f\n", stage_names[s],
+                __atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED) / 1e9);
+        fprintf(f, "rosettapad_latency_seconds_count{stage=\"%s\"} %llu\n",
+                stage_names[s], (unsigned long long)count);
+    }
+}
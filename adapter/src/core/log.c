@@ -0,0 +1,537 @@
+/*
+ * RosettaPad - Asynchronous Logging
+ * ==================================
+ *
+ * Per-thread SPSC byte rings of binary records and the drain that
+ * formats them (see core/log.h).
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
+
+#include "core/log.h"
+#include "core/common.h"
+#include "core/metrics.h"
+
+/* ============================================================================
+ * RECORDS AND RINGS
+ *
+ * A record is a header, one 8-byte slot per argument and the copied
+ * strings. Records never wrap: one that doesn't fit before the end of
+ * the ring is preceded by a pad record covering the rest.
+ * ============================================================================ */
+
+#define LOG_PAD         0xFF        /* Record level: skip to the next lap */
+#define LOG_RING_MASK   (LOG_RING_SIZE - 1)
+
+typedef struct {
+    uint16_t size;                  /* Bytes, header included, multiple of 8 */
+    uint8_t level;
+    uint8_t nargs;
+    uint32_t reserved;
+    const char* fmt;
+    uint64_t time_ns;
+    uint64_t args[];                /* %s: offset of the copy from the record */
+} log_record_t;
+
+enum {
+    LOG_RING_FREE = 0,
+    LOG_RING_USED,                  /* Owned by a live thread */
+    LOG_RING_RETIRED                /* Owner exited - freed once drained */
+};
+
+typedef struct {
+    /* Producer */
+    uint32_t head __attribute__((aligned(64)));
+    uint32_t dropped;
+    /* Drain */
+    uint32_t tail __attribute__((aligned(64)));
+    uint32_t dropped_reported;
+    int state;
+    uint8_t data[LOG_RING_SIZE] __attribute__((aligned(8)));
+} log_ring_t;
+
+static log_ring_t g_rings[LOG_MAX_THREADS];
+static __thread log_ring_t* t_ring = NULL;
+static pthread_key_t g_ring_key;
+
+static int g_async = 0;             /* log_thread() running */
+static int g_stop = 0;
+static int g_pending = 0;           /* Drain already woken */
+static int g_wake_fd = -1;
+static uint32_t g_unowned_dropped = 0;
+static uint32_t g_unowned_reported = 0;
+static pthread_mutex_t g_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ring_release(void* opaque) {
+    log_ring_t* ring = opaque;
+    __atomic_store_n(&ring->state, LOG_RING_RETIRED, __ATOMIC_RELEASE);
+}
+
+static log_ring_t* thread_ring(void) {
+    if (t_ring) return t_ring;
+
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        int expected = LOG_RING_FREE;
+        if (__atomic_compare_exchange_n(&g_rings[i].state, &expected, LOG_RING_USED, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            t_ring = &g_rings[i];
+            pthread_setspecific(g_ring_key, t_ring);
+            return t_ring;
+        }
+    }
+    return NULL;
+}
+
+/* Space for size bytes at the ring's head, NULL if full */
+static uint8_t* ring_reserve(log_ring_t* ring, uint32_t size, uint32_t* head_out) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t off = head & LOG_RING_MASK;
+    uint32_t contiguous = LOG_RING_SIZE - off;
+    uint32_t need = size + (contiguous < size ? contiguous : 0);
+
+    if (need > LOG_RING_SIZE - (head - tail)) return NULL;
+
+    if (contiguous < size) {
+        log_record_t* pad = (log_record_t*)&ring->data[off];
+        pad->size = (uint16_t)contiguous;
+        pad->level = LOG_PAD;
+        head += contiguous;
+        off = 0;
+    }
+    *head_out = head;
+    return &ring->data[off];
+}
+
+static log_record_t* ring_peek(log_ring_t* ring) {
+    for (;;) {
+        uint32_t tail = ring->tail;
+        if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) return NULL;
+
+        log_record_t* rec = (log_record_t*)&ring->data[tail & LOG_RING_MASK];
+        if (rec->level != LOG_PAD) return rec;
+        __atomic_store_n(&ring->tail, tail + rec->size, __ATOMIC_RELEASE);
+    }
+}
+
+static void ring_pop(log_ring_t* ring, const log_record_t* rec) {
+    __atomic_store_n(&ring->tail, ring->tail + rec->size, __ATOMIC_RELEASE);
+}
+
+/* ============================================================================
+ * CONVERSIONS
+ *
+ * Capture and formatting walk the format string the same way, so each
+ * conversion finds its argument slot again.
+ * ============================================================================ */
+
+typedef enum {
+    LEN_NONE = 0, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_Z, LEN_J, LEN_T
+} log_len_t;
+
+typedef enum {
+    ARG_NONE = 0,       /* %% (or unsupported) - no argument */
+    ARG_INT,
+    ARG_UINT,
+    ARG_DOUBLE,
+    ARG_STR,
+    ARG_PTR
+} log_arg_class_t;
+
+typedef struct {
+    const char* start;  /* The '%' */
+    size_t len;         /* Through the conversion character */
+    int star_width;
+    int star_prec;
+    log_len_t length;
+    char conv;
+} log_spec_t;
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* Parse the conversion starting at '%', return what follows it */
+static const char* spec_parse(const char* p, log_spec_t* s) {
+    s->start = p++;
+    s->star_width = 0;
+    s->star_prec = 0;
+    s->length = LEN_NONE;
+
+    while (*p && strchr("-+ #0", *p)) p++;
+    if (*p == '*') {
+        s->star_width = 1;
+        p++;
+    } else {
+        while (is_digit(*p)) p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            s->star_prec = 1;
+            p++;
+        } else {
+            while (is_digit(*p)) p++;
+        }
+    }
+
+    switch (*p) {
+        case 'h':
+            s->length = (p[1] == 'h') ? LEN_HH : LEN_H;
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            s->length = (p[1] == 'l') ? LEN_LL : LEN_L;
+            p += (p[1] == 'l') ? 2 : 1;
+            break;
+        case 'z': s->length = LEN_Z; p++; break;
+        case 'j': s->length = LEN_J; p++; break;
+        case 't': s->length = LEN_T; p++; break;
+        default: break;
+    }
+
+    s->conv = *p;
+    if (*p) p++;
+    s->len = (size_t)(p - s->start);
+    return p;
+}
+
+static log_arg_class_t spec_class(const log_spec_t* s) {
+    switch (s->conv) {
+        case 'd': case 'i': case 'c':
+            return ARG_INT;
+        case 'u': case 'x': case 'X': case 'o':
+            return ARG_UINT;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            return ARG_DOUBLE;
+        case 's':
+            return ARG_STR;
+        case 'p':
+            return ARG_PTR;
+        default:
+            return ARG_NONE;
+    }
+}
+
+static uint64_t capture_int(va_list* ap, log_len_t length) {
+    switch (length) {
+        case LEN_L:  return (uint64_t)(int64_t)va_arg(*ap, long);
+        case LEN_LL: return (uint64_t)(int64_t)va_arg(*ap, long long);
+        case LEN_Z:  return (uint64_t)(int64_t)va_arg(*ap, ssize_t);
+        case LEN_J:  return (uint64_t)(int64_t)va_arg(*ap, intmax_t);
+        case LEN_T:  return (uint64_t)(int64_t)va_arg(*ap, ptrdiff_t);
+        default:     return (uint64_t)(int64_t)va_arg(*ap, int);
+    }
+}
+
+static uint64_t capture_uint(va_list* ap, log_len_t length) {
+    switch (length) {
+        case LEN_L:  return va_arg(*ap, unsigned long);
+        case LEN_LL: return va_arg(*ap, unsigned long long);
+        case LEN_Z:  return va_arg(*ap, size_t);
+        case LEN_J:  return va_arg(*ap, uintmax_t);
+        case LEN_T:  return (uint64_t)va_arg(*ap, ptrdiff_t);
+        default:     return va_arg(*ap, unsigned int);
+    }
+}
+
+/* One conversion into out; returns what snprintf returns */
+static int format_one(char* out, size_t size, const log_spec_t* s, const char* spec,
+                      int width, int prec, uint64_t v, const char* str) {
+#define LOG_EMIT(value) \
+    (s->star_width && s->star_prec ? snprintf(out, size, spec, width, prec, value) : \
+     s->star_width ? snprintf(out, size, spec, width, value) : \
+     s->star_prec ? snprintf(out, size, spec, prec, value) : \
+     snprintf(out, size, spec, value))
+
+    switch (spec_class(s)) {
+        case ARG_INT:
+            switch (s->length) {
+                case LEN_L:  return LOG_EMIT((long)v);
+                case LEN_LL: return LOG_EMIT((long long)v);
+                case LEN_Z:  return LOG_EMIT((ssize_t)v);
+                case LEN_J:  return LOG_EMIT((intmax_t)v);
+                case LEN_T:  return LOG_EMIT((ptrdiff_t)v);
+                default:     return LOG_EMIT((int)v);
+            }
+        case ARG_UINT:
+            switch (s->length) {
+                case LEN_L:  return LOG_EMIT((unsigned long)v);
+                case LEN_LL: return LOG_EMIT((unsigned long long)v);
+                case LEN_Z:  return LOG_EMIT((size_t)v);
+                case LEN_J:  return LOG_EMIT((uintmax_t)v);
+                case LEN_T:  return LOG_EMIT((ptrdiff_t)v);
+                default:     return LOG_EMIT((unsigned int)v);
+            }
+        case ARG_DOUBLE: {
+            double d;
+            memcpy(&d, &v, sizeof(d));
+            return LOG_EMIT(d);
+        }
+        case ARG_STR:
+            return LOG_EMIT(str);
+        case ARG_PTR:
+            return LOG_EMIT((void*)(uintptr_t)v);
+        default:
+            return snprintf(out, size, "%s", "%");
+    }
+#undef LOG_EMIT
+}
+
+static void format_record(const log_record_t* rec, char* out, size_t size) {
+    const char* p = rec->fmt;
+    size_t len = 0;
+    int arg = 0;
+
+    while (*p && len + 1 < size) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        log_spec_t s;
+        p = spec_parse(p, &s);
+        if (s.conv == '\0') break;
+
+        char spec[32];
+        size_t spec_len = s.len < sizeof(spec) ? s.len : sizeof(spec) - 1;
+        memcpy(spec, s.start, spec_len);
+        spec[spec_len] = '\0';
+
+        int width = 0, prec = 0;
+        if (s.star_width) width = arg < rec->nargs ? (int)rec->args[arg++] : 0;
+        if (s.star_prec) prec = arg < rec->nargs ? (int)rec->args[arg++] : 0;
+
+        uint64_t v = 0;
+        const char* str = "";
+        log_arg_class_t cls = spec_class(&s);
+        if (cls != ARG_NONE) {
+            if (arg >= rec->nargs) break;   /* Past LOG_MAX_ARGS */
+            v = rec->args[arg++];
+            if (cls == ARG_STR) str = (const char*)rec + v;
+        }
+
+        int n = format_one(out + len, size - len, &s, spec, width, prec, v, str);
+        if (n < 0) break;
+        len += (size_t)n;
+        if (len >= size) len = size - 1;
+    }
+    out[len] = '\0';
+}
+
+/* ============================================================================
+ * WRITE
+ * ============================================================================ */
+
+static void wake_drain(void) {
+    if (__atomic_exchange_n(&g_pending, 1, __ATOMIC_SEQ_CST)) return;
+    uint64_t one = 1;
+    ssize_t ret = write(g_wake_fd, &one, sizeof(one));
+    (void)ret;
+}
+
+static void count_drop(uint32_t* counter) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+    metrics_inc(METRIC_LOG_DROPPED);
+}
+
+void log_write(int level, const char* fmt, ...) {
+    va_list ap;
+
+    if (!__atomic_load_n(&g_async, __ATOMIC_ACQUIRE)) {
+        va_start(ap, fmt);
+        vfprintf(level == LOG_LEVEL_ERROR ? stderr : stdout, fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    log_ring_t* ring = thread_ring();
+    if (!ring) {
+        count_drop(&g_unowned_dropped);
+        return;
+    }
+
+    /* Arguments and strings first - the header needs their count */
+    uint64_t args[LOG_MAX_ARGS];
+    char strings[LOG_RECORD_MAX - sizeof(log_record_t) - sizeof(args)];
+    size_t strings_len = 0;
+    uint32_t str_mask = 0;          /* Args holding a strings[] offset */
+    int nargs = 0;
+
+    va_start(ap, fmt);
+    for (const char* p = fmt; *p && nargs < LOG_MAX_ARGS; ) {
+        if (*p++ != '%') continue;
+
+        log_spec_t s;
+        p = spec_parse(p - 1, &s);
+        if (s.star_width && nargs < LOG_MAX_ARGS) args[nargs++] = (uint64_t)va_arg(ap, int);
+        if (s.star_prec && nargs < LOG_MAX_ARGS) args[nargs++] = (uint64_t)va_arg(ap, int);
+        if (nargs >= LOG_MAX_ARGS) break;
+
+        switch (spec_class(&s)) {
+            case ARG_INT:
+                args[nargs++] = capture_int(&ap, s.length);
+                break;
+            case ARG_UINT:
+                args[nargs++] = capture_uint(&ap, s.length);
+                break;
+            case ARG_DOUBLE: {
+                double d = va_arg(ap, double);
+                memcpy(&args[nargs++], &d, sizeof(d));
+                break;
+            }
+            case ARG_PTR:
+                args[nargs++] = (uint64_t)(uintptr_t)va_arg(ap, void*);
+                break;
+            case ARG_STR: {
+                const char* str = va_arg(ap, const char*);
+                if (!str) str = "(null)";
+                size_t room = sizeof(strings) - strings_len;
+                if (room == 0) {
+                    args[nargs] = strings_len - 1;     /* Previous copy's NUL: "" */
+                } else {
+                    size_t n = strnlen(str, room - 1);
+                    memcpy(&strings[strings_len], str, n);
+                    strings[strings_len + n] = '\0';
+                    args[nargs] = strings_len;
+                    strings_len += n + 1;
+                }
+                str_mask |= 1u << nargs;
+                nargs++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    va_end(ap);
+
+    size_t args_end = sizeof(log_record_t) + (size_t)nargs * sizeof(uint64_t);
+    uint32_t size = (uint32_t)((args_end + strings_len + 7) & ~(size_t)7);
+    uint32_t head;
+    uint8_t* slot = ring_reserve(ring, size, &head);
+    if (!slot) {
+        count_drop(&ring->dropped);
+        return;
+    }
+
+    log_record_t* rec = (log_record_t*)slot;
+    rec->size = (uint16_t)size;
+    rec->level = (uint8_t)level;
+    rec->nargs = (uint8_t)nargs;
+    rec->reserved = 0;
+    rec->fmt = fmt;
+    rec->time_ns = time_get_ns();
+
+    /* String offsets become relative to the record */
+    for (int i = 0; i < nargs; i++) {
+        rec->args[i] = (str_mask & (1u << i)) ? args_end + args[i] : args[i];
+    }
+    memcpy(slot + args_end, strings, strings_len);
+
+    __atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+    wake_drain();
+}
+
+/* ============================================================================
+ * DRAIN
+ * ============================================================================ */
+
+static void report_drops(uint32_t* dropped, uint32_t* reported) {
+    uint32_t now = __atomic_load_n(dropped, __ATOMIC_RELAXED);
+    if (now != *reported) {
+        fprintf(stdout, "[Log] Dropped %u messages (ring full)\n", now - *reported);
+        *reported = now;
+    }
+}
+
+void log_flush(void) {
+    pthread_mutex_lock(&g_drain_lock);
+
+    /* Oldest record across all rings first */
+    for (;;) {
+        log_ring_t* best = NULL;
+        log_record_t* best_rec = NULL;
+        for (int i = 0; i < LOG_MAX_THREADS; i++) {
+            log_ring_t* ring = &g_rings[i];
+            if (__atomic_load_n(&ring->state, __ATOMIC_ACQUIRE) == LOG_RING_FREE) continue;
+            log_record_t* rec = ring_peek(ring);
+            if (rec && (!best_rec || rec->time_ns < best_rec->time_ns)) {
+                best = ring;
+                best_rec = rec;
+            }
+        }
+        if (!best) break;
+
+        char line[LOG_LINE_MAX];
+        format_record(best_rec, line, sizeof(line));
+        fputs(line, best_rec->level == LOG_LEVEL_ERROR ? stderr : stdout);
+        ring_pop(best, best_rec);
+    }
+
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        log_ring_t* ring = &g_rings[i];
+        int state = __atomic_load_n(&ring->state, __ATOMIC_ACQUIRE);
+        if (state == LOG_RING_FREE) continue;
+        report_drops(&ring->dropped, &ring->dropped_reported);
+        if (state == LOG_RING_RETIRED && !ring_peek(ring)) {
+            __atomic_store_n(&ring->state, LOG_RING_FREE, __ATOMIC_RELEASE);
+        }
+    }
+    report_drops(&g_unowned_dropped, &g_unowned_reported);
+
+    fflush(stdout);
+    pthread_mutex_unlock(&g_drain_lock);
+}
+
+int log_init(void) {
+    if (pthread_key_create(&g_ring_key, ring_release) != 0) return -1;
+
+    g_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_wake_fd < 0) {
+        perror("[Log] eventfd");
+        return -1;
+    }
+    atexit(log_flush);
+    return 0;
+}
+
+void* log_thread(void* arg) {
+    (void)arg;
+    __atomic_store_n(&g_async, 1, __ATOMIC_RELEASE);
+
+    struct pollfd pfd = {.fd = g_wake_fd, .events = POLLIN};
+    while (!__atomic_load_n(&g_stop, __ATOMIC_ACQUIRE)) {
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) break;
+
+        uint64_t count;
+        ssize_t ret = read(g_wake_fd, &count, sizeof(count));
+        (void)ret;
+
+        /* Writers after this point wake us again */
+        __atomic_exchange_n(&g_pending, 0, __ATOMIC_SEQ_CST);
+        log_flush();
+    }
+
+    __atomic_store_n(&g_async, 0, __ATOMIC_RELEASE);
+    log_flush();
+    return NULL;
+}
+
+void log_stop(void) {
+    if (g_wake_fd < 0) return;
+    __atomic_store_n(&g_stop, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    ssize_t ret = write(g_wake_fd, &one, sizeof(one));
+    (void)ret;
+}
@@ -0,0 +1,377 @@
+/*
+ * RosettaPad - Runtime Metrics
+ * =============================
+ *
+ * Per-thread counter blocks, gauges and the scrape server (see
+ * core/metrics.h).
+ */
+
+#define _GNU_SOURCE     /* accept4, open_memstream */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "core/metrics.h"
+#include "core/common.h"
+#include "core/latency.h"
+#include "core/log.h"
+
+/* ============================================================================
+ * REGISTRY
+ * ============================================================================ */
+
+typedef struct {
+    const char* name;
+    const char* help;
+} metric_info_t;
+
+static const metric_info_t g_counter_info[METRIC_COUNT] = {
+    [METRIC_HIDRAW_REPORTS]         = {"hidraw_reports_total", "Controller reports read from hidraw"},
+    [METRIC_HIDRAW_PARSE_ERRORS]    = {"hidraw_parse_errors_total", "Controller reports the driver rejected"},
+    [METRIC_CONTROLLER_CONNECTS]    = {"controller_connects_total", "Controllers connected"},
+    [METRIC_CONTROLLER_DISCONNECTS] = {"controller_disconnects_total", "Controllers disconnected"},
+    [METRIC_USB_REPORTS_SENT]       = {"usb_reports_sent_total", "DS3 input reports polled by the PS3 over USB"},
+    [METRIC_USB_REPORTS_FAILED]     = {"usb_reports_failed_total", "USB input transfers that failed or could not be queued"},
+    [METRIC_USB_REPORTS_DROPPED]    = {"usb_reports_dropped_total", "USB input reports replaced by newer input before going out"},
+    [METRIC_USB_OUTPUT_REPORTS]     = {"usb_output_reports_total", "Output reports received from the PS3 over USB"},
+    [METRIC_USB_SUSPENDS]           = {"usb_suspends_total", "USB suspend events from the host"},
+    [METRIC_BT_REPORTS_SENT]        = {"bt_reports_sent_total", "DS3 input reports sent over Bluetooth"},
+    [METRIC_BT_REPORTS_FAILED]      = {"bt_reports_failed_total", "Bluetooth input reports that failed to send"},
+    [METRIC_BT_REPORTS_DROPPED]     = {"bt_reports_dropped_total", "Bluetooth input reports skipped while the link was backed up"},
+    [METRIC_BT_CONNECTS]            = {"bt_connects_total", "Completed Bluetooth connects to the PS3"},
+    [METRIC_BT_CONNECT_FAILURES]    = {"bt_connect_failures_total", "Failed Bluetooth scans and connects"},
+    [METRIC_OUTPUT_REPORTS]         = {"output_reports_total", "Rumble / LED reports sent to controllers"},
+    [METRIC_OUTPUT_FAILURES]        = {"output_failures_total", "Rumble / LED reports controllers refused"},
+    [METRIC_STATE_TRANSITIONS]      = {"state_transitions_total", "System state changes"},
+    [METRIC_LOG_DROPPED]            = {"log_dropped_total", "Log messages dropped because a log ring was full"},
+};
+
+static const metric_info_t g_gauge_info[METRIC_GAUGE_COUNT] = {
+    [METRIC_GAUGE_SYSTEM_STATE]     = {"system_state", "System state (0 active, 1 standby, 2 waking)"},
+    [METRIC_GAUGE_CONTROLLERS]      = {"controllers_connected", "Controllers connected"},
+    [METRIC_GAUGE_USB_ENABLED]      = {"usb_enabled", "1 while the PS3 has the USB function enabled"},
+    [METRIC_GAUGE_BT_STATE]         = {"bt_state", "Bluetooth state (0 disconnected ... 5 ready, 6 enabled, 7 error)"},
+    [METRIC_GAUGE_BT_RATE_HZ]       = {"bt_rate_hz", "Current Bluetooth input report rate"},
+    [METRIC_GAUGE_BT_RSSI]          = {"bt_rssi_db", "PS3 link RSSI relative to the golden range"},
+    [METRIC_GAUGE_BT_LINK_QUALITY]  = {"bt_link_quality", "PS3 link quality reported by the controller (0-255)"},
+    [METRIC_GAUGE_BT_LINK_GRADE]    = {"bt_link_grade", "PS3 link grade (0 good, 1 poor, 2 bad)"},
+};
+
+typedef struct {
+    uint64_t counters[METRIC_COUNT];
+} __attribute__((aligned(64))) metrics_block_t;
+
+static metrics_block_t g_blocks[METRICS_MAX_THREADS];
+static unsigned g_blocks_claimed = 0;
+static __thread metrics_block_t* t_block = NULL;
+
+static int64_t g_gauges[METRIC_GAUGE_COUNT];
+
+static metrics_block_t* thread_block(void) {
+    metrics_block_t* b = t_block;
+    if (__builtin_expect(b == NULL, 0)) {
+        unsigned i = __atomic_fetch_add(&g_blocks_claimed, 1, __ATOMIC_RELAXED);
+        b = &g_blocks[i < METRICS_MAX_THREADS ? i : METRICS_MAX_THREADS - 1];
+        t_block = b;
+    }
+    return b;
+}
+
+void metrics_add(metric_t metric, uint64_t n) {
+    if (metric >= METRIC_COUNT) return;
+    /* Atomic only because overflow threads share the last block */
+    __atomic_fetch_add(&thread_block()->counters[metric], n, __ATOMIC_RELAXED);
+}
+
+void metrics_gauge_set(metric_gauge_t gauge, int64_t value) {
+    if (gauge >= METRIC_GAUGE_COUNT) return;
+    __atomic_store_n(&g_gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+/* ============================================================================
+ * EXPOSITION
+ * ============================================================================ */
+
+static uint64_t g_start_ms = 0;
+
+/* Thread names are free text - keep them valid label values */
+static void label_sanitize(char* s) {
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\' || *s == '\n') *s = '_';
+    }
+}
+
+static void write_thread_cpu(FILE* f) {
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return;
+
+    double tick = 1.0 / (double)sysconf(_SC_CLK_TCK);
+    fprintf(f, "# HELP rosettapad_thread_cpu_seconds_total CPU time per adapter thread\n");
+    fprintf(f, "# TYPE rosettapad_thread_cpu_seconds_total counter\n");
+
+    struct dirent* de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%.16s/stat", de->d_name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        char buf[512];
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n <= 0) continue;
+        buf[n] = '\0';
+
+        /* "tid (comm) state ppid ..." - comm may hold spaces and ')' */
+        char* open_paren = strchr(buf, '(');
+        char* close_paren = strrchr(buf, ')');
+        if (!open_paren || !close_paren || close_paren < open_paren) continue;
+        *close_paren = '\0';
+        char* comm = open_paren + 1;
+        label_sanitize(comm);
+
+        unsigned long utime, stime;
+        if (sscanf(close_paren + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                   &utime, &stime) != 2) {
+            continue;
+        }
+        fprintf(f, "rosettapad_thread_cpu_seconds_total{thread=\"%s\",tid=\"%s\",mode=\"user\"} %.2f\n",
+                comm, de->d_name, utime * tick);
+        fprintf(f, "rosettapad_thread_cpu_seconds_total{thread=\"%s\",tid=\"%s\",mode=\"system\"} %.2f\n",
+                comm, de->d_name, stime * tick);
+    }
+    closedir(dir);
+}
+
+int metrics_write_prometheus(FILE* f) {
+    unsigned claimed = __atomic_load_n(&g_blocks_claimed, __ATOMIC_RELAXED);
+    if (claimed > METRICS_MAX_THREADS) claimed = METRICS_MAX_THREADS;
+
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        uint64_t total = 0;
+        for (unsigned b = 0; b < claimed; b++) {
+            total += __atomic_load_n(&g_blocks[b].counters[m], __ATOMIC_RELAXED);
+        }
+        fprintf(f, "# HELP rosettapad_%s %s\n", g_counter_info[m].name, g_counter_info[m].help);
+        fprintf(f, "# TYPE rosettapad_%s counter\n", g_counter_info[m].name);
+        fprintf(f, "rosettapad_%s %llu\n", g_counter_info[m].name, (unsigned long long)total);
+    }
+
+    for (int g = 0; g < METRIC_GAUGE_COUNT; g++) {
+        fprintf(f, "# HELP rosettapad_%s %s\n", g_gauge_info[g].name, g_gauge_info[g].help);
+        fprintf(f, "# TYPE rosettapad_%s gauge\n", g_gauge_info[g].name);
+        fprintf(f, "rosettapad_%s %lld\n", g_gauge_info[g].name,
+                (long long)__atomic_load_n(&g_gauges[g], __ATOMIC_RELAXED));
+    }
+
+    fprintf(f, "# HELP rosettapad_uptime_seconds Time since the adapter started\n");
+    fprintf(f, "# TYPE rosettapad_uptime_seconds gauge\n");
+    fprintf(f, "rosettapad_uptime_seconds %.1f\n", (time_get_ms() - g_start_ms) / 1000.0);
+
+    latency_write_prometheus(f);
+    write_thread_cpu(f);
+    return ferror(f) ? -1 : 0;
+}
+
+/* ============================================================================
+ * SERVER
+ * ============================================================================ */
+
+static int g_unix_fd = -1;
+static int g_tcp_fd = -1;
+static int g_stop_fd = -1;
+
+static int unix_listen(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("[Metrics] socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", METRICS_SOCKET_PATH);
+    unlink(METRICS_SOCKET_PATH);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        LOG_ERROR("[Metrics] bind " METRICS_SOCKET_PATH ": %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    chmod(METRICS_SOCKET_PATH, 0660);
+    return fd;
+}
+
+static int tcp_listen(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("[Metrics] socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        LOG_ERROR("[Metrics] Error: Cannot listen on TCP port %d: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int metrics_server_open(int tcp_port) {
+    g_start_ms = time_get_ms();
+
+    g_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_stop_fd < 0) {
+        LOG_ERROR("[Metrics] eventfd: %s\n", strerror(errno));
+        return -1;
+    }
+
+    g_unix_fd = unix_listen();
+    if (tcp_port > 0) g_tcp_fd = tcp_listen(tcp_port);
+    if (g_unix_fd < 0 && g_tcp_fd < 0) {
+        close(g_stop_fd);
+        g_stop_fd = -1;
+        return -1;
+    }
+
+    if (g_unix_fd >= 0) LOG_INFO("[Metrics] Serving on %s\n", METRICS_SOCKET_PATH);
+    if (g_tcp_fd >= 0) LOG_INFO("[Metrics] Serving on TCP port %d\n", tcp_port);
+    return 0;
+}
+
+/* Read until the end of the request headers, EOF or the timeout */
+static size_t read_request(int fd, char* buf, size_t size) {
+    size_t len = 0;
+    uint64_t deadline = time_get_ms() + METRICS_REQUEST_TIMEOUT_MS;
+
+    while (len < size - 1) {
+        uint64_t now = time_get_ms();
+        if (now >= deadline) break;
+
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, (int)(deadline - now)) <= 0) break;
+
+        ssize_t n = recv(fd, buf + len, size - 1 - len, 0);
+        if (n <= 0) break;
+        len += (size_t)n;
+        buf[len] = '\0';
+        if (strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n")) break;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+static void write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+/*
+ * HTTP/1.0 for curl and Prometheus; anything else (socat, nc) gets the
+ * bare body once it has sent its request or closed its end.
+ */
+static void serve_client(int fd) {
+    struct timeval tv = {.tv_sec = METRICS_REQUEST_TIMEOUT_MS / 1000,
+                         .tv_usec = (METRICS_REQUEST_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char req[METRICS_REQUEST_MAX];
+    read_request(fd, req, sizeof(req));
+
+    int http = strncmp(req, "GET ", 4) == 0;
+    if (http && strncmp(req + 4, "/metrics", 8) != 0 && strncmp(req + 4, "/ ", 2) != 0) {
+        static const char not_found[] =
+            "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        write_all(fd, not_found, sizeof(not_found) - 1);
+        return;
+    }
+
+    char* body = NULL;
+    size_t body_len = 0;
+    FILE* f = open_memstream(&body, &body_len);
+    if (!f) return;
+    metrics_write_prometheus(f);
+    fclose(f);
+
+    if (http) {
+        char header[160];
+        int n = snprintf(header, sizeof(header),
+                         "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\n"
+                         "Connection: close\r\n\r\n", body_len);
+        write_all(fd, header, (size_t)n);
+    }
+    write_all(fd, body, body_len);
+    free(body);
+}
+
+void* metrics_thread(void* arg) {
+    (void)arg;
+
+    struct pollfd pfds[3] = {
+        {.fd = g_stop_fd, .events = POLLIN},
+        {.fd = g_unix_fd, .events = POLLIN},
+        {.fd = g_tcp_fd, .events = POLLIN},     /* fd -1 is ignored by poll */
+    };
+
+    for (;;) {
+        if (poll(pfds, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("[Metrics] poll: %s\n", strerror(errno));
+            break;
+        }
+        if (pfds[0].revents) break;
+
+        /* One scrape at a time - they are rare and cheap */
+        for (int i = 1; i < 3; i++) {
+            if (!(pfds[i].revents & POLLIN)) continue;
+            int client = accept4(pfds[i].fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client < 0) continue;
+            serve_client(client);
+            close(client);
+        }
+    }
+
+    if (g_unix_fd >= 0) {
+        close(g_unix_fd);
+        g_unix_fd = -1;
+        unlink(METRICS_SOCKET_PATH);
+    }
+    if (g_tcp_fd >= 0) {
+        close(g_tcp_fd);
+        g_tcp_fd = -1;
+    }
+    return NULL;
+}
+
+void metrics_server_stop(void) {
+    if (g_stop_fd < 0) return;
+    uint64_t one = 1;
+    ssize_t ret = write(g_stop_fd, &one, sizeof(one));
+    (void)ret;
+}
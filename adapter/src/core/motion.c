@@ -0,0 +1,203 @@
+/*
+ * RosettaPad - Motion Conversion Stage
+ * =====================================
+ *
+ * Fixed-point table compiler and per-report apply (see core/motion.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MOTION_USE_NEON 1
+#endif
+
+#include "core/motion.h"
+#include "core/common.h"
+
+#define MOTION_AXES     CONTROLLER_MOTION_OUT_AXES
+#define MOTION_ROUND    (1LL << (MOTION_FRAC_BITS - 1))
+
+/* ============================================================================
+ * COMPILED TABLES
+ * ============================================================================ */
+
+typedef struct {
+    int32_t bias[MOTION_AXES];          /* Raw bias of each channel's source */
+    int32_t mul[MOTION_AXES];           /* Q(MOTION_FRAC_BITS), sign included */
+    int32_t center[MOTION_AXES];
+    int32_t max;
+    uint8_t source[MOTION_AXES];
+} motion_table_t;
+
+/* Per-slot triple buffer, same scheme as core/remap.c */
+#define MOTION_FRESH 4u
+
+static motion_table_t g_tables[MAX_CONTROLLER_SLOTS][3];
+static uint32_t g_middle[MAX_CONTROLLER_SLOTS];     /* Index | MOTION_FRESH */
+static int g_back[MAX_CONTROLLER_SLOTS];            /* Writer only */
+static int g_front[MAX_CONTROLLER_SLOTS];           /* Reader only */
+
+/* Compiler inputs - writer lock */
+static pthread_mutex_t g_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static motion_calib_t g_calib[MAX_CONTROLLER_SLOTS];
+static motion_mapping_t g_mapping;
+static motion_target_t g_target;
+
+/* ============================================================================
+ * COMPILER
+ * ============================================================================ */
+
+static void calib_passthrough(motion_calib_t* calib) {
+    for (int i = 0; i < MOTION_SRC_COUNT; i++) {
+        calib->bias[i] = 0;
+        calib->numer[i] = 1;
+        calib->denom[i] = 1;
+    }
+}
+
+static void compile(int slot, motion_table_t* t) {
+    const motion_calib_t* calib = &g_calib[slot];
+
+    t->max = g_target.max;
+    for (int o = 0; o < MOTION_AXES; o++) {
+        int src = g_mapping.source[o];
+        int gyro = MOTION_SRC_IS_GYRO(src);
+        int64_t tnum = gyro ? g_target.gyro_numer : g_target.accel_numer;
+        int64_t tden = gyro ? g_target.gyro_denom : g_target.accel_denom;
+
+        int64_t num = (int64_t)calib->numer[src] * tnum * (1LL << MOTION_FRAC_BITS);
+        int64_t den = (int64_t)calib->denom[src] * tden;
+        int64_t mul = den ? num / den : 0;
+        if (g_mapping.invert[o]) mul = -mul;
+        if (mul > INT32_MAX) mul = INT32_MAX;
+        if (mul < -INT32_MAX) mul = -INT32_MAX;
+
+        t->source[o] = (uint8_t)src;
+        t->bias[o] = calib->bias[src];
+        t->mul[o] = (int32_t)mul;
+        t->center[o] = g_target.center[o];
+    }
+}
+
+/* Caller holds the writer lock */
+static void publish(int slot) {
+    motion_table_t* t = &g_tables[slot][g_back[slot]];
+    compile(slot, t);
+
+    uint32_t prev = __atomic_exchange_n(&g_middle[slot], (uint32_t)g_back[slot] | MOTION_FRESH,
+                                        __ATOMIC_ACQ_REL);
+    g_back[slot] = (int)(prev & ~MOTION_FRESH);
+}
+
+static void publish_all(void) {
+    for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+        publish(slot);
+    }
+}
+
+void motion_mapping_default(motion_mapping_t* map) {
+    static const uint8_t natural[MOTION_AXES] = {
+        MOTION_SRC_ACCEL_X, MOTION_SRC_ACCEL_Y, MOTION_SRC_ACCEL_Z, MOTION_SRC_GYRO_Z
+    };
+    memcpy(map->source, natural, sizeof(map->source));
+    memset(map->invert, 0, sizeof(map->invert));
+}
+
+void motion_init(void) {
+    pthread_mutex_lock(&g_writer_lock);
+    motion_mapping_default(&g_mapping);
+    for (int slot = 0; slot < MAX_CONTROLLER_SLOTS; slot++) {
+        calib_passthrough(&g_calib[slot]);
+        g_front[slot] = 0;
+        g_middle[slot] = 1;
+        g_back[slot] = 2;
+
+        /* Nothing reads yet - seed the front buffer directly */
+        compile(slot, &g_tables[slot][0]);
+    }
+    pthread_mutex_unlock(&g_writer_lock);
+}
+
+void motion_set_target(const motion_target_t* target) {
+    pthread_mutex_lock(&g_writer_lock);
+    g_target = *target;
+    publish_all();
+    pthread_mutex_unlock(&g_writer_lock);
+}
+
+void motion_set_calibration(int slot, const motion_calib_t* calib) {
+    if (slot < 0 || slot >= MAX_CONTROLLER_SLOTS) return;
+
+    pthread_mutex_lock(&g_writer_lock);
+    if (calib) {
+        g_calib[slot] = *calib;
+    } else {
+        calib_passthrough(&g_calib[slot]);
+    }
+    publish(slot);
+    pthread_mutex_unlock(&g_writer_lock);
+}
+
+int motion_set_mapping(const motion_mapping_t* map) {
+    for (int o = 0; o < MOTION_AXES; o++) {
+        if (map->source[o] >= MOTION_SRC_COUNT) return -1;
+    }
+
+    pthread_mutex_lock(&g_writer_lock);
+    if (memcmp(&g_mapping, map, sizeof(g_mapping)) != 0) {
+        g_mapping = *map;
+        publish_all();
+    }
+    pthread_mutex_unlock(&g_writer_lock);
+    return 0;
+}
+
+/* ============================================================================
+ * HOT PATH
+ * ============================================================================ */
+
+void motion_apply(int slot, controller_state_t* state) {
+    /* Pick up a freshly compiled table */
+    if (__atomic_load_n(&g_middle[slot], __ATOMIC_RELAXED) & MOTION_FRESH) {
+        uint32_t prev = __atomic_exchange_n(&g_middle[slot], (uint32_t)g_front[slot],
+                                            __ATOMIC_ACQ_REL);
+        g_front[slot] = (int)(prev & ~MOTION_FRESH);
+    }
+
+    const motion_table_t* t = &g_tables[slot][g_front[slot]];
+    const int16_t raw[MOTION_SRC_COUNT] = {
+        state->accel_x, state->accel_y, state->accel_z,
+        state->gyro_x, state->gyro_y, state->gyro_z
+    };
+
+    int32_t in[MOTION_AXES];
+    for (int o = 0; o < MOTION_AXES; o++) {
+        in[o] = raw[t->source[o]] - t->bias[o];
+    }
+
+#ifdef MOTION_USE_NEON
+    /* All four channels at once: widening multiply, rounding narrow shift */
+    int32x4_t v = vld1q_s32(in);
+    int32x4_t mul = vld1q_s32(t->mul);
+    int32x2_t lo = vrshrn_n_s64(vmull_s32(vget_low_s32(v), vget_low_s32(mul)),
+                                MOTION_FRAC_BITS);
+    int32x2_t hi = vrshrn_n_s64(vmull_s32(vget_high_s32(v), vget_high_s32(mul)),
+                                MOTION_FRAC_BITS);
+    int32x4_t out = vaddq_s32(vcombine_s32(lo, hi), vld1q_s32(t->center));
+    out = vmaxq_s32(out, vdupq_n_s32(0));
+    out = vminq_s32(out, vdupq_n_s32(t->max));
+    vst1_u16(state->motion_out, vmovn_u32(vreinterpretq_u32_s32(out)));
+#else
+    for (int o = 0; o < MOTION_AXES; o++) {
+        int32_t out = t->center[o] +
+                      (int32_t)(((int64_t)in[o] * t->mul[o] + MOTION_ROUND) >> MOTION_FRAC_BITS);
+        if (out < 0) out = 0;
+        if (out > t->max) out = t->max;
+        state->motion_out[o] = (uint16_t)out;
+    }
+#endif
+    state->motion_valid = 1;
+}
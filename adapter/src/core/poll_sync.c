@@ -0,0 +1,105 @@
+/*
+ * RosettaPad - Host Poll Synchronisation
+ * =======================================
+ *
+ * Period acquisition and PLL tracking (see core/poll_sync.h). Fixed
+ * point with 8 fractional bits, so a 1 ms period is kept to 4 ps and
+ * drift between the host's and our clock is followed without floats.
+ * Only offsets from the anchor are scaled - absolute timestamps would
+ * overflow int64 << 8 after about 417 days of uptime.
+ */
+
+#include <string.h>
+
+#include "core/poll_sync.h"
+
+#define Q8(ns)                  ((int64_t)(ns) * 256)
+
+/* Loop gains: phase takes 1/4 of each error, period 1/32 per poll */
+#define POLL_SYNC_PHASE_SHIFT   2
+#define POLL_SYNC_PERIOD_SHIFT  5
+
+void poll_sync_reset(poll_sync_t* ps) {
+    memset(ps, 0, sizeof(*ps));
+}
+
+/* Signed time from the anchor to t, ns << 8 */
+static int64_t since_anchor_q8(const poll_sync_t* ps, uint64_t t) {
+    return Q8((int64_t)(t - ps->anchor_ns)) - ps->anchor_frac_q8;
+}
+
+/* Move the anchor by a signed offset, keeping the fraction in 0-255 */
+static void anchor_advance(poll_sync_t* ps, int64_t offset_q8) {
+    int64_t v = ps->anchor_frac_q8 + offset_q8;
+    int64_t whole = v / 256;
+    if (v % 256 < 0) whole--;
+    ps->anchor_ns += (uint64_t)whole;
+    ps->anchor_frac_q8 = v - whole * 256;
+}
+
+int poll_sync_acquire(poll_sync_t* ps, uint64_t poll_ns) {
+    if (ps->locked) return 1;
+
+    if (ps->acq_count > 1) {
+        /* A gap (queue ran dry, poll skipped) spoils the mean - start over */
+        uint64_t mean = (ps->acq_last_ns - ps->acq_first_ns) / (ps->acq_count - 1);
+        if (poll_ns - ps->acq_last_ns > 2 * mean) ps->acq_count = 0;
+    }
+    if (ps->acq_count == 0) ps->acq_first_ns = poll_ns;
+    ps->acq_last_ns = poll_ns;
+    ps->acq_count++;
+
+    if (ps->acq_count < POLL_SYNC_ACQUIRE_SAMPLES) return 0;
+
+    uint64_t span = ps->acq_last_ns - ps->acq_first_ns;
+    if (span == 0) {
+        ps->acq_count = 0;
+        return 0;
+    }
+    ps->period_q8 = Q8(span) / (ps->acq_count - 1);
+    ps->anchor_ns = poll_ns;
+    ps->anchor_frac_q8 = 0;
+    ps->last_error_ns = 0;
+    ps->misses = 0;
+    ps->locked = 1;
+    return 1;
+}
+
+int poll_sync_track(poll_sync_t* ps, uint64_t poll_ns) {
+    if (!ps->locked) return -1;
+
+    /* Which predicted poll this is: k periods after the anchor */
+    int64_t delta = since_anchor_q8(ps, poll_ns);
+    int64_t k = (delta + ps->period_q8 / 2) / ps->period_q8;
+    if (k < 1) return 0;    /* Same poll again (two transfers, one poll) */
+
+    int64_t predicted = k * ps->period_q8;
+    int64_t error = delta - predicted;
+    ps->last_error_ns = error / 256;
+
+    int64_t limit = ps->period_q8 / 4;
+    if (error > limit || error < -limit) {
+        if (++ps->misses >= POLL_SYNC_MAX_MISSES) {
+            poll_sync_reset(ps);
+            return -1;
+        }
+        return 0;
+    }
+    ps->misses = 0;
+
+    anchor_advance(ps, predicted + error / (1 << POLL_SYNC_PHASE_SHIFT));
+    ps->period_q8 += error / (k << POLL_SYNC_PERIOD_SHIFT);
+    return 0;
+}
+
+uint64_t poll_sync_next(const poll_sync_t* ps, uint64_t after_ns) {
+    if (!ps->locked) return 0;
+
+    int64_t delta = since_anchor_q8(ps, after_ns);
+    int64_t k = (delta <= 0) ? 0 : (delta + ps->period_q8 - 1) / ps->period_q8;
+    return ps->anchor_ns + (uint64_t)(ps->anchor_frac_q8 + k * ps->period_q8) / 256;
+}
+
+uint64_t poll_sync_period_ns(const poll_sync_t* ps) {
+    return ps->locked ? (uint64_t)(ps->period_q8 >> 8) : 0;
+}
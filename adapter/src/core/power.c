@@ -0,0 +1,144 @@
+/*
+ * RosettaPad - Standby Power
+ * ==========================
+ *
+ * Governor switching and wakeup accounting (see core/power.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "core/common.h"
+#include "core/power.h"
+#include "core/log.h"
+
+#define POWER_GOVERNOR_PATH "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor"
+
+static char g_standby_governor[POWER_GOVERNOR_MAX];
+static char g_saved_governor[POWER_MAX_CPUS][POWER_GOVERNOR_MAX];
+static int g_saved_count = 0;       /* CPUs switched, 0 = nothing to restore */
+
+/* Start of the current period */
+static uint64_t g_period_start_ms = 0;
+static uint64_t g_period_wakeups = 0;
+static uint64_t g_period_cpu_us = 0;
+
+/* ============================================================================
+ * CPU GOVERNOR
+ * ============================================================================ */
+
+static int governor_read(int cpu, char* out, size_t size) {
+    char path[96];
+    snprintf(path, sizeof(path), POWER_GOVERNOR_PATH, cpu);
+    
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    
+    int ok = fgets(out, (int)size, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+    
+    char* nl = strchr(out, '\n');
+    if (nl) *nl = '\0';
+    return 0;
+}
+
+static int governor_write(int cpu, const char* governor) {
+    char path[96];
+    snprintf(path, sizeof(path), POWER_GOVERNOR_PATH, cpu);
+    
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    
+    int ok = fputs(governor, f) >= 0;
+    ok = (fclose(f) == 0) && ok;
+    return ok ? 0 : -1;
+}
+
+void power_set_standby_governor(const char* governor) {
+    if (!governor) {
+        g_standby_governor[0] = '\0';
+        return;
+    }
+    snprintf(g_standby_governor, sizeof(g_standby_governor), "%s", governor);
+}
+
+static void governor_apply(void) {
+    if (!g_standby_governor[0] || g_saved_count > 0) return;
+    
+    int cpu;
+    for (cpu = 0; cpu < POWER_MAX_CPUS; cpu++) {
+        if (governor_read(cpu, g_saved_governor[cpu], POWER_GOVERNOR_MAX) < 0) break;
+        if (governor_write(cpu, g_standby_governor) < 0) {
+            LOG_WARN("[Power] Warning: Cannot set CPU %d governor to %s (need root)\n",
+                     cpu, g_standby_governor);
+            break;
+        }
+    }
+    g_saved_count = cpu;
+    
+    if (g_saved_count > 0) {
+        LOG_INFO("[Power] CPU governor: %s -> %s\n", g_saved_governor[0], g_standby_governor);
+    }
+}
+
+static void governor_restore(void) {
+    if (g_saved_count == 0) return;
+    
+    for (int cpu = 0; cpu < g_saved_count; cpu++) {
+        governor_write(cpu, g_saved_governor[cpu]);
+    }
+    LOG_INFO("[Power] CPU governor restored: %s\n", g_saved_governor[0]);
+    g_saved_count = 0;
+}
+
+/* ============================================================================
+ * WAKEUP ACCOUNTING
+ * ============================================================================ */
+
+static void usage_now(uint64_t* wakeups, uint64_t* cpu_us) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) < 0) {
+        *wakeups = 0;
+        *cpu_us = 0;
+        return;
+    }
+    *wakeups = (uint64_t)ru.ru_nvcsw;
+    *cpu_us = (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+              (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+/* Log the period that just ended and start the next one */
+static void period_end(const char* name) {
+    uint64_t now = time_get_ms();
+    uint64_t wakeups, cpu_us;
+    usage_now(&wakeups, &cpu_us);
+    
+    uint64_t elapsed_ms = now - g_period_start_ms;
+    if (g_period_start_ms && elapsed_ms > 0) {
+        LOG_INFO("[Power] %s for %llu s: %.1f wakeups/s, CPU %.2f%%\n", name,
+                 (unsigned long long)(elapsed_ms / 1000),
+                 (double)(wakeups - g_period_wakeups) * 1000.0 / (double)elapsed_ms,
+                 (double)(cpu_us - g_period_cpu_us) / (double)elapsed_ms / 10.0);
+    }
+    
+    g_period_start_ms = now;
+    g_period_wakeups = wakeups;
+    g_period_cpu_us = cpu_us;
+}
+
+void power_init(void) {
+    g_period_start_ms = time_get_ms();
+    usage_now(&g_period_wakeups, &g_period_cpu_us);
+}
+
+void power_enter_standby(void) {
+    period_end("Active");
+    governor_apply();
+}
+
+void power_exit_standby(void) {
+    governor_restore();
+    if (system_is_standby()) period_end("Standby");
+}
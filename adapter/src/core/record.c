@@ -0,0 +1,530 @@
+/*
+ * RosettaPad - Input Recorder / Replayer
+ * =======================================
+ *
+ * Delta-encoded state stream in a preallocated mmap'd file (see
+ * core/record.h for the format).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#include "core/record.h"
+#include "core/common.h"
+#include "core/remap.h"
+#include "core/log.h"
+
+/* ============================================================================
+ * FIELD CODEC
+ *
+ * A state is flattened into RECORD_FIELD_COUNT integers; bit i of a state
+ * record's mask corresponds to field i here. Append new fields at the end
+ * and bump RECORD_VERSION.
+ * ============================================================================ */
+
+enum {
+    F_BUTTONS,
+    F_LX, F_LY, F_RX, F_RY, F_L2, F_R2,
+    F_AX, F_AY, F_AZ, F_GX, F_GY, F_GZ,
+    F_T0_ACTIVE, F_T0_X, F_T0_Y,
+    F_T1_ACTIVE, F_T1_X, F_T1_Y,
+    F_BATTERY, F_CHARGING, F_FULL,
+    F_M0, F_M1, F_M2, F_M3, F_MOTION_VALID,
+    RECORD_FIELD_COUNT
+};
+
+/* tag + dt + mask + every field at its widest */
+#define RECORD_MAX_STATE_SIZE (1 + 10 + 5 + RECORD_FIELD_COUNT * 5)
+#define RECORD_MAX_RAW_SIZE   (1 + 10 + 5 + 256)
+
+static void state_to_fields(const controller_state_t* s, int32_t f[RECORD_FIELD_COUNT]) {
+    f[F_BUTTONS] = (int32_t)s->buttons;
+    f[F_LX] = s->left_stick_x;
+    f[F_LY] = s->left_stick_y;
+    f[F_RX] = s->right_stick_x;
+    f[F_RY] = s->right_stick_y;
+    f[F_L2] = s->left_trigger;
+    f[F_R2] = s->right_trigger;
+    f[F_AX] = s->accel_x;
+    f[F_AY] = s->accel_y;
+    f[F_AZ] = s->accel_z;
+    f[F_GX] = s->gyro_x;
+    f[F_GY] = s->gyro_y;
+    f[F_GZ] = s->gyro_z;
+    f[F_T0_ACTIVE] = s->touch[0].active;
+    f[F_T0_X] = s->touch[0].x;
+    f[F_T0_Y] = s->touch[0].y;
+    f[F_T1_ACTIVE] = s->touch[1].active;
+    f[F_T1_X] = s->touch[1].x;
+    f[F_T1_Y] = s->touch[1].y;
+    f[F_BATTERY] = s->battery_level;
+    f[F_CHARGING] = s->battery_charging;
+    f[F_FULL] = s->battery_full;
+    for (int i = 0; i < CONTROLLER_MOTION_OUT_AXES; i++) {
+        f[F_M0 + i] = s->motion_out[i];
+    }
+    f[F_MOTION_VALID] = s->motion_valid;
+}
+
+static void fields_to_state(const int32_t f[RECORD_FIELD_COUNT], controller_state_t* s) {
+    memset(s, 0, sizeof(*s));
+    s->buttons = (uint32_t)f[F_BUTTONS];
+    s->left_stick_x = (uint8_t)f[F_LX];
+    s->left_stick_y = (uint8_t)f[F_LY];
+    s->right_stick_x = (uint8_t)f[F_RX];
+    s->right_stick_y = (uint8_t)f[F_RY];
+    s->left_trigger = (uint8_t)f[F_L2];
+    s->right_trigger = (uint8_t)f[F_R2];
+    s->accel_x = (int16_t)f[F_AX];
+    s->accel_y = (int16_t)f[F_AY];
+    s->accel_z = (int16_t)f[F_AZ];
+    s->gyro_x = (int16_t)f[F_GX];
+    s->gyro_y = (int16_t)f[F_GY];
+    s->gyro_z = (int16_t)f[F_GZ];
+    s->touch[0].active = (uint8_t)f[F_T0_ACTIVE];
+    s->touch[0].x = (uint16_t)f[F_T0_X];
+    s->touch[0].y = (uint16_t)f[F_T0_Y];
+    s->touch[1].active = (uint8_t)f[F_T1_ACTIVE];
+    s->touch[1].x = (uint16_t)f[F_T1_X];
+    s->touch[1].y = (uint16_t)f[F_T1_Y];
+    s->battery_level = (uint8_t)f[F_BATTERY];
+    s->battery_charging = (uint8_t)f[F_CHARGING];
+    s->battery_full = (uint8_t)f[F_FULL];
+    for (int i = 0; i < CONTROLLER_MOTION_OUT_AXES; i++) {
+        s->motion_out[i] = (uint16_t)f[F_M0 + i];
+    }
+    s->motion_valid = (uint8_t)f[F_MOTION_VALID];
+}
+
+static size_t put_varint(uint8_t* p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* @return Bytes consumed, 0 if truncated or overlong */
+static size_t get_varint(const uint8_t* p, size_t avail, uint64_t* out) {
+    uint64_t v = 0;
+    for (size_t n = 0; n < avail && n < 10; n++) {
+        v |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *out = v;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/* ============================================================================
+ * RECORDING
+ * ============================================================================ */
+
+static record_header_t* g_rec = NULL;
+static uint8_t* g_rec_data = NULL;
+static size_t g_rec_map_size = 0;
+static int g_rec_fd = -1;
+static int g_rec_full = 0;
+static uint64_t g_rec_last_ns = 0;
+static int32_t g_rec_prev[MAX_CONTROLLER_SLOTS][RECORD_FIELD_COUNT];
+
+int record_start(const char* path, size_t size_mb, int flags) {
+    size_t capacity = size_mb << 20;
+    g_rec_map_size = sizeof(record_header_t) + capacity;
+
+    g_rec_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (g_rec_fd < 0) {
+        LOG_ERROR("[Record] Error: Cannot create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    /* Allocate every block now so the hot path never extends the file */
+    int err = posix_fallocate(g_rec_fd, 0, (off_t)g_rec_map_size);
+    if (err != 0 && ftruncate(g_rec_fd, (off_t)g_rec_map_size) < 0) {
+        err = errno;    /* The fallback's error, not posix_fallocate()'s */
+        LOG_ERROR("[Record] Error: Cannot size %s: %s\n", path, strerror(err));
+        goto fail;
+    }
+
+    void* map = mmap(NULL, g_rec_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_rec_fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("[Record] mmap: %s\n", strerror(errno));
+        goto fail;
+    }
+    madvise(map, g_rec_map_size, MADV_SEQUENTIAL);
+
+    g_rec = map;
+    g_rec_data = (uint8_t*)map + sizeof(record_header_t);
+    memset(g_rec, 0, sizeof(*g_rec));
+    g_rec->version = RECORD_VERSION;
+    g_rec->flags = (uint16_t)(flags & RECORD_FLAG_RAW);
+    g_rec->capacity = capacity;
+    g_rec->start_realtime_s = (uint64_t)time(NULL);
+    __atomic_store_n(&g_rec->magic, RECORD_MAGIC, __ATOMIC_RELEASE);
+
+    g_rec_full = 0;
+    g_rec_last_ns = 0;
+    memset(g_rec_prev, 0, sizeof(g_rec_prev));
+
+    LOG_INFO("[Record] Recording to %s (%zu MB%s)\n", path, size_mb,
+             (flags & RECORD_FLAG_RAW) ? ", raw reports" : "");
+    return 0;
+
+fail:
+    close(g_rec_fd);
+    g_rec_fd = -1;
+    return -1;
+}
+
+void record_stop(void) {
+    if (!g_rec) return;
+
+    uint64_t used = g_rec->used;
+    uint32_t count = g_rec->record_count;
+
+    munmap(g_rec, g_rec_map_size);
+    g_rec = NULL;
+    g_rec_data = NULL;
+
+    if (ftruncate(g_rec_fd, (off_t)(sizeof(record_header_t) + used)) < 0) {
+        LOG_ERROR("[Record] ftruncate: %s\n", strerror(errno));
+    }
+    close(g_rec_fd);
+    g_rec_fd = -1;
+
+    LOG_INFO("[Record] Stopped: %u records, %llu bytes%s\n", count,
+             (unsigned long long)used, g_rec_full ? " (file full, tail dropped)" : "");
+}
+
+/* Header tag and time delta shared by both record types */
+static size_t put_record_head(uint8_t* p, int type, int slot, uint64_t ns) {
+    uint64_t dt_us = 0;
+    if (g_rec_last_ns && ns > g_rec_last_ns) dt_us = (ns - g_rec_last_ns) / 1000;
+
+    /* Keep the residual so rounding never accumulates into drift */
+    g_rec_last_ns = g_rec_last_ns ? g_rec_last_ns + dt_us * 1000 : ns;
+
+    p[0] = (uint8_t)((type << 4) | slot);
+    return 1 + put_varint(p + 1, dt_us);
+}
+
+static void record_commit(const uint8_t* buf, size_t len) {
+    uint64_t used = g_rec->used;
+    if (used + len > g_rec->capacity) {
+        g_rec_full = 1;
+        return;
+    }
+
+    memcpy(g_rec_data + used, buf, len);
+
+    /* Readers of a live file stop at used, so it goes last */
+    __atomic_store_n(&g_rec->used, used + len, __ATOMIC_RELEASE);
+    g_rec->record_count++;
+}
+
+void record_state(int slot, const controller_state_t* state) {
+    if (!g_rec || g_rec_full || slot < 0 || slot >= MAX_CONTROLLER_SLOTS) return;
+
+    int32_t f[RECORD_FIELD_COUNT];
+    int32_t* prev = g_rec_prev[slot];
+    state_to_fields(state, f);
+
+    uint32_t mask = 0;
+    for (int i = 0; i < RECORD_FIELD_COUNT; i++) {
+        if (f[i] != prev[i]) mask |= 1u << i;
+    }
+
+    uint8_t buf[RECORD_MAX_STATE_SIZE];
+    size_t n = put_record_head(buf, RECORD_TYPE_STATE, slot, state->timestamp_ns);
+    n += put_varint(buf + n, mask);
+    for (int i = 0; i < RECORD_FIELD_COUNT; i++) {
+        if (!(mask & (1u << i))) continue;
+        n += put_varint(buf + n, zigzag((int32_t)((uint32_t)f[i] - (uint32_t)prev[i])));
+        prev[i] = f[i];
+    }
+
+    record_commit(buf, n);
+}
+
+void record_raw(int slot, const uint8_t* data, size_t len, uint64_t read_ns) {
+    if (!g_rec || g_rec_full || !(g_rec->flags & RECORD_FLAG_RAW)) return;
+    if (slot < 0 || slot >= MAX_CONTROLLER_SLOTS || len > 256) return;
+
+    uint8_t buf[RECORD_MAX_RAW_SIZE];
+    size_t n = put_record_head(buf, RECORD_TYPE_RAW, slot, read_ns);
+    n += put_varint(buf + n, len);
+    memcpy(buf + n, data, len);
+
+    record_commit(buf, n + len);
+}
+
+/* ============================================================================
+ * REPLAY
+ * ============================================================================ */
+
+typedef struct {
+    int type;
+    int slot;
+    uint64_t offset_ns;         /* Since the first record */
+    const uint8_t* raw;
+    size_t raw_len;
+} replay_record_t;
+
+static const uint8_t* g_play_map = NULL;
+static size_t g_play_map_size = 0;
+static const uint8_t* g_play_data = NULL;
+static size_t g_play_used = 0;
+static size_t g_play_pos = 0;
+static int g_play_flags = 0;
+static uint32_t g_play_count = 0;
+static uint64_t g_play_offset_ns = 0;
+static int32_t g_play_fields[MAX_CONTROLLER_SLOTS][RECORD_FIELD_COUNT];
+
+static event_loop_t* g_play_loop = NULL;
+static int g_play_timer_fd = -1;
+static uint64_t g_play_base_ns = 0;      /* Monotonic time of offset 0 */
+static int g_play_active = 0;
+static replay_raw_fn g_play_raw_fn = NULL;
+static void* g_play_raw_ctx = NULL;
+
+/* Next record header, without consuming it. @return 0 at end of stream */
+static int replay_peek(replay_record_t* rec, size_t* head_len) {
+    if (g_play_pos >= g_play_used) return 0;
+
+    const uint8_t* p = g_play_data + g_play_pos;
+    size_t avail = g_play_used - g_play_pos;
+    uint64_t dt_us;
+
+    if (p[0] == 0) return 0;
+    size_t n = get_varint(p + 1, avail - 1, &dt_us);
+    if (n == 0) return 0;
+
+    rec->type = p[0] >> 4;
+    rec->slot = p[0] & 0x0F;
+    rec->offset_ns = g_play_offset_ns + dt_us * 1000;
+    *head_len = 1 + n;
+    return rec->slot < MAX_CONTROLLER_SLOTS;
+}
+
+/* Decode the body after the header, updating per-slot fields. @return 0 if corrupt */
+static int replay_consume(replay_record_t* rec, size_t head_len) {
+    const uint8_t* p = g_play_data + g_play_pos + head_len;
+    size_t avail = g_play_used - g_play_pos - head_len;
+    size_t n = 0;
+    uint64_t v;
+    size_t k;
+
+    if (rec->type == RECORD_TYPE_STATE) {
+        if ((k = get_varint(p, avail, &v)) == 0) return 0;
+        n += k;
+        uint32_t mask = (uint32_t)v;
+        int32_t* f = g_play_fields[rec->slot];
+
+        for (int i = 0; i < RECORD_FIELD_COUNT; i++) {
+            if (!(mask & (1u << i))) continue;
+            if ((k = get_varint(p + n, avail - n, &v)) == 0) return 0;
+            n += k;
+            f[i] = (int32_t)((uint32_t)f[i] + (uint32_t)unzigzag((uint32_t)v));
+        }
+    } else if (rec->type == RECORD_TYPE_RAW) {
+        if ((k = get_varint(p, avail, &v)) == 0 || v > avail - k) return 0;
+        rec->raw = p + k;
+        rec->raw_len = (size_t)v;
+        n = k + (size_t)v;
+    } else {
+        return 0;
+    }
+
+    g_play_pos += head_len + n;
+    g_play_offset_ns = rec->offset_ns;
+    g_play_count++;
+    return 1;
+}
+
+static void replay_deliver(const replay_record_t* rec, uint64_t now_ns) {
+    int want_raw = (g_play_flags & REPLAY_FLAG_RAW) != 0;
+
+    if (rec->type == RECORD_TYPE_RAW && want_raw) {
+        if (g_play_raw_fn) g_play_raw_fn(rec->slot, rec->raw, rec->raw_len, g_play_raw_ctx);
+    } else if (rec->type == RECORD_TYPE_STATE && !want_raw) {
+        controller_state_t state;
+        fields_to_state(g_play_fields[rec->slot], &state);
+        state.timestamp_ns = now_ns;
+        state.timestamp_ms = now_ns / 1000000ULL;
+        remap_apply(rec->slot, &state);
+        controller_slot_state_update(rec->slot, &state);
+    }
+}
+
+static void replay_finish(void) {
+    g_play_active = 0;
+    LOG_INFO("[Replay] Finished: %u records, %.3f s\n", g_play_count,
+             g_play_offset_ns / 1e9);
+}
+
+/* Release every record due by now_ns. @return Offset of the next one, or UINT64_MAX */
+static uint64_t replay_advance(uint64_t now_ns) {
+    replay_record_t rec;
+    size_t head_len;
+
+    while (replay_peek(&rec, &head_len)) {
+        if (g_play_base_ns + rec.offset_ns > now_ns) return rec.offset_ns;
+        if (!replay_consume(&rec, head_len)) break;
+        replay_deliver(&rec, now_ns);
+    }
+
+    if (g_play_pos < g_play_used && g_play_data[g_play_pos] != 0) {
+        LOG_WARN("[Replay] Warning: Corrupt record at offset %zu\n", g_play_pos);
+    }
+    replay_finish();
+    return UINT64_MAX;
+}
+
+static void timer_arm(uint64_t abs_ns) {
+    struct itimerspec its = {0};
+    if (abs_ns != UINT64_MAX) {
+        its.it_value.tv_sec = (time_t)(abs_ns / 1000000000ULL);
+        its.it_value.tv_nsec = (long)(abs_ns % 1000000000ULL);
+    }
+    timerfd_settime(g_play_timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void on_replay_timer(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0) return;
+    if (!g_play_active) return;
+
+    uint64_t next = replay_advance(time_get_ns());
+    timer_arm(next == UINT64_MAX ? UINT64_MAX : g_play_base_ns + next);
+}
+
+int replay_open(const char* path, int flags) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("[Replay] Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(record_header_t)) {
+        LOG_ERROR("[Replay] Error: %s is not a recording\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("[Replay] mmap: %s\n", strerror(errno));
+        return -1;
+    }
+
+    const record_header_t* hdr = map;
+    size_t avail = (size_t)st.st_size - sizeof(record_header_t);
+    const char* err = NULL;
+
+    if (hdr->magic != RECORD_MAGIC) {
+        err = "not a recording";
+    } else if (hdr->version != RECORD_VERSION) {
+        err = "unsupported version";
+    } else if ((flags & REPLAY_FLAG_RAW) && !(hdr->flags & RECORD_FLAG_RAW)) {
+        err = "recorded without raw reports";
+    }
+    if (err) {
+        LOG_ERROR("[Replay] Error: %s: %s\n", path, err);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    g_play_map = map;
+    g_play_map_size = (size_t)st.st_size;
+    g_play_data = (const uint8_t*)map + sizeof(record_header_t);
+    g_play_used = hdr->used < avail ? (size_t)hdr->used : avail;
+    g_play_pos = 0;
+    g_play_flags = flags;
+    g_play_count = 0;
+    g_play_offset_ns = 0;
+    memset(g_play_fields, 0, sizeof(g_play_fields));
+
+    /* Playback owns the slots from here, so live input is dropped right away */
+    g_play_active = 1;
+
+    LOG_INFO("[Replay] %s: %u records, %zu bytes (%s, %s)\n", path, hdr->record_count,
+             g_play_used, (flags & REPLAY_FLAG_RAW) ? "raw reports" : "states",
+             (flags & REPLAY_FLAG_SYNC_USB) ? "USB poll sync" : "timer");
+    return 0;
+}
+
+int replay_attach(event_loop_t* loop, replay_raw_fn raw_fn, void* ctx) {
+    if (!g_play_map) return -1;
+
+    g_play_raw_fn = raw_fn;
+    g_play_raw_ctx = ctx;
+
+    /* Synced playback starts its clock at the first host poll instead */
+    if (g_play_flags & REPLAY_FLAG_SYNC_USB) return 0;
+
+    g_play_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_play_timer_fd < 0) {
+        LOG_ERROR("[Replay] timerfd_create: %s\n", strerror(errno));
+        return -1;
+    }
+    if (event_loop_add(loop, g_play_timer_fd, EPOLLIN, on_replay_timer, NULL) < 0) {
+        close(g_play_timer_fd);
+        g_play_timer_fd = -1;
+        return -1;
+    }
+    g_play_loop = loop;
+
+    /* First record plays immediately */
+    g_play_base_ns = time_get_ns();
+    timer_arm(g_play_base_ns);
+    return 0;
+}
+
+void replay_detach(void) {
+    if (g_play_timer_fd >= 0) {
+        if (g_play_loop) event_loop_remove(g_play_loop, g_play_timer_fd);
+        close(g_play_timer_fd);
+        g_play_timer_fd = -1;
+    }
+    g_play_loop = NULL;
+
+    if (g_play_map) {
+        munmap((void*)g_play_map, g_play_map_size);
+        g_play_map = NULL;
+        g_play_data = NULL;
+    }
+    g_play_active = 0;
+}
+
+int replay_is_active(void) {
+    return g_play_active;
+}
+
+void replay_host_poll(uint64_t poll_ns) {
+    if (!g_play_active || !(g_play_flags & REPLAY_FLAG_SYNC_USB)) return;
+
+    if (g_play_base_ns == 0) g_play_base_ns = poll_ns;
+    replay_advance(poll_ns);
+}
@@ -0,0 +1,235 @@
+/*
+ * RosettaPad - Remap / Macro Stage
+ * =================================
+ *
+ * Table compiler and per-frame apply (see core/remap.h).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "core/remap.h"
+#include "core/common.h"
+#include "core/log.h"
+
+/* ============================================================================
+ * COMPILED TABLES
+ * ============================================================================ */
+
+typedef struct {
+    uint32_t trigger_mask;      /* 0 = unused */
+    uint8_t step_count;
+    uint8_t repeat;
+    uint32_t step_buttons[REMAP_MAX_MACRO_STEPS];
+    uint64_t step_ns[REMAP_MAX_MACRO_STEPS];
+} remap_macro_table_t;
+
+typedef struct {
+    uint32_t buttons[3][256];   /* Output mask per input byte 0, 1, 2 */
+    uint8_t axes[REMAP_AXIS_COUNT][256];
+    int macro_count;            /* Macros are packed at the front */
+    remap_macro_table_t macros[REMAP_MAX_MACROS];
+} remap_table_t;
+
+typedef struct {
+    int running;
+    int step;
+    uint64_t step_start_ns;
+    int trigger_held;
+} remap_macro_run_t;
+
+/*
+ * Triple buffer: the writer compiles into back and exchanges it with
+ * middle; the reader exchanges middle with front when it is marked fresh.
+ * Neither side ever touches the other's buffer.
+ */
+#define REMAP_FRESH 4u
+
+static remap_table_t g_tables[3];
+static uint32_t g_middle = 1;           /* Index | REMAP_FRESH */
+static int g_back = 2;                  /* Writer only */
+static int g_front = 0;                 /* Reader only */
+static pthread_mutex_t g_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Reader only - reset when a new table arrives */
+static remap_macro_run_t g_macro_run[MAX_CONTROLLER_SLOTS][REMAP_MAX_MACROS];
+
+/* ============================================================================
+ * COMPILER
+ * ============================================================================ */
+
+#define BTN_ALL_MASK ((1u << BTN_COUNT) - 1)
+
+static int is_trigger_axis(int axis) {
+    return axis == REMAP_AXIS_L2 || axis == REMAP_AXIS_R2;
+}
+
+static uint8_t curve_point(const remap_axis_t* a, int trigger, int v) {
+    int center = trigger ? 0 : 128;
+    int d = v - center;
+    int sign = d < 0 ? -1 : 1;
+    int mag = d < 0 ? -d : d;
+    int full = trigger ? 255 : (d < 0 ? 128 : 127);
+
+    int out = 0;
+    if (mag > a->deadzone && full > a->deadzone) {
+        int anti = a->anti_deadzone < full ? a->anti_deadzone : full;
+        out = anti + (mag - a->deadzone) * (full - anti) / (full - a->deadzone);
+        out = out * a->sensitivity / 100;
+        if (out > full) out = full;
+    }
+
+    int value = center + sign * out;
+
+    /* Mirror 0-255 so both ends reach full deflection; a stick at rest stays 128 */
+    if (a->invert && (trigger || out != 0)) value = 255 - value;
+    return (uint8_t)value;
+}
+
+static int compile(const remap_config_t* cfg, remap_table_t* t) {
+    uint32_t consumed = 0;
+
+    /* Macros first - their triggers drop out of the button tables */
+    t->macro_count = 0;
+    for (int m = 0; m < REMAP_MAX_MACROS; m++) {
+        const remap_macro_t* src = &cfg->macros[m];
+        if (src->trigger == REMAP_BTN_NONE || src->step_count == 0) continue;
+        if (src->trigger >= BTN_COUNT || src->step_count > REMAP_MAX_MACRO_STEPS) {
+            LOG_ERROR("[Remap] Error: Macro %d is invalid (trigger %u, %u steps)\n",
+                      m, src->trigger, src->step_count);
+            return -1;
+        }
+
+        remap_macro_table_t* dst = &t->macros[t->macro_count++];
+        dst->trigger_mask = 1u << src->trigger;
+        dst->step_count = src->step_count;
+        dst->repeat = src->repeat ? 1 : 0;
+        for (int s = 0; s < src->step_count; s++) {
+            dst->step_buttons[s] = src->steps[s].buttons & BTN_ALL_MASK;
+            dst->step_ns[s] = (uint64_t)src->steps[s].duration_ms * 1000000ULL;
+        }
+        consumed |= dst->trigger_mask;
+    }
+
+    memset(t->buttons, 0, sizeof(t->buttons));
+    for (int btn = 0; btn < BTN_COUNT; btn++) {
+        if (consumed & (1u << btn)) continue;
+
+        uint32_t target = cfg->button_map[btn] & BTN_ALL_MASK;
+        int byte = btn / 8;
+        uint32_t bit = 1u << (btn % 8);
+        for (int v = 0; v < 256; v++) {
+            if (v & bit) t->buttons[byte][v] |= target;
+        }
+    }
+
+    for (int axis = 0; axis < REMAP_AXIS_COUNT; axis++) {
+        int trigger = is_trigger_axis(axis);
+        for (int v = 0; v < 256; v++) {
+            t->axes[axis][v] = curve_point(&cfg->axes[axis], trigger, v);
+        }
+    }
+    return 0;
+}
+
+void remap_config_default(remap_config_t* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    for (int btn = 0; btn < BTN_COUNT; btn++) {
+        cfg->button_map[btn] = 1u << btn;
+    }
+    for (int axis = 0; axis < REMAP_AXIS_COUNT; axis++) {
+        cfg->axes[axis].sensitivity = 100;
+        if (!is_trigger_axis(axis)) cfg->axes[axis].deadzone = REMAP_DEFAULT_DEADZONE;
+    }
+    for (int m = 0; m < REMAP_MAX_MACROS; m++) {
+        cfg->macros[m].trigger = REMAP_BTN_NONE;
+    }
+}
+
+void remap_init(void) {
+    remap_config_t cfg;
+    remap_config_default(&cfg);
+
+    /* Nothing reads yet - seed the front buffer directly */
+    compile(&cfg, &g_tables[g_front]);
+}
+
+int remap_load(const remap_config_t* cfg) {
+    pthread_mutex_lock(&g_writer_lock);
+
+    remap_table_t* t = &g_tables[g_back];
+    if (compile(cfg, t) < 0) {
+        pthread_mutex_unlock(&g_writer_lock);
+        return -1;
+    }
+
+    uint32_t prev = __atomic_exchange_n(&g_middle, (uint32_t)g_back | REMAP_FRESH,
+                                        __ATOMIC_ACQ_REL);
+    g_back = (int)(prev & ~REMAP_FRESH);
+
+    pthread_mutex_unlock(&g_writer_lock);
+    return 0;
+}
+
+/* ============================================================================
+ * HOT PATH
+ * ============================================================================ */
+
+static uint32_t macro_step(const remap_macro_table_t* m, remap_macro_run_t* run,
+                           uint32_t raw_buttons, uint64_t now_ns) {
+    int held = (raw_buttons & m->trigger_mask) != 0;
+
+    /* Rising edge starts (or restarts) the sequence */
+    if (held && !run->trigger_held) {
+        run->running = 1;
+        run->step = 0;
+        run->step_start_ns = now_ns;
+    }
+    run->trigger_held = held;
+    if (!run->running) return 0;
+
+    /* Skip every step that has fully elapsed since the last frame */
+    while (now_ns - run->step_start_ns >= m->step_ns[run->step]) {
+        run->step_start_ns += m->step_ns[run->step];
+        if (++run->step < m->step_count) continue;
+
+        if (!(m->repeat && held)) {
+            run->running = 0;
+            return 0;
+        }
+        run->step = 0;
+        run->step_start_ns = now_ns;
+        break;
+    }
+    return m->step_buttons[run->step];
+}
+
+void remap_apply(int slot, controller_state_t* state) {
+    /* Pick up a freshly compiled table */
+    if (__atomic_load_n(&g_middle, __ATOMIC_RELAXED) & REMAP_FRESH) {
+        uint32_t prev = __atomic_exchange_n(&g_middle, (uint32_t)g_front, __ATOMIC_ACQ_REL);
+        g_front = (int)(prev & ~REMAP_FRESH);
+        memset(g_macro_run, 0, sizeof(g_macro_run));
+    }
+
+    const remap_table_t* t = &g_tables[g_front];
+    uint32_t raw = state->buttons;
+
+    uint32_t out = t->buttons[0][raw & 0xFF] |
+                   t->buttons[1][(raw >> 8) & 0xFF] |
+                   t->buttons[2][(raw >> 16) & 0xFF];
+
+    state->left_stick_x = t->axes[REMAP_AXIS_LX][state->left_stick_x];
+    state->left_stick_y = t->axes[REMAP_AXIS_LY][state->left_stick_y];
+    state->right_stick_x = t->axes[REMAP_AXIS_RX][state->right_stick_x];
+    state->right_stick_y = t->axes[REMAP_AXIS_RY][state->right_stick_y];
+    state->left_trigger = t->axes[REMAP_AXIS_L2][state->left_trigger];
+    state->right_trigger = t->axes[REMAP_AXIS_R2][state->right_trigger];
+
+    for (int m = 0; m < t->macro_count; m++) {
+        out |= macro_step(&t->macros[m], &g_macro_run[slot][m], raw, state->timestamp_ns);
+    }
+
+    state->buttons = out;
+}
@@ -0,0 +1,216 @@
+/*
+ * RosettaPad - Real-Time Threads
+ * ===============================
+ *
+ * Thread role table, memory locking and prefaulting (see core/rt.h).
+ */
+
+#define _GNU_SOURCE     /* CPU affinity, thread names */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "core/rt.h"
+#include "core/log.h"
+
+/* ============================================================================
+ * ROLE TABLE
+ *
+ * The reactor handles input, USB (ep0 and the ep1/ep2 completions) and BT
+ * sends, so it gets the top priority and a core of its own. Output comes
+ * next; the BT scan worker, the metrics server and the log drain are
+ * never latency critical and stay SCHED_OTHER. Everything not pinned
+ * shares the remaining cores.
+ * ============================================================================ */
+
+typedef struct {
+    const char* name;           /* Thread name, 15 chars max */
+    int priority;               /* SCHED_FIFO 1-99, 0 = stay SCHED_OTHER */
+    int cpu;                    /* Pinned CPU, -1 = any but the reactor CPU */
+} rt_role_config_t;
+
+#define RT_REACTOR_CPU  3       /* Pi Zero 2W: last of four cores */
+
+static const rt_role_config_t g_roles[RT_ROLE_COUNT] = {
+    [RT_ROLE_REACTOR] = {"rp-reactor", 80, RT_REACTOR_CPU},
+    [RT_ROLE_OUTPUT]  = {"rp-output",  60, -1},
+    [RT_ROLE_BT]      = {"rp-bt",       0, -1},
+    [RT_ROLE_METRICS] = {"rp-metrics",  0, -1},
+    [RT_ROLE_LOG]     = {"rp-log",      0, -1},
+};
+
+static int g_enabled = 0;
+static int g_can_fifo = 0;
+static int g_cpu_count = 1;
+
+/* ============================================================================
+ * SETUP
+ * ============================================================================ */
+
+/* Try SCHED_FIFO on the calling thread and switch straight back */
+static int probe_fifo(void) {
+    struct sched_param param = {.sched_priority = 1};
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) return 0;
+
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    return 1;
+}
+
+static int effective_cpu(const rt_role_config_t* role) {
+    return role->cpu < g_cpu_count ? role->cpu : -1;
+}
+
+/* Pinned roles get their CPU, the rest every CPU but the reactor's */
+static void role_cpu_set(const rt_role_config_t* role, cpu_set_t* set) {
+    CPU_ZERO(set);
+
+    int cpu = effective_cpu(role);
+    int reactor_cpu = effective_cpu(&g_roles[RT_ROLE_REACTOR]);
+    if (cpu >= 0) {
+        CPU_SET(cpu, set);
+        return;
+    }
+    for (int i = 0; i < g_cpu_count; i++) {
+        if (i != reactor_cpu || g_cpu_count == 1) CPU_SET(i, set);
+    }
+}
+
+int rt_init(void) {
+    int status = 0;
+
+    g_enabled = 1;
+    g_cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (g_cpu_count < 1) g_cpu_count = 1;
+
+    g_can_fifo = probe_fifo();
+    if (!g_can_fifo) {
+        struct rlimit rl;
+        getrlimit(RLIMIT_RTPRIO, &rl);
+        LOG_WARN("[RT] Warning: SCHED_FIFO not permitted (need root, CAP_SYS_NICE or "
+                 "RLIMIT_RTPRIO >= %d, have %ld) - threads stay at normal priority\n",
+                 g_roles[RT_ROLE_REACTOR].priority, (long)rl.rlim_cur);
+        status = -1;
+    }
+
+    /* Keep freed heap mapped and locked instead of trimming and refaulting */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    /* Threads started elsewhere (connect jobs) inherit a small stack and
+     * stay off the reactor CPU */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, RT_STACK_SIZE);
+    pthread_setattr_default_np(&attr);
+    pthread_attr_destroy(&attr);
+
+    static const rt_role_config_t shared = {"main", 0, -1};
+    cpu_set_t set;
+    role_cpu_set(&shared, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        struct rlimit rl;
+        getrlimit(RLIMIT_MEMLOCK, &rl);
+        LOG_WARN("[RT] Warning: mlockall failed: %s (need root, CAP_IPC_LOCK or a larger "
+                 "RLIMIT_MEMLOCK, have %ld KiB) - hot path may page fault\n",
+                 strerror(errno), (long)(rl.rlim_cur / 1024));
+        status = -1;
+    }
+
+    LOG_INFO("[RT] Real-time mode (%d CPUs):\n", g_cpu_count);
+    for (int i = 0; i < RT_ROLE_COUNT; i++) {
+        const rt_role_config_t* role = &g_roles[i];
+        int cpu = effective_cpu(role);
+        char cpu_desc[16];
+        if (cpu >= 0) {
+            snprintf(cpu_desc, sizeof(cpu_desc), "cpu %d", cpu);
+        } else {
+            snprintf(cpu_desc, sizeof(cpu_desc), "shared");
+        }
+        if (role->priority > 0 && g_can_fifo) {
+            LOG_INFO("[RT]   %-13s SCHED_FIFO %2d  %s\n", role->name, role->priority, cpu_desc);
+        } else {
+            LOG_INFO("[RT]   %-13s SCHED_OTHER    %s\n", role->name, cpu_desc);
+        }
+    }
+    return status;
+}
+
+/* ============================================================================
+ * THREADS
+ * ============================================================================ */
+
+typedef struct {
+    void* (*fn)(void*);
+    void* arg;
+    rt_role_t role;
+} rt_start_t;
+
+/* Touch the stack once so its pages are resident before the hot loop */
+static void __attribute__((noinline)) prefault_stack(void) {
+    volatile uint8_t buf[RT_STACK_PREFAULT];
+    for (size_t i = 0; i < sizeof(buf); i += 4096) {
+        buf[i] = 0;
+    }
+}
+
+static void* rt_trampoline(void* opaque) {
+    rt_start_t start = *(rt_start_t*)opaque;
+    free(opaque);
+
+    pthread_setname_np(pthread_self(), g_roles[start.role].name);
+    if (g_enabled) prefault_stack();
+    return start.fn(start.arg);
+}
+
+
+int rt_thread_create(pthread_t* tid, rt_role_t role, void* (*fn)(void*), void* arg) {
+    rt_start_t* start = malloc(sizeof(*start));
+    if (!start) return ENOMEM;
+    start->fn = fn;
+    start->arg = arg;
+    start->role = role;
+
+    if (!g_enabled) {
+        int err = pthread_create(tid, NULL, rt_trampoline, start);
+        if (err) free(start);
+        return err;
+    }
+
+    const rt_role_config_t* cfg = &g_roles[role];
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, RT_STACK_SIZE);
+
+    cpu_set_t set;
+    role_cpu_set(cfg, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+    if (cfg->priority > 0 && g_can_fifo) {
+        struct sched_param param = {.sched_priority = cfg->priority};
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int err = pthread_create(tid, &attr, rt_trampoline, start);
+    pthread_attr_destroy(&attr);
+
+    if (err == EPERM || err == EINVAL) {
+        LOG_WARN("[RT] Warning: %s refused real-time attributes (%s) - using defaults\n",
+                 cfg->name, strerror(err));
+        err = pthread_create(tid, NULL, rt_trampoline, start);
+    }
+    if (err) free(start);
+    return err;
+}
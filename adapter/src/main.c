@@ -35,13 +35,33 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 
 #include "core/common.h"
+#include "core/latency.h"
+#include "core/event_loop.h"
+#include "core/hotplug.h"
+#include "core/fsutil.h"
+#include "core/control.h"
+#include "core/record.h"
+#include "core/remap.h"
+#include "core/motion.h"
+#include "core/rt.h"
+#include "core/power.h"
+#include "core/metrics.h"
+#include "core/log.h"
 #include "controllers/controller_interface.h"
 #include "controllers/dualsense/dualsense.h"
 #include "console/ps3/ds3_emulation.h"
 #include "console/ps3/usb_gadget.h"
 #include "console/ps3/bt_hid.h"
+#include "controllers/loopback/loopback_pad.h"
+#include "console/loopback/loopback_sink.h"
 
 /* ============================================================================
  * FORWARD DECLARATIONS
@@ -51,23 +71,7 @@
 extern void controller_registry_init(void);
 extern void controller_drivers_init(void);
 extern void controller_drivers_shutdown(void);
-extern int controller_scan_devices(const controller_driver_t** out_driver);
 extern void controller_registry_print(void);
-extern void controller_set_active_driver(const controller_driver_t* driver);
-
-/* From core/common.c */
-extern void controller_set_active(int fd, const controller_driver_t* driver);
-extern void controller_clear_active(void);
-
-/* ============================================================================
- * SIGNAL HANDLER
- * ============================================================================ */
-
-static void signal_handler(int sig) {
-    (void)sig;
-    printf("\n[Main] Shutdown requested...\n");
-    g_running = 0;
-}
 
 /* ============================================================================
  * BANNER
@@ -89,241 +93,797 @@ static void print_banner(void) {
 /* ============================================================================
  * CONTROLLER INPUT THREAD
  * 
- * Generic controller polling - finds controller, reads input, updates state.
+ * The reactor: one epoll loop serves every connected pad (up to
+ * MAX_CONTROLLER_SLOTS) and parses each report the moment it arrives,
+ * so idle pads cost nothing and each extra player only adds its own
+ * reports. The PS3 side runs on the same loop - ep0 requests, the
+ * ep1/ep2 completions (a fresh DS3 report is queued right after the
+ * state update), the BT sockets and their send timer - as do the
+ * control plane, the latency stats timer and SIGINT/SIGTERM via a
+ * signalfd. With nothing to do the thread sleeps without a timeout.
+ * New controllers are picked up from hotplug uevents on the same loop;
+ * /sys/class/hidraw is only scanned at startup (or every second if
+ * netlink is missing).
  * Works with any registered controller driver.
  * ============================================================================ */
 
-static int g_controller_fd = -1;
-static const controller_driver_t* g_active_driver = NULL;
+typedef struct {
+    controller_device_t dev;
+    dev_t devnum;           /* st_rdev of the node, for hotplug removes */
+    int prev_home_pressed;
+    int in_use;
+} input_device_t;
+
+/* Indexed by slot */
+static input_device_t g_devices[MAX_CONTROLLER_SLOTS];
+static int g_device_count = 0;
 
 /* Wake button debouncing */
 static uint64_t g_last_home_press_time = 0;
 #define HOME_BUTTON_DEBOUNCE_MS 500
 
-void* controller_input_thread(void* arg) {
-    (void)arg;
-    printf("[Input] Controller input thread started\n");
+/* Controller rescan interval without hotplug events */
+#define INPUT_POLL_INTERVAL_MS 1000
+
+/* Latency stats refresh */
+#define STATS_INTERVAL_MS 1000
+
+static event_loop_t g_input_loop;
+static int g_hotplug_fd = -1;
+static int g_signal_fd = -1;    /* SIGINT/SIGTERM, opened by main() */
+static int g_stop_fd = -1;      /* Wakes the loop for shutdown from another thread */
+static int g_stats_fd = -1;
+static int g_system_fd = -1;    /* System state changes (standby parks the stats timer) */
+
+/* --loopback: virtual pad in, measuring sink instead of the PS3 out */
+static int g_loopback = 0;
+
+static void controller_disconnect(input_device_t* in) {
+    controller_device_t* dev = &in->dev;
+    LOG_INFO("[Input] Controller disconnected (player %d)\n", dev->slot + 1);
     
-    uint8_t buf[128];
-    controller_state_t state;
-    int prev_home_pressed = 0;
+    /* Output thread is done with the device once detach returns */
+    controller_slot_detach(dev->slot);
     
-    while (g_running) {
-        /* Find controller if not connected */
-        while (g_running && g_controller_fd < 0) {
-            g_controller_fd = controller_scan_devices(&g_active_driver);
-            
-            if (g_controller_fd >= 0 && g_active_driver) {
-                printf("[Input] Controller connected: %s\n", g_active_driver->info->name);
-                controller_set_active(g_controller_fd, g_active_driver);
-                controller_set_active_driver(g_active_driver);
-            } else {
-                sleep(1);
-            }
+    if (dev->driver->on_disconnect) {
+        dev->driver->on_disconnect(dev);
+    }
+    event_loop_remove(&g_input_loop, dev->fd);
+    close(dev->fd);
+    dev->fd = -1;
+    in->in_use = 0;
+    g_device_count--;
+    metrics_inc(METRIC_CONTROLLER_DISCONNECTS);
+    metrics_gauge_set(METRIC_GAUGE_CONTROLLERS, g_device_count);
+}
+
+/* Standby: only the home button is looked at */
+static void controller_handle_standby_report(input_device_t* in, const uint8_t* buf, size_t len) {
+    controller_device_t* dev = &in->dev;
+    int home_pressed;
+    
+    if (dev->driver->process_standby_input) {
+        home_pressed = dev->driver->process_standby_input(dev, buf, len);
+        if (home_pressed < 0) return;
+    } else {
+        controller_state_t state;
+        if (!dev->driver->process_input || dev->driver->process_input(dev, buf, len, &state) != 0) {
+            return;
         }
+        home_pressed = CONTROLLER_BTN_PRESSED(&state, BTN_HOME);
+    }
+    
+    /* Any pad's home button wakes - rising edge, debounced */
+    if (home_pressed && !in->prev_home_pressed) {
+        uint64_t now = time_get_ms();
         
-        if (g_controller_fd < 0) break;
-        
-        /* Read input */
-        ssize_t n = read(g_controller_fd, buf, sizeof(buf));
-        
-        if (n < 0) {
-            if (errno == EAGAIN) {
-                usleep(1000);
+        if (now - g_last_home_press_time >= HOME_BUTTON_DEBOUNCE_MS) {
+            LOG_INFO("[Input] Home button pressed (player %d) - waking PS3\n",
+                     dev->slot + 1);
+            g_last_home_press_time = now;
+            system_exit_standby();
+        } else {
+            LOG_INFO("[Input] Home button ignored (debounce)\n");
+        }
+    }
+    
+    in->prev_home_pressed = home_pressed;
+}
+
+static void controller_handle_report(input_device_t* in, const uint8_t* buf, size_t len,
+                                     uint64_t read_ns) {
+    controller_device_t* dev = &in->dev;
+    controller_state_t state;
+    
+    if (system_is_standby()) {
+        controller_handle_standby_report(in, buf, len);
+        return;
+    }
+    
+    /* Parse input */
+    if (!dev->driver->process_input) {
+        return;
+    }
+    
+    if (dev->driver->process_input(dev, buf, len, &state) != 0) {
+        metrics_inc(METRIC_HIDRAW_PARSE_ERRORS);
+        return;
+    }
+    
+    state.timestamp_ns = read_ns;
+    motion_apply(dev->slot, &state);
+    latency_record_span(LATENCY_STAGE_PARSE, read_ns, time_get_ns());
+    record_state(dev->slot, &state);
+    
+    /* Normal operation - remap, then update state */
+    in->prev_home_pressed = CONTROLLER_BTN_PRESSED(&state, BTN_HOME);
+    remap_apply(dev->slot, &state);
+    controller_slot_state_update(dev->slot, &state);
+}
+
+static void on_controller_event(int fd, uint32_t events, void* ctx) {
+    input_device_t* in = ctx;
+    uint8_t buf[128];
+    
+    /* Drain every queued report - fd is non-blocking */
+    if (events & EPOLLIN) {
+        for (;;) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            uint64_t read_ns = time_get_ns();
+            
+            if (n > 0) {
+                metrics_inc(METRIC_HIDRAW_REPORTS);
+                
+                /* A replay owns the slots - live reports are drained unused */
+                if (replay_is_active()) continue;
+                
+                record_raw(in->dev.slot, buf, n, read_ns);
+                controller_handle_report(in, buf, n, read_ns);
                 continue;
             }
-            
-            /* Disconnected */
-            printf("[Input] Controller disconnected\n");
-            if (g_active_driver && g_active_driver->on_disconnect) {
-                g_active_driver->on_disconnect();
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                break;
             }
-            close(g_controller_fd);
-            g_controller_fd = -1;
-            controller_clear_active();
-            controller_set_active_driver(NULL);
-            g_active_driver = NULL;
-            continue;
+            
+            /* Read error or EOF - device is gone */
+            controller_disconnect(in);
+            return;
         }
-        
-        if (n == 0) {
-            usleep(1000);
-            continue;
+    }
+    
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        controller_disconnect(in);
+    }
+}
+
+static input_device_t* find_device_by_node(dev_t devnum) {
+    if (devnum == 0) return NULL;
+    for (int i = 0; i < MAX_CONTROLLER_SLOTS; i++) {
+        if (g_devices[i].in_use && g_devices[i].devnum == devnum) return &g_devices[i];
+    }
+    return NULL;
+}
+
+/* Open a node with its driver and give it the first free slot */
+static int controller_open(const char* path, const controller_driver_t* driver) {
+    struct stat st;
+    if (stat(path, &st) == 0 && find_device_by_node(st.st_rdev)) {
+        return 0;  /* Already ours */
+    }
+    
+    input_device_t* in = NULL;
+    for (int i = 0; i < MAX_CONTROLLER_SLOTS; i++) {
+        if (!g_devices[i].in_use) {
+            in = &g_devices[i];
+            break;
         }
+    }
+    if (!in) {
+        LOG_INFO("[Input] All %d player slots in use - ignoring %s\n",
+                 MAX_CONTROLLER_SLOTS, path);
+        return -1;
+    }
+    
+    controller_device_t* dev = &in->dev;
+    dev->driver = driver;
+    dev->fd = -1;
+    dev->slot = (int)(in - g_devices);
+    dev->priv = NULL;
+    
+    if (!driver->open_device || driver->open_device(dev, path) < 0) {
+        return -1;
+    }
+    
+    int flags = fcntl(dev->fd, F_GETFL);
+    fcntl(dev->fd, F_SETFL, flags | O_NONBLOCK);
+    
+    if (event_loop_add(&g_input_loop, dev->fd, EPOLLIN, on_controller_event, in) < 0) {
+        if (driver->on_disconnect) driver->on_disconnect(dev);
+        close(dev->fd);
+        return -1;
+    }
+    
+    in->devnum = (fstat(dev->fd, &st) == 0) ? st.st_rdev : 0;
+    in->prev_home_pressed = 0;
+    in->in_use = 1;
+    g_device_count++;
+    metrics_inc(METRIC_CONTROLLER_CONNECTS);
+    metrics_gauge_set(METRIC_GAUGE_CONTROLLERS, g_device_count);
+    
+    /* Until the console assigns one, show the slot's player number */
+    controller_output_t output;
+    controller_slot_output_copy(dev->slot, &output);
+    output.player_leds = ds3_player_led_mask(dev->slot + 1);
+    controller_slot_output_update(dev->slot, &output);
+    
+    controller_slot_attach(dev);
+    LOG_INFO("[Input] Controller connected: %s (player %d)\n", driver->info->name,
+             dev->slot + 1);
+    return 0;
+}
+
+static int on_scan_match(const char* path, const controller_driver_t* driver, void* ctx) {
+    (void)ctx;
+    controller_open(path, driver);
+    return g_device_count >= MAX_CONTROLLER_SLOTS;
+}
+
+/* Full scan for every supported node not yet open */
+static void controller_connect(void) {
+    if (g_device_count >= MAX_CONTROLLER_SLOTS) return;
+    controller_scan_devices(on_scan_match, NULL);
+}
+
+/* Replayed raw reports go through the driver of the pad in that slot */
+static void on_replay_raw(int slot, const uint8_t* buf, size_t len, void* ctx) {
+    (void)ctx;
+    input_device_t* in = &g_devices[slot];
+    if (!in->in_use) return;  /* Parser state lives with the open device */
+    
+    controller_handle_report(in, buf, len, time_get_ns());
+}
+
+static void on_hotplug_event(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    hotplug_event_t ev;
+    int ret;
+    
+    while ((ret = hotplug_read(fd, &ev)) >= 0) {
+        if (ret == 0) continue;
         
-        /* Parse input */
-        if (!g_active_driver || !g_active_driver->process_input) {
-            continue;
+        switch (ev.action) {
+            case HOTPLUG_ADD:
+                if (!ev.has_ids) break;
+                {
+                    const controller_driver_t* driver =
+                        controller_find_driver(ev.vendor_id, ev.product_id);
+                    if (!driver) break;
+                    
+                    LOG_INFO("[Input] Hotplug: %s (%04X:%04X)\n",
+                             ev.devnode, ev.vendor_id, ev.product_id);
+                    controller_open(ev.devnode, driver);
+                }
+                break;
+            
+            case HOTPLUG_REMOVE:
+                {
+                    input_device_t* in = find_device_by_node(ev.devnum);
+                    if (in) controller_disconnect(in);
+                }
+                break;
+            
+            case HOTPLUG_RESYNC:
+                controller_connect();
+                break;
         }
-        
-        if (g_active_driver->process_input(buf, n, &state) != 0) {
-            continue;
+    }
+}
+
+static void on_signal(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    struct signalfd_siginfo info;
+    if (read(fd, &info, sizeof(info)) != (ssize_t)sizeof(info)) return;
+    
+    LOG_INFO("\n[Main] Shutdown requested...\n");
+    g_running = 0;
+}
+
+static void on_stop(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+}
+
+static void on_stats_timer(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    latency_write_stats(LATENCY_STATS_PATH);
+}
+
+static void stats_timer_arm(void) {
+    uint64_t interval_ns = system_is_standby() ? 0 : (uint64_t)STATS_INTERVAL_MS * 1000000ULL;
+    event_timer_arm(g_stats_fd, interval_ns, interval_ns);
+}
+
+static void on_system_state(int fd, uint32_t events, void* ctx) {
+    (void)events;
+    (void)ctx;
+    event_fd_drain(fd);
+    if (g_stats_fd >= 0) stats_timer_arm();
+}
+
+/* Make the reactor notice g_running == 0 */
+static void input_thread_stop(void) {
+    if (g_stop_fd < 0) return;
+    uint64_t one = 1;
+    ssize_t ret = write(g_stop_fd, &one, sizeof(one));
+    (void)ret;
+}
+
+void* controller_input_thread(void* arg) {
+    (void)arg;
+    LOG_INFO("[Input] Controller input thread started\n");
+    
+    if (event_loop_init(&g_input_loop) < 0) {
+        return NULL;
+    }
+    
+    /* Shutdown: signals, and a nudge from main (loopback) */
+    if (g_signal_fd >= 0) {
+        event_loop_add(&g_input_loop, g_signal_fd, EPOLLIN, on_signal, NULL);
+    }
+    if (g_stop_fd >= 0) {
+        event_loop_add(&g_input_loop, g_stop_fd, EPOLLIN, on_stop, NULL);
+    }
+    
+    /* Subscribe before the initial scan so no add event slips between */
+    g_hotplug_fd = hotplug_open();
+    if (g_hotplug_fd >= 0 &&
+        event_loop_add(&g_input_loop, g_hotplug_fd, EPOLLIN, on_hotplug_event, NULL) < 0) {
+        close(g_hotplug_fd);
+        g_hotplug_fd = -1;
+    }
+    if (g_hotplug_fd < 0) {
+        LOG_WARN("[Input] Warning: No hotplug events, falling back to polling\n");
+    }
+    
+    /* PS3 USB endpoints and BT share the loop - input is queued straight from here */
+    if (g_loopback) {
+        loopback_sink_attach(&g_input_loop);
+    } else {
+        if (ps3_usb_ep0_attach(&g_input_loop) < 0) {
+            LOG_WARN("[Input] Warning: USB control endpoint unavailable\n");
+        }
+        if (ps3_usb_io_attach(&g_input_loop) < 0) {
+            LOG_WARN("[Input] Warning: USB endpoint I/O unavailable\n");
+        }
+        if (ps3_bt_attach(&g_input_loop) < 0) {
+            LOG_WARN("[Input] Warning: Bluetooth not on the event loop\n");
         }
         
-        /* Handle standby mode - check for wake button with debouncing */
-        if (system_is_standby()) {
-            int home_pressed = CONTROLLER_BTN_PRESSED(&state, BTN_HOME);
-            
-            /* Detect rising edge (button just pressed) with debounce */
-            if (home_pressed && !prev_home_pressed) {
-                uint64_t now = time_get_ms();
-                
-                if (now - g_last_home_press_time >= HOME_BUTTON_DEBOUNCE_MS) {
-                    printf("[Input] Home button pressed - waking PS3\n");
-                    g_last_home_press_time = now;
-                    system_exit_standby();
-                } else {
-                    printf("[Input] Home button ignored (debounce)\n");
-                }
+        g_stats_fd = event_timer_create();
+        if (g_stats_fd >= 0) {
+            event_loop_add(&g_input_loop, g_stats_fd, EPOLLIN, on_stats_timer, NULL);
+            stats_timer_arm();
+        }
+        g_system_fd = system_state_subscribe();
+        if (g_system_fd >= 0) {
+            event_loop_add(&g_input_loop, g_system_fd, EPOLLIN, on_system_state, NULL);
+        }
+    }
+    
+    /* Control plane pings apply config on this thread */
+    control_attach(&g_input_loop);
+    
+    /* Replay (if requested) feeds the slots from here */
+    if (replay_is_active() && replay_attach(&g_input_loop, on_replay_raw, NULL) < 0) {
+        LOG_WARN("[Input] Warning: Replay could not start\n");
+        replay_detach();
+    }
+    
+    /* Pick up controllers that are already connected */
+    controller_connect();
+    
+    uint64_t last_poll_ms = time_get_ms();
+    while (g_running) {
+        /* Without hotplug events, poll for more controllers */
+        int timeout_ms = -1;
+        if (g_hotplug_fd < 0 && g_device_count < MAX_CONTROLLER_SLOTS) {
+            uint64_t now = time_get_ms();
+            if (now - last_poll_ms >= INPUT_POLL_INTERVAL_MS) {
+                last_poll_ms = now;
+                controller_connect();
             }
-            
-            prev_home_pressed = home_pressed;
-            continue;
+            timeout_ms = INPUT_POLL_INTERVAL_MS;
         }
         
-        /* Normal operation - update state */
-        prev_home_pressed = CONTROLLER_BTN_PRESSED(&state, BTN_HOME);
-        controller_state_update(&state);
+        /* Block until an fd or timer is ready */
+        event_loop_run_once(&g_input_loop, timeout_ms);
     }
     
     /* Cleanup */
-    if (g_controller_fd >= 0) {
-        close(g_controller_fd);
-        g_controller_fd = -1;
+    replay_detach();
+    record_stop();
+    control_detach();
+    if (g_loopback) {
+        loopback_sink_detach();
+    } else {
+        ps3_bt_detach();
+        ps3_usb_io_detach();
+        ps3_usb_ep0_detach();
+    }
+    if (g_stats_fd >= 0) {
+        event_loop_remove(&g_input_loop, g_stats_fd);
+        close(g_stats_fd);
+        g_stats_fd = -1;
+    }
+    if (g_system_fd >= 0) {
+        event_loop_remove(&g_input_loop, g_system_fd);
+        system_state_unsubscribe(g_system_fd);
+        close(g_system_fd);
+        g_system_fd = -1;
+    }
+    
+    /* Send stop signal to controllers while they are still bound */
+    controller_slots_enter_low_power();
+    for (int i = 0; i < MAX_CONTROLLER_SLOTS; i++) {
+        if (g_devices[i].in_use) controller_disconnect(&g_devices[i]);
     }
+    if (g_hotplug_fd >= 0) {
+        event_loop_remove(&g_input_loop, g_hotplug_fd);
+        close(g_hotplug_fd);
+        g_hotplug_fd = -1;
+    }
+    event_loop_close(&g_input_loop);
     
-    printf("[Input] Controller input thread exiting\n");
+    LOG_INFO("[Input] Controller input thread exiting\n");
     return NULL;
 }
 
+/* ============================================================================
+ * LOOPBACK TEST
+ * 
+ * Hardware-free latency run: a uhid virtual DualSense feeds the real
+ * input and output threads, and the loopback sink timestamps every DS3
+ * report where ep1 would have queued it. One table row per input rate.
+ * ============================================================================ */
+
+#define LOOPBACK_DEFAULT_SECONDS 10
+#define LOOPBACK_SETTLE_MS       200    /* Let the last reports drain */
+
+static const int loopback_rates_hz[] = {250, 500, 1000};
+
+static uint64_t rusage_cpu_ns(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+static int run_loopback(int seconds) {
+    pthread_t input_tid;
+    pthread_t output_tid;
+    int status = 0;
+    
+    if (loopback_pad_create() < 0) {
+        return 1;
+    }
+    
+    rt_thread_create(&input_tid, RT_ROLE_REACTOR, controller_input_thread, NULL);
+    rt_thread_create(&output_tid, RT_ROLE_OUTPUT, controller_output_thread, NULL);
+    
+    LOG_INFO("\n[Loopback] %d s per rate, latency = uhid write -> DS3 report built\n\n",
+             seconds);
+    LOG_INFO("%6s %7s %7s %7s %5s %9s %9s %9s %9s %6s\n", "rate", "sent", "recv",
+             "dropped", "dup", "p50 us", "p90 us", "p99 us", "max us", "cpu %");
+    
+    size_t count = sizeof(loopback_rates_hz) / sizeof(loopback_rates_hz[0]);
+    for (size_t i = 0; i < count && g_running; i++) {
+        int rate = loopback_rates_hz[i];
+        loopback_result_t res;
+        
+        loopback_sink_begin();
+        uint64_t cpu_start = rusage_cpu_ns();
+        uint64_t wall_start = time_get_ns();
+        
+        int sent = loopback_pad_run(rate, seconds);
+        usleep(LOOPBACK_SETTLE_MS * 1000);
+        
+        uint64_t cpu = rusage_cpu_ns() - cpu_start;
+        uint64_t wall = time_get_ns() - wall_start;
+        if (sent < 0) {
+            status = 1;
+            break;
+        }
+        loopback_sink_end((uint32_t)sent, &res);
+        
+        LOG_INFO("%6d %7u %7u %7u %5u %9.1f %9.1f %9.1f %9.1f %6.1f\n", rate, res.sent,
+                 res.received, res.dropped, res.duplicated, res.p50_ns / 1e3, res.p90_ns / 1e3,
+                 res.p99_ns / 1e3, res.max_ns / 1e3, 100.0 * (double)cpu / (double)wall);
+    }
+    LOG_INFO("\n");
+    
+    g_running = 0;
+    loopback_pad_destroy();
+    input_thread_stop();
+    controller_output_wake();
+    pthread_join(input_tid, NULL);
+    pthread_join(output_tid, NULL);
+    controller_drivers_shutdown();
+    return status;
+}
+
 /* ============================================================================
  * MAIN
  * ============================================================================ */
 
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --bt-rate HZ    Bluetooth input report rate (%d-%d, default %d)\n",
+           PS3_BT_MIN_RATE_HZ, PS3_BT_MAX_RATE_HZ, PS3_BT_DEFAULT_RATE_HZ);
+    printf("  --led-hidraw    Drive DualSense LEDs via output reports instead of sysfs\n");
+    printf("  --record FILE   Record controller input to FILE (%d MB preallocated)\n",
+           RECORD_DEFAULT_SIZE_MB);
+    printf("  --record-raw    Also record raw hidraw reports\n");
+    printf("  --replay FILE   Play a recording back instead of live input\n");
+    printf("  --replay-raw    Replay raw reports through the connected pad's driver\n");
+    printf("  --replay-sync   Pace the replay by PS3 USB polls instead of a timer\n");
+    printf("  --realtime      SCHED_FIFO threads, CPU pinning and locked memory\n");
+    printf("  --usb-jit       Build USB reports just before each PS3 poll\n");
+    printf("  --standby-governor GOV  CPU governor while the PS3 is off (e.g. powersave)\n");
+    printf("  --metrics-port PORT  Also serve Prometheus metrics over TCP on PORT\n");
+    printf("  --loopback      Measure latency with a virtual pad and console (needs uhid)\n");
+    printf("  --loopback-seconds N  Duration per input rate (default %d)\n",
+           LOOPBACK_DEFAULT_SECONDS);
+    printf("  -h, --help      Show this help\n");
+}
+
 int main(int argc, char* argv[]) {
-    (void)argc;
-    (void)argv;
+    static const struct option long_options[] = {
+        {"bt-rate",    required_argument, NULL, 'r'},
+        {"led-hidraw", no_argument,       NULL, 'l'},
+        {"record",     required_argument, NULL, 'R'},
+        {"record-raw", no_argument,       NULL, 'W'},
+        {"replay",     required_argument, NULL, 'P'},
+        {"replay-raw", no_argument,       NULL, 'X'},
+        {"replay-sync", no_argument,      NULL, 'S'},
+        {"loopback",   no_argument,       NULL, 'L'},
+        {"realtime",   no_argument,       NULL, 'F'},
+        {"usb-jit",    no_argument,       NULL, 'J'},
+        {"standby-governor", required_argument, NULL, 'G'},
+        {"metrics-port", required_argument, NULL, 'M'},
+        {"loopback-seconds", required_argument, NULL, 'T'},
+        {"help",       no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    int bt_rate_hz = PS3_BT_DEFAULT_RATE_HZ;
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    int record_flags = 0;
+    int replay_flags = 0;
+    int loopback_seconds = LOOPBACK_DEFAULT_SECONDS;
+    int realtime = 0;
+    int metrics_port = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'r':
+                bt_rate_hz = atoi(optarg);
+                break;
+            case 'l':
+                dualsense_set_led_backend(DS_LED_BACKEND_HIDRAW);
+                break;
+            case 'R':
+                record_path = optarg;
+                break;
+            case 'W':
+                record_flags |= RECORD_FLAG_RAW;
+                break;
+            case 'P':
+                replay_path = optarg;
+                break;
+            case 'X':
+                replay_flags |= REPLAY_FLAG_RAW;
+                break;
+            case 'S':
+                replay_flags |= REPLAY_FLAG_SYNC_USB;
+                break;
+            case 'L':
+                g_loopback = 1;
+                break;
+            case 'T':
+                loopback_seconds = atoi(optarg);
+                break;
+            case 'F':
+                realtime = 1;
+                break;
+            case 'J':
+                ps3_usb_set_jit(1);
+                break;
+            case 'G':
+                power_set_standby_governor(optarg);
+                break;
+            case 'M':
+                metrics_port = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
     
     pthread_t input_tid;
     pthread_t output_tid;
-    pthread_t usb_ctrl_tid;
-    pthread_t usb_in_tid;
-    pthread_t usb_out_tid;
     pthread_t bt_tid;
-    pthread_t bt_motion_tid;
+    pthread_t metrics_tid;
+    int metrics_running = 0;
     
     print_banner();
     
-    /* Setup signal handlers */
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    /* Shutdown signals arrive on the reactor - blocked in every thread */
+    static const int shutdown_signals[] = { SIGINT, SIGTERM };
+    g_signal_fd = event_signal_open(shutdown_signals, 2);
+    g_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
+    /* Priorities, affinity and locked memory for every thread started below */
+    if (realtime) {
+        rt_init();
+    }
+    
+    /* stdout belongs to the log drain from here on (see core/log.h) */
+    pthread_t log_tid;
+    int log_running = 0;
+    if (log_init() == 0) {
+        log_running = rt_thread_create(&log_tid, RT_ROLE_LOG, log_thread, NULL) == 0;
+    }
+    
+    /* Idle accounting starts here (see core/power.h) */
+    power_init();
     
     /* Create IPC directory */
-    system("mkdir -p /tmp/rosettapad");
+    fs_mkdir_p("/tmp/rosettapad", 0755);
+    
+    /* Pass-through remap profile until the control plane loads one */
+    remap_init();
+    motion_init();
+    
+    /* Shared-memory control plane for the web panel and tools (a stored
+     * remap profile would skew loopback numbers, so not for those) */
+    if (!g_loopback && control_init() < 0) {
+        LOG_WARN("[Main] Warning: Control plane unavailable\n");
+    }
+    
+    /* Input capture / playback, before any input can arrive */
+    if (record_path && record_start(record_path, RECORD_DEFAULT_SIZE_MB, record_flags) < 0) {
+        return 1;
+    }
+    if (replay_path && replay_open(replay_path, replay_flags) < 0) {
+        return 1;
+    }
     
     /* ========== INITIALIZATION ========== */
     
-    printf("[Main] Initializing modules...\n");
+    LOG_INFO("[Main] Initializing modules...\n");
     
     /* Initialize controller registry and drivers */
     controller_registry_init();
+    if (g_loopback) loopback_pad_register();
     controller_drivers_init();
     controller_registry_print();
     
     /* Initialize PS3 emulation */
     ds3_init();
     
+    /* No PS3, no Bluetooth - the sink stands in for the console */
+    if (g_loopback) {
+        return run_loopback(loopback_seconds);
+    }
+    
     /* Initialize PS3 Bluetooth */
     if (ps3_bt_init() < 0) {
-        printf("[Main] Warning: Bluetooth init failed - motion controls disabled\n");
+        LOG_WARN("[Main] Warning: Bluetooth init failed - motion controls disabled\n");
     }
+    ps3_bt_set_input_rate(bt_rate_hz);
     
     /* Initialize PS3 USB gadget */
     if (ps3_usb_init() < 0) {
-        fprintf(stderr, "[Main] Failed to initialize USB gadget\n");
+        LOG_ERROR("[Main] Failed to initialize USB gadget\n");
         return 1;
     }
     
     /* Open ep0 and write descriptors */
     g_ep0_fd = ps3_usb_open_endpoint(0);
     if (g_ep0_fd < 0) {
-        fprintf(stderr, "[Main] Failed to open ep0\n");
+        LOG_ERROR("[Main] Failed to open ep0\n");
         return 1;
     }
     
     if (ps3_usb_write_descriptors(g_ep0_fd) < 0) {
-        fprintf(stderr, "[Main] Failed to write USB descriptors\n");
+        LOG_ERROR("[Main] Failed to write USB descriptors\n");
         close(g_ep0_fd);
         return 1;
     }
     
     /* ========== START THREADS ========== */
     
-    printf("[Main] Starting threads...\n");
-    
-    /* Controller threads */
-    pthread_create(&input_tid, NULL, controller_input_thread, NULL);
-    pthread_create(&output_tid, NULL, controller_output_thread, NULL);
+    LOG_INFO("[Main] Starting threads...\n");
     
-    /* PS3 USB threads */
-    pthread_create(&usb_ctrl_tid, NULL, ps3_usb_control_thread, NULL);
-    pthread_create(&usb_in_tid, NULL, ps3_usb_input_thread, NULL);
-    pthread_create(&usb_out_tid, NULL, ps3_usb_output_thread, NULL);
+    /* Reactor (input, USB, BT I/O), plus the threads that may block */
+    rt_thread_create(&input_tid, RT_ROLE_REACTOR, controller_input_thread, NULL);
+    rt_thread_create(&output_tid, RT_ROLE_OUTPUT, controller_output_thread, NULL);
+    rt_thread_create(&bt_tid, RT_ROLE_BT, ps3_bt_thread, NULL);
     
-    /* PS3 Bluetooth threads */
-    pthread_create(&bt_tid, NULL, ps3_bt_thread, NULL);
-    pthread_create(&bt_motion_tid, NULL, ps3_bt_motion_thread, NULL);
+    /* Scrapes for fleet monitoring, off the reactor */
+    if (metrics_server_open(metrics_port) == 0) {
+        metrics_running = rt_thread_create(&metrics_tid, RT_ROLE_METRICS,
+                                           metrics_thread, NULL) == 0;
+    }
     
     /* Bind USB gadget */
-    printf("[Main] Binding USB gadget...\n");
+    LOG_INFO("[Main] Binding USB gadget...\n");
     if (ps3_usb_bind() < 0) {
-        fprintf(stderr, "[Main] Warning: Failed to bind USB\n");
+        LOG_WARN("[Main] Warning: Failed to bind USB\n");
     }
     
     /* ========== RUNNING ========== */
     
-    printf("\n");
-    printf("╔════════════════════════════════════════════════════════════╗\n");
-    printf("║  RosettaPad running! Press Ctrl+C to stop.                 ║\n");
-    printf("║                                                            ║\n");
-    printf("║  Connect a supported controller via Bluetooth.             ║\n");
-    printf("║  Plug USB into PS3.                                        ║\n");
-    printf("╚════════════════════════════════════════════════════════════╝\n");
-    printf("\n");
-    fflush(stdout);
+    LOG_INFO("\n");
+    LOG_INFO("╔════════════════════════════════════════════════════════════╗\n");
+    LOG_INFO("║  RosettaPad running! Press Ctrl+C to stop.                 ║\n");
+    LOG_INFO("║                                                            ║\n");
+    LOG_INFO("║  Connect a supported controller via Bluetooth.             ║\n");
+    LOG_INFO("║  Plug USB into PS3.                                        ║\n");
+    LOG_INFO("╚════════════════════════════════════════════════════════════╝\n");
+    LOG_INFO("\n");
     
-    /* Main loop - just wait for shutdown */
-    while (g_running) {
-        sleep(1);
-    }
+    /* The reactor runs until a signal or UNBIND clears g_running */
+    pthread_join(input_tid, NULL);
     
     /* ========== SHUTDOWN ========== */
     
-    printf("[Main] Shutting down...\n");
-    
-    /* Send stop signal to controller */
-    if (g_active_driver && g_active_driver->enter_low_power && g_controller_fd >= 0) {
-        g_active_driver->enter_low_power(g_controller_fd);
-    }
+    LOG_INFO("[Main] Shutting down...\n");
     
     /* Disconnect Bluetooth */
     ps3_bt_disconnect();
     
+    /* Leave the CPU governor as we found it */
+    power_exit_standby();
+    
     /* Unbind USB gadget */
     ps3_usb_unbind();
     
-    /* Wait for threads */
-    sleep(1);
+    /* Wait for the threads that may block */
+    ps3_bt_worker_stop();
+    controller_output_wake();
+    pthread_join(bt_tid, NULL);
+    pthread_join(output_tid, NULL);
+    if (metrics_running) {
+        metrics_server_stop();
+        pthread_join(metrics_tid, NULL);
+    }
     
     /* Cleanup drivers */
     controller_drivers_shutdown();
+    control_close();
     
     /* Close file descriptors */
     if (g_ep1_fd >= 0) close(g_ep1_fd);
     if (g_ep2_fd >= 0) close(g_ep2_fd);
-    if (g_controller_fd >= 0) close(g_controller_fd);
     if (g_ep0_fd >= 0) close(g_ep0_fd);
+    if (g_stop_fd >= 0) close(g_stop_fd);
+    if (g_signal_fd >= 0) close(g_signal_fd);
     
-    printf("[Main] Goodbye!\n");
+    LOG_INFO("[Main] Goodbye!\n");
+    if (log_running) {
+        log_stop();
+        pthread_join(log_tid, NULL);
+    }
     return 0;
 }
\ No newline at end of file
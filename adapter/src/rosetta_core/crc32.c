@@ -0,0 +1,71 @@
+/*
+ * RosettaPad Core - CRC32
+ * ========================
+ *
+ * Bytewise and slice-by-8 table walks (see rosetta_core/crc32.h).
+ */
+
+#include "rosetta_core/crc32.h"
+
+#define RC_CRC32_POLY   0xEDB88320u
+
+void rc_crc32_init(rc_crc32_t* crc) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t value = i;
+        for (int j = 0; j < 8; j++) {
+            value = (value >> 1) ^ ((value & 1) ? RC_CRC32_POLY : 0);
+        }
+        crc->tables[0][i] = value;
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = crc->tables[k - 1][i];
+            crc->tables[k][i] = (prev >> 8) ^ crc->tables[0][prev & 0xFF];
+        }
+    }
+}
+
+/* Both walks operate on the non-inverted register */
+static uint32_t walk_bytewise(const rc_crc32_t* crc, uint32_t value,
+                              const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        value = (value >> 8) ^ crc->tables[0][(value ^ data[i]) & 0xFF];
+    }
+    return value;
+}
+
+static uint32_t walk_slice8(const rc_crc32_t* crc, uint32_t value,
+                            const uint8_t* data, size_t len) {
+    const uint32_t (*t)[256] = crc->tables;
+
+    while (len >= 8) {
+        /* Byte-order independent loads - no alignment requirements */
+        uint32_t lo = value ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 |
+                               (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+        uint32_t hi = (uint32_t)data[4] | (uint32_t)data[5] << 8 |
+                      (uint32_t)data[6] << 16 | (uint32_t)data[7] << 24;
+
+        value = t[7][lo & 0xFF] ^
+                t[6][(lo >> 8) & 0xFF] ^
+                t[5][(lo >> 16) & 0xFF] ^
+                t[4][lo >> 24] ^
+                t[3][hi & 0xFF] ^
+                t[2][(hi >> 8) & 0xFF] ^
+                t[1][(hi >> 16) & 0xFF] ^
+                t[0][hi >> 24];
+
+        data += 8;
+        len -= 8;
+    }
+    return walk_bytewise(crc, value, data, len);
+}
+
+uint32_t rc_crc32_update(const rc_crc32_t* crc, uint32_t value, const uint8_t* data, size_t len) {
+    return ~walk_slice8(crc, ~value, data, len);
+}
+
+uint32_t rc_crc32_update_bytewise(const rc_crc32_t* crc, uint32_t value,
+                                  const uint8_t* data, size_t len) {
+    return ~walk_bytewise(crc, ~value, data, len);
+}
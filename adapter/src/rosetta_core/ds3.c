@@ -0,0 +1,424 @@
+/*
+ * RosettaPad Core - DualShock 3 Protocol
+ * =======================================
+ *
+ * Table-driven DS3 report translation and the DS3 feature/output report
+ * protocol (see rosetta_core/ds3.h).
+ */
+
+#include <string.h>
+
+#include "rosetta_core/ds3.h"
+
+/* ============================================================================
+ * INPUT REPORT TEMPLATE
+ * ============================================================================ */
+
+static const uint8_t ds3_neutral_report[DS3_INPUT_REPORT_SIZE] = {
+    /* Default neutral state */
+    0x01,       /* [0]  Report ID */
+    0x00,       /* [1]  Reserved */
+    0x00,       /* [2]  Buttons1 */
+    0x00,       /* [3]  Buttons2 */
+    0x00,       /* [4]  PS button */
+    0x00,       /* [5]  Reserved */
+    0x80,       /* [6]  Left stick X */
+    0x80,       /* [7]  Left stick Y */
+    0x80,       /* [8]  Right stick X */
+    0x80,       /* [9]  Right stick Y */
+    0x00, 0x00, 0x00, 0x00,  /* [10-13] D-pad pressure */
+    0x00, 0x00, 0x00, 0x00,  /* [14-17] Reserved */
+    0x00,       /* [18] L2 pressure */
+    0x00,       /* [19] R2 pressure */
+    0x00,       /* [20] L1 pressure */
+    0x00,       /* [21] R1 pressure */
+    0x00,       /* [22] Triangle pressure */
+    0x00,       /* [23] Circle pressure */
+    0x00,       /* [24] Cross pressure */
+    0x00,       /* [25] Square pressure */
+    0x00, 0x00, 0x00,  /* [26-28] Reserved */
+    0x02,       /* [29] Plugged status */
+    0xEE,       /* [30] Battery: charging */
+    0x12,       /* [31] Connection: USB */
+    0x00, 0x00, 0x00, 0x00,  /* [32-35] Reserved */
+    0x33, 0x04, /* [36-37] Unknown */
+    0x77, 0x01, /* [38-39] Unknown */
+    0xDE, 0x02, /* [40-41] Accel X */
+    0x35, 0x02, /* [42-43] Accel Y */
+    0x08, 0x01, /* [44-45] Accel Z */
+    0x94, 0x00, /* [46-47] Gyro Z */
+    0x02        /* [48] Final byte */
+};
+
+static const uint16_t ds3_motion_center[CONTROLLER_MOTION_OUT_AXES] = {
+    DS3_MOTION_CENTER_ACCEL, DS3_MOTION_CENTER_ACCEL, DS3_MOTION_CENTER_ACCEL,
+    DS3_MOTION_CENTER_GYRO
+};
+
+/* ============================================================================
+ * TRANSLATION TABLES
+ * 
+ * Built once per context so the per-report path is table lookups only.
+ * ============================================================================ */
+
+/* Generic button -> DS3 button byte/mask */
+static const struct {
+    uint8_t btn;
+    uint8_t offset;     /* DS3_OFF_BUTTONS1, DS3_OFF_BUTTONS2 or DS3_OFF_PS_BUTTON */
+    uint8_t mask;
+} ds3_button_map[] = {
+    {BTN_SELECT,     DS3_OFF_BUTTONS1,  DS3_BTN_SELECT},
+    {BTN_L3,         DS3_OFF_BUTTONS1,  DS3_BTN_L3},
+    {BTN_R3,         DS3_OFF_BUTTONS1,  DS3_BTN_R3},
+    {BTN_START,      DS3_OFF_BUTTONS1,  DS3_BTN_START},
+    {BTN_DPAD_UP,    DS3_OFF_BUTTONS1,  DS3_BTN_DPAD_UP},
+    {BTN_DPAD_RIGHT, DS3_OFF_BUTTONS1,  DS3_BTN_DPAD_RIGHT},
+    {BTN_DPAD_DOWN,  DS3_OFF_BUTTONS1,  DS3_BTN_DPAD_DOWN},
+    {BTN_DPAD_LEFT,  DS3_OFF_BUTTONS1,  DS3_BTN_DPAD_LEFT},
+    {BTN_L2,         DS3_OFF_BUTTONS2,  DS3_BTN_L2},
+    {BTN_R2,         DS3_OFF_BUTTONS2,  DS3_BTN_R2},
+    {BTN_L1,         DS3_OFF_BUTTONS2,  DS3_BTN_L1},
+    {BTN_R1,         DS3_OFF_BUTTONS2,  DS3_BTN_R1},
+    {BTN_NORTH,      DS3_OFF_BUTTONS2,  DS3_BTN_TRIANGLE},
+    {BTN_EAST,       DS3_OFF_BUTTONS2,  DS3_BTN_CIRCLE},
+    {BTN_SOUTH,      DS3_OFF_BUTTONS2,  DS3_BTN_CROSS},
+    {BTN_WEST,       DS3_OFF_BUTTONS2,  DS3_BTN_SQUARE},
+    {BTN_HOME,       DS3_OFF_PS_BUTTON, DS3_BTN_PS},
+};
+
+static void build_tables(rc_ds3_t* ds3) {
+    memset(ds3->button_lut, 0, sizeof(ds3->button_lut));
+    
+    for (size_t i = 0; i < sizeof(ds3_button_map) / sizeof(ds3_button_map[0]); i++) {
+        int bit = ds3_button_map[i].btn;
+        int chunk = bit / DS3_BTN_CHUNK_BITS;
+        int chunk_bit = bit % DS3_BTN_CHUNK_BITS;
+        uint32_t packed = (uint32_t)ds3_button_map[i].mask <<
+                          (8 * (ds3_button_map[i].offset - DS3_OFF_BUTTONS1));
+        
+        for (int v = 0; v < (1 << DS3_BTN_CHUNK_BITS); v++) {
+            if (v & (1 << chunk_bit)) ds3->button_lut[chunk][v] |= packed;
+        }
+    }
+    
+    /* Pressure bytes 10-13 follow d-pad up/right/down/left (bits 4-7) */
+    for (int v = 0; v < 16; v++) {
+        for (int i = 0; i < 4; i++) {
+            ds3->dpad_pressure_lut[v][i] = (v & (1 << i)) ? 0xFF : 0x00;
+        }
+    }
+    
+    /* Pressure bytes 20-25 follow L1/R1/triangle/circle/cross/square (bits 2-7) */
+    for (int v = 0; v < 64; v++) {
+        for (int i = 0; i < 6; i++) {
+            ds3->face_pressure_lut[v][i] = (v & (1 << i)) ? 0xFF : 0x00;
+        }
+    }
+    
+    for (int level = 0; level < 256; level++) {
+        uint8_t value;
+        if (level <= 5)       value = DS3_BATTERY_SHUTDOWN;
+        else if (level <= 15) value = DS3_BATTERY_DYING;
+        else if (level <= 35) value = DS3_BATTERY_LOW;
+        else if (level <= 60) value = DS3_BATTERY_MEDIUM;
+        else if (level <= 85) value = DS3_BATTERY_HIGH;
+        else                  value = DS3_BATTERY_FULL;
+        ds3->battery_lut[level] = value;
+    }
+}
+
+/* ============================================================================
+ * FEATURE REPORT TEMPLATES
+ * ============================================================================ */
+
+/* Report 0x01 - Capabilities */
+static const uint8_t template_01[DS3_FEATURE_REPORT_SIZE] = {
+    0x00, 0x01, 0x04, 0x00, 0x08, 0x0C, 0x01, 0x02,
+    0x18, 0x18, 0x18, 0x18, 0x09, 0x0A, 0x10, 0x11,
+    0x12, 0x13, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+    0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x04,
+    0x04, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x01,
+    0x02, 0x07, 0x00, 0x17, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Report 0xF2 - Controller Bluetooth MAC */
+static const uint8_t template_f2[DS3_FEATURE_REPORT_SIZE] = {
+    0xF2, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x03, 0x50, 0x81, 0xD8, 0x01,
+    0x8A, 0x13, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+    0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x04,
+    0x04, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x01,
+    0x02, 0x07, 0x00, 0x17, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Report 0xF5 - Host/Pairing MAC (Pi's BT MAC) */
+static const uint8_t template_f5[DS3_FEATURE_REPORT_SIZE] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xAE, 0x60, 0x00, 0x03, 0x50, 0x81, 0xD8, 0x01,
+    0x8A, 0x13, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+    0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x04,
+    0x04, 0x04, 0x04, 0x00, 0x00, 0x04, 0x00, 0x01,
+    0x02, 0x07, 0x00, 0x17, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Report 0xF7 - Calibration */
+static const uint8_t template_f7[DS3_FEATURE_REPORT_SIZE] = {
+    0x02, 0x01, 0xF8, 0x02, 0x07, 0x02, 0xEF, 0xFF,
+    0x14, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Report 0xF8 - Status */
+static const uint8_t template_f8[DS3_FEATURE_REPORT_SIZE] = {
+    0x00, 0x02, 0x00, 0x00, 0x08, 0x00, 0x03, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Report 0xEF - Config */
+static const uint8_t template_ef[DS3_FEATURE_REPORT_SIZE] = {
+    0x00, 0xEF, 0x04, 0x00, 0x08, 0x00, 0x03, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* ============================================================================
+ * INITIALIZATION
+ * ============================================================================ */
+
+void rc_ds3_init(rc_ds3_t* ds3) {
+    build_tables(ds3);
+    
+    memcpy(ds3->report_01, template_01, DS3_FEATURE_REPORT_SIZE);
+    memcpy(ds3->report_f2, template_f2, DS3_FEATURE_REPORT_SIZE);
+    memcpy(ds3->report_f5, template_f5, DS3_FEATURE_REPORT_SIZE);
+    memcpy(ds3->report_f7, template_f7, DS3_FEATURE_REPORT_SIZE);
+    memcpy(ds3->report_f8, template_f8, DS3_FEATURE_REPORT_SIZE);
+    memcpy(ds3->report_ef, template_ef, DS3_FEATURE_REPORT_SIZE);
+    
+    memset(ds3->ps3_mac, 0, sizeof(ds3->ps3_mac));
+    ds3->ps3_mac_valid = 0;
+}
+
+void rc_ds3_neutral_report(uint8_t* out_report) {
+    memcpy(out_report, ds3_neutral_report, DS3_INPUT_REPORT_SIZE);
+}
+
+/* ============================================================================
+ * INPUT REPORT TRANSLATION
+ * ============================================================================ */
+
+static inline void put_le16(uint8_t* dst, int value) {
+    dst[0] = value & 0xFF;
+    dst[1] = (value >> 8) & 0xFF;
+}
+
+/* Fill every state-dependent byte; the rest come from the template */
+void rc_ds3_translate(const rc_ds3_t* ds3, const controller_state_t* state, uint8_t* out_report) {
+    memcpy(out_report, ds3_neutral_report, DS3_INPUT_REPORT_SIZE);
+    
+    /* --- Buttons (bytes 2-4) --- */
+    uint32_t buttons = state->buttons;
+    uint32_t chunk_mask = (1u << DS3_BTN_CHUNK_BITS) - 1;
+    uint32_t packed = ds3->button_lut[0][buttons & chunk_mask] |
+                      ds3->button_lut[1][(buttons >> DS3_BTN_CHUNK_BITS) & chunk_mask] |
+                      ds3->button_lut[2][(buttons >> (2 * DS3_BTN_CHUNK_BITS)) & chunk_mask];
+    
+    uint8_t btn1 = packed & 0xFF;
+    uint8_t btn2 = (packed >> 8) & 0xFF;
+    out_report[DS3_OFF_BUTTONS1] = btn1;
+    out_report[DS3_OFF_BUTTONS2] = btn2;
+    out_report[DS3_OFF_PS_BUTTON] = (packed >> 16) & 0xFF;
+    
+    /* --- Analog Sticks (bytes 6-9) --- */
+    out_report[DS3_OFF_LX] = state->left_stick_x;
+    out_report[DS3_OFF_LY] = state->left_stick_y;
+    out_report[DS3_OFF_RX] = state->right_stick_x;
+    out_report[DS3_OFF_RY] = state->right_stick_y;
+    
+    /* --- D-pad Pressure (bytes 10-13) --- */
+    memcpy(&out_report[10], ds3->dpad_pressure_lut[btn1 >> 4], 4);
+    
+    /* --- Trigger Pressure (bytes 18-19) --- */
+    out_report[DS3_OFF_L2_PRESSURE] = state->left_trigger;
+    out_report[DS3_OFF_R2_PRESSURE] = state->right_trigger;
+    
+    /* --- Shoulder and Face Button Pressure (bytes 20-25) --- */
+    memcpy(&out_report[20], ds3->face_pressure_lut[btn2 >> 2], 6);
+    
+    /* --- Battery Status (byte 30) - plugged/USB bytes come from the template --- */
+    uint8_t ds3_battery;
+    if (state->battery_full) {
+        ds3_battery = DS3_BATTERY_CHARGED;  /* 0xEF = fully charged */
+    } else if (state->battery_charging) {
+        ds3_battery = DS3_BATTERY_CHARGING;  /* 0xEE = charging */
+    } else {
+        ds3_battery = ds3->battery_lut[state->battery_level];
+    }
+    out_report[DS3_OFF_CHARGE] = ds3_battery;
+    
+    /* --- Motion Data (bytes 40-47) - converted once by the motion stage --- */
+    const uint16_t* motion = state->motion_valid ? state->motion_out : ds3_motion_center;
+    put_le16(&out_report[DS3_OFF_ACCEL_X], motion[0]);
+    put_le16(&out_report[DS3_OFF_ACCEL_Y], motion[1]);
+    put_le16(&out_report[DS3_OFF_ACCEL_Z], motion[2]);
+    put_le16(&out_report[DS3_OFF_GYRO_Z],  motion[3]);
+}
+
+/* ============================================================================
+ * FEATURE REPORTS
+ * ============================================================================ */
+
+void rc_ds3_set_host_mac(rc_ds3_t* ds3, const uint8_t* mac) {
+    /* Report 0xF5 bytes 2-7: Host (adapter) MAC */
+    memcpy(&ds3->report_f5[2], mac, 6);
+    
+    /* Report 0xF2 bytes 4-9: Controller MAC (same as the adapter) */
+    memcpy(&ds3->report_f2[4], mac, 6);
+}
+
+const uint8_t* rc_ds3_feature_report(const rc_ds3_t* ds3, uint8_t report_id,
+                                     const char** out_name) {
+    const char* name = "UNKNOWN";
+    const uint8_t* data = NULL;
+    
+    switch (report_id) {
+        case DS3_REPORT_CAPABILITIES:
+            data = ds3->report_01;
+            name = "Capabilities";
+            break;
+        case DS3_REPORT_BT_MAC:
+            data = ds3->report_f2;
+            name = "BT MAC";
+            break;
+        case DS3_REPORT_PAIRING:
+            data = ds3->report_f5;
+            name = "Pairing";
+            break;
+        case DS3_REPORT_CALIBRATION:
+            data = ds3->report_f7;
+            name = "Calibration";
+            break;
+        case DS3_REPORT_STATUS:
+            data = ds3->report_f8;
+            name = "Status";
+            break;
+        case DS3_REPORT_EF:
+            data = ds3->report_ef;
+            name = "EF Config";
+            break;
+    }
+    
+    if (out_name) *out_name = name;
+    return data;
+}
+
+int rc_ds3_handle_set_report(rc_ds3_t* ds3, uint8_t report_id, const uint8_t* data, size_t len) {
+    if (report_id == DS3_REPORT_PAIRING && len >= 8) {
+        /* Console sends its Bluetooth MAC */
+        memcpy(ds3->ps3_mac, &data[2], 6);
+        ds3->ps3_mac_valid = 1;
+        
+        /* GET_REPORT 0xF5 returns the paired address from now on */
+        memcpy(&ds3->report_f5[2], &data[2], 6);
+        return RC_DS3_SET_PS3_MAC;
+    }
+    if (report_id == DS3_REPORT_EF && len > 0) {
+        ds3->report_ef[0] = DS3_REPORT_EF;
+        size_t copy_len = (len > DS3_FEATURE_REPORT_SIZE - 1) ?
+                          DS3_FEATURE_REPORT_SIZE - 1 : len;
+        memcpy(&ds3->report_ef[1], data, copy_len);
+        return RC_DS3_SET_STORED;
+    }
+    return RC_DS3_SET_IGNORED;
+}
+
+/* ============================================================================
+ * OUTPUT REPORT PARSING
+ * ============================================================================ */
+
+/*
+ * Map DS3 player number to DualSense 5-LED array
+ * DualSense LEDs: [1][2][3][4][5] in a row
+ * 
+ * Player 1 -> DualSense LED 3 (center only) = 0x04
+ * Player 2 -> DualSense LEDs 2,4 (inner pair) = 0x0A
+ * Player 3 -> DualSense LEDs 1,3,5 (edges + center) = 0x15
+ * Player 4 -> DualSense LEDs 1,2,4,5 (all but center) = 0x1B
+ */
+static const uint8_t player_led_patterns[4] = {0x04, 0x0A, 0x15, 0x1B};
+
+uint8_t rc_ds3_player_led_mask(int player) {
+    if (player < 1 || player > 4) return 0;
+    return player_led_patterns[player - 1];
+}
+
+int rc_ds3_parse_output_report(const uint8_t* data, size_t len, controller_output_t* output) {
+    if (len < 6) return -1;
+    
+    /*
+     * DS3 output report format:
+     * [0] 0x01 - Report ID
+     * [1] 0x00 - Padding
+     * [2] Weak motor duration (0-255, 0x96 = 150 = indefinite)
+     * [3] Weak motor power (0 or 1)
+     * [4] Strong motor duration
+     * [5] Strong motor power (0-255)
+     * [6-9] Unknown/padding
+     * [10] LED bitmask:
+     *      Bit 1 (0x02) = LED4 / Player 1
+     *      Bit 2 (0x04) = LED3 / Player 2
+     *      Bit 3 (0x08) = LED2 / Player 3
+     *      Bit 4 (0x10) = LED1 / Player 4
+     * [11+] LED PWM parameters
+     */
+    
+    uint8_t weak_power = data[3];     /* Binary: 0 or 1 */
+    uint8_t strong_power = data[5];   /* Variable: 0-255 */
+    
+    /* Weak motor = right (high frequency), Strong motor = left (low frequency) */
+    output->rumble_right = weak_power ? 0xFF : 0x00;
+    output->rumble_left = strong_power;
+    
+    /* Player LED assignment from byte 10 if present */
+    if (len >= 11) {
+        uint8_t ds3_leds = data[10];
+        
+        /* DS3 player bit -> DualSense pattern for that player */
+        uint8_t ds_player_leds = 0;
+        
+        if (ds3_leds & 0x02) {
+            ds_player_leds = rc_ds3_player_led_mask(1);
+        } else if (ds3_leds & 0x04) {
+            ds_player_leds = rc_ds3_player_led_mask(2);
+        } else if (ds3_leds & 0x08) {
+            ds_player_leds = rc_ds3_player_led_mask(3);
+        } else if (ds3_leds & 0x10) {
+            ds_player_leds = rc_ds3_player_led_mask(4);
+        }
+        
+        if (ds_player_leds != 0) output->player_leds = ds_player_leds;
+    }
+    return 0;
+}
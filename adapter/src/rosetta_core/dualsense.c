@@ -0,0 +1,339 @@
+/*
+ * RosettaPad Core - DualSense Protocol
+ * =====================================
+ *
+ * Report decoding and encoding for the DualSense over Bluetooth (see
+ * rosetta_core/dualsense.h).
+ */
+
+#include <string.h>
+
+#include "rosetta_core/dualsense.h"
+
+static inline uint32_t get_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline int16_t get_le16s(const uint8_t* p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ds_crc(const rc_ds_t* ds, uint32_t crc, const uint8_t* data, size_t len) {
+    if (ds->crc32) return ds->crc32(crc, data, len);
+    return rc_crc32_update(ds->crc_table, crc, data, len);
+}
+
+/* CRC over the implicit HIDP header byte plus the report body */
+static uint32_t bt_report_crc(const rc_ds_t* ds, uint8_t header, const uint8_t* report) {
+    uint32_t crc = ds_crc(ds, 0, &header, 1);
+    return ds_crc(ds, crc, report, DS_BT_CRC_OFFSET);
+}
+
+static int bt_input_crc_ok(const rc_ds_t* ds, const uint8_t* buf, size_t len) {
+    /* Short reports carry no CRC */
+    if (len < DS_BT_INPUT_SIZE) return 1;
+    return bt_report_crc(ds, DS_BT_INPUT_HEADER, buf) == get_le32(&buf[DS_BT_CRC_OFFSET]);
+}
+
+void rc_ds_init(rc_ds_t* ds, rc_crc32_fn crc32, const rc_crc32_t* crc_table) {
+    memset(ds, 0, sizeof(*ds));
+    ds->crc32 = crc32;
+    ds->crc_table = crc_table;
+}
+
+/* ============================================================================
+ * INPUT
+ * ============================================================================ */
+
+void rc_ds_parse_dpad(uint8_t buttons1, controller_state_t* out_state) {
+    uint8_t dpad = buttons1 & 0x0F;
+
+    switch (dpad) {
+        case 0: /* N */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_UP);
+            break;
+        case 1: /* NE */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_UP);
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_RIGHT);
+            break;
+        case 2: /* E */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_RIGHT);
+            break;
+        case 3: /* SE */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_DOWN);
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_RIGHT);
+            break;
+        case 4: /* S */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_DOWN);
+            break;
+        case 5: /* SW */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_DOWN);
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_LEFT);
+            break;
+        case 6: /* W */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_LEFT);
+            break;
+        case 7: /* NW */
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_UP);
+            CONTROLLER_BTN_SET(out_state, BTN_DPAD_LEFT);
+            break;
+        /* 8+ = centered, no buttons */
+    }
+}
+
+/* Swipe on the touchpad drives the right stick (for pads with R3 drift) */
+static void touch_to_stick(rc_ds_t* ds, controller_state_t* out_state) {
+    if (!ds->touchpad_as_right_stick || !out_state->touch[0].active) {
+        ds->touch_was_active = 0;
+        return;
+    }
+
+    int touch_x = out_state->touch[0].x;
+    int touch_y = out_state->touch[0].y;
+
+    if (!ds->touch_was_active) {
+        /* Touch just started - record initial position */
+        ds->touch_initial_x = touch_x;
+        ds->touch_initial_y = touch_y;
+        ds->touch_was_active = 1;
+    }
+
+    /* Delta from the initial touch position -> stick value */
+    int stick_x = 128 + ((touch_x - ds->touch_initial_x) * 127) / DS_TOUCH_STICK_SPAN;
+    int stick_y = 128 + ((touch_y - ds->touch_initial_y) * 127) / DS_TOUCH_STICK_SPAN;
+
+    if (stick_x < 0) stick_x = 0;
+    if (stick_x > 255) stick_x = 255;
+    if (stick_y < 0) stick_y = 0;
+    if (stick_y > 255) stick_y = 255;
+
+    out_state->right_stick_x = (uint8_t)stick_x;
+    out_state->right_stick_y = (uint8_t)stick_y;
+}
+
+int rc_ds_parse_input(rc_ds_t* ds, const uint8_t* buf, size_t len, controller_state_t* out_state) {
+    if (len < 12 || buf[DS_OFF_REPORT_ID] != DS_BT_REPORT_ID) {
+        return -1;
+    }
+
+    /* Drop corrupted frames rather than turning them into phantom input */
+    if (!bt_input_crc_ok(ds, buf, len)) {
+        ds->crc_errors++;
+        return -1;
+    }
+
+    memset(out_state, 0, sizeof(*out_state));
+
+    /* Analog sticks - deadzone and response curves are applied by the remap stage */
+    out_state->left_stick_x = buf[DS_OFF_LX];
+    out_state->left_stick_y = buf[DS_OFF_LY];
+    out_state->right_stick_x = buf[DS_OFF_RX];
+    out_state->right_stick_y = buf[DS_OFF_RY];
+
+    /* Triggers */
+    out_state->left_trigger = buf[DS_OFF_L2];
+    out_state->right_trigger = buf[DS_OFF_R2];
+
+    /* Buttons */
+    uint8_t buttons1 = buf[DS_OFF_BUTTONS1];
+    uint8_t buttons2 = buf[DS_OFF_BUTTONS2];
+    uint8_t buttons3 = buf[DS_OFF_BUTTONS3];
+
+    rc_ds_parse_dpad(buttons1, out_state);
+
+    /* Face buttons */
+    if (buttons1 & DS_BTN1_CROSS)    CONTROLLER_BTN_SET(out_state, BTN_SOUTH);
+    if (buttons1 & DS_BTN1_CIRCLE)   CONTROLLER_BTN_SET(out_state, BTN_EAST);
+    if (buttons1 & DS_BTN1_SQUARE)   CONTROLLER_BTN_SET(out_state, BTN_WEST);
+    if (buttons1 & DS_BTN1_TRIANGLE) CONTROLLER_BTN_SET(out_state, BTN_NORTH);
+
+    /* Shoulder buttons */
+    if (buttons2 & DS_BTN2_L1) CONTROLLER_BTN_SET(out_state, BTN_L1);
+    if (buttons2 & DS_BTN2_R1) CONTROLLER_BTN_SET(out_state, BTN_R1);
+    if (buttons2 & DS_BTN2_L2) CONTROLLER_BTN_SET(out_state, BTN_L2);
+    if (buttons2 & DS_BTN2_R2) CONTROLLER_BTN_SET(out_state, BTN_R2);
+
+    /* Stick clicks */
+    if (buttons2 & DS_BTN2_L3) CONTROLLER_BTN_SET(out_state, BTN_L3);
+    if (buttons2 & DS_BTN2_R3) CONTROLLER_BTN_SET(out_state, BTN_R3);
+
+    /* Center buttons */
+    if (buttons2 & DS_BTN2_CREATE)  CONTROLLER_BTN_SET(out_state, BTN_SELECT);
+    if (buttons2 & DS_BTN2_OPTIONS) CONTROLLER_BTN_SET(out_state, BTN_START);
+    if (buttons3 & DS_BTN3_PS)      CONTROLLER_BTN_SET(out_state, BTN_HOME);
+    if (buttons3 & DS_BTN3_TOUCHPAD) CONTROLLER_BTN_SET(out_state, BTN_TOUCHPAD);
+    if (buttons3 & DS_BTN3_MUTE)    CONTROLLER_BTN_SET(out_state, BTN_MUTE);
+
+    /* Motion sensors - raw counts, calibrated by the motion stage */
+    if (len >= 28) {
+        out_state->gyro_x  = get_le16s(&buf[DS_OFF_GYRO_X]);
+        out_state->gyro_y  = get_le16s(&buf[DS_OFF_GYRO_Y]);
+        out_state->gyro_z  = get_le16s(&buf[DS_OFF_GYRO_Z]);
+        out_state->accel_x = get_le16s(&buf[DS_OFF_ACCEL_X]);
+        out_state->accel_y = get_le16s(&buf[DS_OFF_ACCEL_Y]);
+        out_state->accel_z = get_le16s(&buf[DS_OFF_ACCEL_Z]);
+    }
+
+    /* Touchpad */
+    if (len >= DS_OFF_TOUCHPAD + 4) {
+        const uint8_t* touch = &buf[DS_OFF_TOUCHPAD];
+
+        for (int i = 0; i < 2; i++) {
+            uint8_t contact = touch[i * 4];
+            out_state->touch[i].active = !(contact & DS_TOUCH_INACTIVE);
+
+            if (out_state->touch[i].active) {
+                out_state->touch[i].x = touch[i * 4 + 1] | ((touch[i * 4 + 2] & 0x0F) << 8);
+                out_state->touch[i].y = (touch[i * 4 + 2] >> 4) | (touch[i * 4 + 3] << 4);
+            }
+        }
+
+        touch_to_stick(ds, out_state);
+    }
+
+    /* Battery */
+    if (len >= DS_OFF_BATTERY + 1) {
+        uint8_t battery_byte = buf[DS_OFF_BATTERY];
+
+        /* Low 4 bits = battery level (0-10, where 10 = 100%) */
+        uint8_t battery_data = battery_byte & 0x0F;
+        out_state->battery_level = (battery_data > 10) ? 100 : battery_data * 10;
+
+        /* High 4 bits = charging status: 0x0 discharging, 0x1 charging, 0x2 full */
+        uint8_t charging_status = (battery_byte >> 4) & 0x0F;
+        out_state->battery_charging = (charging_status == 0x1 || charging_status == 0x2) ? 1 : 0;
+        out_state->battery_full = (charging_status == 0x2) ? 1 : 0;
+    }
+
+    return 0;
+}
+
+int rc_ds_parse_standby_input(const rc_ds_t* ds, const uint8_t* buf, size_t len) {
+    if (len < 12 || buf[DS_OFF_REPORT_ID] != DS_BT_REPORT_ID) {
+        return -1;
+    }
+    if (!(buf[DS_OFF_BUTTONS3] & DS_BTN3_PS)) return 0;
+
+    /* A corrupted frame must not wake the console */
+    return bt_input_crc_ok(ds, buf, len) ? 1 : -1;
+}
+
+/* ============================================================================
+ * OUTPUT
+ * ============================================================================ */
+
+void rc_ds_build_output(rc_ds_t* ds, const controller_output_t* output, uint32_t flags,
+                        uint8_t* out_report) {
+    uint8_t* report = out_report;
+    memset(report, 0, DS_BT_OUTPUT_SIZE);
+
+    report[0] = DS_BT_REPORT_ID;
+    report[1] = (ds->output_seq << 4) & 0xF0;
+    ds->output_seq = (ds->output_seq + 1) & 0x0F;
+    report[2] = 0x10;  /* Tag */
+    report[3] = 0x03;  /* Valid flags: rumble + haptics */
+    report[5] = output->rumble_right;
+    report[6] = output->rumble_left;
+
+    if (flags & RC_DS_OUT_LEDS) {
+        report[DS_OUT_OFF_VALID_FLAG1] = DS_OUT_FLAG1_LIGHTBAR | DS_OUT_FLAG1_PLAYER_LEDS;
+        if (flags & RC_DS_OUT_LIGHTBAR_SETUP) {
+            report[DS_OUT_OFF_VALID_FLAG2] = DS_OUT_FLAG2_LIGHTBAR_SETUP;
+            report[DS_OUT_OFF_LIGHTBAR_SETUP] = DS_LIGHTBAR_SETUP_LIGHT_OUT;
+        }
+        report[DS_OUT_OFF_LED_BRIGHTNESS] = 0;  /* Full */
+        report[DS_OUT_OFF_PLAYER_LEDS] = output->player_leds & 0x1F;
+        report[DS_OUT_OFF_LIGHTBAR_R] = output->led_r;
+        report[DS_OUT_OFF_LIGHTBAR_G] = output->led_g;
+        report[DS_OUT_OFF_LIGHTBAR_B] = output->led_b;
+    }
+
+    uint32_t crc = bt_report_crc(ds, DS_BT_OUTPUT_HEADER, report);
+    report[DS_BT_CRC_OFFSET]     = crc & 0xFF;
+    report[DS_BT_CRC_OFFSET + 1] = (crc >> 8) & 0xFF;
+    report[DS_BT_CRC_OFFSET + 2] = (crc >> 16) & 0xFF;
+    report[DS_BT_CRC_OFFSET + 3] = (crc >> 24) & 0xFF;
+}
+
+/* ============================================================================
+ * CALIBRATION
+ * ============================================================================ */
+
+int rc_ds_parse_calibration(const uint8_t* buf, size_t len, ds_calibration_t* calib) {
+    if (len < DS_FEATURE_REPORT_CALIBRATION_SIZE) return -1;
+
+    /* Gyroscope (Bluetooth layout) */
+    int16_t gyro_pitch_bias  = get_le16s(&buf[1]);
+    int16_t gyro_yaw_bias    = get_le16s(&buf[3]);
+    int16_t gyro_roll_bias   = get_le16s(&buf[5]);
+    int16_t gyro_pitch_plus  = get_le16s(&buf[7]);
+    int16_t gyro_yaw_plus    = get_le16s(&buf[9]);
+    int16_t gyro_roll_plus   = get_le16s(&buf[11]);
+    int16_t gyro_pitch_minus = get_le16s(&buf[13]);
+    int16_t gyro_yaw_minus   = get_le16s(&buf[15]);
+    int16_t gyro_roll_minus  = get_le16s(&buf[17]);
+    int16_t gyro_speed_plus  = get_le16s(&buf[19]);
+    int16_t gyro_speed_minus = get_le16s(&buf[21]);
+
+    /* Accelerometer */
+    int16_t acc_x_plus  = get_le16s(&buf[23]);
+    int16_t acc_x_minus = get_le16s(&buf[25]);
+    int16_t acc_y_plus  = get_le16s(&buf[27]);
+    int16_t acc_y_minus = get_le16s(&buf[29]);
+    int16_t acc_z_plus  = get_le16s(&buf[31]);
+    int16_t acc_z_minus = get_le16s(&buf[33]);
+
+    /* Gyro calibration (same formula as the kernel driver) */
+    int speed_2x = gyro_speed_plus + gyro_speed_minus;
+
+    calib->gyro[0].bias = gyro_pitch_bias;
+    calib->gyro[0].sens_numer = speed_2x * DS_GYRO_RES_PER_DEG_S;
+    calib->gyro[0].sens_denom = gyro_pitch_plus - gyro_pitch_minus;
+
+    calib->gyro[1].bias = gyro_yaw_bias;
+    calib->gyro[1].sens_numer = speed_2x * DS_GYRO_RES_PER_DEG_S;
+    calib->gyro[1].sens_denom = gyro_yaw_plus - gyro_yaw_minus;
+
+    calib->gyro[2].bias = gyro_roll_bias;
+    calib->gyro[2].sens_numer = speed_2x * DS_GYRO_RES_PER_DEG_S;
+    calib->gyro[2].sens_denom = gyro_roll_plus - gyro_roll_minus;
+
+    /* Accel calibration */
+    int range_2g;
+
+    range_2g = acc_x_plus - acc_x_minus;
+    calib->accel[0].bias = acc_x_plus - range_2g / 2;
+    calib->accel[0].sens_numer = 2 * DS_ACC_RES_PER_G;
+    calib->accel[0].sens_denom = range_2g;
+
+    range_2g = acc_y_plus - acc_y_minus;
+    calib->accel[1].bias = acc_y_plus - range_2g / 2;
+    calib->accel[1].sens_numer = 2 * DS_ACC_RES_PER_G;
+    calib->accel[1].sens_denom = range_2g;
+
+    range_2g = acc_z_plus - acc_z_minus;
+    calib->accel[2].bias = acc_z_plus - range_2g / 2;
+    calib->accel[2].sens_numer = 2 * DS_ACC_RES_PER_G;
+    calib->accel[2].sens_denom = range_2g;
+
+    /* Avoid division by zero - raw passthrough scaling instead */
+    int replaced = 0;
+    for (int i = 0; i < 3; i++) {
+        if (calib->gyro[i].sens_denom == 0) {
+            calib->gyro[i].bias = 0;
+            calib->gyro[i].sens_numer = DS_GYRO_RANGE;
+            calib->gyro[i].sens_denom = 32767;
+            replaced |= 1 << i;
+        }
+        if (calib->accel[i].sens_denom == 0) {
+            calib->accel[i].bias = 0;
+            calib->accel[i].sens_numer = DS_ACC_RANGE;
+            calib->accel[i].sens_denom = 32767;
+            replaced |= 1 << (3 + i);
+        }
+    }
+
+    calib->valid = 1;
+    return replaced;
+}